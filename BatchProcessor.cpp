@@ -0,0 +1,744 @@
+#include "BatchProcessor.h"
+#include "CornerDetection.h"
+#include "LineDetection.h"
+#include "BufferPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief Constructor for BatchProcessor class.
+ *
+ * @param options The batch configuration.
+ */
+BatchProcessor::BatchProcessor(const BatchOptions& options)
+    : options(options), nextIndex(0), processedCount(0), failedCount(0), imagesPerSecond(0.0) {
+    if (this->options.workers < 1) {
+        throw invalid_argument("Worker count must be at least 1");
+    }
+    if (this->options.decodeWorkers < 1) {
+        throw invalid_argument("Decode worker count must be at least 1");
+    }
+    if (this->options.queueCapacity < 0) {
+        throw invalid_argument("Queue capacity cannot be negative");
+    }
+    if (this->options.scale <= 0) {
+        throw invalid_argument("Scale factor must be greater than 0");
+    }
+    preprocessing = buildPipeline();
+    outputStems = outputStemsFor(this->options.inputs);
+
+    if (!this->options.maskFile.empty()) {
+        if (!this->options.regions.empty()) {
+            throw invalid_argument("--roi and --mask cannot be combined");
+        }
+        regionMask = imread(this->options.maskFile, IMREAD_GRAYSCALE);
+        if (regionMask.empty()) {
+            throw runtime_error("Error: Could not read mask: " + this->options.maskFile);
+        }
+    }
+}
+
+/**
+ * @brief Destructor for BatchProcessor class.
+ */
+BatchProcessor::~BatchProcessor() {
+}
+
+/**
+ * @brief Prints command line usage to the console.
+ */
+void BatchProcessor::printUsage(void) {
+    cout << "Usage: openCV --batch <directory|image|@list.txt> [options]\n"
+        << "  --detector corners|lines|both   Detectors to run (default: corners)\n"
+        << "  --workers N                     Detection worker threads (default: hardware concurrency)\n"
+        << "  --decoders N                    Threads reading images ahead of detection (default: 1)\n"
+        << "  --queue N                       Images held between two stages (default: one per worker)\n"
+        << "  --output DIR                    Existing directory for feature files (default: .)\n"
+        << "  --scale S                       Scale factor applied before detection (default: 1.0)\n"
+        << "  --filter none|gaussian|median   Noise filter applied before detection (default: none)\n"
+        << "  --filter-size K                 Filter aperture (default: 3 gaussian, 11 median)\n"
+        << "  --filter-backend NAME           auto|opencv|histogram|recursive|small (default: auto)\n"
+        << "  --pipeline STAGES               Preprocessing stages replacing --scale and --filter,\n"
+        << "                                  e.g. grayscale,rescale:0.5,median:5:small\n"
+        << "  --quality Q                     Harris quality level (default: 50)\n"
+        << "  --harris fused|opencv|fixed     Harris implementation (default: fused)\n"
+        << "  --lines hough|lsd               Line engine: Canny + HoughLinesP or the LSD segment detector (default: hough)\n"
+        << "  --merge-lines off|on|A,D,G      Merge collinear segments within A degrees, D pixels and gaps of G pixels\n"
+        << "                                  (default: off; on uses 3,8,10)\n"
+        << "  --nms R                         Corner non-maximum suppression radius (default: 0, off)\n"
+        << "  --grid CELL                     Corner bucketing cell size in pixels (default: 0, off)\n"
+        << "  --grid-max N                    Corners kept per bucketing cell (default: 4)\n"
+        << "  --budget N                      Report the best N corners instead of thresholding (default: 0, off)\n"
+        << "  --min-distance D                Minimum distance between budgeted corners (default: 0, off)\n"
+        << "  --front-end harris|fast         Response ranking budgeted corners (default: harris)\n"
+        << "  --fast-threshold T              FAST intensity difference threshold (default: 20)\n"
+        << "  --pyramid L                     Detect coarse-to-fine from pyramid level L (default: 0, off)\n"
+        << "  --roi X,Y,W,H                   Process only this region, repeat for more regions (default: whole image)\n"
+        << "  --mask FILE                     Process only the nonzero pixels of a mask the size of every image\n"
+        << "  --raw W,H,gray|bgr|rgb[,OFFSET] Map inputs as raw 8-bit pixels instead of decoding them; directories\n"
+        << "                                  list their .raw files (default: off, PGM and PPM are always mapped)\n"
+        << "  --format text|binary            Feature file format (default: text)\n"
+        << "  --trace FILE                    Write a Chrome trace (chrome://tracing, Perfetto) of every stage\n"
+        << "  --profile S                     Print a stage timing summary every S seconds\n"
+        << "Usage: openCV --convert <input> <output>\n"
+        << "  Converts a feature file between text (.txt) and binary (.feat), based on the input extension\n";
+}
+
+/**
+ * @brief Builds batch options from command line arguments.
+ *
+ * @param argc Argument count as received by main.
+ * @param argv Argument values as received by main.
+ * @return The parsed options.
+ */
+BatchOptions BatchProcessor::parseArguments(int argc, char** argv) {
+    BatchOptions parsed;
+    parsed.workers = max(1, static_cast<int>(thread::hardware_concurrency()));
+    string source;
+
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (i + 1 >= argc) {
+            throw invalid_argument("Missing value for argument: " + argument);
+        }
+        string value = argv[++i];
+
+        if (argument == "--batch") {
+            source = value;
+        }
+        else if (argument == "--detector") {
+            if (value == "corners") parsed.detector = BatchDetector::Corners;
+            else if (value == "lines") parsed.detector = BatchDetector::Lines;
+            else if (value == "both") parsed.detector = BatchDetector::Both;
+            else throw invalid_argument("Unknown detector: " + value);
+        }
+        else if (argument == "--workers") {
+            parsed.workers = stoi(value);
+        }
+        else if (argument == "--decoders") {
+            parsed.decodeWorkers = stoi(value);
+        }
+        else if (argument == "--queue") {
+            parsed.queueCapacity = stoi(value);
+        }
+        else if (argument == "--output") {
+            parsed.outputDirectory = value;
+        }
+        else if (argument == "--scale") {
+            parsed.scale = stod(value);
+        }
+        else if (argument == "--pipeline") {
+            parsed.pipeline = value;
+        }
+        else if (argument == "--filter") {
+            if (value == "none") parsed.filter = BatchFilter::None;
+            else if (value == "gaussian") parsed.filter = BatchFilter::Gaussian;
+            else if (value == "median") parsed.filter = BatchFilter::Median;
+            else throw invalid_argument("Unknown filter: " + value);
+        }
+        else if (argument == "--filter-size") {
+            parsed.filterSize = stoi(value);
+        }
+        else if (argument == "--filter-backend") {
+            parsed.filterBackend = NoiseFilter::parseBackend(value);
+        }
+        else if (argument == "--quality") {
+            parsed.qualityLevel = stoi(value);
+        }
+        else if (argument == "--harris") {
+            if (value == "fused") parsed.harrisEngine = HarrisEngine::Fused;
+            else if (value == "opencv") parsed.harrisEngine = HarrisEngine::OpenCV;
+            else if (value == "fixed") parsed.harrisEngine = HarrisEngine::FixedPoint;
+            else throw invalid_argument("Unknown Harris engine: " + value);
+        }
+        else if (argument == "--lines") {
+            if (value == "hough") parsed.lineEngine = LineEngine::Hough;
+            else if (value == "lsd") parsed.lineEngine = LineEngine::SegmentDetector;
+            else throw invalid_argument("Unknown line engine: " + value);
+        }
+        else if (argument == "--merge-lines") {
+            parsed.mergeLines = value != "off";
+            if (value != "on" && value != "off") {
+                parsed.mergeTolerances = SegmentMerger::parseTolerances(value);
+            }
+        }
+        else if (argument == "--nms") {
+            parsed.suppressionRadius = stoi(value);
+        }
+        else if (argument == "--grid") {
+            parsed.gridCellSize = stoi(value);
+        }
+        else if (argument == "--grid-max") {
+            parsed.maxCornersPerCell = stoi(value);
+        }
+        else if (argument == "--budget") {
+            parsed.cornerBudget = stoi(value);
+        }
+        else if (argument == "--min-distance") {
+            parsed.budgetSpacing = stoi(value);
+        }
+        else if (argument == "--front-end") {
+            if (value == "harris") parsed.budgetFrontEnd = CornerFrontEnd::Harris;
+            else if (value == "fast") parsed.budgetFrontEnd = CornerFrontEnd::Fast;
+            else throw invalid_argument("Unknown corner front-end: " + value);
+        }
+        else if (argument == "--fast-threshold") {
+            parsed.fastThreshold = stoi(value);
+        }
+        else if (argument == "--pyramid") {
+            parsed.pyramidLevels = stoi(value);
+        }
+        else if (argument == "--roi") {
+            parsed.regions.push_back(Detection::parseRegion(value));
+        }
+        else if (argument == "--mask") {
+            parsed.maskFile = value;
+        }
+        else if (argument == "--raw") {
+            parsed.rawInput = true;
+            parsed.rawLayout = MappedImage::parseLayout(value);
+        }
+        else if (argument == "--trace") {
+            parsed.traceFile = value;
+        }
+        else if (argument == "--profile") {
+            parsed.profileInterval = stod(value);
+        }
+        else if (argument == "--format") {
+            if (value == "text") parsed.binaryOutput = false;
+            else if (value == "binary") parsed.binaryOutput = true;
+            else throw invalid_argument("Unknown format: " + value);
+        }
+        else {
+            throw invalid_argument("Unknown argument: " + argument);
+        }
+    }
+
+    if (source.empty()) {
+        throw invalid_argument("No input given, use --batch <directory|image|@list.txt>");
+    }
+
+    parsed.inputs = collectInputs(source, parsed.rawInput);
+    return parsed;
+}
+
+/**
+ * @brief Collects the image files of a directory, a single image or a list file.
+ *
+ * A source starting with '@' is read as a text file holding one image path per line.
+ * Anything else is expanded with cv::glob, which lists a directory or matches a single file.
+ *
+ * @param source The directory, image path or list file.
+ * @param rawFiles True to collect ".raw" files instead of encoded images and PNM files.
+ * @return The image paths found, in a stable order.
+ */
+vector<string> BatchProcessor::collectInputs(const string& source, bool rawFiles) {
+    vector<string> inputs;
+
+    if (!source.empty() && source[0] == '@') {
+        ifstream list(source.substr(1));
+        if (!list.is_open()) {
+            throw runtime_error("Error: Could not open file list: " + source.substr(1));
+        }
+
+        string line;
+        while (getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                inputs.push_back(line);
+            }
+        }
+        return inputs;
+    }
+
+    static const char* const extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp", ".pgm", ".ppm", ".pbm", ".pnm" };
+
+    vector<String> candidates;
+    glob(source, candidates, false);
+    for (const auto& candidate : candidates) {
+        string path = candidate;
+        size_t dot = path.find_last_of('.');
+        if (dot == string::npos) {
+            continue;
+        }
+
+        string extension = path.substr(dot);
+        transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (rawFiles) {
+            if (extension == ".raw") {
+                inputs.push_back(path);
+            }
+            continue;
+        }
+        for (const char* known : extensions) {
+            if (extension == known) {
+                inputs.push_back(path);
+                break;
+            }
+        }
+    }
+
+    sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+/**
+ * @brief Processes all inputs through the stage pipeline and reports the aggregate throughput.
+ *
+ * Decode threads, detection workers and one writer run concurrently, joined by two bounded
+ * queues. Every stage is closed in order once the stage before it has finished, so each
+ * queue drains before its consumers exit. Console progress messages are disabled for the
+ * duration of the run and OpenCV's own thread pool is limited to one thread when several
+ * workers run, so images, not pixels, are what gets parallelized.
+ *
+ * @return The number of images that failed.
+ */
+int BatchProcessor::run(void) {
+    if (options.inputs.empty()) {
+        throw runtime_error("No images found to process");
+    }
+
+    bool wasVerbose = CommonProcesses::isVerbose();
+    int cvThreads = getNumThreads();
+    CommonProcesses::setVerbose(false);
+
+    const int imageCount = static_cast<int>(options.inputs.size());
+    int workerCount = min<int>(options.workers, imageCount);
+    int decoderCount = min<int>(options.decodeWorkers, imageCount);
+    if (workerCount > 1) {
+        setNumThreads(1);
+    }
+
+    nextIndex = 0;
+    processedCount = 0;
+    failedCount = 0;
+
+    const bool profiling = !options.traceFile.empty() || options.profileInterval > 0;
+    if (profiling) {
+        Profiler::reset();
+        Profiler::setSummaryInterval(options.profileInterval);
+        Profiler::setEnabled(true);
+    }
+
+    BufferPoolStats poolBefore = BufferPool::getGlobalStats();
+    int64 start = getTickCount();
+
+    const size_t capacity = options.queueCapacity > 0 ? options.queueCapacity : workerCount;
+    BoundedQueue<BatchItem> decoded(capacity);
+    BoundedQueue<BatchItem> detected(capacity);
+
+    vector<thread> decoders;
+    vector<thread> workers;
+    decoders.reserve(decoderCount);
+    workers.reserve(workerCount);
+    for (int i = 0; i < decoderCount; i++) {
+        decoders.emplace_back(&BatchProcessor::decodeLoop, this, ref(decoded));
+    }
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&BatchProcessor::detectLoop, this, ref(decoded), ref(detected));
+    }
+    thread writer(&BatchProcessor::writeLoop, this, ref(detected));
+
+    for (auto& decoder : decoders) {
+        decoder.join();
+    }
+    decoded.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    detected.close();
+    writer.join();
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    imagesPerSecond = seconds > 0 ? processedCount / seconds : 0.0;
+
+    setNumThreads(cvThreads);
+    CommonProcesses::setVerbose(wasVerbose);
+
+    cout << "Processed " << processedCount << " images (" << failedCount << " failed) in "
+        << seconds << " s with " << decoderCount << " decoders, " << workerCount << " workers and 1 writer: "
+        << imagesPerSecond << " images/sec\n"
+        << describeQueue("Decode queue", decoded.getStats()) << "\n"
+        << describeQueue("Write queue", detected.getStats()) << "\n"
+        << BufferPool::summarize(poolBefore) << "\n";
+
+    if (profiling) {
+        Profiler::setEnabled(false);
+        cout << Profiler::summary() << "\n";
+        if (!options.traceFile.empty()) {
+            Profiler::writeChromeTrace(options.traceFile);
+            cout << "Trace written to " << options.traceFile << "\n";
+        }
+    }
+
+    return failedCount;
+}
+
+/**
+ * @brief Decode stage: reads the next unclaimed image until the input list is exhausted.
+ *
+ * Blocks while the decode queue is full, so reading never runs more than the queue
+ * capacity ahead of detection.
+ *
+ * @param decoded Queue receiving the read images.
+ */
+void BatchProcessor::decodeLoop(BoundedQueue<BatchItem>& decoded) {
+    size_t index;
+    while ((index = nextIndex++) < options.inputs.size()) {
+        try {
+            if (!decoded.push(decodeImage(index))) {
+                return;
+            }
+        }
+        catch (const exception& e) {
+            reportFailure(index, e);
+        }
+    }
+}
+
+/**
+ * @brief Detection stage: preprocesses and detects until the decode queue is closed and drained.
+ *
+ * Every worker owns a copy of the preprocessing pipeline, so its buffers are reused for
+ * all images of the same size the worker processes.
+ *
+ * @param decoded Queue of read images.
+ * @param detected Queue receiving the images with their features.
+ */
+void BatchProcessor::detectLoop(BoundedQueue<BatchItem>& decoded, BoundedQueue<BatchItem>& detected) {
+    PreprocessingPipeline pipeline = preprocessing;
+    BatchItem item;
+    while (decoded.pop(item)) {
+        try {
+            detectImage(item, pipeline);
+            detected.push(move(item));
+        }
+        catch (const exception& e) {
+            reportFailure(item.index, e);
+        }
+    }
+}
+
+/**
+ * @brief Write stage: saves the features until the write queue is closed and drained.
+ *
+ * The images are released here, after their features are on disk.
+ *
+ * @param detected Queue of images with their features.
+ */
+void BatchProcessor::writeLoop(BoundedQueue<BatchItem>& detected) {
+    BatchItem item;
+    while (detected.pop(item)) {
+        try {
+            if (item.combined) {
+                saveResults(*item.combined, item.index, FeatureType::Corners);
+                saveResults(*item.combined, item.index, FeatureType::Lines);
+            }
+            if (item.corners) {
+                saveResults(*item.corners, item.index, FeatureType::Corners);
+            }
+            if (item.lines) {
+                saveResults(*item.lines, item.index, FeatureType::Lines);
+            }
+            processedCount++;
+            Profiler::tick();
+        }
+        catch (const exception& e) {
+            reportFailure(item.index, e);
+        }
+        item = BatchItem();
+    }
+}
+
+/**
+ * @brief Reads an image into the selected detectors.
+ *
+ * The image is decoded or mapped once. When both detectors run they share one combined
+ * detector if possible; otherwise the line detector shares the pixels of the corner detector,
+ * preprocessing replaces the image of each detector without writing into it.
+ *
+ * @param index Position of the image in the input list.
+ * @return The item holding the detectors.
+ */
+BatchProcessor::BatchItem BatchProcessor::decodeImage(size_t index) const {
+    const string& path = options.inputs[index];
+    double scale = preprocessing.getScaleFactor();
+    BatchItem item;
+    item.index = index;
+
+    if (canCombine()) {
+        item.combined.reset(options.rawInput
+            ? new CombinedDetection(path, options.rawLayout, path, scale) : new CombinedDetection(path, path, scale));
+        return item;
+    }
+    if (options.detector != BatchDetector::Lines) {
+        item.corners.reset(options.rawInput
+            ? new CornerDetection(path, options.rawLayout, path, scale) : new CornerDetection(path, path, scale));
+    }
+    if (options.detector != BatchDetector::Corners) {
+        if (item.corners) {
+            item.lines.reset(new LineDetection(item.corners->getImage(), path, scale));
+            item.lines->setChannelOrder(item.corners->getChannelOrder());
+        }
+        else {
+            item.lines.reset(options.rawInput
+                ? new LineDetection(path, options.rawLayout, path, scale) : new LineDetection(path, path, scale));
+        }
+    }
+    return item;
+}
+
+/**
+ * @brief Runs the selected detectors on an image.
+ *
+ * @param item The image, its detectors receive the features.
+ * @param pipeline The preprocessing pipeline of the calling worker.
+ */
+void BatchProcessor::detectImage(BatchItem& item, PreprocessingPipeline& pipeline) const {
+    TRACE_STAGE("image");
+
+    if (item.combined) {
+        CombinedDetection& combinedDetector = *item.combined;
+        combinedDetector.setQualityLevel(options.qualityLevel);
+        combinedDetector.setSuppressionRadius(options.suppressionRadius);
+        combinedDetector.setGridBucketing(options.gridCellSize, options.maxCornersPerCell);
+        combinedDetector.setSegmentMerging(options.mergeLines, options.mergeTolerances);
+        combinedDetector.preprocess(pipeline);
+        combinedDetector.detectFeatures();
+    }
+
+    if (item.corners) {
+        CornerDetection& cornerDetector = *item.corners;
+        cornerDetector.setQualityLevel(options.qualityLevel);
+        cornerDetector.setHarrisEngine(options.harrisEngine);
+        cornerDetector.setSuppressionRadius(options.suppressionRadius);
+        cornerDetector.setGridBucketing(options.gridCellSize, options.maxCornersPerCell);
+        cornerDetector.setCornerBudget(options.cornerBudget, options.budgetSpacing);
+        cornerDetector.setBudgetFrontEnd(options.budgetFrontEnd, options.fastThreshold);
+        cornerDetector.setPyramidLevels(options.pyramidLevels);
+        applyRegions(cornerDetector);
+        cornerDetector.preprocess(pipeline);
+        cornerDetector.detectFeatures();
+    }
+
+    if (item.lines) {
+        LineDetection& lineDetector = *item.lines;
+        lineDetector.setLineEngine(options.lineEngine);
+        lineDetector.setSegmentMerging(options.mergeLines, options.mergeTolerances);
+        lineDetector.setPyramidLevels(options.pyramidLevels);
+        applyRegions(lineDetector);
+        lineDetector.preprocess(pipeline);
+        lineDetector.detectFeatures();
+    }
+}
+
+/**
+ * @brief Reports an image that failed in any stage.
+ *
+ * @param index Position of the image in the input list.
+ * @param error The failure.
+ */
+void BatchProcessor::reportFailure(size_t index, const exception& error) {
+    failedCount++;
+    lock_guard<mutex> lock(errorMutex);
+    cerr << "Error : " << options.inputs[index] << " : " << error.what() << endl;
+}
+
+/**
+ * @brief Formats the counters of a stage queue.
+ *
+ * @param name The queue name.
+ * @param stats The counters.
+ * @return One summary line; the stage with the most blocked time on either side is the bottleneck.
+ */
+string BatchProcessor::describeQueue(const string& name, const BoundedQueueStats& stats) {
+    stringstream summary;
+    summary << name << ": capacity " << stats.capacity << ", mean depth " << stats.meanDepth
+        << ", max depth " << stats.maxDepth << ", producers blocked " << stats.producerWaitSeconds
+        << " s, consumers blocked " << stats.consumerWaitSeconds << " s";
+    return summary.str();
+}
+
+/**
+ * @brief Restricts a detector to the regions of interest or the mask, if any.
+ *
+ * @param detector The detector of the current image, before preprocessing.
+ */
+void BatchProcessor::applyRegions(Detection& detector) const {
+    if (!regionMask.empty()) {
+        detector.setMask(regionMask);
+    }
+    else if (!options.regions.empty()) {
+        detector.setRegions(options.regions);
+    }
+}
+
+/**
+ * @brief Builds the preprocessing pipeline from the options.
+ *
+ * Without a pipeline description the stages are grayscale conversion, rescaling and the
+ * selected filter, as in the interactive mode.
+ *
+ * @return The validated pipeline, starting with grayscale conversion.
+ */
+PreprocessingPipeline BatchProcessor::buildPipeline(void) const {
+    if (!options.pipeline.empty()) {
+        if (options.scale != 1.0 || options.filter != BatchFilter::None || options.filterSize > 0 || options.filterBackend != FilterBackend::Auto) {
+            throw invalid_argument("--pipeline replaces --scale and the --filter options, use only one of them");
+        }
+        PreprocessingPipeline parsed = PreprocessingPipeline::parse(options.pipeline);
+        if (parsed.getSteps().empty() || parsed.getSteps().front().stage != PreprocessStage::Grayscale) {
+            throw invalid_argument("Batch preprocessing pipeline must start with grayscale");
+        }
+        return parsed;
+    }
+
+    PreprocessingPipeline pipeline;
+    pipeline.grayscale();
+    if (options.scale != 1.0) {
+        pipeline.rescale(options.scale);
+    }
+    if (options.filter == BatchFilter::Gaussian) {
+        pipeline.gaussian(options.filterSize > 0 ? options.filterSize : 3, options.filterBackend);
+    }
+    else if (options.filter == BatchFilter::Median) {
+        pipeline.median(options.filterSize > 0 ? options.filterSize : 11, options.filterBackend);
+    }
+    return pipeline;
+}
+
+/**
+ * @brief Checks whether both detectors can run as one CombinedDetection pass.
+ *
+ * The combined pass feeds the fused Harris kernel and Canny from one Sobel pass, so it
+ * replaces the two detectors only where they would run exactly those engines on whole frames.
+ *
+ * @return True for both detectors with the fused Harris and Hough engines on whole frames.
+ */
+bool BatchProcessor::canCombine(void) const {
+    return options.detector == BatchDetector::Both && options.harrisEngine == HarrisEngine::Fused
+        && options.lineEngine == LineEngine::Hough && options.cornerBudget == 0 && options.pyramidLevels == 0
+        && options.regions.empty() && regionMask.empty();
+}
+
+/**
+ * @brief Saves one kind of features of a detector in the selected output format.
+ *
+ * @param detector The detector holding the features.
+ * @param index Index of the input image.
+ * @param type Feature kind, also used in the file name ("corners" or "lines").
+ */
+void BatchProcessor::saveResults(Detection& detector, size_t index, FeatureType type) const {
+    const string kind = type == FeatureType::Corners ? "corners" : "lines";
+    if (options.binaryOutput) {
+        detector.saveFeaturesBinary(outputPathFor(index, "_" + kind + ".feat"), type);
+    }
+    else {
+        detector.saveFeatures(outputPathFor(index, "_" + kind + ".txt"), type);
+    }
+}
+
+/**
+ * @brief Builds the output file name for an input image.
+ *
+ * @param index Index of the input image.
+ * @param suffix The suffix appended to the image's output stem.
+ * @return The output file path inside the output directory.
+ */
+string BatchProcessor::outputPathFor(size_t index, const string& suffix) const {
+    return options.outputDirectory + "/" + outputStems[index] + suffix;
+}
+
+/**
+ * @brief Derives a distinct output file stem for every input.
+ *
+ * The stem is the file name without its extension. Inputs whose stems collide (x.jpg and
+ * x.png, or a/img.png and b/img.png) keep the extension as "x_jpg"; names that still
+ * collide get "_1", "_2", ... in input order. Names are compared case-insensitively, so
+ * the files stay distinct on Windows as well. Renamed inputs are reported once.
+ *
+ * @param inputs The input image paths.
+ * @return One stem per input.
+ */
+vector<string> BatchProcessor::outputStemsFor(const vector<string>& inputs) {
+    auto lowered = [](string name) {
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return name;
+    };
+
+    vector<string> stems(inputs.size()), extensions(inputs.size());
+    map<string, int> stemCount;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const size_t slash = inputs[i].find_last_of("/\\");
+        stems[i] = slash == string::npos ? inputs[i] : inputs[i].substr(slash + 1);
+        const size_t dot = stems[i].find_last_of('.');
+        if (dot != string::npos) {
+            extensions[i] = stems[i].substr(dot + 1);
+            stems[i] = stems[i].substr(0, dot);
+        }
+        stemCount[lowered(stems[i])]++;
+    }
+    const vector<string> plainStems = stems;
+
+    map<string, int> nameCount;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (stemCount[lowered(stems[i])] > 1 && !extensions[i].empty()) {
+            stems[i] += "_" + extensions[i];
+        }
+        nameCount[lowered(stems[i])]++;
+    }
+
+    set<string> used;
+    map<string, int> nextIndex;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        string name = stems[i];
+        if (nameCount[lowered(stems[i])] > 1) {
+            do {
+                name = stems[i] + "_" + to_string(++nextIndex[lowered(stems[i])]);
+            } while (used.count(lowered(name)) != 0 || nameCount.count(lowered(name)) != 0);
+        }
+        used.insert(lowered(name));
+        stems[i] = name;
+    }
+
+    if (stems != plainStems) {
+        cout << "Note: input file names collide, their feature files keep the extension or an index suffix\n";
+    }
+    return stems;
+}
+
+/**
+ * @brief Gets the number of images processed successfully.
+ *
+ * @return The processed image count.
+ */
+int BatchProcessor::getProcessedCount(void) const {
+    return processedCount;
+}
+
+/**
+ * @brief Gets the number of images that failed.
+ *
+ * @return The failed image count.
+ */
+int BatchProcessor::getFailedCount(void) const {
+    return failedCount;
+}
+
+/**
+ * @brief Gets the aggregate throughput of the last run.
+ *
+ * @return Images per second.
+ */
+double BatchProcessor::getImagesPerSecond(void) const {
+    return imagesPerSecond;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "BoundedQueue.h"
+#include "CombinedDetection.h"
+#include "Detection.h"
+#include "CornerDetection.h"
+#include "LineDetection.h"
+#include "PreprocessingPipeline.h"
+
+using namespace std;
+using namespace cv;
+
+/// Detector selection for a batch run
+enum class BatchDetector { Corners, Lines, Both };
+
+/// Noise filter applied before detection in a batch run
+enum class BatchFilter { None, Gaussian, Median };
+
+/// Options for a headless batch run
+struct BatchOptions {
+    vector<string> inputs;                  ///< Image paths to process
+    bool rawInput = false;                  ///< Map every input as raw pixels of rawLayout instead of reading it as an image file
+    RawImageLayout rawLayout;               ///< Pixel layout of raw inputs
+    string outputDirectory = ".";           ///< Directory receiving the per-image feature files
+    BatchDetector detector = BatchDetector::Corners; ///< Detectors to run on every image
+    BatchFilter filter = BatchFilter::None; ///< Noise filter applied after grayscale conversion
+    int filterSize = 0;                     ///< Filter aperture, 0 keeps the filter default (Gaussian 3, median 11)
+    FilterBackend filterBackend = FilterBackend::Auto; ///< Filter implementation
+    int workers = 1;                        ///< Number of detection worker threads
+    int decodeWorkers = 1;                  ///< Number of threads reading images ahead of detection
+    int queueCapacity = 0;                  ///< Images held between two stages, 0 for one per detection worker
+    double scale = 1.0;                     ///< Scale factor applied before detection
+    string pipeline;                        ///< Preprocessing stages for PreprocessingPipeline::parse, empty builds them from scale and filter
+    int qualityLevel = 50;                  ///< Harris quality level for corner detection
+    HarrisEngine harrisEngine = HarrisEngine::Fused; ///< Harris response implementation
+    LineEngine lineEngine = LineEngine::Hough; ///< Line segment implementation
+    bool mergeLines = false;                ///< Merge collinear fragments and near-duplicate segments
+    MergeTolerances mergeTolerances;        ///< Tolerances of the segment merge
+    int suppressionRadius = 0;              ///< Corner non-maximum suppression radius, 0 disables it
+    int gridCellSize = 0;                   ///< Corner bucketing cell size, 0 disables it
+    int maxCornersPerCell = 4;              ///< Corners kept per bucketing cell
+    int cornerBudget = 0;                   ///< Best corners reported per image, 0 thresholds with the quality level
+    int budgetSpacing = 0;                  ///< Minimum distance between budgeted corners, 0 disables it
+    CornerFrontEnd budgetFrontEnd = CornerFrontEnd::Harris; ///< Response ranking the budgeted corners
+    int fastThreshold = 20;                 ///< FAST intensity difference threshold of the budget mode
+    int pyramidLevels = 0;                  ///< Coarse-to-fine pyramid levels, 0 detects at full resolution
+    vector<Rect> regions;                   ///< Regions of interest in image coordinates, empty processes whole images
+    string maskFile;                        ///< Mask image restricting detection to its nonzero pixels, empty for none
+    bool binaryOutput = false;              ///< Write binary feature files (.feat) instead of text
+    string traceFile;                       ///< Chrome trace of all stages, empty disables it
+    double profileInterval = 0.0;           ///< Seconds between stage summary lines, 0 disables them
+};
+
+/// BatchProcessor Class
+/// Runs corner and/or line detection over many images on a pool of worker threads without opening any window.
+/// Every image gets its own feature file named after the input image, e.g. "photo_corners.txt".
+/// Inputs sharing a file name keep their extension in it ("photo_png_corners.txt") and, if that
+/// is not enough, an index suffix, so no two images write the same file.
+/// Images flow through three overlapped stages joined by bounded queues: decode threads read image N+1
+/// while the detection workers run on N and a writer thread saves the features of N-1. A full queue
+/// blocks the stage feeding it, so at most 2 * queueCapacity + decodeWorkers + workers + 1 images are in flight.
+class BatchProcessor {
+public:
+    /// Constructor
+    /// @param options The batch configuration.
+    explicit BatchProcessor(const BatchOptions& options);
+
+    /// Destructor
+    ~BatchProcessor();
+
+    /// Build batch options from command line arguments
+    /// @param argc Argument count as received by main.
+    /// @param argv Argument values as received by main.
+    /// @return The parsed options.
+    static BatchOptions parseArguments(int argc, char** argv);
+
+    /// Collect the image files of a directory, a single image or a list file ("@list.txt")
+    /// @param source The directory, image path or list file.
+    /// @param rawFiles True to collect ".raw" files instead of encoded images and PNM files.
+    /// @return The image paths found.
+    static vector<string> collectInputs(const string& source, bool rawFiles = false);
+
+    /// Print command line usage to the console
+    static void printUsage(void);
+
+    /// Process all inputs and report the aggregate throughput
+    /// @return The number of images that failed.
+    int run(void);
+
+    /// Get the number of images processed successfully
+    /// @return The processed image count.
+    int getProcessedCount(void) const;
+
+    /// Get the number of images that failed
+    /// @return The failed image count.
+    int getFailedCount(void) const;
+
+    /// Get the aggregate throughput of the last run
+    /// @return Images per second.
+    double getImagesPerSecond(void) const;
+
+private:
+    /// One image on its way through the stages
+    struct BatchItem {
+        size_t index = 0;                   ///< Position in the input list
+        unique_ptr<CornerDetection> corners; ///< Corner detector holding the image, null if corners are not detected
+        unique_ptr<LineDetection> lines;    ///< Line detector holding the image, null if lines are not detected
+        unique_ptr<CombinedDetection> combined; ///< Detector of both kinds sharing one gradient pass, replaces corners and lines
+    };
+
+    /// Decode stage: read the next unclaimed images until the list is exhausted
+    /// @param decoded Queue receiving the read images.
+    void decodeLoop(BoundedQueue<BatchItem>& decoded);
+
+    /// Detection stage: preprocess and detect until the decode stage is drained
+    /// @param decoded Queue of read images.
+    /// @param detected Queue receiving the images with their features.
+    void detectLoop(BoundedQueue<BatchItem>& decoded, BoundedQueue<BatchItem>& detected);
+
+    /// Write stage: save the features until the detection stage is drained
+    /// @param detected Queue of images with their features.
+    void writeLoop(BoundedQueue<BatchItem>& detected);
+
+    /// Read an image into the selected detectors
+    /// @param index Position of the image in the input list.
+    /// @return The item holding the detectors.
+    BatchItem decodeImage(size_t index) const;
+
+    /// Run the selected detectors on an image
+    /// @param item The image, its detectors receive the features.
+    /// @param pipeline The preprocessing pipeline of the calling worker.
+    void detectImage(BatchItem& item, PreprocessingPipeline& pipeline) const;
+
+    /// Report an image that failed in any stage
+    /// @param index Position of the image in the input list.
+    /// @param error The failure.
+    void reportFailure(size_t index, const exception& error);
+
+    /// Format the counters of a stage queue
+    /// @param name The queue name.
+    /// @param stats The counters.
+    /// @return One summary line.
+    static string describeQueue(const string& name, const BoundedQueueStats& stats);
+
+    /// Restrict a detector to the regions of interest or the mask, if any
+    /// @param detector The detector of the current image.
+    void applyRegions(Detection& detector) const;
+
+    /// Build the preprocessing pipeline from the options
+    /// @return The validated pipeline, starting with grayscale conversion.
+    PreprocessingPipeline buildPipeline(void) const;
+
+    /// Check whether both detectors can run as one CombinedDetection pass
+    /// @return True for both detectors with the fused Harris and Hough engines on whole frames.
+    bool canCombine(void) const;
+
+    /// Save one kind of features of a detector in the selected output format
+    /// @param detector The detector holding the features.
+    /// @param index Index of the input image.
+    /// @param type Feature kind, also used in the file name ("corners" or "lines").
+    void saveResults(Detection& detector, size_t index, FeatureType type) const;
+
+    /// Build the output file name for an input image
+    /// @param index Index of the input image.
+    /// @param suffix The suffix appended to the image's output stem.
+    /// @return The output file path.
+    string outputPathFor(size_t index, const string& suffix) const;
+
+    /// Derive a distinct output file stem for every input
+    /// @param inputs The input image paths.
+    /// @return One stem per input, unique even on case-insensitive file systems.
+    static vector<string> outputStemsFor(const vector<string>& inputs);
+
+    BatchOptions options;                   ///< Batch configuration
+    PreprocessingPipeline preprocessing;    ///< Validated preprocessing stages, copied by every worker
+    Mat regionMask;                         ///< Mask read from the mask file, shared by every image
+    vector<string> outputStems;             ///< Distinct output file stem of every input
+    atomic<size_t> nextIndex;               ///< Index of the next image to hand out
+    atomic<int> processedCount;             ///< Images processed successfully
+    atomic<int> failedCount;                ///< Images that failed
+    double imagesPerSecond;                 ///< Throughput of the last run
+    mutex errorMutex;                       ///< Serializes error reports from the workers
+};
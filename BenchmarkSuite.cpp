@@ -0,0 +1,629 @@
+#include "BenchmarkSuite.h"
+#include "CombinedDetection.h"
+#include "CommonProcesses.h"
+#include "CornerDetection.h"
+#include "FeatureIndex.h"
+#include "FixedPointHarris.h"
+#include "HarrisKernel.h"
+#include "LineDetection.h"
+#include "NoiseFilter.h"
+#include "ProbabilisticHough.h"
+#include "SegmentMerger.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    const int medianSizes[] = { 3, 5, 11, 21 };     // kernel sizes of the per-backend median stages
+    const int gaussianSizes[] = { 3, 5, 15, 31 };   // kernel sizes of the per-backend Gaussian stages
+    const FilterBackend filterBackends[] = { FilterBackend::OpenCV, FilterBackend::Histogram, FilterBackend::Recursive, FilterBackend::Small };
+
+    /// Default allocator wrapper counting every Mat allocation made while it is installed.
+    /// The allocated UMatData keeps the wrapped allocator, so Mats outliving the benchmark
+    /// are released correctly after the wrapper is uninstalled.
+    class CountingAllocator : public MatAllocator {
+    public:
+        explicit CountingAllocator(MatAllocator* inner) : inner(inner), count(0), bytes(0) {
+        }
+
+        UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+            AccessFlag flags, UMatUsageFlags usageFlags) const override {
+            if (!data) {
+                size_t total = CV_ELEM_SIZE(type);
+                for (int i = 0; i < dims; i++) {
+                    total *= sizes[i];
+                }
+                count++;
+                bytes += total;
+            }
+            return inner->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        }
+
+        bool allocate(UMatData* data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override {
+            return inner->allocate(data, accessFlags, usageFlags);
+        }
+
+        void deallocate(UMatData* data) const override {
+            inner->deallocate(data);
+        }
+
+        MatAllocator* inner;
+        mutable atomic<size_t> count;
+        mutable atomic<size_t> bytes;
+    };
+
+    /// Escape a string for a JSON value
+    string jsonString(const string& text) {
+        string escaped = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+}
+
+/**
+ * @brief Constructor for BenchmarkSuite class.
+ *
+ * @param options The benchmark configuration.
+ */
+BenchmarkSuite::BenchmarkSuite(const BenchmarkOptions& options) : options(options) {
+    if (this->options.iterations < 0) {
+        throw invalid_argument("Iteration count cannot be negative");
+    }
+    if (this->options.minSeconds <= 0) {
+        throw invalid_argument("Minimum time per stage must be greater than 0");
+    }
+    for (int height : this->options.heights) {
+        if (height < 16) {
+            throw invalid_argument("Synthetic image height must be at least 16");
+        }
+    }
+}
+
+/**
+ * @brief Destructor for BenchmarkSuite class.
+ */
+BenchmarkSuite::~BenchmarkSuite() {
+}
+
+/**
+ * @brief Prints command line usage to the console.
+ */
+void BenchmarkSuite::printUsage(void) {
+    cout << "Usage: openCV --bench [options]\n"
+        << "  --sizes H1,H2,...               Heights of the synthetic 16:9 images (default: 480,1080)\n"
+        << "  --images A,B,...                Image files to include, missing ones are skipped\n"
+        << "                                  (default: resim.png,RGBvalues.jpg, 'none' for synthetic only)\n"
+        << "  --iterations N                  Timed calls per stage (default: 0, until --min-time)\n"
+        << "  --min-time S                    Minimum timed seconds per stage (default: 0.5)\n"
+        << "  --stage NAME                    Only run stages whose name contains NAME\n"
+        << "  --output FILE                   Result file (default: benchmark.json)\n"
+        << "  --format json|csv               Result format (default: from the file extension)\n"
+        << "  --seed N                        Synthetic image seed (default: 42)\n";
+}
+
+/**
+ * @brief Builds benchmark options from command line arguments.
+ *
+ * @param argc Argument count as received by main.
+ * @param argv Argument values as received by main, starting with --bench.
+ * @return The parsed options.
+ */
+BenchmarkOptions BenchmarkSuite::parseArguments(int argc, char** argv) {
+    BenchmarkOptions parsed;
+    bool formatGiven = false;
+
+    auto splitList = [](const string& value) {
+        vector<string> items;
+        stringstream tokens(value);
+        string token;
+        while (getline(tokens, token, ',')) {
+            if (!token.empty()) {
+                items.push_back(token);
+            }
+        }
+        return items;
+    };
+
+    for (int i = 2; i < argc; i++) {
+        string argument = argv[i];
+        if (i + 1 >= argc) {
+            throw invalid_argument("Missing value for argument: " + argument);
+        }
+        string value = argv[++i];
+
+        if (argument == "--sizes") {
+            parsed.heights.clear();
+            for (const auto& height : splitList(value)) {
+                parsed.heights.push_back(stoi(height));
+            }
+        }
+        else if (argument == "--images") {
+            parsed.images = value == "none" ? vector<string>() : splitList(value);
+        }
+        else if (argument == "--iterations") {
+            parsed.iterations = stoi(value);
+        }
+        else if (argument == "--min-time") {
+            parsed.minSeconds = stod(value);
+        }
+        else if (argument == "--stage") {
+            parsed.stage = value;
+        }
+        else if (argument == "--output") {
+            parsed.outputFile = value;
+        }
+        else if (argument == "--format") {
+            if (value == "json") parsed.csvOutput = false;
+            else if (value == "csv") parsed.csvOutput = true;
+            else throw invalid_argument("Unknown result format: " + value);
+            formatGiven = true;
+        }
+        else if (argument == "--seed") {
+            parsed.seed = stoi(value);
+        }
+        else {
+            throw invalid_argument("Unknown argument: " + argument);
+        }
+    }
+
+    const string& output = parsed.outputFile;
+    if (!formatGiven && output.size() >= 4 && output.compare(output.size() - 4, 4, ".csv") == 0) {
+        parsed.csvOutput = true;
+    }
+
+    return parsed;
+}
+
+/**
+ * @brief Generates a reproducible synthetic BGR test image.
+ *
+ * Gaussian noise over a mid-gray background gives the filters realistic work, filled
+ * rectangles and circles give corners, and thin lines give the Hough transform segments.
+ * Shape positions scale with the image, so every resolution shows the same scene.
+ *
+ * @param size Image size.
+ * @param seed Generator seed.
+ * @return The image.
+ */
+Mat BenchmarkSuite::makeSyntheticImage(Size size, int seed) {
+    RNG rng(static_cast<uint64>(seed));
+    Mat image(size, CV_8UC3);
+    rng.fill(image, RNG::NORMAL, Scalar::all(128), Scalar::all(12));
+
+    auto randomPoint = [&]() {
+        return Point(rng.uniform(0, size.width), rng.uniform(0, size.height));
+    };
+    auto randomColor = [&]() {
+        return Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+    };
+
+    const int unit = max(1, size.height / 60);
+    for (int i = 0; i < 40; i++) {
+        rectangle(image, Rect(randomPoint(), Size(rng.uniform(2, 12) * unit, rng.uniform(2, 12) * unit)), randomColor(), FILLED);
+    }
+    for (int i = 0; i < 20; i++) {
+        circle(image, randomPoint(), rng.uniform(1, 6) * unit, randomColor(), FILLED);
+    }
+    for (int i = 0; i < 40; i++) {
+        line(image, randomPoint(), randomPoint(), randomColor(), max(1, unit / 4));
+    }
+    return image;
+}
+
+/**
+ * @brief Runs every stage on every image and writes the result file.
+ *
+ * A counting allocator is installed as the default Mat allocator for the whole run, and
+ * console progress messages are muted so they do not distort the timings.
+ *
+ * @return The number of measurements.
+ */
+int BenchmarkSuite::run(void) {
+    results.clear();
+
+    bool wasVerbose = CommonProcesses::isVerbose();
+    CommonProcesses::setVerbose(false);
+
+    cout << left << setw(28) << "image" << setw(22) << "stage" << right << setw(8) << "calls"
+        << setw(12) << "median ms" << setw(12) << "Mpix/s" << setw(12) << "allocs" << "\n";
+
+    for (int height : options.heights) {
+        Size size(height * 16 / 9, height);
+        Mat image = makeSyntheticImage(size, options.seed);
+        string label = "synthetic_" + to_string(size.width) + "x" + to_string(size.height);
+        string path = "bench_" + label + ".png";
+        if (!imwrite(path, image)) {
+            throw runtime_error("Error: Could not write file: " + path);
+        }
+        benchmarkImage(label, image, path);
+        remove(path.c_str());
+    }
+
+    for (const auto& path : options.images) {
+        Mat image = imread(path, IMREAD_COLOR);
+        if (image.empty()) {
+            cout << "Skipping missing image: " << path << "\n";
+            continue;
+        }
+        benchmarkImage(path, image, path);
+    }
+
+    cout << "Auto filter backends:";
+    for (int kernelSize : medianSizes) {
+        cout << " median" << kernelSize << "=" << NoiseFilter::backendName(NoiseFilter::selectMedian(kernelSize));
+    }
+    for (int kernelSize : gaussianSizes) {
+        cout << " gaussian" << kernelSize << "=" << NoiseFilter::backendName(NoiseFilter::selectGaussian(kernelSize));
+    }
+    cout << "\n";
+
+    CommonProcesses::setVerbose(wasVerbose);
+
+    if (options.csvOutput) {
+        writeCsv();
+    }
+    else {
+        writeJson();
+    }
+    cout << results.size() << " measurements written to " << options.outputFile << "\n";
+
+    return static_cast<int>(results.size());
+}
+
+/**
+ * @brief Runs all stages on one image.
+ *
+ * In-place stages get a fresh copy of their input before every call, outside the timed
+ * region. Files written by the save stages are removed afterwards.
+ *
+ * @param label Image label.
+ * @param image The BGR image.
+ * @param path File holding the image, timed by the read stage.
+ */
+void BenchmarkSuite::benchmarkImage(const string& label, const Mat& image, const string& path) {
+    const Size size = image.size();
+    double scale = 1.0;
+    Mat gray, work;
+    cvtColor(image, gray, COLOR_BGR2GRAY);
+
+    CommonProcesses common(image, label, scale);
+    auto nothing = []() {};
+
+    measure(label, size, "readImage", nothing, [&]() { common.readImage(path); });
+
+    // Binary PPM files are mapped instead of decoded; reading the PNG again releases the mapping
+    const string pnmFile = "bench_image.ppm";
+    if (!imwrite(pnmFile, image)) {
+        throw runtime_error("Error: Could not write file: " + pnmFile);
+    }
+    measure(label, size, "readImagePnm", nothing, [&]() { common.readImage(pnmFile); });
+    common.readImage(path);
+    remove(pnmFile.c_str());
+
+    vector<uchar> encoded;
+    imencode(".png", image, encoded);
+    measure(label, size, "decodeBuffer", nothing, [&]() { CommonProcesses decoded(encoded.data(), encoded.size(), label, scale); });
+    measure(label, size, "convertToGrayScale", [&]() { image.copyTo(work); }, [&]() { common.convertToGrayScale(work); });
+    measure(label, size, "filterNoiseGaus", [&]() { gray.copyTo(work); }, [&]() { common.filterNoiseGaus(work); });
+    measure(label, size, "filterNoiseMedian", [&]() { gray.copyTo(work); }, [&]() { common.filterNoiseMedian(work); });
+
+    // The same grayscale, half-size and 3 x 3 Gaussian chain stage by stage and as one fused pass
+    PreprocessingPipeline preprocessing;
+    preprocessing.grayscale().rescale(0.5).gaussian(3);
+    preprocessing.setFusion(false);
+    measure(label, size, "preprocessStaged", nothing, [&]() { preprocessing.run(image); });
+    preprocessing.setFusion(true);
+    measure(label, size, "preprocessFused", nothing, [&]() { preprocessing.run(image); });
+    reportFusionAgreement(label, image);
+    for (FilterBackend backend : filterBackends) {
+        const string name = NoiseFilter::backendName(backend);
+        for (int kernelSize : medianSizes) {
+            if (NoiseFilter::supportsMedian(backend, kernelSize)) {
+                measure(label, size, "median" + to_string(kernelSize) + "_" + name, nothing,
+                    [&]() { NoiseFilter::median(gray, work, kernelSize, backend); });
+            }
+        }
+        for (int kernelSize : gaussianSizes) {
+            if (NoiseFilter::supportsGaussian(backend, kernelSize)) {
+                measure(label, size, "gaussian" + to_string(kernelSize) + "_" + name, nothing,
+                    [&]() { NoiseFilter::gaussian(gray, work, kernelSize, backend); });
+            }
+        }
+    }
+
+    CornerDetection cornerDetector(gray, label, scale);
+    vector<Point> corners;
+    cornerDetector.setHarrisEngine(HarrisEngine::OpenCV);
+    measure(label, size, "harrisOpenCV", nothing, [&]() { cornerDetector.detectCorners(gray, corners); });
+    cornerDetector.setHarrisEngine(HarrisEngine::Fused);
+    measure(label, size, "harrisFused", nothing, [&]() { cornerDetector.detectCorners(gray, corners); });
+    cornerDetector.setHarrisEngine(HarrisEngine::FixedPoint);
+    measure(label, size, "harrisFixed", nothing, [&]() { cornerDetector.detectCorners(gray, corners); });
+    reportFixedPointAgreement(label, gray, cornerDetector);
+    cornerDetector.setHarrisEngine(HarrisEngine::Fused);
+    const vector<Rect> centerRegion = { Rect(size.width / 4, size.height / 4, size.width / 2, size.height / 2) };
+    vector<float> cornerScores;
+    measure(label, size, "harrisRegionQuarter", nothing, [&]() { cornerDetector.detectCornersInRegions(gray, centerRegion, corners, cornerScores); });
+
+    CornerSelector selector;
+    measure(label, size, "budgetComputeHarris", nothing, [&]() { selector.compute(gray, vector<Rect>(), CornerFrontEnd::Harris); });
+    // Keeping every candidate resets the ranking, so each selection sorts from scratch
+    auto unranked = [&]() { selector.filterCandidates([](const Point&) { return true; }); };
+    measure(label, size, "budgetSelect500", unranked, [&]() { selector.select(500, 0, corners); });
+    measure(label, size, "budgetSelect500Spaced", unranked, [&]() { selector.select(500, 10, corners); });
+    measure(label, size, "budgetComputeFast", nothing, [&]() { selector.compute(gray, vector<Rect>(), CornerFrontEnd::Fast); });
+
+    LineDetection lineDetector(gray, label, scale);
+    measure(label, size, "cannyHoughLinesP", nothing, [&]() { lineDetector.detectFeatures(); });
+    lineDetector.setLineEngine(LineEngine::SegmentDetector);
+    measure(label, size, "lineSegmentDetector", nothing, [&]() { lineDetector.detectFeatures(); });
+    lineDetector.setLineEngine(LineEngine::Hough);
+    lineDetector.detectFeatures();
+    const vector<Vec4i> rawLines = lineDetector.getLineFeatures();
+
+    // Hough voting on the 8-bit Canny map and on the packed map with its edge list
+    Mat edgeBytes;
+    Canny(gray, edgeBytes, 50, 150);
+    EdgeMap edgeMap;
+    vector<Vec4i> byteLines, packedLines;
+    measure(label, size, "edgePack", nothing, [&]() { edgeMap.pack(edgeBytes); });
+    measure(label, size, "houghLinesPBytes", nothing, [&]() { HoughLinesP(edgeBytes, byteLines, 1, CV_PI / 180, 50, 50, 10); });
+    measure(label, size, "houghEdgeList", nothing, [&]() { ProbabilisticHough::findSegments(edgeMap, 1, CV_PI / 180, 50, 50, 10, packedLines); });
+    const string edgeFile = "bench_edges.edg";
+    int edgeLow, edgeHigh;
+    measure(label, size, "saveEdgeMap", nothing, [&]() { edgeMap.save(edgeFile, label, 50, 150); });
+    measure(label, size, "loadEdgeMap", nothing, [&]() { edgeMap.load(edgeFile, edgeLow, edgeHigh); });
+    remove(edgeFile.c_str());
+    cout << left << setw(28) << label << "edge map: " << edgeMap.count() << " edge pixels, " << edgeBytes.total()
+        << " bytes as 8-bit map, " << edgeMap.byteSize() << " packed with edge list; segments "
+        << (byteLines == packedLines ? "identical" : "differ") << " (" << packedLines.size() << ")\n";
+
+    // Both kinds from one Sobel pass, to compare with harrisFused + cannyHoughLinesP
+    CombinedDetection combinedDetector(gray, label, scale);
+    measure(label, size, "harrisCannyCombined", nothing, [&]() { combinedDetector.detectFeatures(); });
+    vector<Vec4i> mergedLines;
+    measure(label, size, "mergeLines", [&]() { mergedLines = rawLines; }, [&]() { SegmentMerger::merge(mergedLines); });
+
+    const string featureFile = "bench_features.txt";
+    const string rgbFile = "bench_rgb.dat";
+    cornerDetector.detectFeatures();
+    lineDetector.detectFeatures();
+    lineDetector.setCornerFeatures(cornerDetector.getCornerFeatures());
+    measure(label, size, "saveFeatures", nothing, [&]() { lineDetector.saveFeatures(featureFile); });
+
+    FeatureIndex featureIndex;
+    vector<int> found;
+    const Point2f middle(size.width * 0.5f, size.height * 0.5f);
+    const Rect quarter(size.width / 4, size.height / 4, size.width / 4, size.height / 4);
+    measure(label, size, "featureIndexBuild", nothing, [&]() { featureIndex.build(lineDetector.getCornerFeatures(), lineDetector.getLineFeatures()); });
+    measure(label, size, "cornersInRect", nothing, [&]() { featureIndex.cornersInRect(quarter, found); });
+    measure(label, size, "nearestCorners8", nothing, [&]() { featureIndex.nearestCorners(middle, 8, found); });
+    measure(label, size, "linesInRect", nothing, [&]() { featureIndex.linesInRect(quarter, found); });
+    measure(label, size, "saveRGBToFileText", nothing, [&]() { common.saveRGBToFile(image, rgbFile, RGBDumpFormat::Text); });
+    measure(label, size, "saveRGBToFileRaw", nothing, [&]() { common.saveRGBToFile(image, rgbFile, RGBDumpFormat::RawInterleaved); });
+    remove(featureFile.c_str());
+    remove(rgbFile.c_str());
+}
+
+/**
+ * @brief Times one stage.
+ *
+ * One untimed warm-up call fills caches and buffer pools, so the measurement reflects the
+ * steady state of a long run. Each call is timed on its own; the median is reported
+ * together with the fastest call.
+ *
+ * @param label Image label.
+ * @param size Image size used for the throughput.
+ * @param stage Stage name.
+ * @param prepare Untimed setup run before every call.
+ * @param body The timed call.
+ */
+void BenchmarkSuite::measure(const string& label, Size size, const string& stage,
+    const function<void()>& prepare, const function<void()>& body) {
+    if (!options.stage.empty() && stage.find(options.stage) == string::npos) {
+        return;
+    }
+
+    MatAllocator* previous = Mat::getDefaultAllocator();
+    CountingAllocator counter(previous);
+    Mat::setDefaultAllocator(&counter);
+
+    vector<double> times;
+    double totalMilliseconds = 0.0;
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+
+    try {
+        prepare();
+        body();
+
+        for (;;) {
+            prepare();
+            const size_t countBefore = counter.count;
+            const size_t bytesBefore = counter.bytes;
+            int64 start = getTickCount();
+            body();
+            double milliseconds = (getTickCount() - start) * 1000.0 / getTickFrequency();
+            allocations += counter.count - countBefore;
+            allocatedBytes += counter.bytes - bytesBefore;
+
+            times.push_back(milliseconds);
+            totalMilliseconds += milliseconds;
+
+            bool done = options.iterations > 0
+                ? static_cast<int>(times.size()) >= options.iterations
+                : (times.size() >= 3 && totalMilliseconds >= options.minSeconds * 1000.0) || times.size() >= 1000;
+            if (done) {
+                break;
+            }
+        }
+    }
+    catch (...) {
+        Mat::setDefaultAllocator(previous);
+        throw;
+    }
+    Mat::setDefaultAllocator(previous);
+
+    BenchmarkResult result;
+    result.image = label;
+    result.width = size.width;
+    result.height = size.height;
+    result.stage = stage;
+    result.iterations = static_cast<int>(times.size());
+    result.minMilliseconds = *min_element(times.begin(), times.end());
+    nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    result.medianMilliseconds = times[times.size() / 2];
+    result.megapixelsPerSecond = result.medianMilliseconds > 0
+        ? size.area() / 1e6 / (result.medianMilliseconds / 1000.0) : 0.0;
+    result.allocationsPerCall = static_cast<double>(allocations) / times.size();
+    result.allocatedBytesPerCall = static_cast<double>(allocatedBytes) / times.size();
+    results.push_back(result);
+
+    cout << left << setw(28) << label << setw(22) << stage << right << setw(8) << result.iterations
+        << fixed << setprecision(3) << setw(12) << result.medianMilliseconds
+        << setprecision(1) << setw(12) << result.megapixelsPerSecond
+        << setw(12) << result.allocationsPerCall << defaultfloat << "\n";
+}
+
+/**
+ * @brief Prints how far the fixed-point Harris engine agrees with the float one.
+ *
+ * Both engines run with and without suppression; the line lists the corners both find, the
+ * ones only one of them finds and the relative difference of the response maxima.
+ *
+ * @param label Image label.
+ * @param gray The grayscale image.
+ * @param detector Corner detector whose quality level is used, left on the fixed-point engine.
+ */
+void BenchmarkSuite::reportFixedPointAgreement(const string& label, const Mat& gray, CornerDetection& detector) const {
+    const int radius = detector.getSuppressionRadius();
+    auto rasterOrder = [](const Point& a, const Point& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; };
+
+    cout << left << setw(28) << label << "fixed-point agreement:";
+    for (int nms : { 0, 3 }) {
+        vector<Point> floatCorners, fixedCorners, shared;
+        detector.setSuppressionRadius(nms);
+        detector.setHarrisEngine(HarrisEngine::Fused);
+        detector.detectCorners(gray, floatCorners);
+        detector.setHarrisEngine(HarrisEngine::FixedPoint);
+        detector.detectCorners(gray, fixedCorners);
+        set_intersection(floatCorners.begin(), floatCorners.end(), fixedCorners.begin(), fixedCorners.end(),
+            back_inserter(shared), rasterOrder);
+        cout << " nms" << nms << " shared " << shared.size() << " float-only " << floatCorners.size() - shared.size()
+            << " fixed-only " << fixedCorners.size() - shared.size() << ";";
+    }
+    detector.setSuppressionRadius(radius);
+
+    const FixedPointHarris fixedHarris(2, 0.04);
+    int64_t fixedMin, fixedMax;
+    fixedHarris.responseRange(gray, fixedMin, fixedMax);
+    double floatMin, floatMax;
+    HarrisKernel(2, 3, 0.04).responseRange(gray, floatMin, floatMax);
+    const double fixedPeak = fixedHarris.toFloatResponse(fixedMax);
+    cout << " max response " << floatMax << " vs " << fixedPeak << " (rel. "
+        << (floatMax != 0.0 ? fabs(fixedPeak - floatMax) / fabs(floatMax) : 0.0) << ")\n";
+}
+
+/**
+ * @brief Prints how far the fused preprocessing pass agrees with the staged pipeline.
+ *
+ * The grayscale, rescale and Gaussian chain runs with and without fusion for both fused
+ * kernel sizes at several scales: 0.5, which resize serves from its area path, and factors
+ * on its linear path. For each, the line gives the largest absolute difference in gray levels
+ * and the number of differing pixels.
+ *
+ * @param label Image label.
+ * @param image The BGR image.
+ */
+void BenchmarkSuite::reportFusionAgreement(const string& label, const Mat& image) const {
+    cout << left << setw(28) << label << "fused preprocess agreement:";
+    for (double factor : { 0.5, 0.75, 0.4, 1.0 }) {
+        for (int kernelSize : { 3, 5 }) {
+            PreprocessingPipeline pipeline;
+            pipeline.grayscale().rescale(factor).gaussian(kernelSize);
+            pipeline.setFusion(false);
+            // Holding the staged result keeps the fused run from writing into its buffer
+            const Mat staged = pipeline.run(image);
+            pipeline.setFusion(true);
+            Mat difference;
+            absdiff(staged, pipeline.run(image), difference);
+            double maxDifference;
+            minMaxLoc(difference, nullptr, &maxDifference);
+            cout << " x" << factor << " g" << kernelSize << " max " << maxDifference
+                << " differing " << countNonZero(difference) << ";";
+        }
+    }
+    cout << '\n';
+}
+
+/**
+ * @brief Writes the results as JSON, together with the OpenCV version and thread count.
+ */
+void BenchmarkSuite::writeJson(void) const {
+    ofstream file(options.outputFile);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + options.outputFile);
+    }
+
+    file << "{\n  \"opencv\": " << jsonString(CV_VERSION) << ",\n  \"threads\": " << getNumThreads()
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        file << "    {\"image\": " << jsonString(r.image) << ", \"width\": " << r.width << ", \"height\": " << r.height
+            << ", \"stage\": " << jsonString(r.stage) << ", \"iterations\": " << r.iterations
+            << ", \"median_ms\": " << r.medianMilliseconds << ", \"min_ms\": " << r.minMilliseconds
+            << ", \"megapixels_per_sec\": " << r.megapixelsPerSecond
+            << ", \"allocations_per_call\": " << r.allocationsPerCall
+            << ", \"allocated_bytes_per_call\": " << r.allocatedBytesPerCall << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + options.outputFile);
+    }
+}
+
+/**
+ * @brief Writes the results as CSV, one header row followed by one row per measurement.
+ */
+void BenchmarkSuite::writeCsv(void) const {
+    ofstream file(options.outputFile);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + options.outputFile);
+    }
+
+    file << "image,width,height,stage,iterations,median_ms,min_ms,megapixels_per_sec,allocations_per_call,allocated_bytes_per_call\n";
+    for (const auto& r : results) {
+        file << r.image << "," << r.width << "," << r.height << "," << r.stage << "," << r.iterations << ","
+            << r.medianMilliseconds << "," << r.minMilliseconds << "," << r.megapixelsPerSecond << ","
+            << r.allocationsPerCall << "," << r.allocatedBytesPerCall << "\n";
+    }
+
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + options.outputFile);
+    }
+}
+
+/**
+ * @brief Gets the measurements of the last run.
+ *
+ * @return The results in execution order.
+ */
+const vector<BenchmarkResult>& BenchmarkSuite::getResults(void) const {
+    return results;
+}
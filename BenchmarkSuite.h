@@ -0,0 +1,112 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+class CornerDetection;
+
+/// Options for a benchmark run
+struct BenchmarkOptions {
+    vector<int> heights = { 480, 1080 };    ///< Heights of the synthetic 16:9 images
+    vector<string> images = { "resim.png", "RGBvalues.jpg" }; ///< Bundled images, skipped when missing
+    int iterations = 0;                     ///< Timed calls per stage, 0 repeats until minSeconds have passed
+    double minSeconds = 0.5;                ///< Minimum timed duration per stage in automatic mode
+    string stage;                           ///< Only run stages whose name contains this text
+    string outputFile = "benchmark.json";   ///< Result file, JSON unless it ends in .csv or csv is selected
+    bool csvOutput = false;                 ///< Write CSV instead of JSON
+    int seed = 42;                          ///< Seed of the synthetic image generator
+};
+
+/// Timing of one stage on one image
+struct BenchmarkResult {
+    string image;                           ///< Image label, e.g. "synthetic_1920x1080" or "resim.png"
+    int width;                              ///< Image width in pixels
+    int height;                             ///< Image height in pixels
+    string stage;                           ///< Stage name
+    int iterations;                         ///< Timed calls
+    double medianMilliseconds;              ///< Median duration of one call
+    double minMilliseconds;                 ///< Fastest call
+    double megapixelsPerSecond;             ///< Throughput at the median duration
+    double allocationsPerCall;              ///< Mat allocations per call
+    double allocatedBytesPerCall;           ///< Bytes of those allocations per call
+};
+
+/// BenchmarkSuite Class
+/// Times every stage of the detection path - image reading, grayscale conversion, both noise
+/// filters, Harris with its threshold scan, Canny with Hough voting on byte and packed edge
+/// maps, the line segment detector, feature saving and RGB dumps - on reproducible synthetic
+/// images and the bundled sample images. Every NoiseFilter backend is timed at several kernel sizes as well. Mat allocations
+/// are counted through a wrapping default allocator. Results go to the console and to a JSON
+/// or CSV file for regression tracking.
+class BenchmarkSuite {
+public:
+    /// Constructor
+    /// @param options The benchmark configuration.
+    explicit BenchmarkSuite(const BenchmarkOptions& options);
+
+    /// Destructor
+    ~BenchmarkSuite();
+
+    /// Build benchmark options from command line arguments
+    /// @param argc Argument count as received by main.
+    /// @param argv Argument values as received by main, starting with --bench.
+    /// @return The parsed options.
+    static BenchmarkOptions parseArguments(int argc, char** argv);
+
+    /// Print command line usage to the console
+    static void printUsage(void);
+
+    /// Generate a reproducible synthetic BGR test image
+    /// @param size Image size.
+    /// @param seed Generator seed.
+    /// @return Image with noise, filled shapes and lines.
+    static Mat makeSyntheticImage(Size size, int seed);
+
+    /// Run every stage on every image and write the result file
+    /// @return The number of measurements.
+    int run(void);
+
+    /// Get the measurements of the last run
+    /// @return The results in execution order.
+    const vector<BenchmarkResult>& getResults(void) const;
+
+private:
+    /// Run all stages on one image
+    /// @param label Image label.
+    /// @param image The BGR image.
+    /// @param path File holding the image, timed by the read stage.
+    void benchmarkImage(const string& label, const Mat& image, const string& path);
+
+    /// Time one stage
+    /// @param label Image label.
+    /// @param size Image size used for the throughput.
+    /// @param stage Stage name.
+    /// @param prepare Untimed setup run before every call, e.g. restoring an in-place input.
+    /// @param body The timed call.
+    void measure(const string& label, Size size, const string& stage,
+        const function<void()>& prepare, const function<void()>& body);
+
+    /// Print how far the fixed-point Harris engine agrees with the float one
+    /// @param label Image label.
+    /// @param gray The grayscale image.
+    /// @param detector Corner detector whose quality level is used, left on the fixed-point engine.
+    void reportFixedPointAgreement(const string& label, const Mat& gray, CornerDetection& detector) const;
+
+    /// Print how far the fused preprocessing pass agrees with the staged pipeline
+    /// @param label Image label.
+    /// @param image The BGR image.
+    void reportFusionAgreement(const string& label, const Mat& image) const;
+
+    /// Write the results as JSON
+    void writeJson(void) const;
+
+    /// Write the results as CSV
+    void writeCsv(void) const;
+
+    BenchmarkOptions options;               ///< Benchmark configuration
+    vector<BenchmarkResult> results;        ///< Measurements of the last run
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+/// Occupancy and blocking counters of a bounded queue
+/// A queue that is mostly full with blocked producers feeds a stage slower than the one
+/// filling it; a queue that is mostly empty with blocked consumers is fed too slowly.
+struct BoundedQueueStats {
+    size_t capacity = 0;                    ///< Largest number of queued items
+    size_t pushes = 0;                      ///< Items pushed
+    double meanDepth = 0.0;                 ///< Queued items seen by an average push, including the pushed item
+    size_t maxDepth = 0;                    ///< Most items queued at once
+    double producerWaitSeconds = 0.0;       ///< Time producers spent blocked on a full queue, summed over threads
+    double consumerWaitSeconds = 0.0;       ///< Time consumers spent blocked on an empty queue, summed over threads
+};
+
+/// BoundedQueue Class
+/// Blocking first-in first-out queue between the threads of two pipeline stages. push()
+/// blocks while the queue holds capacity items, which is the backpressure that caps the
+/// memory in flight between the stages; pop() blocks while it is empty. close() ends the
+/// stream: pushes fail and pops drain the remaining items, then fail.
+template<typename T>
+class BoundedQueue
+{
+public:
+    /// Constructor
+    /// @param capacity Largest number of queued items, at least 1.
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {
+        if (capacity == 0) {
+            throw invalid_argument("Queue capacity must be at least 1");
+        }
+        stats.capacity = capacity;
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// Append an item, waiting while the queue is full
+    /// @param item The item, moved into the queue.
+    /// @return False if the queue was closed; the item is then left untouched.
+    bool push(T&& item) {
+        unique_lock<mutex> lock(guard);
+        if (items.size() >= capacity && !closed) {
+            const auto blocked = chrono::steady_clock::now();
+            notFull.wait(lock, [this]() { return items.size() < capacity || closed; });
+            stats.producerWaitSeconds += chrono::duration<double>(chrono::steady_clock::now() - blocked).count();
+        }
+        if (closed) {
+            return false;
+        }
+
+        items.push_back(move(item));
+        depthSum += items.size();
+        stats.pushes++;
+        stats.maxDepth = max(stats.maxDepth, items.size());
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /// Remove the oldest item, waiting while the queue is empty and open
+    /// @param item Output item.
+    /// @return False once the queue is closed and drained.
+    bool pop(T& item) {
+        unique_lock<mutex> lock(guard);
+        if (items.empty() && !closed) {
+            const auto blocked = chrono::steady_clock::now();
+            notEmpty.wait(lock, [this]() { return !items.empty() || closed; });
+            stats.consumerWaitSeconds += chrono::duration<double>(chrono::steady_clock::now() - blocked).count();
+        }
+        if (items.empty()) {
+            return false;
+        }
+
+        item = move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    /// End the stream, waking every waiting producer and consumer
+    void close(void) {
+        {
+            lock_guard<mutex> lock(guard);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    /// Get the number of queued items
+    /// @return The current depth.
+    size_t size(void) const {
+        lock_guard<mutex> lock(guard);
+        return items.size();
+    }
+
+    /// Get the occupancy and blocking counters
+    /// @return The counters since the queue was created.
+    BoundedQueueStats getStats(void) const {
+        lock_guard<mutex> lock(guard);
+        BoundedQueueStats current = stats;
+        current.meanDepth = stats.pushes > 0 ? static_cast<double>(depthSum) / stats.pushes : 0.0;
+        return current;
+    }
+
+private:
+    const size_t capacity;                  ///< Largest number of queued items
+    deque<T> items;                         ///< Queued items, oldest first
+    bool closed;                            ///< True after close
+    size_t depthSum = 0;                    ///< Depth after every push, summed
+    BoundedQueueStats stats;                ///< Counters, meanDepth is filled in by getStats
+    mutable mutex guard;                    ///< Protects all members
+    condition_variable notFull;             ///< Signaled when an item is removed or the queue closes
+    condition_variable notEmpty;            ///< Signaled when an item is added or the queue closes
+};
@@ -0,0 +1,220 @@
+#include "BufferPool.h"
+#include <atomic>
+#include <sstream>
+
+namespace {
+    const int minBucket = 12;               // 4 KB, smaller requests share the smallest bucket
+    const int bucketCount = 48;
+
+    atomic<size_t> globalRequests(0);
+    atomic<size_t> globalAllocations(0);
+    atomic<size_t> globalBytesAllocated(0);
+    atomic<size_t> globalBytesHeld(0);
+}
+
+/**
+ * @brief Constructor for an empty pool.
+ */
+BufferPool::BufferPool() : buckets(bucketCount) {
+}
+
+/**
+ * @brief Destructor releasing all idle blocks.
+ */
+BufferPool::~BufferPool() {
+    clear();
+}
+
+/**
+ * @brief Gets the pool of the calling thread.
+ *
+ * Batch workers and the OpenCV worker threads each get their own pool, which lives as long
+ * as the thread and therefore across all images the thread processes.
+ *
+ * @return The thread's pool.
+ */
+BufferPool& BufferPool::local(void) {
+    static thread_local BufferPool pool;
+    return pool;
+}
+
+/**
+ * @brief Gets the bucket index of a byte size.
+ *
+ * @param bytes Requested size.
+ * @return Smallest k with 2^k >= bytes, at least minBucket.
+ */
+int BufferPool::bucketFor(size_t bytes) {
+    int bucket = minBucket;
+    while (bucket < bucketCount - 1 && (static_cast<size_t>(1) << bucket) < bytes) {
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Leases a block of at least the given size.
+ *
+ * An idle block of the matching bucket is reused; otherwise a new block of the bucket
+ * capacity is allocated. Blocks are 4096 bytes wide so capacities beyond INT_MAX still fit.
+ *
+ * @param bytes Minimum capacity in bytes.
+ * @return Continuous 8-bit block whose total() is the bucket capacity.
+ */
+Mat BufferPool::acquire(size_t bytes) {
+    const int bucket = bucketFor(bytes);
+    stats.requests++;
+    globalRequests++;
+
+    vector<Mat>& idle = buckets[bucket];
+    if (!idle.empty()) {
+        Mat block = move(idle.back());
+        idle.pop_back();
+        return block;
+    }
+
+    const size_t capacity = static_cast<size_t>(1) << bucket;
+    Mat block(static_cast<int>(capacity >> minBucket), 1 << minBucket, CV_8U);
+    stats.allocations++;
+    stats.bytesAllocated += capacity;
+    stats.bytesHeld += capacity;
+    globalAllocations++;
+    globalBytesAllocated += capacity;
+    globalBytesHeld += capacity;
+    return block;
+}
+
+/**
+ * @brief Returns a leased block to its bucket.
+ *
+ * @param block The block, released on return.
+ */
+void BufferPool::release(Mat& block) {
+    if (block.empty()) {
+        return;
+    }
+    buckets[bucketFor(block.total())].push_back(block);
+    block.release();
+}
+
+/**
+ * @brief Counts a request served outside the Mat buckets.
+ *
+ * @param newBytes Bytes the request had to allocate, 0 if it was served from reused memory.
+ */
+void BufferPool::record(size_t newBytes) {
+    stats.requests++;
+    globalRequests++;
+    if (newBytes > 0) {
+        stats.allocations++;
+        stats.bytesAllocated += newBytes;
+        globalAllocations++;
+        globalBytesAllocated += newBytes;
+    }
+}
+
+/**
+ * @brief Drops all idle blocks; leased blocks are freed when their lease ends.
+ */
+void BufferPool::clear(void) {
+    for (auto& idle : buckets) {
+        for (const auto& block : idle) {
+            stats.bytesHeld -= block.total();
+            globalBytesHeld -= block.total();
+        }
+        idle.clear();
+    }
+}
+
+/**
+ * @brief Gets the counters of this pool.
+ *
+ * @return The counters since the pool was created.
+ */
+BufferPoolStats BufferPool::getStats(void) const {
+    return stats;
+}
+
+/**
+ * @brief Gets the counters summed over the pools of all threads.
+ *
+ * @return The counters since program start.
+ */
+BufferPoolStats BufferPool::getGlobalStats(void) {
+    BufferPoolStats total;
+    total.requests = globalRequests;
+    total.allocations = globalAllocations;
+    total.bytesAllocated = globalBytesAllocated;
+    total.bytesHeld = globalBytesHeld;
+    return total;
+}
+
+/**
+ * @brief Summarizes the global counters accumulated since a snapshot.
+ *
+ * In steady state the allocation count stops growing while the request count keeps rising.
+ *
+ * @param since Snapshot taken with getGlobalStats.
+ * @return One line with requests, allocations and pooled bytes.
+ */
+string BufferPool::summarize(const BufferPoolStats& since) {
+    BufferPoolStats now = getGlobalStats();
+    stringstream summary;
+    summary << "Buffer pool: " << now.requests - since.requests << " requests, "
+        << now.allocations - since.allocations << " allocations ("
+        << (now.bytesAllocated - since.bytesAllocated) / 1048576.0 << " MB), "
+        << now.bytesHeld / 1048576.0 << " MB pooled";
+    return summary.str();
+}
+
+/**
+ * @brief Constructor without a block.
+ */
+PooledMat::PooledMat() : pool(BufferPool::local()) {
+}
+
+/**
+ * @brief Constructor leasing a block for the given shape.
+ *
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param type OpenCV element type.
+ */
+PooledMat::PooledMat(int rows, int cols, int type) : pool(BufferPool::local()) {
+    create(rows, cols, type);
+}
+
+/**
+ * @brief Destructor returning the block.
+ */
+PooledMat::~PooledMat() {
+    header.release();
+    pool.release(block);
+}
+
+/**
+ * @brief Shapes the Mat, keeping the current block if it is large enough.
+ *
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param type OpenCV element type.
+ * @return The shaped Mat.
+ */
+Mat& PooledMat::create(int rows, int cols, int type) {
+    const size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+    if (block.empty() || block.total() < bytes) {
+        pool.release(block);
+        block = pool.acquire(bytes);
+    }
+    header = Mat(rows, cols, type, block.data);
+    return header;
+}
+
+/**
+ * @brief Gets the Mat.
+ *
+ * @return The Mat, empty before the first create.
+ */
+Mat& PooledMat::get(void) {
+    return header;
+}
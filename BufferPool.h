@@ -0,0 +1,165 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// Allocation counters of a buffer pool
+struct BufferPoolStats {
+    size_t requests = 0;                    ///< Buffers handed out
+    size_t allocations = 0;                 ///< Requests that needed new memory
+    size_t bytesAllocated = 0;              ///< Bytes of that new memory
+    size_t bytesHeld = 0;                   ///< Bytes of Mat blocks owned by the pool, idle or leased
+};
+
+/// BufferPool Class
+/// Recycles scratch memory of the detectors between calls and images. Blocks are bucketed by
+/// power-of-two byte size, so a block serves every Mat shape up to its capacity and a stream of
+/// images of varying size settles on a few blocks per bucket. Each thread owns its pool
+/// (local()), so leasing never takes a lock; blocks return to the pool of the leasing thread.
+class BufferPool
+{
+public:
+    /// Constructor for an empty pool
+    BufferPool();
+
+    /// Destructor releasing all idle blocks
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// Get the pool of the calling thread
+    /// @return The thread's pool, created on first use.
+    static BufferPool& local(void);
+
+    /// Lease a block of at least the given size
+    /// @param bytes Minimum capacity in bytes.
+    /// @return Continuous 8-bit block whose total() is the bucket capacity.
+    Mat acquire(size_t bytes);
+
+    /// Return a leased block to its bucket
+    /// @param block The block, released on return.
+    void release(Mat& block);
+
+    /// Count a request served outside the Mat buckets, e.g. by a pooled vector
+    /// @param newBytes Bytes the request had to allocate, 0 if it was served from reused memory.
+    void record(size_t newBytes);
+
+    /// Drop all idle blocks
+    void clear(void);
+
+    /// Get the counters of this pool
+    /// @return The counters since the pool was created.
+    BufferPoolStats getStats(void) const;
+
+    /// Get the counters summed over the pools of all threads
+    /// @return The counters since program start.
+    static BufferPoolStats getGlobalStats(void);
+
+    /// Summarize the global counters accumulated since a snapshot
+    /// @param since Snapshot taken with getGlobalStats.
+    /// @return One line with requests, allocations and pooled bytes.
+    static string summarize(const BufferPoolStats& since);
+
+private:
+    /// Get the bucket index of a byte size
+    static int bucketFor(size_t bytes);
+
+    vector<vector<Mat>> buckets;            ///< Idle blocks, indexed by log2 of their capacity
+    BufferPoolStats stats;                  ///< Counters of this pool
+};
+
+/// PooledMat Class
+/// Scratch Mat whose pixels live in a block leased from the thread's pool and returned on
+/// destruction. The Mat returned by create() does not own its pixels: it must not outlive the
+/// PooledMat, and copies of it must be taken with clone() or copyTo().
+class PooledMat
+{
+public:
+    /// Constructor without a block
+    PooledMat();
+
+    /// Constructor leasing a block for the given shape
+    /// @param rows Number of rows.
+    /// @param cols Number of columns.
+    /// @param type OpenCV element type.
+    PooledMat(int rows, int cols, int type);
+
+    /// Destructor returning the block
+    ~PooledMat();
+
+    PooledMat(const PooledMat&) = delete;
+    PooledMat& operator=(const PooledMat&) = delete;
+
+    /// Shape the Mat, keeping the current block if it is large enough
+    /// Passing the result as an output of an OpenCV call with the same shape writes into the block.
+    /// @param rows Number of rows.
+    /// @param cols Number of columns.
+    /// @param type OpenCV element type.
+    /// @return The shaped Mat.
+    Mat& create(int rows, int cols, int type);
+
+    /// Get the Mat
+    /// @return The Mat, empty before the first create.
+    Mat& get(void);
+
+private:
+    BufferPool& pool;                       ///< Pool of the leasing thread
+    Mat block;                              ///< Leased block
+    Mat header;                             ///< Mat over the block
+};
+
+/// PooledVector Class
+/// Scratch vector whose capacity is kept in a per-thread free list between uses.
+/// The vector is empty on construction and cleared, not freed, on destruction.
+template<typename T>
+class PooledVector
+{
+public:
+    /// Constructor taking a recycled vector of the calling thread if one is idle
+    PooledVector() : items(take()), capacity(items.capacity()) {
+    }
+
+    /// Destructor returning the vector and counting any capacity growth as an allocation
+    ~PooledVector() {
+        size_t grown = items.capacity() > capacity ? (items.capacity() - capacity) * sizeof(T) : 0;
+        BufferPool::local().record(grown);
+        items.clear();
+        idle().push_back(move(items));
+    }
+
+    PooledVector(const PooledVector&) = delete;
+    PooledVector& operator=(const PooledVector&) = delete;
+
+    /// Get the vector
+    /// @return The vector.
+    vector<T>& get(void) {
+        return items;
+    }
+
+private:
+    /// Free list of the calling thread
+    static vector<vector<T>>& idle(void) {
+        static thread_local vector<vector<T>> lists;
+        return lists;
+    }
+
+    /// Take the most recently returned vector of the calling thread
+    static vector<T> take(void) {
+        vector<vector<T>>& lists = idle();
+        if (lists.empty()) {
+            return vector<T>();
+        }
+        vector<T> recycled = move(lists.back());
+        lists.pop_back();
+        return recycled;
+    }
+
+    vector<T> items;                        ///< The leased vector
+    size_t capacity;                        ///< Capacity when leased
+};
@@ -0,0 +1,173 @@
+#include "CannyCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+    const ushort edgeFlag = 0x8000;     // marks edges in suppressed during hysteresis; L1 magnitudes stay below 2041
+}
+
+/**
+ * @brief Constructor computing gradients and non-maximum suppression.
+ *
+ * Follows the integer formulation of Canny: derivatives with a replicated border, the
+ * L1 magnitude |dx| + |dy| and a direction quantized to four sectors with tan(22.5)
+ * in 15-bit fixed point. Pixels outside the image have zero magnitude.
+ *
+ * @param gray Single channel 8-bit image.
+ */
+CannyCache::CannyCache(const Mat& gray) {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw invalid_argument("Canny cache needs a single channel 8-bit image");
+    }
+
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+
+    Mat dx, dy;
+    Sobel(gray, dx, CV_16S, 1, 0, 3, 1, 0, BORDER_REPLICATE);
+    Sobel(gray, dy, CV_16S, 0, 1, 3, 1, 0, BORDER_REPLICATE);
+
+    // Magnitude with a one pixel zero frame so the neighbor reads never leave the buffer
+    Mat magnitude(rows + 2, cols + 2, CV_32S, Scalar(0));
+    for (int y = 0; y < rows; y++) {
+        const short* pdx = dx.ptr<short>(y);
+        const short* pdy = dy.ptr<short>(y);
+        int* pm = magnitude.ptr<int>(y + 1) + 1;
+        for (int x = 0; x < cols; x++) {
+            pm[x] = abs(pdx[x]) + abs(pdy[x]);
+        }
+    }
+
+    suppressed.create(rows, cols, CV_16U);
+    parallel_for_(Range(0, rows), [&](const Range& range) {
+        const int shift = 15;
+        const int tan22 = 13573;    // tan(22.5 degrees) * 2^15
+
+        for (int y = range.start; y < range.end; y++) {
+            const short* pdx = dx.ptr<short>(y);
+            const short* pdy = dy.ptr<short>(y);
+            const int* above = magnitude.ptr<int>(y) + 1;
+            const int* center = magnitude.ptr<int>(y + 1) + 1;
+            const int* below = magnitude.ptr<int>(y + 2) + 1;
+            ushort* out = suppressed.ptr<ushort>(y);
+
+            for (int x = 0; x < cols; x++) {
+                const int m = center[x];
+                bool peak = false;
+                if (m > 0) {
+                    const int ax = abs(pdx[x]);
+                    const int ay = abs(pdy[x]) << shift;
+                    const int tan22x = ax * tan22;
+                    if (ay < tan22x) {
+                        peak = m > center[x - 1] && m >= center[x + 1];
+                    }
+                    else if (ay > tan22x + (ax << (shift + 1))) {
+                        peak = m > above[x] && m >= below[x];
+                    }
+                    else {
+                        const int s = (pdx[x] ^ pdy[x]) < 0 ? -1 : 1;
+                        peak = m > above[x - s] && m > below[x + s];
+                    }
+                }
+                out[x] = peak ? static_cast<ushort>(m) : 0;
+            }
+        }
+    });
+
+    for (int y = 0; y < rows; y++) {
+        const ushort* ps = suppressed.ptr<ushort>(y);
+        for (int x = 0; x < cols; x++) {
+            if (ps[x] != 0) {
+                candidates.push_back(y * cols + x);
+            }
+        }
+    }
+
+    currentEdges = EdgeMap(Size(cols, rows));
+}
+
+/**
+ * @brief Recomputes the edge map for a threshold pair.
+ *
+ * Local maxima above the high threshold seed an 8-connected flood fill through the local
+ * maxima above the low threshold. Visited pixels are marked in the unused top bit of their
+ * magnitude instead of a separate map. Edges are always a subset of the candidates, so the
+ * new edge list, the diff against the previous map and the removal of the marks are one pass
+ * over the candidates.
+ *
+ * @param lowThreshold Hysteresis low threshold.
+ * @param highThreshold Hysteresis high threshold.
+ * @param added Output indices (y * cols + x) of pixels that became edges.
+ * @param removed Output indices of pixels that stopped being edges.
+ * @return True if any edge pixel changed since the previous update.
+ */
+bool CannyCache::update(int lowThreshold, int highThreshold, vector<int>& added, vector<int>& removed) {
+    if (lowThreshold > highThreshold) {
+        swap(lowThreshold, highThreshold);
+    }
+
+    const int rows = suppressed.rows;
+    const int cols = suppressed.cols;
+    ushort* magnitude = suppressed.ptr<ushort>();
+
+    stack.clear();
+    for (int index : candidates) {
+        if (magnitude[index] > highThreshold) {
+            magnitude[index] |= edgeFlag;
+            stack.push_back(index);
+        }
+    }
+
+    while (!stack.empty()) {
+        const int index = stack.back();
+        stack.pop_back();
+        const int y = index / cols;
+        const int x = index - y * cols;
+        for (int ny = max(y - 1, 0); ny <= min(y + 1, rows - 1); ny++) {
+            for (int nx = max(x - 1, 0); nx <= min(x + 1, cols - 1); nx++) {
+                const int neighbor = ny * cols + nx;
+                if (!(magnitude[neighbor] & edgeFlag) && magnitude[neighbor] > lowThreshold) {
+                    magnitude[neighbor] |= edgeFlag;
+                    stack.push_back(neighbor);
+                }
+            }
+        }
+    }
+
+    added.clear();
+    removed.clear();
+    nextEdges.clear();
+    for (int index : candidates) {
+        const bool edge = (magnitude[index] & edgeFlag) != 0;
+        magnitude[index] &= ~edgeFlag;
+        const int y = index / cols;
+        if (edge) {
+            nextEdges.push_back(index);
+        }
+        if (edge != currentEdges.test(index - y * cols, y)) {
+            (edge ? added : removed).push_back(index);
+        }
+    }
+
+    currentEdges.assign(nextEdges);
+    return !added.empty() || !removed.empty();
+}
+
+/**
+ * @brief Gets the edge map of the last update.
+ *
+ * @return Packed map with its edge list, without edges before the first update.
+ */
+const EdgeMap& CannyCache::edges(void) const {
+    return currentEdges;
+}
+
+/**
+ * @brief Gets the number of local maxima hysteresis has to visit.
+ *
+ * @return The candidate count.
+ */
+size_t CannyCache::candidateCount(void) const {
+    return candidates.size();
+}
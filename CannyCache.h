@@ -0,0 +1,46 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+#include "EdgeMap.h"
+
+using namespace std;
+using namespace cv;
+
+/// CannyCache Class
+/// Threshold independent part of the Canny edge detector, computed once per image.
+/// Sobel gradients, the L1 magnitude and the non-maximum suppression along the gradient
+/// direction do not depend on the thresholds, so only the hysteresis has to be redone when
+/// the thresholds move. Hysteresis only visits the suppressed local maxima, and every update
+/// reports which edge pixels appeared or disappeared. The edge maps are packed, with the same
+/// edge pixels as Canny(gray, low, high) with aperture 3 and the L1 gradient.
+class CannyCache
+{
+public:
+    /// Constructor computing gradients and non-maximum suppression
+    /// @param gray Single channel 8-bit image.
+    explicit CannyCache(const Mat& gray);
+
+    /// Recompute the edge map for a threshold pair
+    /// @param lowThreshold Hysteresis low threshold.
+    /// @param highThreshold Hysteresis high threshold.
+    /// @param added Output indices (y * cols + x) of pixels that became edges.
+    /// @param removed Output indices of pixels that stopped being edges.
+    /// @return True if any edge pixel changed since the previous update.
+    bool update(int lowThreshold, int highThreshold, vector<int>& added, vector<int>& removed);
+
+    /// Get the edge map of the last update
+    /// @return Packed map with its edge list, without edges before the first update.
+    const EdgeMap& edges(void) const;
+
+    /// Get the number of local maxima hysteresis has to visit
+    /// @return The candidate count.
+    size_t candidateCount(void) const;
+
+private:
+    Mat suppressed;             ///< CV_16U L1 magnitude of the local maxima, 0 elsewhere
+    vector<int> candidates;     ///< Indices of the nonzero pixels of suppressed, in raster order
+    EdgeMap currentEdges;       ///< Edge map of the last update
+    vector<int> nextEdges;      ///< Scratch edge list of the running update
+    vector<int> stack;          ///< Hysteresis stack, kept to avoid reallocation
+};
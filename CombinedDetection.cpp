@@ -0,0 +1,233 @@
+#include "CombinedDetection.h"
+#include "CornerDetection.h"
+#include "HarrisKernel.h"
+#include "BufferPool.h"
+#include "ProbabilisticHough.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+namespace {
+    const int maxQualityLevel = 100;        // Same cap as CornerDetection
+    const int houghVotes = 50;              // Hough settings of LineDetection::detectFeatures
+    const int houghMinLength = 50;
+    const int houghMaxGap = 10;
+}
+
+/**
+ * @brief Constructor for the CombinedDetection class.
+ *
+ * @param filePath The file path of the image.
+ * @param fileName The name of the image file.
+ * @param scale The scaling factor for resizing the image.
+ */
+CombinedDetection::CombinedDetection(const string& filePath, const string& fileName, double& scale)
+    : Detection(filePath, fileName, scale), qualityLevel(50), suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0),
+    cannyLowThreshold(50), mergeSegments(false) {
+    logMessage("Constructor Created for CombinedDetection");
+}
+
+/**
+ * @brief Constructor for the CombinedDetection class from an image that is already in memory.
+ *
+ * @param image The BGR image to process, shared rather than copied.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CombinedDetection::CombinedDetection(const Mat& image, const string& fileName, double& scale)
+    : Detection(image, fileName, scale), qualityLevel(50), suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0),
+    cannyLowThreshold(50), mergeSegments(false) {
+    logMessage("Constructor Created for CombinedDetection");
+}
+
+/**
+ * @brief Constructor for the CombinedDetection class from an encoded image held in memory.
+ *
+ * @param encoded The encoded bytes, only read during construction.
+ * @param length Number of encoded bytes.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CombinedDetection::CombinedDetection(const uchar* encoded, size_t length, const string& fileName, double& scale)
+    : Detection(encoded, length, fileName, scale), qualityLevel(50), suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0),
+    cannyLowThreshold(50), mergeSegments(false) {
+    logMessage("Constructor Created for CombinedDetection");
+}
+
+/**
+ * @brief Constructor for the CombinedDetection class wrapping uncompressed pixels owned by the caller.
+ *
+ * @param pixels The first pixel, shared rather than copied.
+ * @param size Image size.
+ * @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+ * @param step Bytes per row, 0 for tightly packed rows.
+ * @param order Sample order of color pixels.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CombinedDetection::CombinedDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale)
+    : Detection(pixels, size, type, step, order, fileName, scale), qualityLevel(50), suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0),
+    cannyLowThreshold(50), mergeSegments(false) {
+    logMessage("Constructor Created for CombinedDetection");
+}
+
+/**
+ * @brief Constructor for the CombinedDetection class mapping a raw pixel file.
+ *
+ * @param filePath The raw file.
+ * @param layout Where and how the pixels are stored in the file.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CombinedDetection::CombinedDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale)
+    : Detection(filePath, layout, fileName, scale), qualityLevel(50), suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0),
+    cannyLowThreshold(50), mergeSegments(false) {
+    logMessage("Constructor Created for CombinedDetection");
+}
+
+/**
+ * @brief Destructor for the CombinedDetection class.
+ */
+CombinedDetection::~CombinedDetection() {
+    logMessage("Destructor Called for CombinedDetection");
+}
+
+/**
+ * @brief Detects corners and line segments from one shared gradient pass.
+ *
+ * The 3 x 3 Sobel derivatives are taken once in 16 bits with replicated borders, exactly as
+ * Canny takes them. Canny runs its magnitude, non-maximum suppression and hysteresis on them
+ * directly, and the fused Harris kernel scales the rows each band needs to float instead of
+ * differentiating the image again.
+ */
+void CombinedDetection::detectFeatures() {
+    TRACE_STAGE("detectCombined");
+    const Mat& gray = getImage();
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw runtime_error("Combined detection needs the single channel 8-bit image left by grayscale preprocessing");
+    }
+    if (!getDetectionRegions().empty() || getPyramidLevels() > 0) {
+        throw runtime_error("Combined detection runs on the whole frame, use CornerDetection and LineDetection for regions and pyramids");
+    }
+
+    PooledMat dxBuffer(gray.rows, gray.cols, CV_16S), dyBuffer(gray.rows, gray.cols, CV_16S);
+    Mat& dx = dxBuffer.get();
+    Mat& dy = dyBuffer.get();
+    Sobel(gray, dx, CV_16S, 1, 0, 3, 1, 0, BORDER_REPLICATE);
+    Sobel(gray, dy, CV_16S, 0, 1, 3, 1, 0, BORDER_REPLICATE);
+
+    vector<Point> corners;
+    PooledVector<float> scoreBuffer;
+    vector<float>& scores = scoreBuffer.get();
+    HarrisKernel(2, 3, 0.04).detect(gray, dx, dy, qualityLevel, suppressionRadius, corners, gridCellSize > 0 ? &scores : nullptr);
+    if (gridCellSize > 0) {
+        CornerDetection::bucketCorners(corners, scores, gridCellSize, maxCornersPerCell);
+    }
+
+    vector<Vec4i> lines;
+    PooledMat edgeBuffer(gray.rows, gray.cols, CV_8U);
+    Canny(dx, dy, edgeBuffer.get(), cannyLowThreshold, cannyLowThreshold * 3);
+    EdgeMap edges;
+    edges.pack(edgeBuffer.get());
+    ProbabilisticHough::findSegments(edges, 1, CV_PI / 180, houghVotes, houghMinLength, houghMaxGap, lines);
+    if (mergeSegments) {
+        SegmentMerger::merge(lines, mergeTolerances);
+    }
+
+    traceStage.setCount(corners.size() + lines.size());
+    setCornerFeatures(move(corners));
+    setLineFeatures(move(lines));
+    logMessage("Corners and lines detected and stored in features.");
+}
+
+/**
+ * @brief Gets the Harris quality level.
+ *
+ * @return The threshold on the normalized (0-255) response.
+ */
+int CombinedDetection::getQualityLevel(void) const {
+    return qualityLevel;
+}
+
+/**
+ * @brief Sets the Harris quality level.
+ *
+ * @param q The threshold on the normalized (0-255) response.
+ */
+void CombinedDetection::setQualityLevel(int q) {
+    if (q < 0 || q > maxQualityLevel) {
+        throw invalid_argument("Quality level must be between 0 and " + to_string(maxQualityLevel));
+    }
+    qualityLevel = q;
+}
+
+/**
+ * @brief Sets the corner non-maximum suppression radius.
+ *
+ * @param radius The radius in pixels, 0 to disable suppression.
+ */
+void CombinedDetection::setSuppressionRadius(int radius) {
+    if (radius < 0) {
+        throw invalid_argument("Suppression radius cannot be negative");
+    }
+    suppressionRadius = radius;
+}
+
+/**
+ * @brief Enables or disables corner grid bucketing.
+ *
+ * @param cellSize Width and height of a grid cell in pixels, 0 to disable bucketing.
+ * @param maxPerCell Maximum number of corners kept per cell.
+ */
+void CombinedDetection::setGridBucketing(int cellSize, int maxPerCell) {
+    if (cellSize < 0 || (cellSize > 0 && maxPerCell < 1)) {
+        throw invalid_argument("Grid cell size cannot be negative and each cell must keep at least one corner");
+    }
+    gridCellSize = cellSize;
+    maxCornersPerCell = maxPerCell;
+}
+
+/**
+ * @brief Gets the Canny low threshold.
+ *
+ * @return The hysteresis low threshold.
+ */
+int CombinedDetection::getCannyLowThreshold(void) const {
+    return cannyLowThreshold;
+}
+
+/**
+ * @brief Sets the Canny low threshold.
+ *
+ * @param threshold The hysteresis low threshold, the high threshold is three times as large.
+ */
+void CombinedDetection::setCannyLowThreshold(int threshold) {
+    if (threshold < 0) {
+        throw invalid_argument("Canny threshold cannot be negative");
+    }
+    cannyLowThreshold = threshold;
+}
+
+/**
+ * @brief Enables or disables merging of collinear fragments and near-duplicate segments.
+ *
+ * @param enabled True to merge the detected segments.
+ * @param tolerances The match tolerances.
+ */
+void CombinedDetection::setSegmentMerging(bool enabled, const MergeTolerances& tolerances) {
+    mergeSegments = enabled;
+    mergeTolerances = tolerances;
+}
+
+/**
+ * @brief Records the Harris, Canny and Hough settings in a binary feature file header.
+ *
+ * @param header The header to complete.
+ */
+void CombinedDetection::describeParameters(FeatureFileHeader& header) const {
+    Detection::describeParameters(header);
+    header.detectors |= FeatureFileCorners | FeatureFileLines;
+    header.qualityLevel = qualityLevel;
+    header.suppressionRadius = suppressionRadius;
+    header.cannyLowThreshold = cannyLowThreshold;
+    header.houghThreshold = houghVotes;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Detection.h"
+#include "SegmentMerger.h"
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// CombinedDetection Class
+/// Detects corners and line segments of one image in a single pass. The image is read and
+/// preprocessed once, and one Sobel pass feeds both the fused Harris structure tensor and
+/// Canny's magnitude, direction and hysteresis, which CornerDetection and LineDetection would
+/// each compute on their own. Corners match CornerDetection with the fused Harris engine up to
+/// float rounding at the threshold, segments match LineDetection with the Hough engine exactly.
+/// Regions of interest and pyramids are not supported, use the separate detectors for them.
+class CombinedDetection : public Detection
+{
+public:
+    /// Constructor
+    /// @param filePath The file path of the image to process.
+    /// @param fileName The name of the image file.
+    /// @param scale The scale factor for resizing the image.
+    CombinedDetection(const string& filePath, const string& fileName, double& scale);
+
+    /// Constructor for an image that is already in memory
+    /// @param image The BGR image to process, shared rather than copied.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing the image.
+    CombinedDetection(const Mat& image, const string& fileName, double& scale);
+
+    /// Constructor decoding an encoded image held in memory
+    /// @param encoded The encoded bytes, only read during construction.
+    /// @param length Number of encoded bytes.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing the image.
+    CombinedDetection(const uchar* encoded, size_t length, const string& fileName, double& scale);
+
+    /// Constructor wrapping uncompressed pixels owned by the caller, which must outlive the object
+    /// @param pixels The first pixel, shared rather than copied.
+    /// @param size Image size.
+    /// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+    /// @param step Bytes per row, 0 for tightly packed rows.
+    /// @param order Sample order of color pixels.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing the image.
+    CombinedDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale);
+
+    /// Constructor mapping a raw pixel file without decoding or copying it
+    /// @param filePath The raw file.
+    /// @param layout Where and how the pixels are stored in the file.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing the image.
+    CombinedDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale);
+
+    /// Destructor
+    ~CombinedDetection();
+
+    /// Detect corners and line segments from one shared gradient pass
+    /// Needs the single channel 8-bit image left by grayscale preprocessing.
+    void detectFeatures(void) override;
+
+    /// Get the Harris quality level
+    /// @return The threshold on the normalized (0-255) response.
+    int getQualityLevel(void) const;
+
+    /// Set the Harris quality level
+    /// @param q The threshold on the normalized (0-255) response.
+    void setQualityLevel(int q);
+
+    /// Set the corner non-maximum suppression radius
+    /// @param radius The radius in pixels, 0 to disable suppression.
+    void setSuppressionRadius(int radius);
+
+    /// Enable or disable corner grid bucketing
+    /// @param cellSize Width and height of a grid cell in pixels, 0 to disable bucketing.
+    /// @param maxPerCell Maximum number of corners kept per cell.
+    void setGridBucketing(int cellSize, int maxPerCell);
+
+    /// Get the Canny low threshold
+    /// @return The hysteresis low threshold, the high threshold is three times as large.
+    int getCannyLowThreshold(void) const;
+
+    /// Set the Canny low threshold
+    /// @param threshold The hysteresis low threshold, the high threshold is three times as large.
+    void setCannyLowThreshold(int threshold);
+
+    /// Enable or disable merging of collinear fragments and near-duplicate segments
+    /// @param enabled True to merge the detected segments.
+    /// @param tolerances The match tolerances.
+    void setSegmentMerging(bool enabled, const MergeTolerances& tolerances = MergeTolerances());
+
+protected:
+    /// Record the Harris, Canny and Hough settings in a binary feature file header
+    /// @param header The header to complete.
+    void describeParameters(FeatureFileHeader& header) const override;
+
+private:
+    int qualityLevel;                       ///< Harris threshold on the normalized response
+    int suppressionRadius;                  ///< Corner non-maximum suppression radius, 0 when disabled
+    int gridCellSize;                       ///< Corner bucketing cell size, 0 when disabled
+    int maxCornersPerCell;                  ///< Corners kept per bucketing cell
+    int cannyLowThreshold;                  ///< Canny hysteresis low threshold
+    bool mergeSegments;                     ///< True to merge the detected segments
+    MergeTolerances mergeTolerances;        ///< Tolerances of the segment merge
+};
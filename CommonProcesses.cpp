@@ -1,26 +1,113 @@
 #include "CommonProcesses.h"
+#include "Profiler.h"
 #include <stdexcept>
+#include <climits>
 #include <fstream>
 
 using namespace std;
 using namespace cv;
 
-
+/// Progress messages are printed unless a headless run disables them
+bool CommonProcesses::verbose = true;
 
 /// Constructor with an optional filePath and fileName
 CommonProcesses::CommonProcesses(const string& filePath, const string& fileName, double& scale)
 {	
-	cout << "Constructor Created for CommonProcesses " << endl;
+	if (verbose) cout << "Constructor Created for CommonProcesses " << '\n';
 	setScaleFactor(scale);
 	setfileName(fileName);
 	readImage(filePath);
 	
 	
 }
+/// Constructor for an image that is already in memory
+/// @param image The BGR image to process, shared rather than copied.
+/// @param fileName The name identifying the image.
+/// @param scale The scale factor for resizing.
+CommonProcesses::CommonProcesses(const Mat& image, const string& fileName, double& scale)
+{
+	if (verbose) cout << "Constructor Created for CommonProcesses " << '\n';
+	if (image.empty())
+	{
+		throw runtime_error("Image could not be loaded");
+	}
+
+	setScaleFactor(scale);
+	setfileName(fileName);
+	this->image = image;
+}
+
+/// Constructor decoding an encoded image held in memory
+/// @param encoded The encoded bytes, wrapped rather than copied for decoding.
+/// @param length Number of encoded bytes.
+/// @param fileName The name identifying the image.
+/// @param scale The scale factor for resizing.
+CommonProcesses::CommonProcesses(const uchar* encoded, size_t length, const string& fileName, double& scale)
+{
+	if (verbose) cout << "Constructor Created for CommonProcesses " << '\n';
+	if (encoded == nullptr || length == 0 || length > static_cast<size_t>(INT_MAX))
+	{
+		throw runtime_error("Image could not be loaded");
+	}
+
+	setScaleFactor(scale);
+	setfileName(fileName);
+	{
+		TRACE_STAGE("read");
+		image = imdecode(Mat(1, static_cast<int>(length), CV_8UC1, const_cast<uchar*>(encoded)), IMREAD_COLOR);
+	}
+	if (image.empty())
+	{
+		throw runtime_error("Image could not be decoded");
+	}
+}
+
+/// Constructor wrapping uncompressed pixels owned by the caller
+/// @param pixels The first pixel, shared rather than copied.
+/// @param size Image size.
+/// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+/// @param step Bytes per row, 0 for tightly packed rows.
+/// @param order Sample order of color pixels.
+/// @param fileName The name identifying the image.
+/// @param scale The scale factor for resizing.
+CommonProcesses::CommonProcesses(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale)
+{
+	if (verbose) cout << "Constructor Created for CommonProcesses " << '\n';
+	if (pixels == nullptr || size.width <= 0 || size.height <= 0)
+	{
+		throw runtime_error("Image could not be loaded");
+	}
+	if (type != CV_8UC1 && type != CV_8UC3 && type != CV_8UC4)
+	{
+		throw invalid_argument("Raw pixels must be 8-bit with 1, 3 or 4 channels");
+	}
+
+	setScaleFactor(scale);
+	setfileName(fileName);
+	image = Mat(size, type, pixels, step); /// A step of 0 is Mat::AUTO_STEP
+	channelOrder = order;
+}
+
+/// Constructor mapping a raw pixel file
+/// @param filePath The raw file.
+/// @param layout Where and how the pixels are stored in the file.
+/// @param fileName The name identifying the image.
+/// @param scale The scale factor for resizing.
+CommonProcesses::CommonProcesses(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale)
+{
+	if (verbose) cout << "Constructor Created for CommonProcesses " << '\n';
+	setScaleFactor(scale);
+	setfileName(fileName);
+
+	mappedImage.reset(new MappedImage(filePath, layout));
+	image = mappedImage->getImage();
+	channelOrder = layout.order;
+}
+
 /// Destructor for CommonProcessor
 CommonProcesses::~CommonProcesses()
 {
-	cout << "Destructor Called for CommonProcesses " << endl;
+	if (verbose) cout << "Destructor Called for CommonProcesses " << '\n';
 }
 
 /// Get the original image
@@ -54,9 +141,22 @@ void CommonProcesses::setfileName(string const& nameOfFile)
 
 
 /// Read an image from the specified file path
+/// Binary PGM and PPM files are wrapped in place through a copy-on-write mapping.
 /// @param filePath The path of the image file to load.
 void CommonProcesses::readImage(const string& filePath)
 {
+	TRACE_STAGE("read");
+	RawImageLayout layout;
+	if (MappedImage::readPnmLayout(filePath, layout))
+	{
+		/// The previous mapping stays alive until the image no longer points into it
+		unique_ptr<MappedImage> mapped(new MappedImage(filePath));
+		image = mapped->getImage();
+		channelOrder = layout.order;
+		mappedImage = move(mapped);
+		return;
+	}
+
 	image = imread(filePath,IMREAD_COLOR); /// IMREAD_COLOR = If set, always convert image to the 3 channel BGR color image.
 
 	if (image.empty())
@@ -65,18 +165,42 @@ void CommonProcesses::readImage(const string& filePath)
 
 		throw runtime_error("Image could not be loaded");
 	}
+	channelOrder = ChannelOrder::BGR;
+	mappedImage.reset();
+
+}
 
+/// Get the sample order of the color image
+/// @return The sample order of the pixels returned by getImage.
+ChannelOrder CommonProcesses::getChannelOrder(void) const
+{
+	return channelOrder;
+}
+
+/// Set the sample order of the color image
+/// @param order The sample order of the pixels returned by getImage.
+void CommonProcesses::setChannelOrder(ChannelOrder order)
+{
+	channelOrder = order;
 }
 
 /// Convert the given image to grayscale
 /// @param image A reference to the Mat object to convert.
 void CommonProcesses::convertToGrayScale(Mat& image)
 {	
+	TRACE_STAGE("convert");
 	/// Check if the image is empty
 	if (!image.empty())
 	{
-		cvtColor(image, image, COLOR_BGR2GRAY);
-		cout << "The file image  has been converted to grayscale " << endl;
+		if (image.channels() == 3)
+		{
+			cvtColor(image, image, channelOrder == ChannelOrder::RGB ? COLOR_RGB2GRAY : COLOR_BGR2GRAY);
+		}
+		else if (image.channels() == 4)
+		{
+			cvtColor(image, image, channelOrder == ChannelOrder::RGB ? COLOR_RGBA2GRAY : COLOR_BGRA2GRAY);
+		}
+		if (verbose) cout << "The file image  has been converted to grayscale " << '\n';
 	}
 	else
 	{
@@ -87,11 +211,21 @@ void CommonProcesses::convertToGrayScale(Mat& image)
 }
 
 /// Display the given image in a window
+/// imshow expects BGR, so RGB samples (mapped PPMs, capture buffers) are swapped for display.
 /// @param windowName The name of the display window.
 /// @param image A reference to the Mat object to display.
 void CommonProcesses::showImage(const string& windowName, Mat& image) const
 {
-	imshow(windowName,image);
+	if (channelOrder == ChannelOrder::RGB && (image.channels() == 3 || image.channels() == 4))
+	{
+		Mat shown;
+		cvtColor(image, shown, image.channels() == 3 ? COLOR_RGB2BGR : COLOR_RGBA2BGRA);
+		imshow(windowName, shown);
+	}
+	else
+	{
+		imshow(windowName, image);
+	}
 	waitKey(0);
 }
 
@@ -113,40 +247,183 @@ void CommonProcesses::showGrayLevelImage(const string& windowName) const
 /// @param fileName The name of the file to save the RGB values
 void CommonProcesses::saveRGBToFile(const Mat& image, const string& fileName)
 {	
-	// Creating the file for RGB values.
-	ofstream outFile(fileName);
-	if (!outFile.is_open()) {
-		cerr << "Error: Could not open file!" << endl;
-		throw runtime_error("Could not open file " + fileName);
+	saveRGBToFile(image, fileName, RGBDumpFormat::Text);
+}
+
+/// Size of the output produced per chunk of rows
+static const size_t dumpChunkBytes = 4 * 1024 * 1024;
+
+/// Longest formatted pixel: "Pixel (" + 10 digits + ", " + 10 digits + "): R: 255, G: 255, B: 255\n"
+static const size_t maxFormattedPixelBytes = 56;
+
+/// Append the decimal digits of a non-negative integer
+/// @param out Output position.
+/// @param value The value to format.
+/// @return The position after the last digit.
+static char* appendDecimal(char* out, int value)
+{
+	char digits[10];
+	int count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	while (count > 0) {
+		*out++ = digits[--count];
 	}
+	return out;
+}
 
-	// Taking the row and column variables.
+/// Append a NUL terminated literal
+/// @param out Output position.
+/// @param text The literal to copy.
+/// @return The position after the last character.
+static char* appendLiteral(char* out, const char* text)
+{
+	while (*text) {
+		*out++ = *text++;
+	}
+	return out;
+}
 
+/// Format one image row in the Text or CSV layout
+/// @param image The 8-bit gray or 3 channel image.
+/// @param y The row to format.
+/// @param format Text or CSV.
+/// @param rgb Sample positions of red, green and blue within a pixel.
+/// @param out Output buffer of at least cols * maxFormattedPixelBytes bytes.
+/// @return The number of bytes written.
+static size_t formatPixelRow(const Mat& image, int y, RGBDumpFormat format, const int rgb[3], char* out)
+{
+	char* start = out;
+	const uchar* row = image.ptr<uchar>(y);
+	const int channels = image.channels();
+
+	for (int x = 0; x < image.cols; x++) {
+		const uchar* pixel = row + x * channels;
+		if (format == RGBDumpFormat::CSV) {
+			out = appendDecimal(out, y);
+			*out++ = ',';
+			out = appendDecimal(out, x);
+			*out++ = ',';
+			out = appendDecimal(out, pixel[rgb[0]]);
+			*out++ = ',';
+			out = appendDecimal(out, pixel[rgb[1]]);
+			*out++ = ',';
+			out = appendDecimal(out, pixel[rgb[2]]);
+			*out++ = '\n';
+		}
+		else {
+			out = appendLiteral(out, "Pixel (");
+			out = appendDecimal(out, y);
+			out = appendLiteral(out, ", ");
+			out = appendDecimal(out, x);
+			out = appendLiteral(out, "): R: ");
+			out = appendDecimal(out, pixel[rgb[0]]);
+			out = appendLiteral(out, ", G: ");
+			out = appendDecimal(out, pixel[rgb[1]]);
+			out = appendLiteral(out, ", B: ");
+			out = appendDecimal(out, pixel[rgb[2]]);
+			*out++ = '\n';
+		}
+	}
 
-	
+	return static_cast<size_t>(out - start);
+}
+
+/// Save the RGB values of an image in the selected layout
+/// Color samples are read in the order of getChannelOrder; a gray image is dumped with R = G = B.
+/// @param image The 8-bit gray or 3 channel image to dump.
+/// @param fileName The name of the output file.
+/// @param format The output layout.
+void CommonProcesses::saveRGBToFile(const Mat& image, const string& fileName, RGBDumpFormat format)
+{
+	TRACE_STAGE("saveRGB");
+	if (image.empty() || (image.type() != CV_8UC3 && image.type() != CV_8UC1))
+	{
+		throw runtime_error("RGB values can only be saved for a non-empty 8-bit gray or 3 channel image");
+	}
 
-	for (int y = 0; y < image.rows; y++) {   // Iterate over rows
-		for (int x = 0; x < image.cols; x++) {  // Iterate over columns
-			cv::Vec3b pixel = image.at<cv::Vec3b>(y, x);  // Get the pixel value
+	// Sample positions of red, green and blue, a gray image repeats its one sample
+	const bool gray = image.channels() == 1;
+	const int red = gray || channelOrder == ChannelOrder::RGB ? 0 : 2;
+	const int rgb[3] = { red, gray ? 0 : 1, gray ? 0 : 2 - red };
 
-			int blue = pixel[0];
-			int green = pixel[1];
-			int red = pixel[2];
+	// Text keeps the platform newline convention of the original dump, the other layouts are written verbatim
+	ofstream outFile(fileName, format == RGBDumpFormat::Text ? ios::out : ios::out | ios::binary);
+	if (!outFile.is_open()) {
+		cerr << "Error: Could not open file!" << endl;
+		throw runtime_error("Could not open file " + fileName);
+	}
+
+	if (format == RGBDumpFormat::Text || format == RGBDumpFormat::CSV)
+	{
+		// Every row of a chunk is formatted into its own reusable buffer in parallel, then written in order
+		const size_t rowBytes = static_cast<size_t>(image.cols) * maxFormattedPixelBytes;
+		const int chunkRows = static_cast<int>(min<size_t>(image.rows, max<size_t>(1, dumpChunkBytes / rowBytes)));
+		vector<vector<char>> rowBuffers(chunkRows, vector<char>(rowBytes));
+		vector<size_t> rowLengths(chunkRows);
+
+		if (format == RGBDumpFormat::CSV) {
+			outFile << "y,x,r,g,b\n";
+		}
 
-			// Write RGB values to the file
-			outFile << "Pixel (" << y << ", " << x << "): "
-				<< "R: " << red << ", G: " << green << ", B: " << blue << "\n";
+		for (int y0 = 0; y0 < image.rows; y0 += chunkRows) {
+			int rows = min(chunkRows, image.rows - y0);
+			parallel_for_(Range(0, rows), [&](const Range& range) {
+				for (int i = range.start; i < range.end; i++) {
+					rowLengths[i] = formatPixelRow(image, y0 + i, format, rgb, rowBuffers[i].data());
+				}
+			});
+			for (int i = 0; i < rows; i++) {
+				outFile.write(rowBuffers[i].data(), rowLengths[i]);
+			}
+		}
+	}
+	else
+	{
+		// Raw layouts convert chunks of rows into one reusable 8-bit buffer and write it as is
+		const size_t rowBytes = static_cast<size_t>(image.cols) * 3;
+		const int chunkRows = static_cast<int>(min<size_t>(image.rows, max<size_t>(1, dumpChunkBytes / rowBytes)));
+		Mat chunk(chunkRows, image.cols, format == RGBDumpFormat::RawInterleaved ? CV_8UC3 : CV_8UC1);
+
+		// RGB order: interleaved converts to RGB, planar extracts the red, green and blue samples
+		const int planeCount = format == RGBDumpFormat::RawInterleaved ? 1 : 3;
+		for (int plane = 0; plane < planeCount; plane++) {
+			for (int y0 = 0; y0 < image.rows; y0 += chunkRows) {
+				int rows = min(chunkRows, image.rows - y0);
+				Mat source = image.rowRange(y0, y0 + rows);
+				Mat destination = chunk.rowRange(0, rows);
+				if (format != RGBDumpFormat::RawInterleaved) {
+					extractChannel(source, destination, rgb[plane]);
+				}
+				else if (gray) {
+					cvtColor(source, destination, COLOR_GRAY2RGB);
+				}
+				else if (channelOrder == ChannelOrder::RGB) {
+					source.copyTo(destination);
+				}
+				else {
+					cvtColor(source, destination, COLOR_BGR2RGB);
+				}
+				outFile.write(reinterpret_cast<const char*>(destination.data), destination.total() * destination.elemSize());
+			}
 		}
 	}
 
+	if (!outFile) {
+		throw runtime_error("Could not write file " + fileName);
+	}
 	outFile.close();
-	cout << "RGB values " << fileName << " successfully saved to file." << endl;
+	if (verbose) cout << "RGB values " << fileName << " successfully saved to file." << '\n';
 }
 
 /// Rescale the given image by a scale factor
 /// @param image A reference to the Mat object to resize.
 void CommonProcesses::rescaleImage(Mat& image) const
 {	
+	TRACE_STAGE("rescale");
 	double localScaleFactor = getScaleFactor();
 	if (localScaleFactor <= 0)
 	{
@@ -154,19 +431,42 @@ void CommonProcesses::rescaleImage(Mat& image) const
 	}
 
 	resize(image, image, Size(), localScaleFactor, localScaleFactor);
-	cout << "Image Resized" << endl;
+	if (verbose) cout << "Image Resized" << '\n';
+
+}
 
+/// Build a coarser pyramid level of the given image by repeated pyrDown
+/// @param image The full resolution image.
+/// @param level Output image reduced by 2^levels.
+/// @param levels Number of halvings.
+void CommonProcesses::buildPyramidLevel(const Mat& image, Mat& level, int levels) const
+{
+	if (levels < 0)
+	{
+		throw invalid_argument("Pyramid levels cannot be negative.");
+	}
+
+	level = image;
+	for (int i = 0; i < levels; i++)
+	{
+		Mat reduced;
+		pyrDown(level, reduced);
+		level = reduced;
+	}
 }
 
 /// Apply Gaussian blur to reduce noise in the given image
 /// @param image A reference to the Mat object to apply the filter.
-void CommonProcesses::filterNoiseGaus(Mat& image)
+/// @param kernelSize Odd aperture size.
+/// @param backend The filter implementation.
+void CommonProcesses::filterNoiseGaus(Mat& image, int kernelSize, FilterBackend backend)
 {	
+	TRACE_STAGE("filter");
 
 	if (!image.empty())
 	{
-		GaussianBlur(image, image, Size(3,3), 0);
-		cout << "Noise in the image was cleaned using the GaussianBlur filter. " << endl;
+		NoiseFilter::gaussian(image, image, kernelSize, backend);
+		if (verbose) cout << "Noise in the image was cleaned using the GaussianBlur filter. " << '\n';
 	}
 	else
 	{
@@ -178,13 +478,16 @@ void CommonProcesses::filterNoiseGaus(Mat& image)
 
 /// Apply median blur to reduce noise in the given image
 /// @param image A reference to the Mat object to apply the filter.
-void CommonProcesses::filterNoiseMedian(Mat& image)
+/// @param kernelSize Odd aperture size, at least 3.
+/// @param backend The filter implementation.
+void CommonProcesses::filterNoiseMedian(Mat& image, int kernelSize, FilterBackend backend)
 {	
+	TRACE_STAGE("filter");
 
 	if (!image.empty())
 	{
-		medianBlur(image, image, 11);
-		cout << "Noise in the image was cleaned using the median filter. " << endl;
+		NoiseFilter::median(image, image, kernelSize, backend);
+		if (verbose) cout << "Noise in the image was cleaned using the median filter. " << '\n';
 	}
 	else
 	{
@@ -193,6 +496,38 @@ void CommonProcesses::filterNoiseMedian(Mat& image)
 
 }
 
+/// Replace the image with the result of a preprocessing pipeline
+/// The image takes over the result buffer of the pipeline instead of copying it, and the
+/// input pixels are left untouched, so they may be shared with the caller or another detector.
+/// Stage windows reuse the names of the individual calls: GrayScale, Resized and Filtered.
+/// @param pipeline The stages to run.
+/// @param showStages True to display the raw image and every stage result.
+void CommonProcesses::preprocess(PreprocessingPipeline& pipeline, bool showStages)
+{
+	if (image.empty())
+	{
+		throw runtime_error("image file is empty preprocessing cannot be applied!");
+	}
+
+	if (showStages)
+	{
+		showImage("Raw Image", image);
+		pipeline.setStageObserver([this](const PreprocessStep& step, const Mat& result) {
+			Mat shown = result;
+			switch (step.stage)
+			{
+			case PreprocessStage::Grayscale: showImage("GrayScale", shown); break;
+			case PreprocessStage::Rescale: showImage("Resized", shown); break;
+			default: showImage("Filtered", shown); break;
+			}
+		});
+	}
+
+	image = pipeline.run(image, channelOrder);
+	pipeline.setStageObserver(PreprocessingPipeline::StageObserver());
+	if (verbose) cout << "Image preprocessed: " << pipeline.describe() << '\n';
+}
+
 /// Get the scale factor
 /// @return The current scale factor.
 double CommonProcesses::getScaleFactor(void) const
@@ -215,3 +550,16 @@ void CommonProcesses::setScaleFactor(double& sf)
 	
 }
 
+/// Enable or disable console progress messages
+/// @param enabled True to print progress messages.
+void CommonProcesses::setVerbose(bool enabled)
+{
+	verbose = enabled;
+}
+
+/// Check whether console progress messages are enabled
+/// @return True if progress messages are printed.
+bool CommonProcesses::isVerbose(void)
+{
+	return verbose;
+}
@@ -7,6 +7,9 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <memory>
+#include "MappedImage.h"
+#include "PreprocessingPipeline.h"
 
 /* *******************************************************
  * Filename		:	CommonProcesses.h
@@ -18,6 +21,11 @@
 using namespace std;
 using namespace cv;
 
+/// Output layouts of CommonProcesses::saveRGBToFile
+/// Text is the original "Pixel (y, x): R: r, G: g, B: b" listing, CSV writes "y,x,r,g,b" rows,
+/// RawInterleaved writes R,G,B bytes per pixel and RawPlanar writes the whole R, G and B planes in turn.
+enum class RGBDumpFormat { Text, CSV, RawInterleaved, RawPlanar };
+
 /// CommonProcesses Class
 /// This class provides common image processing utilities such as image reading, grayscale conversion, resizing, noise filtering, and more.
 
@@ -33,6 +41,38 @@ public:
 	 /// @param scale The scale factor for resizing.
 	CommonProcesses(const string& filePath, const string& fileName, double& scale ); //ok
 
+	/// Constructor for an image that is already in memory, e.g. a video frame
+	/// The Mat header is shared, the pixels are not copied.
+	/// @param image The BGR image to process.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing.
+	CommonProcesses(const Mat& image, const string& fileName, double& scale);
+
+	/// Constructor decoding an encoded image held in memory, e.g. a received JPEG or PNG
+	/// @param encoded The encoded bytes, only read during construction.
+	/// @param length Number of encoded bytes.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing.
+	CommonProcesses(const uchar* encoded, size_t length, const string& fileName, double& scale);
+
+	/// Constructor wrapping uncompressed pixels owned by the caller, e.g. a capture buffer
+	/// The pixels are not copied and must outlive the object; preprocessing may write into them.
+	/// @param pixels The first pixel.
+	/// @param size Image size.
+	/// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+	/// @param step Bytes per row, 0 for tightly packed rows.
+	/// @param order Sample order of color pixels.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing.
+	CommonProcesses(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale);
+
+	/// Constructor mapping a raw pixel file without decoding or copying it
+	/// @param filePath The raw file.
+	/// @param layout Where and how the pixels are stored in the file.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing.
+	CommonProcesses(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale);
+
 	/// Destructor for CommonProcesses
 	virtual ~CommonProcesses(); 
 
@@ -53,14 +93,25 @@ public:
 	void setfileName(string const& nameOfFile);
 
 	/// Read an image from the local file system
+	/// Binary PGM and PPM files are memory mapped instead of decoded, other formats go through imread.
 	/// @param filePath The file path of the image to read.
 	void readImage(const string& filePath); 
 
+	/// Get the sample order of the color image
+	/// @return RGB for mapped PPM files and RGB raw pixels, BGR otherwise.
+	ChannelOrder getChannelOrder(void) const;
+
+	/// Set the sample order of the color image
+	/// @param order The sample order of the pixels returned by getImage.
+	void setChannelOrder(ChannelOrder order);
+
 	/// Convert the RGB image to grayscale
+	/// The sample order of the image is taken from getChannelOrder; single channel images are left as they are.
 	/// @param image Reference to the Mat object containing the image to convert.
 	void convertToGrayScale(Mat& image); 
 
 	/// Display the image in a window
+	/// Color images are taken in the sample order of getChannelOrder and shown as BGR.
 	/// @param windowName The name of the window.
 	/// @param image Reference to the Mat object containing the image to display.
 	void showImage(const string& windowName, Mat& image) const;
@@ -71,21 +122,48 @@ public:
 
 	/// Save the RGB values of the image to a text file
 	/// Format: Pixel(x, y): R: r_value, G: g_value, B: b_value
+	/// Color images are taken in the sample order of getChannelOrder, gray images repeat their value.
 	/// @param image The Mat object containing the image to process.
 	/// @param fileName The name of the file to save the RGB values.
 	void saveRGBToFile(const Mat& image, const string& fileName);
 
+	/// Save the RGB values of the image in the selected layout
+	/// The image is streamed in row chunks through fixed-size buffers, so memory stays flat for any image size.
+	/// Text and CSV rows are formatted in parallel with hand-rolled integer formatting.
+	/// @param image The 8-bit gray or 3 channel image to dump, color in the order of getChannelOrder.
+	/// @param fileName The name of the output file.
+	/// @param format The output layout.
+	void saveRGBToFile(const Mat& image, const string& fileName, RGBDumpFormat format);
+
 	/// Resize the image using the resize function
 	/// @param image Reference to the Mat object containing the image to resize.
 	void rescaleImage(Mat& image) const; 
 
+	/// Build a coarser pyramid level of the given image
+	/// Every level halves the resolution with pyrDown, which low-pass filters before decimating,
+	/// so pixel (x, y) of the result sits at (x * 2^levels, y * 2^levels) of the input.
+	/// @param image The full resolution image.
+	/// @param level Output image reduced by 2^levels, sharing the input data when levels is 0.
+	/// @param levels Number of halvings.
+	void buildPyramidLevel(const Mat& image, Mat& level, int levels) const;
+
 	/// Reduce noise in the image using a Gaussian filter
 	/// @param image Reference to the Mat object containing the image to filter.
-	void filterNoiseGaus(Mat& image); 
+	/// @param kernelSize Odd aperture size.
+	/// @param backend The filter implementation, see NoiseFilter.
+	void filterNoiseGaus(Mat& image, int kernelSize = 3, FilterBackend backend = FilterBackend::Auto); 
 
 	/// Reduce noise in the image using a Median filter
 	/// @param image Reference to the Mat object containing the image to filter
-	void filterNoiseMedian(Mat& image);
+	/// @param kernelSize Odd aperture size, at least 3.
+	/// @param backend The filter implementation, see NoiseFilter.
+	void filterNoiseMedian(Mat& image, int kernelSize = 11, FilterBackend backend = FilterBackend::Auto);
+
+	/// Replace the image with the result of a preprocessing pipeline
+	/// The pipeline keeps its buffers, so reusing it for images of the same size does not reallocate them.
+	/// @param pipeline The stages to run.
+	/// @param showStages True to display the raw image and every stage result.
+	virtual void preprocess(PreprocessingPipeline& pipeline, bool showStages = false);
 
 
 	
@@ -97,8 +175,20 @@ public:
     /// @param sf The scale factor.
 	void setScaleFactor(double& sf); 
 
+	/// Enable or disable console progress messages
+	/// Headless batch runs switch this off so worker threads do not contend on cout.
+	/// @param enabled True to print progress messages.
+	static void setVerbose(bool enabled);
+
+	/// Check whether console progress messages are enabled
+	/// @return True if progress messages are printed.
+	static bool isVerbose(void);
+
 private:
 
+		/// Console progress messages switch shared by all instances
+		static bool verbose;
+
 		/// Storing raw RGB Values with static Mat class
 		Mat image; 
 
@@ -108,6 +198,12 @@ private:
 		/// Scaling Factor
 		double scaleFactor;
 
+		/// Sample order of the color image
+		ChannelOrder channelOrder = ChannelOrder::BGR;
+
+		/// Mapping the image points into when it was read without decoding
+		unique_ptr<MappedImage> mappedImage;
+
 		/// Name of File
 		string fileName;
 
@@ -1,4 +1,11 @@
 #include "CornerDetection.h"
+#include "FixedPointHarris.h"
+#include "HarrisKernel.h"
+#include "BufferPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <tuple>
 
 /**
  * @brief Constructor for the CornerDetection class.
@@ -10,7 +17,71 @@
  * @param scale The scaling factor for resizing the image.
  */
 CornerDetection::CornerDetection(const string& filePath, const string& fileName, double& scale)
-    : Detection(filePath, fileName, scale), qualityLevel(50) {
+    : Detection(filePath, fileName, scale), qualityLevel(50), harrisEngine(HarrisEngine::OpenCV),
+    suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0), cornerBudget(0), budgetSpacing(0),
+    budgetFrontEnd(CornerFrontEnd::Harris), fastThreshold(20) {
+    logMessage("Constructor Created for CornerDetection");
+}
+
+/**
+ * @brief Constructor for the CornerDetection class from an image that is already in memory.
+ *
+ * @param image The BGR image to process, shared rather than copied.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CornerDetection::CornerDetection(const Mat& image, const string& fileName, double& scale)
+    : Detection(image, fileName, scale), qualityLevel(50), harrisEngine(HarrisEngine::OpenCV),
+    suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0), cornerBudget(0), budgetSpacing(0),
+    budgetFrontEnd(CornerFrontEnd::Harris), fastThreshold(20) {
+    logMessage("Constructor Created for CornerDetection");
+}
+
+/**
+ * @brief Constructor for the CornerDetection class from an encoded image held in memory.
+ *
+ * @param encoded The encoded bytes, only read during construction.
+ * @param length Number of encoded bytes.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CornerDetection::CornerDetection(const uchar* encoded, size_t length, const string& fileName, double& scale)
+    : Detection(encoded, length, fileName, scale), qualityLevel(50), harrisEngine(HarrisEngine::OpenCV),
+    suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0), cornerBudget(0), budgetSpacing(0),
+    budgetFrontEnd(CornerFrontEnd::Harris), fastThreshold(20) {
+    logMessage("Constructor Created for CornerDetection");
+}
+
+/**
+ * @brief Constructor for the CornerDetection class wrapping uncompressed pixels owned by the caller.
+ *
+ * @param pixels The first pixel, shared rather than copied.
+ * @param size Image size.
+ * @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+ * @param step Bytes per row, 0 for tightly packed rows.
+ * @param order Sample order of color pixels.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CornerDetection::CornerDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale)
+    : Detection(pixels, size, type, step, order, fileName, scale), qualityLevel(50), harrisEngine(HarrisEngine::OpenCV),
+    suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0), cornerBudget(0), budgetSpacing(0),
+    budgetFrontEnd(CornerFrontEnd::Harris), fastThreshold(20) {
+    logMessage("Constructor Created for CornerDetection");
+}
+
+/**
+ * @brief Constructor for the CornerDetection class mapping a raw pixel file.
+ *
+ * @param filePath The raw file.
+ * @param layout Where and how the pixels are stored in the file.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+CornerDetection::CornerDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale)
+    : Detection(filePath, layout, fileName, scale), qualityLevel(50), harrisEngine(HarrisEngine::OpenCV),
+    suppressionRadius(0), gridCellSize(0), maxCornersPerCell(0), cornerBudget(0), budgetSpacing(0),
+    budgetFrontEnd(CornerFrontEnd::Harris), fastThreshold(20) {
     logMessage("Constructor Created for CornerDetection");
 }
 
@@ -26,29 +97,362 @@ CornerDetection::~CornerDetection() {
 /**
  * @brief Detects corners in the image using the Harris corner detection algorithm.
  *
- * Corners detected are stored in the corner features vector.
+ * Corners detected are stored in the corner features vector. In budget mode the strongest
+ * candidates of the budget front-end are selected instead of thresholding. With regions of
+ * interest set, only the regions are searched and corners off the mask are dropped before
+ * bucketing or selection; the regions take precedence over the pyramid. With pyramid levels
+ * set, the detection runs coarse-to-fine.
  */
 void CornerDetection::detectFeatures() {
-    Mat dst;
-    cornerHarris(getImage(), dst, 2, 3, 0.04);
-    Mat dstNormalized;
-    normalize(dst, dstNormalized, 0, 255, NORM_MINMAX);
+    TRACE_STAGE("detectCorners");
+    vector<Point> localFeatures;
+    if (cornerBudget > 0) {
+        if (!selector) {
+            selector.reset(new CornerSelector());
+        }
+        selector->compute(getImage(), getDetectionRegions(), budgetFrontEnd, fastThreshold);
+        if (!getDetectionRegions().empty()) {
+            selector->filterCandidates([this](const Point& candidate) { return insideMask(candidate); });
+        }
+        selector->select(cornerBudget, budgetSpacing, localFeatures);
+    }
+    else if (!getDetectionRegions().empty()) {
+        vector<float> scores;
+        detectCornersInRegions(getImage(), getDetectionRegions(), localFeatures, scores);
 
-    vector<Point> localFeatures = getCornerFeatures();
+        size_t kept = 0;
+        for (size_t i = 0; i < localFeatures.size(); i++) {
+            if (insideMask(localFeatures[i])) {
+                localFeatures[kept] = localFeatures[i];
+                scores[kept] = scores[i];
+                kept++;
+            }
+        }
+        localFeatures.resize(kept);
+        scores.resize(kept);
+        if (gridCellSize > 0) {
+            bucketCorners(localFeatures, scores, gridCellSize, maxCornersPerCell);
+        }
+    }
+    else if (getPyramidLevels() > 0) {
+        detectCornersPyramid(getImage(), localFeatures);
+    }
+    else {
+        detectCorners(getImage(), localFeatures);
+    }
+    traceStage.setCount(localFeatures.size());
+    setCornerFeatures(move(localFeatures));
 
-    localFeatures.clear();
-    for (int y = 0; y < dstNormalized.rows; y++) {
-        for (int x = 0; x < dstNormalized.cols; x++) {
-            if ((int)dstNormalized.at<float>(y, x) > qualityLevel) {
-                localFeatures.emplace_back(Point(x, y));
-                //*this += Point(x, y);
+    logMessage("Corners detected and stored in features.");
+}
 
+/**
+ * @brief Detects corners in a grayscale image with the current settings.
+ *
+ * Every pixel whose min-max normalized Harris response is above the quality level is a corner.
+ * The fused engine produces the same corners without the full-frame response buffers, the
+ * fixed-point engine nearly the same ones from integer derivatives, tensor and levels.
+ * With a suppression radius only local maxima survive: the response is dilated with a square
+ * window and compared against itself, a linear-time test instead of pairwise distances.
+ * Grid bucketing then caps the number of corners per cell.
+ *
+ * @param gray Single channel image to search.
+ * @param corners Output corners in raster order.
+ */
+void CornerDetection::detectCorners(const Mat& gray, vector<Point>& corners) const {
+    corners.clear();
+    PooledVector<float> scoreBuffer;
+    vector<float>& scores = scoreBuffer.get();
+    vector<float>* cornerScores = gridCellSize > 0 ? &scores : nullptr;
+
+    if (harrisEngine == HarrisEngine::Fused) {
+        HarrisKernel(2, 3, 0.04).detect(gray, qualityLevel, suppressionRadius, corners, cornerScores);
+    }
+    else if (harrisEngine == HarrisEngine::FixedPoint) {
+        FixedPointHarris(2, 0.04).detect(gray, qualityLevel, suppressionRadius, corners, cornerScores);
+    }
+    else {
+        // Response buffers are leased from the thread's pool instead of allocated per call
+        PooledMat dstBuffer(gray.rows, gray.cols, CV_32F);
+        Mat& dst = dstBuffer.get();
+        cornerHarris(gray, dst, 2, 3, 0.04);
+        PooledMat normalizedBuffer(gray.rows, gray.cols, CV_32F);
+        Mat& dstNormalized = normalizedBuffer.get();
+        normalize(dst, dstNormalized, 0, 255, NORM_MINMAX);
+
+        PooledMat localMaxBuffer;
+        Mat& localMax = localMaxBuffer.get();
+        if (suppressionRadius > 0) {
+            int window = 2 * suppressionRadius + 1;
+            dilate(dstNormalized, localMaxBuffer.create(gray.rows, gray.cols, CV_32F), getStructuringElement(MORPH_RECT, Size(window, window)));
+        }
+
+        for (int y = 0; y < dstNormalized.rows; y++) {
+            const float* row = dstNormalized.ptr<float>(y);
+            const float* peak = suppressionRadius > 0 ? localMax.ptr<float>(y) : row;
+            for (int x = 0; x < dstNormalized.cols; x++) {
+                if ((int)row[x] > qualityLevel && row[x] >= peak[x]) {
+                    corners.emplace_back(Point(x, y));
+                    if (cornerScores) {
+                        cornerScores->push_back(row[x]);
+                    }
+                }
             }
         }
     }
-    setCornerFeatures(localFeatures);
 
-    logMessage("Corners detected and stored in features.");
+    if (gridCellSize > 0) {
+        bucketCorners(corners, scores, gridCellSize, maxCornersPerCell);
+    }
+}
+
+/**
+ * @brief Computes the raw Harris response of an image with the selected engine.
+ *
+ * The fused engine computes the whole image as one band and the fixed-point engine converts
+ * its integer response to cornerHarris units, so the region and pyramid searches normalize
+ * all engines alike. Sobel reads the pixels around an ROI in every engine.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param response Output float response in cornerHarris units.
+ */
+void CornerDetection::harrisResponse(const Mat& gray, Mat& response) const {
+    if (harrisEngine == HarrisEngine::Fused) {
+        HarrisKernel(2, 3, 0.04).computeResponseRows(gray, 0, gray.rows, response);
+    }
+    else if (harrisEngine == HarrisEngine::FixedPoint) {
+        FixedPointHarris(2, 0.04).computeResponse(gray, response);
+    }
+    else {
+        cornerHarris(gray, response, 2, 3, 0.04);
+    }
+}
+
+/**
+ * @brief Detects corners coarse-to-fine with the current settings.
+ *
+ * The Harris response of the pyramid level marks candidate regions: every coarse pixel whose
+ * response exceeds a quarter of the response the quality level corresponds to at that level,
+ * grown by one coarse pixel and grouped into connected clusters. The cluster footprints are
+ * then searched at full resolution with detectCornersInRegions, so empty parts of the image
+ * are never visited at full resolution. The full-frame response range is never computed:
+ * the threshold is normalized with the range inside the clusters, and when the strongest
+ * full-frame response lies outside them (a corner lost by the downsampling), the threshold
+ * is lower than the one detectCorners applies and more corners are kept.
+ *
+ * @param gray Single channel full resolution image.
+ * @param corners Output corners in full resolution coordinates, raster order.
+ */
+void CornerDetection::detectCornersPyramid(const Mat& gray, vector<Point>& corners) const {
+    corners.clear();
+
+    const int levels = getPyramidLevels();
+    const int factor = 1 << levels;
+    const double candidateRelaxation = 0.25;
+    Mat coarse;
+    buildPyramidLevel(gray, coarse, levels);
+
+    // Candidate regions on the coarse level, thresholded on the raw response
+    Mat coarseResponse;
+    harrisResponse(coarse, coarseResponse);
+    double coarseMin, coarseMax;
+    minMaxLoc(coarseResponse, &coarseMin, &coarseMax);
+    double candidateThreshold = coarseMin + (qualityLevel + 1) * (coarseMax - coarseMin) / 255.0;
+    if (candidateThreshold > 0) {
+        candidateThreshold *= candidateRelaxation;
+    }
+
+    Mat candidateMask = coarseResponse > candidateThreshold;
+    dilate(candidateMask, candidateMask, Mat());
+    Mat labels, stats, centroids;
+    const int clusterCount = connectedComponentsWithStats(candidateMask, labels, stats, centroids, 8, CV_32S);
+    if (clusterCount <= 1) {
+        return;
+    }
+
+    const Rect frame(0, 0, gray.cols, gray.rows);
+    vector<Rect> regions;
+    for (int label = 1; label < clusterCount; label++) {
+        regions.push_back(Rect(stats.at<int>(label, CC_STAT_LEFT) * factor, stats.at<int>(label, CC_STAT_TOP) * factor,
+            stats.at<int>(label, CC_STAT_WIDTH) * factor, stats.at<int>(label, CC_STAT_HEIGHT) * factor) & frame);
+    }
+
+    vector<float> scores;
+    detectCornersInRegions(gray, regions, corners, scores);
+    if (gridCellSize > 0) {
+        bucketCorners(corners, scores, gridCellSize, maxCornersPerCell);
+    }
+}
+
+/**
+ * @brief Detects corners inside regions of an image with the current threshold and suppression.
+ *
+ * The full resolution response is computed only over the regions, each padded by
+ * regionMargin for the Sobel, the structure tensor window and the suppression window, so its
+ * values inside the region equal those of the whole frame. It is normalized with the minimum
+ * and maximum found over all regions, not over the whole frame, and thresholded and
+ * suppressed as in detectCorners.
+ *
+ * @param gray Single channel image.
+ * @param regions The regions to search, may overlap.
+ * @param corners Output corners in image coordinates, raster order, each reported once.
+ * @param scores Output normalized response of every corner.
+ */
+void CornerDetection::detectCornersInRegions(const Mat& gray, const vector<Rect>& regions, vector<Point>& corners, vector<float>& scores) const {
+    corners.clear();
+    scores.clear();
+    if (regions.empty()) {
+        return;
+    }
+
+    const Rect frame(0, 0, gray.cols, gray.rows);
+    const int margin = regionMargin();
+    const int regionCount = static_cast<int>(regions.size());
+    vector<Rect> padded(regionCount);
+    vector<Mat> responses(regionCount);
+    vector<double> regionMin(regionCount, DBL_MAX), regionMax(regionCount, -DBL_MAX);
+
+    parallel_for_(Range(0, regionCount), [&](const Range& range) {
+        for (int index = range.start; index < range.end; index++) {
+            padded[index] = Rect(regions[index].x - margin, regions[index].y - margin,
+                regions[index].width + 2 * margin, regions[index].height + 2 * margin) & frame;
+
+            // Derivatives read the real pixels around the ROI, only the padding sees the box filter border
+            harrisResponse(gray(padded[index]), responses[index]);
+            minMaxLoc(responses[index](regions[index] - padded[index].tl()), &regionMin[index], &regionMax[index]);
+        }
+    });
+
+    const double minValue = *min_element(regionMin.begin(), regionMin.end());
+    const double maxValue = *max_element(regionMax.begin(), regionMax.end());
+    const float alpha = maxValue > minValue ? static_cast<float>(255.0 / (maxValue - minValue)) : 0.0f;
+    const float beta = static_cast<float>(-minValue * alpha);
+
+    vector<vector<Point>> found(regionCount);
+    vector<vector<float>> foundScores(regionCount);
+    parallel_for_(Range(0, regionCount), [&](const Range& range) {
+        for (int index = range.start; index < range.end; index++) {
+            Mat normalized;
+            responses[index].convertTo(normalized, CV_32F, alpha, beta);
+
+            // The dilated response needs its own buffer, dilating in place would erase the peaks
+            PooledMat localMaxBuffer;
+            Mat& localMax = localMaxBuffer.get();
+            if (suppressionRadius > 0) {
+                int window = 2 * suppressionRadius + 1;
+                dilate(normalized, localMaxBuffer.create(normalized.rows, normalized.cols, CV_32F), getStructuringElement(MORPH_RECT, Size(window, window)));
+            }
+
+            const Rect inner = regions[index] - padded[index].tl();
+            for (int y = inner.y; y < inner.y + inner.height; y++) {
+                const float* row = normalized.ptr<float>(y);
+                const float* peak = suppressionRadius > 0 ? localMax.ptr<float>(y) : row;
+                for (int x = inner.x; x < inner.x + inner.width; x++) {
+                    if ((int)row[x] > qualityLevel && row[x] >= peak[x]) {
+                        found[index].push_back(Point(x, y) + padded[index].tl());
+                        foundScores[index].push_back(row[x]);
+                    }
+                }
+            }
+        }
+    });
+
+    // Regions may overlap, so merge in raster order and drop repeated pixels
+    vector<pair<Point, float>> merged;
+    for (int index = 0; index < regionCount; index++) {
+        for (size_t i = 0; i < found[index].size(); i++) {
+            merged.push_back(make_pair(found[index][i], foundScores[index][i]));
+        }
+    }
+    sort(merged.begin(), merged.end(), [](const pair<Point, float>& a, const pair<Point, float>& b) {
+        return tie(a.first.y, a.first.x) < tie(b.first.y, b.first.x);
+    });
+
+    for (size_t i = 0; i < merged.size(); i++) {
+        if (i > 0 && merged[i].first == merged[i - 1].first) {
+            continue;
+        }
+        corners.push_back(merged[i].first);
+        scores.push_back(merged[i].second);
+    }
+}
+
+/**
+ * @brief Gets the margin the Harris response reads around a region.
+ *
+ * @return The Sobel and structure tensor footprint plus the suppression radius.
+ */
+int CornerDetection::regionMargin(void) const {
+    return 4 + suppressionRadius;
+}
+
+/**
+ * @brief Keeps only the strongest corners of every grid cell.
+ *
+ * Corners are counting-sorted by cell, each cell holding more than maxPerCell corners is
+ * partitioned with nth_element on the response, and the survivors are compacted in place.
+ *
+ * @param corners Corners to filter in place; their relative order is preserved.
+ * @param scores Response of every corner, filtered alongside the corners.
+ * @param cellSize Width and height of a grid cell in pixels.
+ * @param maxPerCell Maximum number of corners kept per cell.
+ */
+void CornerDetection::bucketCorners(vector<Point>& corners, vector<float>& scores, int cellSize, int maxPerCell) {
+    if (corners.empty() || cellSize <= 0) {
+        return;
+    }
+    if (scores.size() != corners.size()) {
+        throw invalid_argument("Every corner needs a score for grid bucketing");
+    }
+
+    int maxX = 0, maxY = 0;
+    for (const auto& corner : corners) {
+        maxX = max(maxX, corner.x);
+        maxY = max(maxY, corner.y);
+    }
+    const int cellsX = maxX / cellSize + 1;
+    const int cellCount = cellsX * (maxY / cellSize + 1);
+
+    // Counting sort of corner indices by cell
+    vector<int> cellStart(cellCount + 1, 0);
+    vector<int> cellOf(corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        cellOf[i] = (corners[i].y / cellSize) * cellsX + corners[i].x / cellSize;
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < cellCount; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    vector<int> order(corners.size());
+    vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < corners.size(); i++) {
+        order[cursor[cellOf[i]]++] = static_cast<int>(i);
+    }
+
+    vector<char> keep(corners.size(), 1);
+    auto stronger = [&scores](int a, int b) { return scores[a] > scores[b]; };
+    for (int c = 0; c < cellCount; c++) {
+        int begin = cellStart[c];
+        int end = cellStart[c + 1];
+        if (end - begin <= maxPerCell) {
+            continue;
+        }
+        nth_element(order.begin() + begin, order.begin() + begin + maxPerCell, order.begin() + end, stronger);
+        for (int j = begin + maxPerCell; j < end; j++) {
+            keep[order[j]] = 0;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < corners.size(); i++) {
+        if (keep[i]) {
+            corners[kept] = corners[i];
+            scores[kept] = scores[i];
+            kept++;
+        }
+    }
+    corners.resize(kept);
+    scores.resize(kept);
 }
 
 /**
@@ -58,15 +462,13 @@ void CornerDetection::detectFeatures() {
  * saves the detected corners to a file, and displays the results.
  */
 void CornerDetection::processCornerDetection() {
-    showImage("Raw Image", getImage());
-    convertToGrayScale(getImage());     // Convert to grayscale
-
-
+    PreprocessingPipeline pipeline;
+    pipeline.grayscale();                   // Convert to grayscale
     if (getScaleFactor() != 1.0)
     {
-        rescaleImage(getImage());           // Rescale the image
-        showImage("Resized", getImage());   // Show resized image
+        pipeline.rescale(getScaleFactor()); // Rescale the image
     }
+    preprocess(pipeline, true);         // Show every stage
 
     detectFeatures();                   // Detect corners
     saveFeatures("Corners.txt");        // Save corners to a file
@@ -83,24 +485,19 @@ void CornerDetection::processCornerDetection() {
  * @param filter If true, applies a Gaussian filter; otherwise, applies a Median filter.
  */
 void CornerDetection::processCornerDetection(bool filter) {
-    
-    
-    showImage("Raw Image", getImage());
-    convertToGrayScale(getImage());
-    showImage("GrayScale", getImage());
-   
+    PreprocessingPipeline pipeline;
+    pipeline.grayscale();
+
     // Apply the selected filter
     if (filter)
     {
-        filterNoiseGaus(getImage());
+        pipeline.gaussian();
     }
     else
-        filterNoiseMedian(getImage());
-    
-    
-    
-    showImage("Filtered",getImage());
-        
+        pipeline.median();
+
+    preprocess(pipeline, true);         // Show every stage
+
     detectFeatures();                   // Detect corners
     saveFeatures("CornersFiltered.txt");        // Save corners to a file
     displayFeatures("Detected Corners", FeatureType::Corners); // Display corners
@@ -112,3 +509,219 @@ void CornerDetection::processCornerDetection(bool filter) {
  * @param corner The Point object representing a detected corner.
  * @return Reference to the updated CornerDetection object.
  */
+CornerDetection& CornerDetection::operator+=(const Point& corner) {
+    Detection::operator+=(corner);
+
+    return *this;
+}
+
+/**
+ * @brief Gets the quality level used to threshold the normalized Harris response.
+ *
+ * @return The current quality level.
+ */
+int CornerDetection::getQualityLevel(void) const
+{
+    return qualityLevel;
+}
+
+/**
+ * @brief Sets the quality level used to threshold the normalized Harris response.
+ *
+ * @param q The quality level, between 0 and maxQualityLevel.
+ */
+void CornerDetection::setQualityLevel(int q)
+{
+    if (q < 0 || q > maxQualityLevel)
+    {
+        throw invalid_argument("Quality level must be between 0 and " + to_string(maxQualityLevel));
+    }
+
+    qualityLevel = q;
+}
+
+/**
+ * @brief Gets the Harris response implementation.
+ *
+ * @return The engine used by detectFeatures.
+ */
+HarrisEngine CornerDetection::getHarrisEngine(void) const
+{
+    return harrisEngine;
+}
+
+/**
+ * @brief Selects the Harris response implementation.
+ *
+ * @param engine The engine used by detectFeatures.
+ */
+void CornerDetection::setHarrisEngine(HarrisEngine engine)
+{
+    harrisEngine = engine;
+}
+
+/**
+ * @brief Gets the non-maximum suppression radius.
+ *
+ * @return The radius in pixels, 0 if suppression is disabled.
+ */
+int CornerDetection::getSuppressionRadius(void) const
+{
+    return suppressionRadius;
+}
+
+/**
+ * @brief Sets the non-maximum suppression radius.
+ *
+ * @param radius The radius in pixels, 0 to disable suppression.
+ */
+void CornerDetection::setSuppressionRadius(int radius)
+{
+    if (radius < 0)
+    {
+        throw invalid_argument("Suppression radius cannot be negative");
+    }
+
+    suppressionRadius = radius;
+}
+
+/**
+ * @brief Gets the grid cell size used for bucketing.
+ *
+ * @return The cell size in pixels, 0 if bucketing is disabled.
+ */
+int CornerDetection::getGridCellSize(void) const
+{
+    return gridCellSize;
+}
+
+/**
+ * @brief Gets the maximum number of corners kept per grid cell.
+ *
+ * @return The per-cell cap.
+ */
+int CornerDetection::getMaxCornersPerCell(void) const
+{
+    return maxCornersPerCell;
+}
+
+/**
+ * @brief Enables or disables grid bucketing.
+ *
+ * @param cellSize Width and height of a grid cell in pixels, 0 to disable bucketing.
+ * @param maxPerCell Maximum number of corners kept per cell.
+ */
+void CornerDetection::setGridBucketing(int cellSize, int maxPerCell)
+{
+    if (cellSize < 0 || (cellSize > 0 && maxPerCell < 1))
+    {
+        throw invalid_argument("Grid cell size cannot be negative and each cell must keep at least one corner");
+    }
+
+    gridCellSize = cellSize;
+    maxCornersPerCell = maxPerCell;
+}
+
+/**
+ * @brief Gets the corner budget.
+ *
+ * @return The number of corners reported in budget mode, 0 if the quality level applies.
+ */
+int CornerDetection::getCornerBudget(void) const
+{
+    return cornerBudget;
+}
+
+/**
+ * @brief Gets the minimum distance between budgeted corners.
+ *
+ * @return The distance in pixels, 0 if budgeted corners may touch.
+ */
+int CornerDetection::getBudgetSpacing(void) const
+{
+    return budgetSpacing;
+}
+
+/**
+ * @brief Enables or disables the budget mode.
+ *
+ * @param count Number of corners wanted, 0 to threshold with the quality level again.
+ * @param minDistance Smallest distance between two reported corners in pixels, 0 for no spacing.
+ */
+void CornerDetection::setCornerBudget(int count, int minDistance)
+{
+    if (count < 0 || minDistance < 0)
+    {
+        throw invalid_argument("Corner budget and minimum distance cannot be negative");
+    }
+
+    cornerBudget = count;
+    budgetSpacing = minDistance;
+}
+
+/**
+ * @brief Gets the response front-end of the budget mode.
+ *
+ * @return The front-end ranking the candidates.
+ */
+CornerFrontEnd CornerDetection::getBudgetFrontEnd(void) const
+{
+    return budgetFrontEnd;
+}
+
+/**
+ * @brief Selects the response front-end of the budget mode.
+ *
+ * @param frontEnd Harris local maxima or FAST keypoints.
+ * @param threshold Intensity difference threshold of the FAST test, between 1 and 255.
+ */
+void CornerDetection::setBudgetFrontEnd(CornerFrontEnd frontEnd, int threshold)
+{
+    if (threshold < 1 || threshold > 255)
+    {
+        throw invalid_argument("FAST threshold must be between 1 and 255");
+    }
+
+    budgetFrontEnd = frontEnd;
+    fastThreshold = threshold;
+}
+
+/**
+ * @brief Replaces the corner features with a new budget from the response of the last detection.
+ *
+ * The candidates and the ranking done so far are reused, so trying several budgets costs a
+ * partial sort each instead of a response computation.
+ *
+ * @param count Number of corners wanted.
+ * @param minDistance Smallest distance between two reported corners in pixels, 0 for no spacing.
+ */
+void CornerDetection::reselectCorners(int count, int minDistance)
+{
+    if (!selector || !selector->isComputed())
+    {
+        throw runtime_error("No corner response cached, run detectFeatures with a corner budget first");
+    }
+
+    setCornerBudget(count, minDistance);
+    TRACE_STAGE("selectCorners");
+    vector<Point> localFeatures;
+    selector->select(cornerBudget, budgetSpacing, localFeatures);
+    traceStage.setCount(localFeatures.size());
+    setCornerFeatures(move(localFeatures));
+}
+
+/**
+ * @brief Records the Harris settings in a binary feature file header.
+ *
+ * In budget mode no quality level applies and the budget spacing is recorded as the
+ * suppression radius.
+ *
+ * @param header The header to complete.
+ */
+void CornerDetection::describeParameters(FeatureFileHeader& header) const
+{
+    Detection::describeParameters(header);
+    header.detectors |= FeatureFileCorners;
+    header.qualityLevel = cornerBudget > 0 ? 0 : qualityLevel;
+    header.suppressionRadius = cornerBudget > 0 ? budgetSpacing : suppressionRadius;
+}
@@ -1,11 +1,17 @@
 #pragma once
 #include "Detection.h"
+#include "CornerSelector.h"
 #include <fstream>
 #include <vector>
 
 using namespace std;
 using namespace cv;
 
+/// Harris response implementation used by CornerDetection
+/// OpenCV runs cornerHarris + normalize on full frames, Fused runs the band-parallel HarrisKernel,
+/// FixedPoint the integer FixedPointHarris on 8-bit images.
+enum class HarrisEngine { OpenCV, Fused, FixedPoint };
+
 /// CornerDetection Class
 /// Derived from the Detection class, this class provides specific functionalities for detecting and visualizing corners in an image.
 class CornerDetection :public Detection
@@ -16,6 +22,36 @@ public:
     /// @param fileName The name of the image file.
     /// @param scale The scale factor for resizing the image.
 	CornerDetection(const string& filePath, const string& fileName, double& scale);
+
+	/// Constructor for an image that is already in memory
+	/// @param image The BGR image to process, shared rather than copied.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing the image.
+	CornerDetection(const Mat& image, const string& fileName, double& scale);
+
+	/// Constructor decoding an encoded image held in memory
+	/// @param encoded The encoded bytes, only read during construction.
+	/// @param length Number of encoded bytes.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing the image.
+	CornerDetection(const uchar* encoded, size_t length, const string& fileName, double& scale);
+
+	/// Constructor wrapping uncompressed pixels owned by the caller, which must outlive the object
+	/// @param pixels The first pixel, shared rather than copied.
+	/// @param size Image size.
+	/// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+	/// @param step Bytes per row, 0 for tightly packed rows.
+	/// @param order Sample order of color pixels.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing the image.
+	CornerDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale);
+
+	/// Constructor mapping a raw pixel file without decoding or copying it
+	/// @param filePath The raw file.
+	/// @param layout Where and how the pixels are stored in the file.
+	/// @param fileName The name identifying the image.
+	/// @param scale The scale factor for resizing the image.
+	CornerDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale);
 	
 	/// Destructor for CornerDetection
 	~CornerDetection(); 
@@ -24,6 +60,30 @@ public:
 	/// Uses the Harris corner detection algorithm.
 	void detectFeatures(void) override;
 
+	/// Detect corners in a grayscale image with the current settings
+	/// @param gray Single channel image to search.
+	/// @param corners Output corners in raster order.
+	void detectCorners(const Mat& gray, vector<Point>& corners) const;
+
+	/// Detect corners coarse-to-fine with the current settings
+	/// The pyramid level only selects candidate regions; threshold, suppression and bucketing
+	/// run on the full resolution response of those regions, computed by the Harris engine.
+	/// The quality level is taken relative to the response range inside the regions, so where
+	/// the strongest full-frame response lies outside them the corners differ from detectCorners.
+	/// @param gray Single channel full resolution image.
+	/// @param corners Output corners in full resolution coordinates, raster order.
+	void detectCornersPyramid(const Mat& gray, vector<Point>& corners) const;
+
+	/// Detect corners inside regions of an image with the current threshold and suppression
+	/// The Harris response is computed by the Harris engine over every region padded by
+	/// regionMargin and min-max normalized with the range found over all regions, so the
+	/// quality level means the same as for the whole frame when the regions hold its maximum.
+	/// @param gray Single channel image.
+	/// @param regions The regions to search, may overlap.
+	/// @param corners Output corners in image coordinates, raster order, without bucketing.
+	/// @param scores Output normalized response of every corner.
+	void detectCornersInRegions(const Mat& gray, const vector<Rect>& regions, vector<Point>& corners, vector<float>& scores) const;
+
 	/// Process corner detection with default settings
 	/// Applies grayscale conversion, detects features, saves features, and visualizes detected corners.
 	void processCornerDetection(void);
@@ -40,11 +100,95 @@ public:
 	/// @param q The quality level to set.
 	void setQualityLevel(int q);
 
+	/// Get the Harris response implementation
+	/// @return The engine used by detectFeatures.
+	HarrisEngine getHarrisEngine(void) const;
+
+	/// Select the Harris response implementation
+	/// @param engine The engine used by detectFeatures.
+	void setHarrisEngine(HarrisEngine engine);
+
+	/// Get the non-maximum suppression radius
+	/// @return The radius in pixels, 0 if suppression is disabled.
+	int getSuppressionRadius(void) const;
+
+	/// Set the non-maximum suppression radius
+	/// A corner is kept only if its response is the maximum of the (2r+1) x (2r+1) window around it.
+	/// @param radius The radius in pixels, 0 to disable suppression.
+	void setSuppressionRadius(int radius);
+
+	/// Get the grid cell size used for bucketing
+	/// @return The cell size in pixels, 0 if bucketing is disabled.
+	int getGridCellSize(void) const;
+
+	/// Get the maximum number of corners kept per grid cell
+	/// @return The per-cell cap.
+	int getMaxCornersPerCell(void) const;
+
+	/// Enable or disable grid bucketing
+	/// Only the strongest corners of each cell are kept, spreading features evenly over the image.
+	/// @param cellSize Width and height of a grid cell in pixels, 0 to disable bucketing.
+	/// @param maxPerCell Maximum number of corners kept per cell.
+	void setGridBucketing(int cellSize, int maxPerCell);
+
+	/// Get the corner budget
+	/// @return The number of corners reported in budget mode, 0 if the quality level applies.
+	int getCornerBudget(void) const;
+
+	/// Get the minimum distance between budgeted corners
+	/// @return The distance in pixels, 0 if budgeted corners may touch.
+	int getBudgetSpacing(void) const;
+
+	/// Enable or disable the budget mode
+	/// detectFeatures then reports the best count corners, strongest first, instead of every
+	/// corner above the quality level; suppression radius, grid bucketing and pyramid levels
+	/// do not apply. The response is cached for reselectCorners.
+	/// @param count Number of corners wanted, 0 to threshold with the quality level again.
+	/// @param minDistance Smallest distance between two reported corners in pixels, 0 for no spacing.
+	void setCornerBudget(int count, int minDistance = 0);
+
+	/// Get the response front-end of the budget mode
+	/// @return The front-end ranking the candidates.
+	CornerFrontEnd getBudgetFrontEnd(void) const;
+
+	/// Select the response front-end of the budget mode
+	/// @param frontEnd Harris local maxima or FAST keypoints.
+	/// @param fastThreshold Intensity difference threshold of the FAST test, between 1 and 255.
+	void setBudgetFrontEnd(CornerFrontEnd frontEnd, int fastThreshold = 20);
+
+	/// Replace the corner features with a new budget from the response of the last detection
+	/// Only the candidate ranking runs again, no response is computed.
+	/// @param count Number of corners wanted.
+	/// @param minDistance Smallest distance between two reported corners in pixels, 0 for no spacing.
+	void reselectCorners(int count, int minDistance = 0);
+
+	/// Keep only the strongest corners of every grid cell
+	/// Runs in linear time: corners are counting-sorted by cell and each overfull cell is trimmed with nth_element.
+	/// @param corners Corners to filter in place; their relative order is preserved.
+	/// @param scores Response of every corner, filtered alongside the corners.
+	/// @param cellSize Width and height of a grid cell in pixels.
+	/// @param maxPerCell Maximum number of corners kept per cell.
+	static void bucketCorners(vector<Point>& corners, vector<float>& scores, int cellSize, int maxPerCell);
+
 	/// Overload the += operator to add a detected corner to the corner list
 	/// @param corner A detected corner point.
 	/// @return Reference to the CornerDetection object.
 	CornerDetection& operator+=(const Point& corner);
 
+protected:
+	/// Record the Harris settings in a binary feature file header
+	/// @param header The header to complete.
+	void describeParameters(FeatureFileHeader& header) const override;
+
+	/// Get the margin the Harris response reads around a region
+	/// @return The Sobel and structure tensor footprint plus the suppression radius.
+	int regionMargin(void) const override;
+
+	/// Compute the raw Harris response of an image with the selected engine
+	/// @param gray Single channel 8-bit image.
+	/// @param response Output float response in cornerHarris units.
+	void harrisResponse(const Mat& gray, Mat& response) const;
+
 
 
 private:
@@ -54,6 +198,33 @@ private:
 	/// Maximum quality level for corner detection
 	const int maxQualityLevel = 100;
 
+	/// Harris response implementation
+	HarrisEngine harrisEngine;
+
+	/// Non-maximum suppression radius, 0 when disabled
+	int suppressionRadius;
+
+	/// Grid bucketing cell size, 0 when disabled
+	int gridCellSize;
+
+	/// Maximum number of corners kept per grid cell
+	int maxCornersPerCell;
+
+	/// Number of corners reported in budget mode, 0 when disabled
+	int cornerBudget;
+
+	/// Minimum distance between budgeted corners, 0 when disabled
+	int budgetSpacing;
+
+	/// Response front-end of the budget mode
+	CornerFrontEnd budgetFrontEnd;
+
+	/// FAST intensity difference threshold of the budget mode
+	int fastThreshold;
+
+	/// Candidates of the last budgeted detection, kept for reselectCorners
+	unique_ptr<CornerSelector> selector;
+
 	/// Vector to store detected corners
 	vector<Point> corners;
 	
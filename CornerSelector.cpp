@@ -0,0 +1,279 @@
+#include "CornerSelector.h"
+#include "HarrisKernel.h"
+#include <opencv2/features2d.hpp>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    const int harrisMargin = 4;             // Sobel aperture, structure tensor window and the 3 x 3 maximum test
+    const int fastMargin = 4;               // Bresenham circle of radius 3 and the 3 x 3 score suppression
+
+    /// Collect the positive 3 x 3 local maxima of the Harris response inside an area
+    void collectHarrisMaxima(const Mat& area, const Rect& inner, const Point& offset, vector<Point>& points, vector<float>& values) {
+        const HarrisKernel harris(2, 3, 0.04);
+        const int bandRows = HarrisKernel::bandRowsFor(area.cols);
+        const int bands = (area.rows + bandRows - 1) / bandRows;
+        Mat response(area.rows, area.cols, CV_32F);
+        parallel_for_(Range(0, bands), [&](const Range& range) {
+            for (int band = range.start; band < range.end; band++) {
+                const int y0 = band * bandRows;
+                Mat rows = response.rowRange(y0, min(area.rows, y0 + bandRows));
+                harris.computeResponseRows(area, y0, y0 + rows.rows, rows);
+            }
+        });
+
+        // Pixels on the area border compare against the neighbors that exist
+        vector<vector<Point>> foundPoints(inner.height);
+        vector<vector<float>> foundValues(inner.height);
+        parallel_for_(Range(0, inner.height), [&](const Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                const int y = inner.y + i;
+                const float* previous = response.ptr<float>(max(0, y - 1));
+                const float* row = response.ptr<float>(y);
+                const float* next = response.ptr<float>(min(response.rows - 1, y + 1));
+                for (int x = inner.x; x < inner.x + inner.width; x++) {
+                    const float value = row[x];
+                    if (value <= 0.0f) {
+                        continue;
+                    }
+                    const int left = max(0, x - 1);
+                    const int right = min(response.cols - 1, x + 1);
+                    if (value >= row[left] && value >= row[right] &&
+                        value >= previous[left] && value >= previous[x] && value >= previous[right] &&
+                        value >= next[left] && value >= next[x] && value >= next[right]) {
+                        foundPoints[i].push_back(Point(x, y) + offset);
+                        foundValues[i].push_back(value);
+                    }
+                }
+            }
+        });
+
+        for (int i = 0; i < inner.height; i++) {
+            points.insert(points.end(), foundPoints[i].begin(), foundPoints[i].end());
+            values.insert(values.end(), foundValues[i].begin(), foundValues[i].end());
+        }
+    }
+
+    /// Collect the FAST keypoints inside an area, scored and suppressed by FAST itself
+    void collectFastKeypoints(const Mat& area, const Rect& inner, const Point& offset, int threshold, vector<Point>& points, vector<float>& values) {
+        vector<KeyPoint> keypoints;
+        FAST(area, keypoints, threshold, true);
+        sort(keypoints.begin(), keypoints.end(), [](const KeyPoint& a, const KeyPoint& b) {
+            return tie(a.pt.y, a.pt.x) < tie(b.pt.y, b.pt.x);
+        });
+        for (const auto& keypoint : keypoints) {
+            const Point position(cvRound(keypoint.pt.x), cvRound(keypoint.pt.y));
+            if (inner.contains(position)) {
+                points.push_back(position + offset);
+                values.push_back(keypoint.response);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Constructor for a selector without candidates.
+ */
+CornerSelector::CornerSelector()
+    : ranked(0), computed(false) {
+}
+
+/**
+ * @brief Computes the corner response and collects its candidates.
+ *
+ * Every region is read with the margin of the front-end, so a candidate inside it gets the
+ * score it has in the whole image. Harris keeps the positive 3 x 3 local maxima of its raw
+ * response, computed in cache sized row bands; FAST keeps its own non-maximum suppressed
+ * keypoints. Candidates found by overlapping regions are kept once. The ranking of a
+ * previous compute is discarded.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param regions Regions to search; empty searches the whole image.
+ * @param frontEnd The corner response.
+ * @param fastThreshold Intensity difference threshold of the FAST test; Fast only.
+ */
+void CornerSelector::compute(const Mat& gray, const vector<Rect>& regions, CornerFrontEnd frontEnd, int fastThreshold) {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw invalid_argument("Corner selection needs a single channel 8-bit image");
+    }
+    if (frontEnd == CornerFrontEnd::Fast && (fastThreshold < 1 || fastThreshold > 255)) {
+        throw invalid_argument("FAST threshold must be between 1 and 255");
+    }
+
+    candidates.clear();
+    scores.clear();
+    imageSize = gray.size();
+    const Rect frame(0, 0, gray.cols, gray.rows);
+    const vector<Rect> searched = regions.empty() ? vector<Rect>(1, frame) : regions;
+    const int margin = frontEnd == CornerFrontEnd::Harris ? harrisMargin : fastMargin;
+
+    for (const auto& region : searched) {
+        const Rect core = region & frame;
+        if (core.empty()) {
+            continue;
+        }
+        const Rect padded = Rect(core.x - margin, core.y - margin, core.width + 2 * margin, core.height + 2 * margin) & frame;
+        if (frontEnd == CornerFrontEnd::Harris) {
+            collectHarrisMaxima(gray(padded), core - padded.tl(), padded.tl(), candidates, scores);
+        }
+        else {
+            collectFastKeypoints(gray(padded), core - padded.tl(), padded.tl(), fastThreshold, candidates, scores);
+        }
+    }
+
+    if (searched.size() > 1) {
+        vector<int> byPosition(candidates.size());
+        iota(byPosition.begin(), byPosition.end(), 0);
+        sort(byPosition.begin(), byPosition.end(), [this](int a, int b) {
+            return tie(candidates[a].y, candidates[a].x) < tie(candidates[b].y, candidates[b].x);
+        });
+
+        vector<Point> uniquePoints;
+        vector<float> uniqueScores;
+        for (size_t i = 0; i < byPosition.size(); i++) {
+            if (i > 0 && candidates[byPosition[i]] == candidates[byPosition[i - 1]]) {
+                continue;
+            }
+            uniquePoints.push_back(candidates[byPosition[i]]);
+            uniqueScores.push_back(scores[byPosition[i]]);
+        }
+        candidates.swap(uniquePoints);
+        scores.swap(uniqueScores);
+    }
+
+    order.resize(candidates.size());
+    iota(order.begin(), order.end(), 0);
+    ranked = 0;
+    computed = true;
+}
+
+/**
+ * @brief Drops the candidates a predicate rejects.
+ *
+ * The ranking starts over, the response is not computed again.
+ *
+ * @param keep Returns true for the candidates to keep.
+ */
+void CornerSelector::filterCandidates(const function<bool(const Point&)>& keep) {
+    size_t kept = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (keep(candidates[i])) {
+            candidates[kept] = candidates[i];
+            scores[kept] = scores[i];
+            kept++;
+        }
+    }
+    candidates.resize(kept);
+    scores.resize(kept);
+
+    order.resize(kept);
+    iota(order.begin(), order.end(), 0);
+    ranked = 0;
+}
+
+/**
+ * @brief Selects the strongest candidates.
+ *
+ * Without spacing the answer is the ranked prefix. With spacing, candidates are visited
+ * strongest first and accepted greedily unless an accepted corner lies closer than
+ * minDistance; accepted corners are bucketed into cells minDistance wide, so each test only
+ * looks at the 3 x 3 cells around the candidate. The ranked prefix grows in doubling steps
+ * until enough corners are accepted, so a query sorts little more than it visits.
+ *
+ * @param count Number of corners wanted.
+ * @param minDistance Smallest distance between two selected corners in pixels, 0 for no spacing.
+ * @param corners Output corners, strongest first.
+ */
+void CornerSelector::select(int count, int minDistance, vector<Point>& corners) {
+    if (count < 0 || minDistance < 0) {
+        throw invalid_argument("Corner count and minimum distance cannot be negative");
+    }
+
+    corners.clear();
+    const size_t wanted = min(static_cast<size_t>(count), candidates.size());
+    if (minDistance == 0) {
+        rank(wanted);
+        for (size_t i = 0; i < wanted; i++) {
+            corners.push_back(candidates[order[i]]);
+        }
+        return;
+    }
+
+    const int columns = imageSize.width / minDistance + 1;
+    const int rows = imageSize.height / minDistance + 1;
+    const int limit = minDistance * minDistance;
+    vector<int> cellHead(static_cast<size_t>(columns) * rows, -1);
+    vector<int> nextInCell;
+
+    size_t visited = 0;
+    size_t step = max<size_t>(wanted, 64);
+    while (corners.size() < wanted && visited < candidates.size()) {
+        rank(min(candidates.size(), visited + step));
+        step *= 2;
+
+        for (; visited < ranked && corners.size() < wanted; visited++) {
+            const Point& candidate = candidates[order[visited]];
+            const int column = candidate.x / minDistance;
+            const int row = candidate.y / minDistance;
+
+            bool crowded = false;
+            for (int r = max(0, row - 1); r <= min(rows - 1, row + 1) && !crowded; r++) {
+                for (int c = max(0, column - 1); c <= min(columns - 1, column + 1) && !crowded; c++) {
+                    for (int i = cellHead[r * columns + c]; i >= 0 && !crowded; i = nextInCell[i]) {
+                        const Point offset = corners[i] - candidate;
+                        crowded = offset.dot(offset) < limit;
+                    }
+                }
+            }
+            if (crowded) {
+                continue;
+            }
+
+            const int cell = row * columns + column;
+            nextInCell.push_back(cellHead[cell]);
+            cellHead[cell] = static_cast<int>(corners.size());
+            corners.push_back(candidate);
+        }
+    }
+}
+
+/**
+ * @brief Extends the ranked prefix of the candidate order.
+ *
+ * The unranked tail only holds candidates no stronger than the ranked prefix, so sorting
+ * the strongest of the tail behind the prefix extends it. Equal scores fall back to the
+ * raster order, so selections are reproducible.
+ *
+ * @param count Number of strongest candidates that must be in order.
+ */
+void CornerSelector::rank(size_t count) {
+    count = min(count, order.size());
+    if (count <= ranked) {
+        return;
+    }
+
+    partial_sort(order.begin() + ranked, order.begin() + count, order.end(), [this](int a, int b) {
+        return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+    });
+    ranked = count;
+}
+
+/**
+ * @brief Gets the number of candidates.
+ *
+ * @return The local maxima found by the last compute, after filtering.
+ */
+size_t CornerSelector::getCandidateCount(void) const {
+    return candidates.size();
+}
+
+/**
+ * @brief Checks whether a response has been computed.
+ *
+ * @return True after compute.
+ */
+bool CornerSelector::isComputed(void) const {
+    return computed;
+}
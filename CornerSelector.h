@@ -0,0 +1,64 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <functional>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// Corner response computed for budgeted selection
+/// Harris ranks local maxima of the raw Harris response, Fast ranks FAST-9 keypoints by their
+/// FAST score, which is much cheaper but less repeatable.
+enum class CornerFrontEnd { Harris, Fast };
+
+/// CornerSelector Class
+/// Selects the best N corners of an image instead of thresholding a normalized response.
+/// compute() runs the response once and keeps every 3 x 3 local maximum as a candidate with
+/// its score; select() then picks the strongest candidates, optionally at least a minimum
+/// distance apart. Candidates are ranked lazily with partial sorts that extend the sorted
+/// prefix only as far as a query needs, so asking again for a different N or spacing reuses
+/// the cached response and the ranking done so far.
+class CornerSelector
+{
+public:
+    /// Constructor for a selector without candidates
+    CornerSelector();
+
+    /// Compute the corner response and collect its candidates
+    /// @param gray Single channel 8-bit image.
+    /// @param regions Regions to search, each read with the margin of the front-end; empty searches the whole image.
+    /// @param frontEnd The corner response.
+    /// @param fastThreshold Intensity difference threshold of the FAST test; Fast only.
+    void compute(const Mat& gray, const vector<Rect>& regions = vector<Rect>(), CornerFrontEnd frontEnd = CornerFrontEnd::Harris, int fastThreshold = 20);
+
+    /// Drop the candidates a predicate rejects, e.g. those off a mask
+    /// @param keep Returns true for the candidates to keep.
+    void filterCandidates(const function<bool(const Point&)>& keep);
+
+    /// Select the strongest candidates
+    /// Not safe to call concurrently on one selector, the ranking is extended in place.
+    /// @param count Number of corners wanted.
+    /// @param minDistance Smallest distance between two selected corners in pixels, 0 for no spacing.
+    /// @param corners Output corners, strongest first; fewer than count if the candidates run out.
+    void select(int count, int minDistance, vector<Point>& corners);
+
+    /// Get the number of candidates
+    /// @return The local maxima found by the last compute, after filtering.
+    size_t getCandidateCount(void) const;
+
+    /// Check whether a response has been computed
+    /// @return True after compute.
+    bool isComputed(void) const;
+
+private:
+    /// Extend the ranked prefix of the candidate order
+    /// @param count Number of strongest candidates that must be in order.
+    void rank(size_t count);
+
+    vector<Point> candidates;               ///< Local maxima of the response
+    vector<float> scores;                   ///< Response of every candidate
+    vector<int> order;                      ///< Candidate indices, strongest first up to ranked
+    size_t ranked;                          ///< Length of the sorted prefix of order
+    Size imageSize;                         ///< Size of the image the candidates were found in
+    bool computed;                          ///< True after compute
+};
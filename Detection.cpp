@@ -1,4 +1,15 @@
 #include "Detection.h"
+#include "ProbabilisticHough.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+    /// Grow a rectangle by a margin on every side
+    Rect grown(const Rect& region, int margin) {
+        return Rect(region.x - margin, region.y - margin, region.width + 2 * margin, region.height + 2 * margin);
+    }
+}
 
 /**
  * @brief Constructor for Detection class.
@@ -8,7 +19,61 @@
  * @param scale The scaling factor for resizing the image.
  */
 Detection::Detection(const string& filePath, const string& fileName, double& scale)
-    : CommonProcesses(filePath, fileName, scale), threshold(100), maxThreshold(255) {
+    : CommonProcesses(filePath, fileName, scale), threshold(100), maxThreshold(255), edgesChanged(true), edgeMapLoaded(false), pyramidLevels(0), regionScale(1.0) {
+    logMessage("Constructor Created for Detection");
+}
+
+/**
+ * @brief Constructor for Detection class from an image that is already in memory.
+ *
+ * @param image The BGR image to process, shared rather than copied.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+Detection::Detection(const Mat& image, const string& fileName, double& scale)
+    : CommonProcesses(image, fileName, scale), threshold(100), maxThreshold(255), edgesChanged(true), edgeMapLoaded(false), pyramidLevels(0), regionScale(1.0) {
+    logMessage("Constructor Created for Detection");
+}
+
+/**
+ * @brief Constructor for Detection class from an encoded image held in memory.
+ *
+ * @param encoded The encoded bytes, only read during construction.
+ * @param length Number of encoded bytes.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+Detection::Detection(const uchar* encoded, size_t length, const string& fileName, double& scale)
+    : CommonProcesses(encoded, length, fileName, scale), threshold(100), maxThreshold(255), edgesChanged(true), edgeMapLoaded(false), pyramidLevels(0), regionScale(1.0) {
+    logMessage("Constructor Created for Detection");
+}
+
+/**
+ * @brief Constructor for Detection class wrapping uncompressed pixels owned by the caller.
+ *
+ * @param pixels The first pixel, shared rather than copied.
+ * @param size Image size.
+ * @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+ * @param step Bytes per row, 0 for tightly packed rows.
+ * @param order Sample order of color pixels.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+Detection::Detection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale)
+    : CommonProcesses(pixels, size, type, step, order, fileName, scale), threshold(100), maxThreshold(255), edgesChanged(true), edgeMapLoaded(false), pyramidLevels(0), regionScale(1.0) {
+    logMessage("Constructor Created for Detection");
+}
+
+/**
+ * @brief Constructor for Detection class mapping a raw pixel file.
+ *
+ * @param filePath The raw file.
+ * @param layout Where and how the pixels are stored in the file.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+Detection::Detection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale)
+    : CommonProcesses(filePath, layout, fileName, scale), threshold(100), maxThreshold(255), edgesChanged(true), edgeMapLoaded(false), pyramidLevels(0), regionScale(1.0) {
     logMessage("Constructor Created for Detection");
 }
 
@@ -22,10 +87,25 @@ Detection::~Detection() {
 /**
  * @brief Logs a message to the console.
  *
+ * Messages are dropped when console output has been disabled with setVerbose(false).
+ *
  * @param message The message to be logged.
  */
 void Detection::logMessage(const string& message) {
-    cout << message << endl;
+    if (isVerbose()) {
+        cout << message << '\n';
+    }
+}
+
+/**
+ * @brief Logs a literal message to the console without building a string when muted.
+ *
+ * @param message The message to be logged.
+ */
+void Detection::logMessage(const char* message) {
+    if (isVerbose()) {
+        cout << message << '\n';
+    }
 }
 
 /**
@@ -35,29 +115,33 @@ void Detection::logMessage(const string& message) {
  * @param type The type of feature to display (corners or lines).
  */
 void Detection::displayFeatures(const string& windowName, FeatureType type) {
-    Mat displayImage = getImage().clone();
-
-    if (type == FeatureType::Corners) {
-        for (const auto& feature : cornerFeatures) {
-            circle(displayImage, feature, 5, Scalar(0, 255, 0), 2); // Green points
+    // Time the drawing only, not the wait for a key press
+    {
+        TRACE_STAGE("render");
+        getImage().copyTo(displayImage);
+
+        if (type == FeatureType::Corners) {
+            for (const auto& feature : cornerFeatures) {
+                circle(displayImage, feature, 5, Scalar(0, 255, 0), 2); // Green points
+            }
+
+            string cornerCountText = "Corners Detected: " + to_string(getCornerCount());
+            putText(displayImage, cornerCountText, Point(10, displayImage.rows - 50), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
+            logMessage(cornerCountText);
         }
-
-        string cornerCountText = "Corners Detected: " + to_string(getCornerCount());
-        putText(displayImage, cornerCountText, Point(10, displayImage.rows - 50), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
-        logMessage(cornerCountText);
-    }
-    else if (type == FeatureType::Lines) {
-        for (const auto& lline : lineFeatures) {
-            Point pt1(lline[0], lline[1]);
-            Point pt2(lline[2], lline[3]);
-            line(displayImage, pt1, pt2, Scalar(255, 0, 0), 2); // Blue lines
+        else if (type == FeatureType::Lines) {
+            for (const auto& lline : lineFeatures) {
+                Point pt1(lline[0], lline[1]);
+                Point pt2(lline[2], lline[3]);
+                line(displayImage, pt1, pt2, Scalar(255, 0, 0), 2); // Blue lines
+            }
+            string lineCountText = "Edges Detected: " + to_string(getLineCount());
+            putText(displayImage, lineCountText, Point(10, displayImage.rows - 50), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
+            logMessage(lineCountText);
         }
-        string lineCountText = "Edges Detected: " + to_string(getLineCount());
-        putText(displayImage, lineCountText, Point(10, displayImage.rows - 50), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
-        logMessage(lineCountText);
-    }
 
-    imshow(windowName, displayImage);
+        imshow(windowName, displayImage);
+    }
     waitKey(0);
     logMessage("Features displayed in window: " + windowName);
 }
@@ -68,26 +152,84 @@ void Detection::displayFeatures(const string& windowName, FeatureType type) {
  * @param fileName The name of the file to save the features.
  */
 void Detection::saveFeatures(const string& fileName) {
-    ofstream file(fileName);
-    if (!file.is_open()) {
-        throw runtime_error("Error: Could not open file: " + fileName);
-    }
-
-    for (const auto& feature : cornerFeatures) {
-        file << "Point: (" << feature.x << ", " << feature.y << ")\n";
-    }
+    TRACE_STAGE("save");
+    traceStage.setCount(cornerFeatures.size() + lineFeatures.size());
+    FeatureFile::writeText(fileName, cornerFeatures, lineFeatures);
+    logMessage("Features saved to file: " + fileName);
+}
 
-    for (const auto& line : lineFeatures) {
-        file << "Line: (" << line[0] << ", " << line[1] << ") -> ("
-            << line[2] << ", " << line[3] << ")\n";
-    }
+/**
+ * @brief Saves detected features (corners and lines) to a binary feature file.
+ *
+ * @param fileName The name of the file to save the features.
+ */
+void Detection::saveFeaturesBinary(const string& fileName) {
+    TRACE_STAGE("save");
+    traceStage.setCount(cornerFeatures.size() + lineFeatures.size());
+    FeatureFileHeader header = FeatureFile::makeHeader(getfileName(), getImage().cols, getImage().rows);
+    header.scaleFactor = static_cast<float>(getScaleFactor());
+    describeParameters(header);
+
+    FeatureFile::writeBinary(fileName, header, cornerFeatures, lineFeatures);
+    logMessage("Features saved to binary file: " + fileName);
+}
 
-    file.close();
+/**
+ * @brief Saves one kind of detected features to a text file.
+ *
+ * @param fileName The name of the file to save the features.
+ * @param type The kind of features to save.
+ */
+void Detection::saveFeatures(const string& fileName, FeatureType type) {
+    TRACE_STAGE("save");
+    const bool corners = type == FeatureType::Corners;
+    traceStage.setCount(corners ? cornerFeatures.size() : lineFeatures.size());
+    const vector<Point> noCorners;
+    const vector<Vec4i> noLines;
+    FeatureFile::writeText(fileName, corners ? cornerFeatures : noCorners, corners ? noLines : lineFeatures);
     logMessage("Features saved to file: " + fileName);
 }
 
+/**
+ * @brief Saves one kind of detected features to a binary feature file.
+ *
+ * @param fileName The name of the file to save the features.
+ * @param type The kind of features to save; the header only lists that detector.
+ */
+void Detection::saveFeaturesBinary(const string& fileName, FeatureType type) {
+    TRACE_STAGE("save");
+    const bool corners = type == FeatureType::Corners;
+    traceStage.setCount(corners ? cornerFeatures.size() : lineFeatures.size());
+    FeatureFileHeader header = FeatureFile::makeHeader(getfileName(), getImage().cols, getImage().rows);
+    header.scaleFactor = static_cast<float>(getScaleFactor());
+    describeParameters(header);
+    header.detectors &= corners ? FeatureFileCorners : FeatureFileLines;
+
+    const vector<Point> noCorners;
+    const vector<Vec4i> noLines;
+    FeatureFile::writeBinary(fileName, header, corners ? cornerFeatures : noCorners, corners ? noLines : lineFeatures);
+    logMessage("Features saved to binary file: " + fileName);
+}
+
+/**
+ * @brief Fills the detector specific parameters of a binary feature file header.
+ *
+ * The base class only records which feature types are present.
+ *
+ * @param header The header to complete.
+ */
+void Detection::describeParameters(FeatureFileHeader& header) const {
+    header.detectors = (cornerFeatures.empty() ? 0 : FeatureFileCorners) | (lineFeatures.empty() ? 0 : FeatureFileLines);
+}
+
 /**
  * @brief Updates the edge map using the Canny edge detection algorithm.
+ *
+ * Inside a tuning session only the hysteresis is rerun on the cached gradients, and the
+ * edge pixels that changed are remembered for the Hough update. A loaded edge map stands in
+ * for the first update; a session started from one computes its gradients, and restarts its
+ * Hough accumulator, on the first threshold move. The session reads the edge map of the
+ * Canny cache in place instead of copying it on every move.
  */
 void Detection::updateEdgeMap() {
     if (getImage().empty()) {
@@ -95,7 +237,28 @@ void Detection::updateEdgeMap() {
     }
 
     // Generate edge map
-    Canny(getImage(), edgeImage, threshold, threshold * 2);
+    TRACE_STAGE("edges");
+    if (edgeMapLoaded) {
+        addedEdges = edgeMap.indices();
+        removedEdges.clear();
+        edgesChanged = true;
+        edgeMapLoaded = false;
+        edgeMap.unpack(edgeImage);
+    }
+    else if (cannyCache || houghState) {
+        if (!cannyCache) {
+            cannyCache.reset(new CannyCache(getImage()));
+            houghState.reset(new IncrementalHough(getImage().size()));
+        }
+        edgesChanged = cannyCache->update(threshold, threshold * 2, addedEdges, removedEdges);
+        cannyCache->edges().unpack(edgeImage);
+    }
+    else {
+        Canny(getImage(), edgeImage, threshold, threshold * 2);
+        edgeMap.pack(edgeImage);
+        edgesChanged = true;
+    }
+    traceStage.setCount(currentEdgeMap().count());
 
     // Display edge map
     imshow("Edge Map", edgeImage);
@@ -103,10 +266,66 @@ void Detection::updateEdgeMap() {
 }
 
 
+/**
+ * @brief Updates the line features and the line map window.
+ *
+ * Inside a tuning session the Hough accumulator is kept between calls: the removed edge
+ * pixels are voted out, the added ones voted in, and nothing is redone when the edge map
+ * did not change.
+ */
+void Detection::updateLineMap() {
+    if (!edgesChanged) {
+        return;
+    }
+
+    // Clear and update line features
+    TRACE_STAGE("lineMap");
+    lineFeatures.clear();
+    featureIndex.reset();
+    const EdgeMap& edges = currentEdgeMap();
+    if (houghState) {
+        houghState->removePoints(removedEdges);
+        houghState->addPoints(addedEdges);
+        houghState->findSegments(edges, 50, 50, 10, lineFeatures);
+    }
+    else {
+        ProbabilisticHough::findSegments(edges, 1, CV_PI / 180, 50, 50, 10, lineFeatures);
+    }
+
+    // Update and display line map
+    getImage().copyTo(lineImage);
+    for (const auto& lline : lineFeatures) {
+        Point pt1(lline[0], lline[1]);
+        Point pt2(lline[2], lline[3]);
+        line(lineImage, pt1, pt2, Scalar(255, 0, 0), 2);
+    }
+
+    string lineCountText = "Lines Detected: " + to_string(getLineCount());
+    putText(lineImage, lineCountText, Point(10, lineImage.rows - 20), FONT_HERSHEY_SIMPLEX, 0.8, Scalar(255, 255, 255), 2);
+    imshow("Line Map", lineImage);
+}
+
 /**
  * @brief Creates an interactive window for edge and line detection with adjustable threshold.
+ *
+ * The Canny gradients and the Hough accumulator live for the duration of the session; a
+ * session starting from a loaded edge map computes the gradients on the first threshold move.
+ * The last edge map is copied out of the Canny cache when the session ends, so it can still
+ * be saved.
  */
 void Detection::createAdjustableEdgeMap() {
+    if (getImage().empty()) {
+        throw runtime_error("Gray level image is empty!");
+    }
+    if (edgeMapLoaded && edgeMap.size() != getImage().size()) {
+        throw runtime_error("Loaded edge map does not match the image size");
+    }
+
+    if (!edgeMapLoaded) {
+        cannyCache.reset(new CannyCache(getImage()));
+    }
+    houghState.reset(new IncrementalHough(getImage().size()));
+
     // Create windows for edge and line maps
     namedWindow("Edge Map", WINDOW_AUTOSIZE);
     namedWindow("Line Map", WINDOW_AUTOSIZE);
@@ -114,42 +333,66 @@ void Detection::createAdjustableEdgeMap() {
     // Create trackbar for threshold adjustment
     createTrackbar("Min Threshold:", "Edge Map", &threshold, maxThreshold, [](int, void* userdata) {
         Detection* self = static_cast<Detection*>(userdata);
-
-        // Update edge map
         self->updateEdgeMap();
-
-        // Clear and update line features
-        self->lineFeatures.clear();
-        HoughLinesP(self->edgeImage, self->lineFeatures, 1, CV_PI / 180, 50, 50, 10);
-
-        // Update and display line map
-        Mat lineImage = self->getImage().clone();
-        for (const auto& lline : self->lineFeatures) {
-            Point pt1(lline[0], lline[1]);
-            Point pt2(lline[2], lline[3]);
-            line(lineImage, pt1, pt2, Scalar(255, 0, 0), 2);
-        }
-        
-        string lineCountText = "Lines Detected: " + to_string(self->getLineCount());
-        putText(lineImage, lineCountText, Point(10, lineImage.rows - 20), FONT_HERSHEY_SIMPLEX, 0.8, Scalar(255, 255, 255), 2);
-        imshow("Line Map", lineImage);
+        self->updateLineMap();
         }, this);
 
     // Show default maps
     updateEdgeMap();
+    updateLineMap();
 
-    lineFeatures.clear();
-    HoughLinesP(edgeImage, lineFeatures, 1, CV_PI / 180, 50, 50, 10);
-    Mat lineImage = getImage().clone();
-    for (const auto& lline : lineFeatures) {
-        Point pt1(lline[0], lline[1]);
-        Point pt2(lline[2], lline[3]);
-        line(lineImage, pt1, pt2, Scalar(255, 0, 0), 2);
+    while (waitKey(0) == 's') {
+        saveEdgeMap(getfileName() + "_edges.edg");
     }
-    
 
-    waitKey(0);
+    if (cannyCache) {
+        edgeMap = cannyCache->edges();
+    }
+    cannyCache.reset();
+    houghState.reset();
+    edgeImage.release();
+    lineImage.release();
 }
+/**
+ * @brief Saves the packed edge map of the last update.
+ *
+ * The file records the image name and the thresholds the map was detected with.
+ *
+ * @param fileName The edge map file.
+ */
+void Detection::saveEdgeMap(const string& fileName) {
+    const EdgeMap& edges = currentEdgeMap();
+    if (edges.size().area() == 0) {
+        throw runtime_error("No edge map to save, update the edge map first");
+    }
+    edges.save(fileName, getfileName(), threshold, threshold * 2);
+    logMessage("Edge map saved to file: " + fileName);
+}
+
+/**
+ * @brief Gets the edge map of the last update.
+ *
+ * @return The map of the tuning session's Canny cache while it has one, else edgeMap.
+ */
+const EdgeMap& Detection::currentEdgeMap(void) const {
+    return cannyCache ? cannyCache->edges() : edgeMap;
+}
+
+/**
+ * @brief Loads an edge map saved by saveEdgeMap.
+ *
+ * The session threshold is set to the low threshold of the map.
+ *
+ * @param fileName The edge map file.
+ */
+void Detection::loadEdgeMap(const string& fileName) {
+    int lowThreshold, highThreshold;
+    edgeMap.load(fileName, lowThreshold, highThreshold);
+    threshold = lowThreshold;
+    edgeMapLoaded = true;
+    logMessage("Edge map loaded from file: " + fileName + " (" + to_string(edgeMap.count()) + " edge pixels)");
+}
+
 /**
  * @brief Creates an adjustable edge map with custom threshold values.
  *
@@ -170,7 +413,8 @@ void Detection::createAdjustableEdgeMap(int initialThreshold, int maxThreshold)
  */
 void Detection::setCornerFeatures(vector<Point> local)
 {
-    cornerFeatures = local;
+    cornerFeatures = move(local);
+    featureIndex.reset();
 }
 
 /**
@@ -180,19 +424,49 @@ void Detection::setCornerFeatures(vector<Point> local)
  */
 void Detection::setLineFeatures(vector<Vec4i> local)
 {
-    lineFeatures = local;
+    lineFeatures = move(local);
+    featureIndex.reset();
 }
 
 /**
  * @brief Gets the corner features.
  *
- * @return A vector of detected corner points.
+ * @return A vector of detected corner points, valid until the features change.
  */
-vector<Point> Detection::getCornerFeatures(void) const
+const vector<Point>& Detection::getCornerFeatures(void) const
 {
     return cornerFeatures;
 }
 
+/**
+ * @brief Gets the line features.
+ *
+ * @return A vector of detected line segments, valid until the features change.
+ */
+const vector<Vec4i>& Detection::getLineFeatures(void) const
+{
+    return lineFeatures;
+}
+
+/**
+ * @brief Gets the spatial index over the detected features.
+ *
+ * The index is built on the first call after the features changed and kept until they
+ * change again.
+ *
+ * @return The index, valid until the features change.
+ */
+const FeatureIndex& Detection::getFeatureIndex(void) const
+{
+    if (!featureIndex)
+    {
+        TRACE_STAGE("index");
+        featureIndex.reset(new FeatureIndex(cornerFeatures, lineFeatures));
+        traceStage.setCount(cornerFeatures.size() + lineFeatures.size());
+    }
+    return *featureIndex;
+}
+
 /**
  * @brief Gets the number of detected corners.
  *
@@ -213,6 +487,261 @@ int Detection::getLineCount(void) const
     return lineFeatures.size();
 }
 
+/**
+ * @brief Gets the number of pyramid levels used for coarse-to-fine detection.
+ *
+ * @return The number of levels, 0 if detection runs at full resolution only.
+ */
+int Detection::getPyramidLevels(void) const
+{
+    return pyramidLevels;
+}
+
+/**
+ * @brief Enables or disables coarse-to-fine detection.
+ *
+ * @param levels Number of pyramid halvings, 0 to disable.
+ */
+void Detection::setPyramidLevels(int levels)
+{
+    if (levels < 0 || levels > 8)
+    {
+        throw invalid_argument("Pyramid levels must be between 0 and 8");
+    }
+
+    pyramidLevels = levels;
+}
+
+/**
+ * @brief Restricts preprocessing and detection to rectangular regions of interest.
+ *
+ * @param local Regions in raw image coordinates; they are clipped to the image and empty
+ *        ones are dropped. An empty list processes the whole image again.
+ */
+void Detection::setRegions(const vector<Rect>& local)
+{
+    const Rect frame(0, 0, getImage().cols, getImage().rows);
+    vector<Rect> clipped;
+    for (const auto& region : local) {
+        if (!(region & frame).empty()) {
+            clipped.push_back(region & frame);
+        }
+    }
+    if (!local.empty() && clipped.empty())
+    {
+        throw invalid_argument("No region of interest overlaps the image");
+    }
+
+    regions = move(clipped);
+    detectionRegions = regions;
+    regionMask.release();
+    regionScale = 1.0;
+}
+
+/**
+ * @brief Restricts preprocessing and detection to the nonzero pixels of a mask.
+ *
+ * Every 8-connected component of the mask contributes its bounding box as a region, so a
+ * mask made of a few blobs costs about as much as their boxes. Speckled masks should be
+ * cleaned up first, every speck pays the region margin.
+ *
+ * @param mask Single channel 8-bit mask the size of the raw image, shared rather than copied;
+ *        empty to process the whole image again.
+ */
+void Detection::setMask(const Mat& mask)
+{
+    if (mask.empty())
+    {
+        clearRegions();
+        return;
+    }
+    if (mask.type() != CV_8UC1 || mask.size() != getImage().size())
+    {
+        throw invalid_argument("Mask must be a single channel 8-bit image the size of the image");
+    }
+
+    Mat labels, stats, centroids;
+    const int componentCount = connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+    if (componentCount <= 1)
+    {
+        throw invalid_argument("Mask has no nonzero pixel");
+    }
+
+    vector<Rect> boxes;
+    for (int label = 1; label < componentCount; label++) {
+        boxes.push_back(Rect(stats.at<int>(label, CC_STAT_LEFT), stats.at<int>(label, CC_STAT_TOP),
+            stats.at<int>(label, CC_STAT_WIDTH), stats.at<int>(label, CC_STAT_HEIGHT)));
+    }
+    setRegions(boxes);
+    regionMask = mask;
+}
+
+/**
+ * @brief Removes the regions of interest and the mask, the whole image is processed again.
+ */
+void Detection::clearRegions(void)
+{
+    regions.clear();
+    detectionRegions.clear();
+    regionMask.release();
+    regionScale = 1.0;
+}
+
+/**
+ * @brief Gets the regions of interest.
+ *
+ * @return The regions in raw image coordinates, empty if the whole image is processed.
+ */
+const vector<Rect>& Detection::getRegions(void) const
+{
+    return regions;
+}
+
+/**
+ * @brief Gets the regions of interest in preprocessed image coordinates.
+ *
+ * @return The regions to search, empty if the whole image is searched.
+ */
+const vector<Rect>& Detection::getDetectionRegions(void) const
+{
+    return detectionRegions;
+}
+
+/**
+ * @brief Gets the margin the detector reads around a region of interest.
+ *
+ * The base class reads nothing beyond the region.
+ *
+ * @return The margin in preprocessed image pixels.
+ */
+int Detection::regionMargin(void) const
+{
+    return 0;
+}
+
+/**
+ * @brief Checks whether a point of the preprocessed image lies on the mask.
+ *
+ * @param point The point in preprocessed image coordinates.
+ * @return True if no mask is set or the mask pixel the point maps back to is nonzero.
+ */
+bool Detection::insideMask(const Point& point) const
+{
+    if (regionMask.empty())
+    {
+        return true;
+    }
+
+    const int x = min(regionMask.cols - 1, max(0, static_cast<int>(point.x / regionScale)));
+    const int y = min(regionMask.rows - 1, max(0, static_cast<int>(point.y / regionScale)));
+    return regionMask.at<uchar>(y, x) != 0;
+}
+
+/**
+ * @brief Replaces the image with the result of a preprocessing pipeline.
+ *
+ * Without regions of interest the whole image is preprocessed. Otherwise every region is
+ * grown by the filter radii and the detector margin, cut out of the raw image, run through
+ * the pipeline and written into a black image of the preprocessed size. Only the region and
+ * the detector margin are written back: the filter radii absorb the border the filters see
+ * at the cut, so the written pixels equal those of the whole frame and overlapping regions
+ * agree. A rescale stage maps the regions with the pipeline scale factor; the cut then
+ * resamples with a phase that differs from the whole frame by at most half a pixel.
+ *
+ * The filters and the detectors only touch the regions, but the result is still one frame of
+ * the preprocessed size, allocated and cleared on every call: the detectors, the feature
+ * masks and the display address the image in full-frame coordinates. Memory and the clearing
+ * pass therefore follow the frame size; only the filtering and detection follow the area.
+ *
+ * @param pipeline The stages to run.
+ * @param showStages True to display the raw image and the assembled result.
+ */
+void Detection::preprocess(PreprocessingPipeline& pipeline, bool showStages)
+{
+    if (regions.empty())
+    {
+        CommonProcesses::preprocess(pipeline, showStages);
+        return;
+    }
+
+    Mat& image = getImage();
+    int filterRadius = 0;
+    for (const auto& step : pipeline.getSteps()) {
+        if (step.backend == FilterBackend::Recursive)
+        {
+            // Its response never reaches zero, so no margin makes regions match the full frame
+            throw invalid_argument("Region preprocessing needs filters of finite extent, the recursive Gaussian is not supported");
+        }
+        if (step.stage == PreprocessStage::Gaussian || step.stage == PreprocessStage::Median)
+        {
+            filterRadius += step.kernelSize / 2;
+        }
+    }
+
+    if (showStages)
+    {
+        showImage("Raw Image", image);
+    }
+
+    const double scale = pipeline.getScaleFactor();
+    const Size size(cvRound(image.cols * scale), cvRound(image.rows * scale));
+    const Rect frame(0, 0, size.width, size.height);
+    const int margin = regionMargin();
+    const int rawMargin = cvCeil((filterRadius + margin) / scale) + (scale != 1.0 ? 2 : 0);
+
+    Mat result;
+    detectionRegions.clear();
+    for (const auto& region : regions) {
+        const Rect source = grown(region, rawMargin) & Rect(0, 0, image.cols, image.rows);
+        const Mat cut = image(source);
+        const Mat& output = pipeline.run(cut, getChannelOrder());
+        if (result.empty())
+        {
+            result.create(size, output.type());
+            result.setTo(Scalar::all(0));
+        }
+
+        const Rect target = Rect(cvRound(region.x * scale), cvRound(region.y * scale),
+            max(1, cvRound(region.width * scale)), max(1, cvRound(region.height * scale))) & frame;
+        const Rect placed(Point(cvRound(source.x * scale), cvRound(source.y * scale)), output.size());
+        const Rect written = grown(target, margin) & placed & frame;
+        Mat destination = result(written);
+        output(written - placed.tl()).copyTo(destination);
+        detectionRegions.push_back(target);
+    }
+
+    image = result;
+    regionScale = scale;
+    if (showStages)
+    {
+        showImage("Regions", image);
+    }
+    logMessage("Image preprocessed in " + to_string(regions.size()) + " regions: " + pipeline.describe());
+}
+
+/**
+ * @brief Parses a region written as "x,y,width,height".
+ *
+ * @param description The comma separated rectangle, e.g. "100,50,640,480".
+ * @return The region.
+ */
+Rect Detection::parseRegion(const string& description)
+{
+    stringstream values(description);
+    string x, y, width, height;
+    if (!getline(values, x, ',') || !getline(values, y, ',') || !getline(values, width, ',') || !getline(values, height, ','))
+    {
+        throw invalid_argument("Regions must be written as x,y,width,height: " + description);
+    }
+
+    const Rect region(stoi(x), stoi(y), stoi(width), stoi(height));
+    if (region.x < 0 || region.y < 0 || region.width <= 0 || region.height <= 0)
+    {
+        throw invalid_argument("Region needs a non-negative origin and a positive size: " + description);
+    }
+    return region;
+}
+
 /**
  * @brief Overloaded += operator to add a corner point.
  *
@@ -221,6 +750,7 @@ int Detection::getLineCount(void) const
  */
 Detection& Detection::operator+=(const Point& corner) {
     cornerFeatures.push_back(corner);
+    featureIndex.reset();
 
     return *this;
 }
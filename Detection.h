@@ -7,6 +7,12 @@
 #include <vector>
 #include <string>
 #include "CommonProcesses.h"
+#include "FeatureFile.h"
+#include "CannyCache.h"
+#include "EdgeMap.h"
+#include "IncrementalHough.h"
+#include "FeatureIndex.h"
+#include <memory>
 
 using namespace cv;
 using namespace std;
@@ -24,6 +30,36 @@ public:
     /// @param scale The scale factor for resizing.
     Detection(const string& filePath, const string& fileName, double& scale);
 
+    /// Constructor for an image that is already in memory
+    /// @param image The BGR image to process, shared rather than copied.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing.
+    Detection(const Mat& image, const string& fileName, double& scale);
+
+    /// Constructor decoding an encoded image held in memory
+    /// @param encoded The encoded bytes, only read during construction.
+    /// @param length Number of encoded bytes.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing.
+    Detection(const uchar* encoded, size_t length, const string& fileName, double& scale);
+
+    /// Constructor wrapping uncompressed pixels owned by the caller, which must outlive the object
+    /// @param pixels The first pixel, shared rather than copied.
+    /// @param size Image size.
+    /// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+    /// @param step Bytes per row, 0 for tightly packed rows.
+    /// @param order Sample order of color pixels.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing.
+    Detection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale);
+
+    /// Constructor mapping a raw pixel file without decoding or copying it
+    /// @param filePath The raw file.
+    /// @param layout Where and how the pixels are stored in the file.
+    /// @param fileName The name identifying the image.
+    /// @param scale The scale factor for resizing.
+    Detection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale);
+
     /// Destructor
     virtual ~Detection();
 
@@ -39,11 +75,34 @@ public:
     /// @param fileName The name of the file to save the features.
     void saveFeatures(const string& fileName);
 
+    /// Save detected features to a binary feature file
+    /// The file carries the image id, dimensions and detector parameters, see FeatureFileHeader.
+    /// @param fileName The name of the file to save the features.
+    void saveFeaturesBinary(const string& fileName);
+
+    /// Save one kind of detected features to a text file
+    /// Lets a detector that found both kinds write them to separate files.
+    /// @param fileName The name of the file to save the features.
+    /// @param type The kind of features to save.
+    void saveFeatures(const string& fileName, FeatureType type);
+
+    /// Save one kind of detected features to a binary feature file
+    /// @param fileName The name of the file to save the features.
+    /// @param type The kind of features to save; the header only lists that detector.
+    void saveFeaturesBinary(const string& fileName, FeatureType type);
+
     /// Log a message to the console
     /// @param message The message to log.
     void logMessage(const string& message);
 
+    /// Log a literal message to the console
+    /// @param message The message to log.
+    void logMessage(const char* message);
+
     /// Create an adjustable window for edge map adjustment
+    /// Gradients and the Hough accumulator are computed once per session; a trackbar move only
+    /// reruns the Canny hysteresis and re-votes the edge pixels that changed. Pressing 's'
+    /// saves the current edge map as "<image>_edges.edg", any other key ends the session.
     void createAdjustableEdgeMap();
 
     /// Create an adjustable edge map with initial values
@@ -54,6 +113,18 @@ public:
     /// Update the edge map based on the current threshold values
     void updateEdgeMap();
 
+    /// Save the packed edge map of the last update
+    /// The map stays available after the tuning session ends.
+    /// @param fileName The edge map file.
+    void saveEdgeMap(const string& fileName);
+
+    /// Load an edge map saved by saveEdgeMap
+    /// The next edge map update uses the loaded map and its low threshold instead of running
+    /// Canny, so a tuning session starts without computing gradients; they are computed once
+    /// the threshold moves.
+    /// @param fileName The edge map file, detected on an image of the size of the session image.
+    void loadEdgeMap(const string& fileName);
+
     /// Set corner features
     /// @param local A vector of points representing corner features.
     void setCornerFeatures(vector<Point> local);
@@ -69,8 +140,18 @@ public:
     //Detection& operator+=(const Vec4i& line);
 
     /// Get corner features
-    /// @return A vector of points representing detected corner features.
-    vector<Point> getCornerFeatures(void) const;
+    /// @return A vector of points representing detected corner features, valid until they change.
+    const vector<Point>& getCornerFeatures(void) const;
+
+    /// Get line features
+    /// @return A vector of segments (x1, y1, x2, y2) representing detected line features, valid until they change.
+    const vector<Vec4i>& getLineFeatures(void) const;
+
+    /// Get the spatial index over the detected features
+    /// Built on the first call after the features changed, so repeated region, radius and
+    /// nearest neighbor queries do not scan the feature vectors.
+    /// @return The index, valid until the features change.
+    const FeatureIndex& getFeatureIndex(void) const;
 
     /// Get the count of detected corners
     /// @return The number of detected corners.
@@ -80,12 +161,91 @@ public:
     /// @return The number of detected lines.
     int getLineCount(void) const;
 
+    /// Get the number of pyramid levels used for coarse-to-fine detection
+    /// @return The number of levels, 0 if detection runs at full resolution only.
+    int getPyramidLevels(void) const;
+
+    /// Enable or disable coarse-to-fine detection
+    /// Candidates are found on the image reduced by 2^levels and refined at full resolution,
+    /// features are still reported in full resolution coordinates.
+    /// @param levels Number of pyramid halvings, 0 to disable.
+    void setPyramidLevels(int levels);
+
+    /// Restrict preprocessing and detection to rectangular regions of interest
+    /// Set before preprocess: only the regions plus the margin the filters and the detector
+    /// read around them are preprocessed and searched, the rest of the preprocessed image
+    /// stays black. Features are reported in full image coordinates. Replaces any mask.
+    /// @param local Regions in raw image coordinates, clipped to the image; empty to process the whole image.
+    void setRegions(const vector<Rect>& local);
+
+    /// Restrict preprocessing and detection to the nonzero pixels of a mask
+    /// The bounding boxes of the connected mask components become the regions of interest
+    /// and features outside the nonzero pixels are dropped.
+    /// @param mask Single channel 8-bit mask the size of the raw image; empty to process the whole image.
+    void setMask(const Mat& mask);
+
+    /// Process the whole image again
+    void clearRegions(void);
+
+    /// Get the regions of interest
+    /// @return The regions in raw image coordinates, empty if the whole image is processed.
+    const vector<Rect>& getRegions(void) const;
+
+    /// Replace the image with the result of a preprocessing pipeline
+    /// With regions of interest set, the pipeline runs on each padded region instead of the frame.
+    /// @param pipeline The stages to run.
+    /// @param showStages True to display the raw image and every stage result.
+    void preprocess(PreprocessingPipeline& pipeline, bool showStages = false) override;
+
+    /// Parse a region written as "x,y,width,height"
+    /// @param description The comma separated rectangle.
+    /// @return The region.
+    static Rect parseRegion(const string& description);
+
+protected:
+    /// Fill the detector specific parameters of a binary feature file header
+    /// @param header The header to complete.
+    virtual void describeParameters(FeatureFileHeader& header) const;
+
+    /// Get the margin the detector reads around a region of interest
+    /// @return The margin in preprocessed image pixels.
+    virtual int regionMargin(void) const;
+
+    /// Get the regions of interest in preprocessed image coordinates
+    /// @return The regions to search, empty if the whole image is searched.
+    const vector<Rect>& getDetectionRegions(void) const;
+
+    /// Check whether a point of the preprocessed image lies on the mask
+    /// @param point The point in preprocessed image coordinates.
+    /// @return True if no mask is set or the mask is nonzero there.
+    bool insideMask(const Point& point) const;
 
 private:
+    /// Update the line features and the line map window from the changed edge pixels
+    void updateLineMap();
+
+    /// Get the edge map of the last update
+    /// @return The map of the tuning session's Canny cache while it has one, else edgeMap.
+    const EdgeMap& currentEdgeMap(void) const;
 
     vector<Point> cornerFeatures;           ///< Vector to store detected corner features
     vector<Vec4i> lineFeatures;             ///< Vector to store detected line features
-    Mat edgeImage;                          ///< Mat object to store edge detection image
+    mutable unique_ptr<FeatureIndex> featureIndex; ///< Index over the features, null while outdated
+    Mat edgeImage;                          ///< 8-bit display buffer of the edge map
+    EdgeMap edgeMap;                        ///< Packed edge map outside a session, taken from the Canny cache when it ends
     int threshold;                          ///< Threshold value for edge detection
     int maxThreshold;                       ///< Maximum threshold value for edge detection
+    unique_ptr<CannyCache> cannyCache;      ///< Threshold independent Canny state of the tuning session
+    unique_ptr<IncrementalHough> houghState; ///< Hough accumulator of the tuning session
+    vector<int> addedEdges;                 ///< Edge pixels added by the last edge map update
+    vector<int> removedEdges;               ///< Edge pixels removed by the last edge map update
+    bool edgesChanged;                      ///< True if the last edge map update changed any pixel
+    bool edgeMapLoaded;                     ///< True while edgeMap holds a loaded map not yet shown
+    int pyramidLevels;                      ///< Coarse-to-fine pyramid levels, 0 when disabled
+    vector<Rect> regions;                   ///< Regions of interest in raw image coordinates
+    vector<Rect> detectionRegions;          ///< Regions of interest in preprocessed image coordinates
+    Mat regionMask;                         ///< Mask the regions were derived from, empty for plain regions
+    double regionScale;                     ///< Scale from raw to preprocessed image coordinates
+    Mat lineImage;                          ///< Reused line map display buffer
+    Mat displayImage;                       ///< Reused feature display buffer
 };
@@ -0,0 +1,271 @@
+#include "EdgeMap.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static_assert(sizeof(EdgeMapFileHeader) == 112, "EdgeMapFileHeader layout must not contain padding");
+
+/**
+ * @brief Constructor for an empty map.
+ */
+EdgeMap::EdgeMap() : rowWords(0) {
+}
+
+/**
+ * @brief Constructor for a map without edges.
+ *
+ * @param size Size of the map.
+ */
+EdgeMap::EdgeMap(Size size) : rowWords(0) {
+    reset(size);
+}
+
+/**
+ * @brief Allocates cleared rows for a size and drops the edge list.
+ *
+ * @param size Size of the map.
+ */
+void EdgeMap::reset(Size size) {
+    if (size.width < 0 || size.height < 0) {
+        throw invalid_argument("Edge map size cannot be negative");
+    }
+    mapSize = size;
+    rowWords = (size.width + 63) / 64;
+    words.assign(static_cast<size_t>(rowWords) * size.height, 0);
+    edgeIndices.clear();
+}
+
+/**
+ * @brief Packs an 8-bit edge map and lists its edge pixels.
+ *
+ * Bands of rows are packed in parallel, each into its own part of the edge list; the parts
+ * are joined in band order, so the list stays in raster order.
+ *
+ * @param edges Single channel 8-bit map, nonzero on edges.
+ */
+void EdgeMap::pack(const Mat& edges) {
+    if (edges.type() != CV_8UC1) {
+        throw invalid_argument("Edge map needs a single channel 8-bit image");
+    }
+    reset(edges.size());
+
+    const int cols = mapSize.width;
+    const int bands = max(1, min(getNumThreads() * 2, mapSize.height / 16));
+    vector<vector<int>> found(bands);
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        for (int band = range.start; band < range.end; band++) {
+            const int y0 = mapSize.height * band / bands;
+            const int y1 = mapSize.height * (band + 1) / bands;
+            for (int y = y0; y < y1; y++) {
+                const uchar* in = edges.ptr<uchar>(y);
+                uint64_t* out = words.data() + static_cast<size_t>(y) * rowWords;
+                for (int x = 0; x < cols; x++) {
+                    if (in[x] != 0) {
+                        out[x >> 6] |= uint64_t(1) << (x & 63);
+                        found[band].push_back(y * cols + x);
+                    }
+                }
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& part : found) {
+        total += part.size();
+    }
+    edgeIndices.reserve(total);
+    for (const auto& part : found) {
+        edgeIndices.insert(edgeIndices.end(), part.begin(), part.end());
+    }
+}
+
+/**
+ * @brief Replaces the edges by a list of pixels.
+ *
+ * @param indices Pixel indices (y * cols + x) in raster order.
+ */
+void EdgeMap::assign(const vector<int>& indices) {
+    const int cols = mapSize.width;
+    for (int index : edgeIndices) {
+        const int y = index / cols;
+        const int x = index - y * cols;
+        words[static_cast<size_t>(y) * rowWords + (x >> 6)] &= ~(uint64_t(1) << (x & 63));
+    }
+    for (int index : indices) {
+        const int y = index / cols;
+        const int x = index - y * cols;
+        words[static_cast<size_t>(y) * rowWords + (x >> 6)] |= uint64_t(1) << (x & 63);
+    }
+    edgeIndices = indices;
+}
+
+/**
+ * @brief Expands the map to 8 bits per pixel.
+ *
+ * @param edges Output map with 255 on edges.
+ */
+void EdgeMap::unpack(Mat& edges) const {
+    edges.create(mapSize, CV_8UC1);
+    edges.setTo(Scalar(0));
+    const int cols = mapSize.width;
+    for (int index : edgeIndices) {
+        edges.at<uchar>(index / cols, index % cols) = 255;
+    }
+}
+
+/**
+ * @brief Gets the edge pixels.
+ *
+ * @return Pixel indices (y * cols + x) in raster order.
+ */
+const vector<int>& EdgeMap::indices(void) const {
+    return edgeIndices;
+}
+
+/**
+ * @brief Gets the packed rows.
+ *
+ * @return height * wordsPerRow() words.
+ */
+const vector<uint64_t>& EdgeMap::packedWords(void) const {
+    return words;
+}
+
+/**
+ * @brief Gets the number of 64-bit words of a packed row.
+ *
+ * @return The words per row.
+ */
+int EdgeMap::wordsPerRow(void) const {
+    return rowWords;
+}
+
+/**
+ * @brief Gets the size of the map.
+ *
+ * @return The size, empty for an empty map.
+ */
+Size EdgeMap::size(void) const {
+    return mapSize;
+}
+
+/**
+ * @brief Gets the number of edge pixels.
+ *
+ * @return The edge count.
+ */
+size_t EdgeMap::count(void) const {
+    return edgeIndices.size();
+}
+
+/**
+ * @brief Gets the memory held by the packed rows and the edge list.
+ *
+ * @return The size in bytes.
+ */
+size_t EdgeMap::byteSize(void) const {
+    return words.size() * sizeof(uint64_t) + edgeIndices.size() * sizeof(int);
+}
+
+/**
+ * @brief Saves the map to an edge map file.
+ *
+ * Only the packed rows are written; the edge list is rebuilt on load.
+ *
+ * @param fileName The output file.
+ * @param imageId Identifier of the source image, truncated to 63 characters.
+ * @param lowThreshold Canny low threshold the map was detected with.
+ * @param highThreshold Canny high threshold the map was detected with.
+ */
+void EdgeMap::save(const string& fileName, const string& imageId, int lowThreshold, int highThreshold) const {
+    EdgeMapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "EDGE", 4);
+    header.version = EdgeMapFileVersion;
+    header.headerSize = sizeof(EdgeMapFileHeader);
+    header.byteOrder = 0x01020304;
+    imageId.copy(header.imageId, sizeof(header.imageId) - 1);
+    header.width = mapSize.width;
+    header.height = mapSize.height;
+    header.lowThreshold = lowThreshold;
+    header.highThreshold = highThreshold;
+    header.edgeCount = edgeIndices.size();
+    header.wordsPerRow = rowWords;
+
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + fileName);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + fileName);
+    }
+}
+
+/**
+ * @brief Loads a map saved with save and rebuilds its edge list.
+ *
+ * The file is mapped and its rows copied in one piece. The edge list is rebuilt from the
+ * nonzero words only, so sparse maps load in little more than the copy.
+ *
+ * @param fileName The edge map file.
+ * @param lowThreshold Output Canny low threshold of the map.
+ * @param highThreshold Output Canny high threshold of the map.
+ */
+void EdgeMap::load(const string& fileName, int& lowThreshold, int& highThreshold) {
+    MappedFile file(fileName);
+    if (file.size() < sizeof(EdgeMapFileHeader)) {
+        throw runtime_error("Not an edge map file (too small): " + fileName);
+    }
+
+    EdgeMapFileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "EDGE", 4) != 0) {
+        throw runtime_error("Not an edge map file (bad magic): " + fileName);
+    }
+    if (header.byteOrder != 0x01020304) {
+        throw runtime_error("Edge map file was written with a different byte order: " + fileName);
+    }
+    if (header.version != EdgeMapFileVersion || header.headerSize != sizeof(EdgeMapFileHeader)) {
+        throw runtime_error("Unsupported edge map file version " + to_string(header.version) + ": " + fileName);
+    }
+
+    const bool valid = header.width >= 0 && header.height >= 0 &&
+        header.wordsPerRow == static_cast<uint64_t>((header.width + 63) / 64) &&
+        header.wordsPerRow * header.height <= (file.size() - sizeof(header)) / sizeof(uint64_t);
+    if (!valid) {
+        throw runtime_error("Edge map file is truncated or corrupt: " + fileName);
+    }
+
+    reset(Size(header.width, header.height));
+    if (!words.empty()) {
+        memcpy(words.data(), file.data() + sizeof(header), words.size() * sizeof(uint64_t));
+    }
+
+    const int cols = mapSize.width;
+    edgeIndices.reserve(static_cast<size_t>(header.edgeCount));
+    for (int y = 0; y < mapSize.height; y++) {
+        const uint64_t* row = words.data() + static_cast<size_t>(y) * rowWords;
+        for (int w = 0; w < rowWords; w++) {
+            for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1) {
+                int bit = 0;
+                while (!((bits >> bit) & 1)) {
+                    bit++;
+                }
+                if (w * 64 + bit >= cols) {
+                    throw runtime_error("Edge map file is truncated or corrupt: " + fileName);
+                }
+                edgeIndices.push_back(y * cols + w * 64 + bit);
+            }
+        }
+    }
+    if (edgeIndices.size() != header.edgeCount) {
+        throw runtime_error("Edge map file is truncated or corrupt: " + fileName);
+    }
+
+    lowThreshold = header.lowThreshold;
+    highThreshold = header.highThreshold;
+}
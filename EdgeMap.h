@@ -0,0 +1,111 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// Header of an edge map file (version 1)
+/// Followed by height rows of wordsPerRow little endian 64-bit words, bit x % 64 of word
+/// x / 64 set on edges. The header has no padding, so the words start on an 8-byte boundary.
+struct EdgeMapFileHeader {
+    char magic[4];                  ///< "EDGE"
+    uint32_t version;               ///< Format version, currently 1
+    uint32_t headerSize;            ///< sizeof(EdgeMapFileHeader) of the writer
+    uint32_t byteOrder;             ///< 0x01020304 written natively, detects foreign byte order
+    char imageId[64];               ///< NUL terminated image identifier
+    int32_t width;                  ///< Width of the edge map
+    int32_t height;                 ///< Height of the edge map
+    int32_t lowThreshold;           ///< Canny low threshold the map was detected with
+    int32_t highThreshold;          ///< Canny high threshold the map was detected with
+    uint64_t edgeCount;             ///< Number of edge pixels
+    uint64_t wordsPerRow;           ///< 64-bit words of one packed row
+};
+
+/// Current edge map file version
+const uint32_t EdgeMapFileVersion = 1;
+
+/// EdgeMap Class
+/// Binary edge map stored one bit per pixel, together with the indices (y * cols + x) of its
+/// edge pixels in raster order. The packed rows take an eighth of an 8-bit Canny map and the
+/// index list lets line voting visit the edge pixels without scanning the map. Rows are padded
+/// to whole 64-bit words.
+class EdgeMap
+{
+public:
+    /// Constructor for an empty map
+    EdgeMap();
+
+    /// Constructor for a map without edges
+    /// @param size Size of the map.
+    explicit EdgeMap(Size size);
+
+    /// Pack an 8-bit edge map and list its edge pixels
+    /// @param edges Single channel 8-bit map, nonzero on edges.
+    void pack(const Mat& edges);
+
+    /// Replace the edges by a list of pixels
+    /// Only the bits of the previous and the new edge pixels are touched.
+    /// @param indices Pixel indices (y * cols + x) in raster order.
+    void assign(const vector<int>& indices);
+
+    /// Expand the map to 8 bits per pixel
+    /// @param edges Output map with 255 on edges.
+    void unpack(Mat& edges) const;
+
+    /// Check whether a pixel is an edge
+    /// @param x Column inside the map.
+    /// @param y Row inside the map.
+    /// @return True on edges.
+    bool test(int x, int y) const {
+        return (words[static_cast<size_t>(y) * rowWords + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    /// Get the edge pixels
+    /// @return Pixel indices (y * cols + x) in raster order.
+    const vector<int>& indices(void) const;
+
+    /// Get the packed rows
+    /// @return height * wordsPerRow() words.
+    const vector<uint64_t>& packedWords(void) const;
+
+    /// Get the number of 64-bit words of a packed row
+    /// @return The words per row.
+    int wordsPerRow(void) const;
+
+    /// Get the size of the map
+    /// @return The size, empty for an empty map.
+    Size size(void) const;
+
+    /// Get the number of edge pixels
+    /// @return The edge count.
+    size_t count(void) const;
+
+    /// Get the memory held by the packed rows and the edge list
+    /// @return The size in bytes.
+    size_t byteSize(void) const;
+
+    /// Save the map to an edge map file
+    /// @param fileName The output file.
+    /// @param imageId Identifier of the source image, truncated to 63 characters.
+    /// @param lowThreshold Canny low threshold the map was detected with.
+    /// @param highThreshold Canny high threshold the map was detected with.
+    void save(const string& fileName, const string& imageId, int lowThreshold, int highThreshold) const;
+
+    /// Load a map saved with save and rebuild its edge list
+    /// @param fileName The edge map file.
+    /// @param lowThreshold Output Canny low threshold of the map.
+    /// @param highThreshold Output Canny high threshold of the map.
+    void load(const string& fileName, int& lowThreshold, int& highThreshold);
+
+private:
+    /// Allocate cleared rows for a size and drop the edge list
+    void reset(Size size);
+
+    Size mapSize;                   ///< Size of the map
+    int rowWords;                   ///< 64-bit words per packed row
+    vector<uint64_t> words;         ///< Packed rows
+    vector<int> edgeIndices;        ///< Edge pixels in raster order
+};
@@ -0,0 +1,235 @@
+#include "FeatureFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static_assert(sizeof(FeatureFileHeader) == 144, "FeatureFileHeader layout must not contain padding");
+static_assert(sizeof(Point) == 2 * sizeof(int32_t), "Point must be two packed int32 values");
+static_assert(sizeof(Vec4i) == 4 * sizeof(int32_t), "Vec4i must be four packed int32 values");
+
+/**
+ * @brief Creates a header with the identification fields filled in and every parameter zeroed.
+ *
+ * @param imageId Identifier of the source image, truncated to 63 characters.
+ * @param width Image width.
+ * @param height Image height.
+ * @return The header.
+ */
+FeatureFileHeader FeatureFile::makeHeader(const string& imageId, int width, int height) {
+    FeatureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FEAT", 4);
+    header.version = FeatureFileVersion;
+    header.headerSize = sizeof(FeatureFileHeader);
+    header.byteOrder = 0x01020304;
+    imageId.copy(header.imageId, sizeof(header.imageId) - 1);
+    header.width = width;
+    header.height = height;
+    header.scaleFactor = 1.0f;
+    return header;
+}
+
+/**
+ * @brief Writes features in the binary format with a single write call.
+ *
+ * Header, corner array and line array are laid out back to back in one buffer, which is
+ * handed to the stream in one write.
+ *
+ * @param fileName The output file.
+ * @param header Header carrying the image and detector description.
+ * @param corners Corner features.
+ * @param lines Line features.
+ */
+void FeatureFile::writeBinary(const string& fileName, FeatureFileHeader header, const vector<Point>& corners, const vector<Vec4i>& lines) {
+    memcpy(header.magic, "FEAT", 4);
+    header.version = FeatureFileVersion;
+    header.headerSize = sizeof(FeatureFileHeader);
+    header.byteOrder = 0x01020304;
+    header.cornerCount = corners.size();
+    header.lineCount = lines.size();
+    header.cornerOffset = sizeof(FeatureFileHeader);
+    header.lineOffset = header.cornerOffset + corners.size() * sizeof(Point);
+
+    vector<char> buffer(static_cast<size_t>(header.lineOffset + lines.size() * sizeof(Vec4i)));
+    memcpy(buffer.data(), &header, sizeof(header));
+    if (!corners.empty()) {
+        memcpy(buffer.data() + header.cornerOffset, corners.data(), corners.size() * sizeof(Point));
+    }
+    if (!lines.empty()) {
+        memcpy(buffer.data() + header.lineOffset, lines.data(), lines.size() * sizeof(Vec4i));
+    }
+
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + fileName);
+    }
+    file.write(buffer.data(), buffer.size());
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + fileName);
+    }
+}
+
+/**
+ * @brief Writes features in the text format used by Detection::saveFeatures.
+ *
+ * @param fileName The output file.
+ * @param corners Corner features.
+ * @param lines Line features.
+ */
+void FeatureFile::writeText(const string& fileName, const vector<Point>& corners, const vector<Vec4i>& lines) {
+    ofstream file(fileName);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + fileName);
+    }
+
+    for (const auto& feature : corners) {
+        file << "Point: (" << feature.x << ", " << feature.y << ")\n";
+    }
+
+    for (const auto& line : lines) {
+        file << "Line: (" << line[0] << ", " << line[1] << ") -> ("
+            << line[2] << ", " << line[3] << ")\n";
+    }
+
+    file.close();
+}
+
+/**
+ * @brief Reads features from the text format.
+ *
+ * Lines that are neither a point nor a line entry are ignored.
+ *
+ * @param fileName The input file.
+ * @param corners Output corner features.
+ * @param lines Output line features.
+ */
+void FeatureFile::readText(const string& fileName, vector<Point>& corners, vector<Vec4i>& lines) {
+    ifstream file(fileName);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + fileName);
+    }
+
+    corners.clear();
+    lines.clear();
+
+    string entry;
+    while (getline(file, entry)) {
+        Point corner;
+        Vec4i line;
+        if (sscanf(entry.c_str(), " Point: (%d, %d)", &corner.x, &corner.y) == 2) {
+            corners.push_back(corner);
+        }
+        else if (sscanf(entry.c_str(), " Line: (%d, %d) -> (%d, %d)", &line[0], &line[1], &line[2], &line[3]) == 4) {
+            lines.push_back(line);
+        }
+    }
+}
+
+/**
+ * @brief Converts a text feature file to the binary format.
+ *
+ * @param textFile The input text file.
+ * @param binaryFile The output binary file.
+ */
+void FeatureFile::textToBinary(const string& textFile, const string& binaryFile) {
+    vector<Point> corners;
+    vector<Vec4i> lines;
+    readText(textFile, corners, lines);
+
+    FeatureFileHeader header = makeHeader(textFile, 0, 0);
+    header.detectors = (corners.empty() ? 0 : FeatureFileCorners) | (lines.empty() ? 0 : FeatureFileLines);
+    writeBinary(binaryFile, header, corners, lines);
+}
+
+/**
+ * @brief Converts a binary feature file to the text format.
+ *
+ * @param binaryFile The input binary file.
+ * @param textFile The output text file.
+ */
+void FeatureFile::binaryToText(const string& binaryFile, const string& textFile) {
+    FeatureFileView view(binaryFile);
+    vector<Point> corners(view.corners(), view.corners() + view.cornerCount());
+    vector<Vec4i> lines(view.lines(), view.lines() + view.lineCount());
+    writeText(textFile, corners, lines);
+}
+
+/**
+ * @brief Constructor mapping and validating a binary feature file.
+ *
+ * @param fileName The binary feature file.
+ */
+FeatureFileView::FeatureFileView(const string& fileName)
+    : file(fileName), fileHeader(nullptr) {
+    if (file.size() < sizeof(FeatureFileHeader)) {
+        throw runtime_error("Not a feature file (too small): " + fileName);
+    }
+
+    const FeatureFileHeader* mapped = reinterpret_cast<const FeatureFileHeader*>(file.data());
+    if (memcmp(mapped->magic, "FEAT", 4) != 0) {
+        throw runtime_error("Not a feature file (bad magic): " + fileName);
+    }
+    if (mapped->byteOrder != 0x01020304) {
+        throw runtime_error("Feature file was written with a different byte order: " + fileName);
+    }
+    if (mapped->version != FeatureFileVersion || mapped->headerSize != sizeof(FeatureFileHeader)) {
+        throw runtime_error("Unsupported feature file version " + to_string(mapped->version) + ": " + fileName);
+    }
+
+    const uint64_t size = file.size();
+    bool valid = mapped->cornerOffset <= size && mapped->lineOffset <= size &&
+        mapped->cornerOffset % alignof(int32_t) == 0 && mapped->lineOffset % alignof(int32_t) == 0 &&
+        mapped->cornerCount <= (size - mapped->cornerOffset) / sizeof(Point) &&
+        mapped->lineCount <= (size - mapped->lineOffset) / sizeof(Vec4i);
+    if (!valid) {
+        throw runtime_error("Feature file is truncated or corrupt: " + fileName);
+    }
+
+    fileHeader = mapped;
+}
+
+/**
+ * @brief Gets the file header.
+ *
+ * @return Reference to the mapped header.
+ */
+const FeatureFileHeader& FeatureFileView::header(void) const {
+    return *fileHeader;
+}
+
+/**
+ * @brief Gets the corner array.
+ *
+ * @return Pointer to cornerCount() points inside the mapping.
+ */
+const Point* FeatureFileView::corners(void) const {
+    return reinterpret_cast<const Point*>(file.data() + fileHeader->cornerOffset);
+}
+
+/**
+ * @brief Gets the number of corners.
+ *
+ * @return The corner count.
+ */
+size_t FeatureFileView::cornerCount(void) const {
+    return static_cast<size_t>(fileHeader->cornerCount);
+}
+
+/**
+ * @brief Gets the line array.
+ *
+ * @return Pointer to lineCount() segments inside the mapping.
+ */
+const Vec4i* FeatureFileView::lines(void) const {
+    return reinterpret_cast<const Vec4i*>(file.data() + fileHeader->lineOffset);
+}
+
+/**
+ * @brief Gets the number of line segments.
+ *
+ * @return The line count.
+ */
+size_t FeatureFileView::lineCount(void) const {
+    return static_cast<size_t>(fileHeader->lineCount);
+}
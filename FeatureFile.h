@@ -0,0 +1,119 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+using namespace std;
+using namespace cv;
+
+/// Detector bits stored in FeatureFileHeader::detectors
+enum FeatureFileDetector : int32_t { FeatureFileCorners = 1, FeatureFileLines = 2 };
+
+/// Header of a binary feature file (version 1)
+/// All fields are naturally aligned, so the header has no padding and the packed arrays that
+/// follow it start on 8-byte boundaries: cornerCount int32 (x, y) pairs, then lineCount
+/// int32 (x1, y1, x2, y2) quadruples, both in the writer's native (little endian) byte order.
+struct FeatureFileHeader {
+    char magic[4];                  ///< "FEAT"
+    uint32_t version;               ///< Format version, currently 1
+    uint32_t headerSize;            ///< sizeof(FeatureFileHeader) of the writer
+    uint32_t byteOrder;             ///< 0x01020304 written natively, detects foreign byte order
+    char imageId[64];               ///< NUL terminated image identifier
+    int32_t width;                  ///< Width of the image the features were detected on
+    int32_t height;                 ///< Height of the image the features were detected on
+    int32_t detectors;              ///< FeatureFileDetector bits of the detectors that ran
+    int32_t qualityLevel;           ///< Harris quality level, 0 if not applicable
+    int32_t suppressionRadius;      ///< Corner non-maximum suppression radius, 0 if off
+    int32_t cannyLowThreshold;      ///< Canny low threshold, 0 if not applicable
+    int32_t houghThreshold;         ///< HoughLinesP accumulator threshold, 0 if not applicable
+    float scaleFactor;              ///< Scale factor applied before detection
+    uint64_t cornerCount;           ///< Number of corners
+    uint64_t lineCount;             ///< Number of line segments
+    uint64_t cornerOffset;          ///< Byte offset of the corner array from the file start
+    uint64_t lineOffset;            ///< Byte offset of the line array from the file start
+};
+
+/// Current binary feature file version
+const uint32_t FeatureFileVersion = 1;
+
+/// FeatureFile Class
+/// Reads and writes detected features as text ("Point: (x, y)" / "Line: (..) -> (..)")
+/// or as the versioned binary format described by FeatureFileHeader.
+class FeatureFile
+{
+public:
+    /// Create a header with the identification fields filled in and every parameter zeroed
+    /// @param imageId Identifier of the source image, truncated to 63 characters.
+    /// @param width Image width.
+    /// @param height Image height.
+    /// @return The header.
+    static FeatureFileHeader makeHeader(const string& imageId, int width, int height);
+
+    /// Write features in the binary format with a single write call
+    /// Magic, version, counts and offsets of the header are filled in by this function.
+    /// @param fileName The output file.
+    /// @param header Header carrying the image and detector description.
+    /// @param corners Corner features.
+    /// @param lines Line features.
+    static void writeBinary(const string& fileName, FeatureFileHeader header, const vector<Point>& corners, const vector<Vec4i>& lines);
+
+    /// Write features in the text format used by Detection::saveFeatures
+    /// @param fileName The output file.
+    /// @param corners Corner features.
+    /// @param lines Line features.
+    static void writeText(const string& fileName, const vector<Point>& corners, const vector<Vec4i>& lines);
+
+    /// Read features from the text format
+    /// @param fileName The input file.
+    /// @param corners Output corner features.
+    /// @param lines Output line features.
+    static void readText(const string& fileName, vector<Point>& corners, vector<Vec4i>& lines);
+
+    /// Convert a text feature file to the binary format
+    /// The text format carries no image description, so dimensions and parameters are zero.
+    /// @param textFile The input text file.
+    /// @param binaryFile The output binary file.
+    static void textToBinary(const string& textFile, const string& binaryFile);
+
+    /// Convert a binary feature file to the text format
+    /// @param binaryFile The input binary file.
+    /// @param textFile The output text file.
+    static void binaryToText(const string& binaryFile, const string& textFile);
+};
+
+/// FeatureFileView Class
+/// Zero-parse reader of a binary feature file: the file is memory mapped, the header is
+/// validated once and the corner and line arrays are exposed in place.
+class FeatureFileView
+{
+public:
+    /// Constructor mapping a binary feature file
+    /// @param fileName The binary feature file.
+    explicit FeatureFileView(const string& fileName);
+
+    /// Get the file header
+    /// @return Reference to the mapped header.
+    const FeatureFileHeader& header(void) const;
+
+    /// Get the corner array
+    /// @return Pointer to cornerCount() points inside the mapping.
+    const Point* corners(void) const;
+
+    /// Get the number of corners
+    /// @return The corner count.
+    size_t cornerCount(void) const;
+
+    /// Get the line array
+    /// @return Pointer to lineCount() segments inside the mapping.
+    const Vec4i* lines(void) const;
+
+    /// Get the number of line segments
+    /// @return The line count.
+    size_t lineCount(void) const;
+
+private:
+    MappedFile file;                ///< Mapping of the whole file
+    const FeatureFileHeader* fileHeader; ///< Header at the start of the mapping
+};
@@ -0,0 +1,402 @@
+#include "FeatureIndex.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <queue>
+
+namespace {
+    /// Floor division of a coordinate offset by the cell size
+    int cellIndex(float offset, int cellSize) {
+        return static_cast<int>(floor(offset / cellSize));
+    }
+
+    /// Bounding box of a set of points, width and height measured between the extreme points
+    template<typename Iterator, typename Extract>
+    Rect boundsOf(Iterator first, Iterator last, const Extract& extract) {
+        int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+        for (; first != last; ++first) {
+            extract(*first, minX, minY, maxX, maxY);
+        }
+        return Rect(minX, minY, maxX - minX, maxY - minY);
+    }
+}
+
+/**
+ * @brief Constructor for an empty index.
+ */
+FeatureIndex::FeatureIndex() {
+    build(vector<Point>(), vector<Vec4i>());
+}
+
+/**
+ * @brief Constructor building the index.
+ *
+ * @param corners The corners to index.
+ * @param lines The line segments to index.
+ */
+FeatureIndex::FeatureIndex(const vector<Point>& corners, const vector<Vec4i>& lines) {
+    build(corners, lines);
+}
+
+/**
+ * @brief Rebuilds the index for new features.
+ *
+ * @param corners The corners to index, copied into the index.
+ * @param lines The line segments to index, copied into the index.
+ */
+void FeatureIndex::build(const vector<Point>& corners, const vector<Vec4i>& lines) {
+    this->corners = corners;
+    this->lines = lines;
+    buildCornerGrid();
+    buildLineGrid();
+}
+
+/**
+ * @brief Shapes a grid over a bounding box.
+ *
+ * @param grid The grid to shape.
+ * @param bounds The box to cover, its right and bottom edge included.
+ * @param cellSize Cell width and height.
+ */
+void FeatureIndex::shapeGrid(Grid& grid, const Rect& bounds, int cellSize) {
+    grid.origin = bounds.tl();
+    grid.cellSize = cellSize;
+    grid.columns = bounds.width / cellSize + 1;
+    grid.rows = bounds.height / cellSize + 1;
+    grid.cellStart.assign(static_cast<size_t>(grid.columns) * grid.rows + 1, 0);
+}
+
+/**
+ * @brief Indexes the corners.
+ *
+ * The cell size gives about two corners per cell for evenly spread corners. Entries are
+ * placed with a counting sort, so corners of one cell stay in ascending order.
+ */
+void FeatureIndex::buildCornerGrid(void) {
+    cornerGrid = Grid();
+    cornerGrid.cellStart.assign(1, 0);
+    if (corners.empty()) {
+        return;
+    }
+
+    const Rect bounds = boundsOf(corners.begin(), corners.end(), [](const Point& p, int& minX, int& minY, int& maxX, int& maxY) {
+        minX = min(minX, p.x);
+        minY = min(minY, p.y);
+        maxX = max(maxX, p.x);
+        maxY = max(maxY, p.y);
+    });
+    const double area = (bounds.width + 1.0) * (bounds.height + 1.0);
+    shapeGrid(cornerGrid, bounds, max(1, static_cast<int>(ceil(sqrt(area * 2.0 / corners.size())))));
+
+    vector<int> cellOf(corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        const int column = (corners[i].x - cornerGrid.origin.x) / cornerGrid.cellSize;
+        const int row = (corners[i].y - cornerGrid.origin.y) / cornerGrid.cellSize;
+        cellOf[i] = row * cornerGrid.columns + column;
+        cornerGrid.cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 1; c < cornerGrid.cellStart.size(); c++) {
+        cornerGrid.cellStart[c] += cornerGrid.cellStart[c - 1];
+    }
+
+    vector<int> next(cornerGrid.cellStart.begin(), cornerGrid.cellStart.end() - 1);
+    cornerGrid.entries.resize(corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        cornerGrid.entries[next[cellOf[i]]++] = static_cast<int>(i);
+    }
+}
+
+/**
+ * @brief Indexes the line segments.
+ *
+ * The cell size gives about as many cells as segments. Every segment is listed in each
+ * cell it passes through, found with two passes of the same cell walk: one counting, one
+ * placing.
+ */
+void FeatureIndex::buildLineGrid(void) {
+    lineGrid = Grid();
+    lineGrid.cellStart.assign(1, 0);
+    if (lines.empty()) {
+        return;
+    }
+
+    const Rect bounds = boundsOf(lines.begin(), lines.end(), [](const Vec4i& l, int& minX, int& minY, int& maxX, int& maxY) {
+        minX = min(minX, min(l[0], l[2]));
+        minY = min(minY, min(l[1], l[3]));
+        maxX = max(maxX, max(l[0], l[2]));
+        maxY = max(maxY, max(l[1], l[3]));
+    });
+    const double area = (bounds.width + 1.0) * (bounds.height + 1.0);
+    shapeGrid(lineGrid, bounds, max(4, static_cast<int>(ceil(sqrt(area / lines.size())))));
+
+    for (const auto& line : lines) {
+        forEachCell(lineGrid, line, [&](int cell) { lineGrid.cellStart[cell + 1]++; });
+    }
+    for (size_t c = 1; c < lineGrid.cellStart.size(); c++) {
+        lineGrid.cellStart[c] += lineGrid.cellStart[c - 1];
+    }
+
+    vector<int> next(lineGrid.cellStart.begin(), lineGrid.cellStart.end() - 1);
+    lineGrid.entries.resize(lineGrid.cellStart.back());
+    for (size_t i = 0; i < lines.size(); i++) {
+        forEachCell(lineGrid, lines[i], [&](int cell) { lineGrid.entries[next[cell]++] = static_cast<int>(i); });
+    }
+}
+
+/**
+ * @brief Calls a function for every cell a segment passes through.
+ *
+ * The segment is cut into the horizontal bands of the cell rows; within a band it spans the
+ * columns between its x coordinates at the band edges. Band edges count on both sides, so
+ * a segment running along a cell border is listed on both sides of it.
+ *
+ * @param grid The line grid.
+ * @param line The segment, inside the grid bounds.
+ * @param visit Called with the cell number.
+ */
+template<typename Visitor>
+void FeatureIndex::forEachCell(const Grid& grid, const Vec4i& line, const Visitor& visit) {
+    const float x0 = static_cast<float>(line[0] - grid.origin.x), y0 = static_cast<float>(line[1] - grid.origin.y);
+    const float x1 = static_cast<float>(line[2] - grid.origin.x), y1 = static_cast<float>(line[3] - grid.origin.y);
+    const float size = static_cast<float>(grid.cellSize);
+    const int firstRow = min(grid.rows - 1, cellIndex(min(y0, y1), grid.cellSize));
+    const int lastRow = min(grid.rows - 1, cellIndex(max(y0, y1), grid.cellSize));
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        float from = min(x0, x1), to = max(x0, x1);
+        if (y0 != y1) {
+            const float top = max(min(y0, y1), row * size);
+            const float bottom = min(max(y0, y1), (row + 1) * size);
+            const float xTop = x0 + (top - y0) * (x1 - x0) / (y1 - y0);
+            const float xBottom = x0 + (bottom - y0) * (x1 - x0) / (y1 - y0);
+            from = min(xTop, xBottom);
+            to = max(xTop, xBottom);
+        }
+        const int firstColumn = max(0, cellIndex(from, grid.cellSize));
+        const int lastColumn = min(grid.columns - 1, cellIndex(to, grid.cellSize));
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            visit(row * grid.columns + column);
+        }
+    }
+}
+
+/**
+ * @brief Finds the corners inside a rectangle.
+ *
+ * @param region The rectangle; corners on its right and bottom edge are outside, as for Rect::contains.
+ * @param found Output corner indices in ascending order.
+ */
+void FeatureIndex::cornersInRect(const Rect& region, vector<int>& found) const {
+    found.clear();
+    if (corners.empty() || region.width <= 0 || region.height <= 0) {
+        return;
+    }
+
+    const Grid& grid = cornerGrid;
+    const int firstColumn = max(0, cellIndex(static_cast<float>(region.x - grid.origin.x), grid.cellSize));
+    const int lastColumn = min(grid.columns - 1, cellIndex(static_cast<float>(region.x + region.width - 1 - grid.origin.x), grid.cellSize));
+    const int firstRow = max(0, cellIndex(static_cast<float>(region.y - grid.origin.y), grid.cellSize));
+    const int lastRow = min(grid.rows - 1, cellIndex(static_cast<float>(region.y + region.height - 1 - grid.origin.y), grid.cellSize));
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const int cell = row * grid.columns + column;
+            for (int e = grid.cellStart[cell]; e < grid.cellStart[cell + 1]; e++) {
+                if (region.contains(corners[grid.entries[e]])) {
+                    found.push_back(grid.entries[e]);
+                }
+            }
+        }
+    }
+    sort(found.begin(), found.end());
+}
+
+/**
+ * @brief Finds the corners within a distance of a point.
+ *
+ * @param center The query point.
+ * @param radius The largest distance, inclusive.
+ * @param found Output corner indices in ascending order.
+ */
+void FeatureIndex::cornersInRadius(Point2f center, float radius, vector<int>& found) const {
+    found.clear();
+    if (corners.empty() || radius < 0) {
+        return;
+    }
+
+    const Grid& grid = cornerGrid;
+    const int firstColumn = max(0, cellIndex(center.x - radius - grid.origin.x, grid.cellSize));
+    const int lastColumn = min(grid.columns - 1, cellIndex(center.x + radius - grid.origin.x, grid.cellSize));
+    const int firstRow = max(0, cellIndex(center.y - radius - grid.origin.y, grid.cellSize));
+    const int lastRow = min(grid.rows - 1, cellIndex(center.y + radius - grid.origin.y, grid.cellSize));
+    const float limit = radius * radius;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const int cell = row * grid.columns + column;
+            for (int e = grid.cellStart[cell]; e < grid.cellStart[cell + 1]; e++) {
+                const float dx = corners[grid.entries[e]].x - center.x;
+                const float dy = corners[grid.entries[e]].y - center.y;
+                if (dx * dx + dy * dy <= limit) {
+                    found.push_back(grid.entries[e]);
+                }
+            }
+        }
+    }
+    sort(found.begin(), found.end());
+}
+
+/**
+ * @brief Finds the k corners nearest to a point.
+ *
+ * Cells are visited in square rings around the query cell, starting with the first ring
+ * that reaches the grid. Every corner of ring r lies at least (r - 1) cell sizes from the
+ * query, so the search stops once k corners are known and the farthest of them is closer
+ * than that. Ties are broken by the lower index.
+ *
+ * @param query The query point.
+ * @param k Number of corners wanted.
+ * @param found Output corner indices, nearest first; fewer than k if the index holds fewer.
+ */
+void FeatureIndex::nearestCorners(Point2f query, int k, vector<int>& found) const {
+    found.clear();
+    k = min(k, static_cast<int>(corners.size()));
+    if (k <= 0) {
+        return;
+    }
+
+    const Grid& grid = cornerGrid;
+    const int cx = cellIndex(query.x - grid.origin.x, grid.cellSize);
+    const int cy = cellIndex(query.y - grid.origin.y, grid.cellSize);
+    const int firstRing = max(max(0, max(-cx, cx - (grid.columns - 1))), max(-cy, cy - (grid.rows - 1)));
+    const int lastRing = max(max(abs(cx), abs(cx - (grid.columns - 1))), max(abs(cy), abs(cy - (grid.rows - 1))));
+
+    priority_queue<pair<float, int>> best;  // the k nearest so far, farthest on top
+    auto visitCell = [&](int column, int row) {
+        const int cell = row * grid.columns + column;
+        for (int e = grid.cellStart[cell]; e < grid.cellStart[cell + 1]; e++) {
+            const float dx = corners[grid.entries[e]].x - query.x;
+            const float dy = corners[grid.entries[e]].y - query.y;
+            const pair<float, int> candidate(dx * dx + dy * dy, grid.entries[e]);
+            if (static_cast<int>(best.size()) < k) {
+                best.push(candidate);
+            }
+            else if (candidate < best.top()) {
+                best.pop();
+                best.push(candidate);
+            }
+        }
+    };
+
+    for (int ring = firstRing; ring <= lastRing; ring++) {
+        if (static_cast<int>(best.size()) == k && ring > 0) {
+            const float reach = static_cast<float>((ring - 1) * grid.cellSize);
+            if (best.top().first < reach * reach) {
+                break;
+            }
+        }
+
+        for (int row = max(0, cy - ring); row <= min(grid.rows - 1, cy + ring); row++) {
+            if (row == cy - ring || row == cy + ring) {
+                for (int column = max(0, cx - ring); column <= min(grid.columns - 1, cx + ring); column++) {
+                    visitCell(column, row);
+                }
+            }
+            else {
+                if (cx - ring >= 0 && cx - ring < grid.columns) {
+                    visitCell(cx - ring, row);
+                }
+                if (ring > 0 && cx + ring >= 0 && cx + ring < grid.columns) {
+                    visitCell(cx + ring, row);
+                }
+            }
+        }
+    }
+
+    found.resize(best.size());
+    for (int i = static_cast<int>(best.size()) - 1; i >= 0; i--) {
+        found[i] = best.top().second;
+        best.pop();
+    }
+}
+
+/**
+ * @brief Finds the line segments that cross or touch a rectangle.
+ *
+ * Segments listed in the cells under the rectangle are candidates; each is clipped against
+ * the rectangle (Liang-Barsky) to drop those that only share a cell with it.
+ *
+ * @param region The rectangle, taken as the closed area from (x, y) to (x + width, y + height).
+ * @param found Output line indices in ascending order.
+ */
+void FeatureIndex::linesInRect(const Rect& region, vector<int>& found) const {
+    found.clear();
+    if (lines.empty() || region.width < 0 || region.height < 0) {
+        return;
+    }
+
+    const Grid& grid = lineGrid;
+    const int firstColumn = max(0, cellIndex(static_cast<float>(region.x - grid.origin.x), grid.cellSize));
+    const int lastColumn = min(grid.columns - 1, cellIndex(static_cast<float>(region.x + region.width - grid.origin.x), grid.cellSize));
+    const int firstRow = max(0, cellIndex(static_cast<float>(region.y - grid.origin.y), grid.cellSize));
+    const int lastRow = min(grid.rows - 1, cellIndex(static_cast<float>(region.y + region.height - grid.origin.y), grid.cellSize));
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const int cell = row * grid.columns + column;
+            found.insert(found.end(), grid.entries.begin() + grid.cellStart[cell], grid.entries.begin() + grid.cellStart[cell + 1]);
+        }
+    }
+    sort(found.begin(), found.end());
+    found.erase(unique(found.begin(), found.end()), found.end());
+
+    const float left = static_cast<float>(region.x), right = static_cast<float>(region.x + region.width);
+    const float top = static_cast<float>(region.y), bottom = static_cast<float>(region.y + region.height);
+    auto crosses = [&](const Vec4i& l) {
+        const float x0 = static_cast<float>(l[0]), y0 = static_cast<float>(l[1]);
+        const float dx = static_cast<float>(l[2] - l[0]), dy = static_cast<float>(l[3] - l[1]);
+        const float p[4] = { -dx, dx, -dy, dy };
+        const float q[4] = { x0 - left, right - x0, y0 - top, bottom - y0 };
+        float enter = 0.0f, leave = 1.0f;
+        for (int i = 0; i < 4; i++) {
+            if (p[i] == 0.0f) {
+                if (q[i] < 0.0f) {
+                    return false;
+                }
+            }
+            else if (p[i] < 0.0f) {
+                enter = max(enter, q[i] / p[i]);
+            }
+            else {
+                leave = min(leave, q[i] / p[i]);
+            }
+        }
+        return enter <= leave;
+    };
+
+    size_t kept = 0;
+    for (int i : found) {
+        if (crosses(lines[i])) {
+            found[kept++] = i;
+        }
+    }
+    found.resize(kept);
+}
+
+/**
+ * @brief Gets the indexed corners.
+ *
+ * @return The corners the returned indices refer to.
+ */
+const vector<Point>& FeatureIndex::getCorners(void) const {
+    return corners;
+}
+
+/**
+ * @brief Gets the indexed line segments.
+ *
+ * @return The segments the returned indices refer to.
+ */
+const vector<Vec4i>& FeatureIndex::getLines(void) const {
+    return lines;
+}
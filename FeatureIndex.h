@@ -0,0 +1,95 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// FeatureIndex Class
+/// Spatial index over detected corners and line segments, built once after detection.
+/// Corners go into a uniform grid sized for about two corners per cell; line segments into a
+/// second grid in which every segment is listed in each cell it passes through. Both grids
+/// are stored compactly as one index array sorted by cell plus per-cell offsets, so a query
+/// only touches the cells around its region and the index never reallocates after building.
+/// Queries return indices into the indexed corner and line arrays and may run concurrently.
+class FeatureIndex
+{
+public:
+    /// Constructor for an empty index
+    FeatureIndex();
+
+    /// Constructor building the index
+    /// @param corners The corners to index.
+    /// @param lines The line segments to index.
+    FeatureIndex(const vector<Point>& corners, const vector<Vec4i>& lines);
+
+    /// Rebuild the index for new features
+    /// @param corners The corners to index, copied into the index.
+    /// @param lines The line segments to index, copied into the index.
+    void build(const vector<Point>& corners, const vector<Vec4i>& lines);
+
+    /// Find the corners inside a rectangle
+    /// @param region The rectangle; corners on its right and bottom edge are outside, as for Rect::contains.
+    /// @param found Output corner indices in ascending order.
+    void cornersInRect(const Rect& region, vector<int>& found) const;
+
+    /// Find the corners within a distance of a point
+    /// @param center The query point.
+    /// @param radius The largest distance, inclusive.
+    /// @param found Output corner indices in ascending order.
+    void cornersInRadius(Point2f center, float radius, vector<int>& found) const;
+
+    /// Find the k corners nearest to a point
+    /// @param query The query point.
+    /// @param k Number of corners wanted.
+    /// @param found Output corner indices, nearest first; fewer than k if the index holds fewer.
+    void nearestCorners(Point2f query, int k, vector<int>& found) const;
+
+    /// Find the line segments that cross or touch a rectangle
+    /// @param region The rectangle, taken as the closed area from (x, y) to (x + width, y + height).
+    /// @param found Output line indices in ascending order.
+    void linesInRect(const Rect& region, vector<int>& found) const;
+
+    /// Get the indexed corners
+    /// @return The corners the returned indices refer to.
+    const vector<Point>& getCorners(void) const;
+
+    /// Get the indexed line segments
+    /// @return The segments the returned indices refer to.
+    const vector<Vec4i>& getLines(void) const;
+
+private:
+    /// Uniform grid over a bounding box, storing item indices sorted by cell
+    struct Grid {
+        Point origin;                       ///< Top-left corner of the first cell
+        int cellSize = 1;                   ///< Cell width and height in pixels
+        int columns = 0;                    ///< Number of cell columns
+        int rows = 0;                       ///< Number of cell rows
+        vector<int> cellStart;              ///< Offset of every cell's first entry, plus the total count at the end
+        vector<int> entries;                ///< Item indices, grouped by cell
+    };
+
+    /// Shape a grid over a bounding box
+    /// @param grid The grid to shape.
+    /// @param bounds The box to cover.
+    /// @param cellSize Cell width and height.
+    static void shapeGrid(Grid& grid, const Rect& bounds, int cellSize);
+
+    /// Index the corners
+    void buildCornerGrid(void);
+
+    /// Index the line segments
+    void buildLineGrid(void);
+
+    /// Call a function for every cell a segment passes through
+    /// @param grid The line grid.
+    /// @param line The segment.
+    /// @param visit Called with the cell number.
+    template<typename Visitor>
+    static void forEachCell(const Grid& grid, const Vec4i& line, const Visitor& visit);
+
+    vector<Point> corners;                  ///< Indexed corners
+    vector<Vec4i> lines;                    ///< Indexed line segments
+    Grid cornerGrid;                        ///< Grid of the corners
+    Grid lineGrid;                          ///< Grid of the line segments
+};
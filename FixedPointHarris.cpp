@@ -0,0 +1,342 @@
+#include "FixedPointHarris.h"
+#include "BufferPool.h"
+#include "HarrisKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    const int responseShift = 16;           // fraction bits of k, and of det to match
+    const double coarseLevels = 65535.0;    // 2^16 - 1 = 255 * 257
+    const double fineLevels = 16777215.0;   // 2^24 - 1 = 255 * 65793, still exact in a float
+
+    /// Collect the pixels of a band whose level passes the threshold and, with peaks, equals the local maximum
+    template<typename Level>
+    void collectCorners(const Mat& levels, const Mat& peaks, int top, int y0, int y1, int64_t threshold, float scoreScale,
+        vector<Point>& found, vector<float>* foundScores) {
+        for (int y = y0; y < y1; y++) {
+            const Level* row = levels.ptr<Level>(y - top);
+            const Level* peak = peaks.empty() ? row : peaks.ptr<Level>(y - top);
+            for (int x = 0; x < levels.cols; x++) {
+                if (static_cast<int64_t>(row[x]) >= threshold && row[x] >= peak[x]) {
+                    found.emplace_back(x, y);
+                    if (foundScores) {
+                        foundScores->push_back(static_cast<float>(row[x]) * scoreScale);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Constructor for FixedPointHarris class.
+ *
+ * Sobel derivatives of 8-bit images stay within +-1020, so the box sums of their products
+ * fit 32 bits, and 2^16 det and 2^16 k trace^2 fit 64 bits up to a 3 x 3 block and k = 0.25.
+ *
+ * @param blockSize Neighborhood size of the structure tensor box sum, 1 to 3.
+ * @param k Harris detector free parameter, at most 0.25.
+ */
+FixedPointHarris::FixedPointHarris(int blockSize, double k)
+    : blockSize(blockSize), kFixed(llround(k * (1 << responseShift))) {
+    if (blockSize < 1 || blockSize > 3) {
+        throw invalid_argument("Fixed-point Harris block size must be between 1 and 3");
+    }
+    if (k < 0 || k > 0.25) {
+        throw invalid_argument("Fixed-point Harris k must be between 0 and 0.25");
+    }
+}
+
+/**
+ * @brief Computes the fixed-point response of a band, one row at a time.
+ *
+ * Mirrors HarrisKernel::computeResponseRows with 16-bit derivatives and 32-bit box sums
+ * of the unscaled products; the scale cornerHarris applies to the derivatives only
+ * multiplies R by a constant, which the min-max normalization cancels. Borders are
+ * reflect-101 and rows just outside the band are read from the parent image.
+ *
+ * @param gray The image.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param sink Called with the row index and the response of every row of the band.
+ */
+template<typename RowSink>
+void FixedPointHarris::responseBand(const Mat& gray, int y0, int y1, const RowSink& sink) const {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const int anchor = blockSize / 2;
+    const int extended = cols + blockSize - 1;
+
+    int tensorLo = rows;
+    int tensorHi = -1;
+    for (int y = y0 - anchor; y < y1 - anchor + blockSize; y++) {
+        int r = borderInterpolate(y, rows, BORDER_REFLECT_101);
+        tensorLo = min(tensorLo, r);
+        tensorHi = max(tensorHi, r);
+    }
+
+    Mat source = gray.rowRange(tensorLo, tensorHi + 1);
+    const int tensorRows = source.rows;
+    PooledMat dxBuffer(tensorRows, cols, CV_16S), dyBuffer(tensorRows, cols, CV_16S);
+    Mat& dx = dxBuffer.get();
+    Mat& dy = dyBuffer.get();
+    Sobel(source, dx, CV_16S, 1, 0, 3, 1, 0, BORDER_DEFAULT);
+    Sobel(source, dy, CV_16S, 0, 1, 3, 1, 0, BORDER_DEFAULT);
+
+    // Horizontal box sums of dx*dx, dx*dy and dy*dy for every tensor row
+    PooledMat sumABuffer(tensorRows, cols, CV_32S), sumBBuffer(tensorRows, cols, CV_32S), sumCBuffer(tensorRows, cols, CV_32S);
+    Mat& sumA = sumABuffer.get();
+    Mat& sumB = sumBBuffer.get();
+    Mat& sumC = sumCBuffer.get();
+    PooledVector<int32_t> extABuffer, extBBuffer, extCBuffer;
+    vector<int32_t>& extA = extABuffer.get();
+    vector<int32_t>& extB = extBBuffer.get();
+    vector<int32_t>& extC = extCBuffer.get();
+    extA.resize(extended);
+    extB.resize(extended);
+    extC.resize(extended);
+    for (int r = 0; r < tensorRows; r++) {
+        const short* pdx = dx.ptr<short>(r);
+        const short* pdy = dy.ptr<short>(r);
+        int32_t* ea = extA.data() + anchor;
+        int32_t* eb = extB.data() + anchor;
+        int32_t* ec = extC.data() + anchor;
+        for (int x = 0; x < cols; x++) {
+            ea[x] = pdx[x] * pdx[x];
+            eb[x] = pdx[x] * pdy[x];
+            ec[x] = pdy[x] * pdy[x];
+        }
+        for (int i = 0; i < extended - cols; i++) {
+            int e = i < anchor ? i : i + cols;
+            int x = borderInterpolate(e - anchor, cols, BORDER_REFLECT_101);
+            extA[e] = ea[x];
+            extB[e] = eb[x];
+            extC[e] = ec[x];
+        }
+
+        int32_t* ha = sumA.ptr<int32_t>(r);
+        int32_t* hb = sumB.ptr<int32_t>(r);
+        int32_t* hc = sumC.ptr<int32_t>(r);
+        copy(extA.begin(), extA.begin() + cols, ha);
+        copy(extB.begin(), extB.begin() + cols, hb);
+        copy(extC.begin(), extC.begin() + cols, hc);
+        for (int j = 1; j < blockSize; j++) {
+            for (int x = 0; x < cols; x++) {
+                ha[x] += extA[x + j];
+                hb[x] += extB[x + j];
+                hc[x] += extC[x + j];
+            }
+        }
+    }
+
+    // Vertical box sum and response, one output row at a time
+    PooledVector<int32_t> boxABuffer, boxBBuffer, boxCBuffer;
+    vector<int32_t>& boxA = boxABuffer.get();
+    vector<int32_t>& boxB = boxBBuffer.get();
+    vector<int32_t>& boxC = boxCBuffer.get();
+    boxA.resize(cols);
+    boxB.resize(cols);
+    boxC.resize(cols);
+    PooledVector<int64_t> responseBuffer;
+    vector<int64_t>& response = responseBuffer.get();
+    response.resize(cols);
+    for (int y = y0; y < y1; y++) {
+        for (int i = 0; i < blockSize; i++) {
+            int r = borderInterpolate(y - anchor + i, rows, BORDER_REFLECT_101) - tensorLo;
+            const int32_t* ha = sumA.ptr<int32_t>(r);
+            const int32_t* hb = sumB.ptr<int32_t>(r);
+            const int32_t* hc = sumC.ptr<int32_t>(r);
+            if (i == 0) {
+                copy(ha, ha + cols, boxA.begin());
+                copy(hb, hb + cols, boxB.begin());
+                copy(hc, hc + cols, boxC.begin());
+                continue;
+            }
+            for (int x = 0; x < cols; x++) {
+                boxA[x] += ha[x];
+                boxB[x] += hb[x];
+                boxC[x] += hc[x];
+            }
+        }
+
+        for (int x = 0; x < cols; x++) {
+            const int64_t a = boxA[x];
+            const int64_t b = boxB[x];
+            const int64_t c = boxC[x];
+            const int64_t trace = a + c;
+            response[x] = (a * c - b * b) * (int64_t(1) << responseShift) - kFixed * trace * trace;
+        }
+        sink(y, response.data());
+    }
+}
+
+/**
+ * @brief Computes the global minimum and maximum fixed-point response with a parallel band reduction.
+ *
+ * Bands only reduce their rows, the response is never stored.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param minValue Output minimum response.
+ * @param maxValue Output maximum response.
+ */
+void FixedPointHarris::responseRange(const Mat& gray, int64_t& minValue, int64_t& maxValue) const {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw runtime_error("Fixed-point Harris needs a single channel 8-bit image");
+    }
+
+    const int bandRows = HarrisKernel::bandRowsFor(gray.cols);
+    const int bands = (gray.rows + bandRows - 1) / bandRows;
+    vector<int64_t> bandMin(bands, INT64_MAX), bandMax(bands, INT64_MIN);
+
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        for (int band = range.start; band < range.end; band++) {
+            int y0 = band * bandRows;
+            int y1 = min(gray.rows, y0 + bandRows);
+            int64_t& low = bandMin[band];
+            int64_t& high = bandMax[band];
+            responseBand(gray, y0, y1, [&](int, const int64_t* response) {
+                for (int x = 0; x < gray.cols; x++) {
+                    low = min(low, response[x]);
+                    high = max(high, response[x]);
+                }
+            });
+        }
+    });
+
+    minValue = *min_element(bandMin.begin(), bandMin.end());
+    maxValue = *max_element(bandMax.begin(), bandMax.end());
+}
+
+/**
+ * @brief Computes the response of every pixel in cornerHarris units.
+ *
+ * The bands run one after the other, callers such as the region search already run one
+ * image per thread.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param response Output float response of the size of gray.
+ */
+void FixedPointHarris::computeResponse(const Mat& gray, Mat& response) const {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw runtime_error("Fixed-point Harris needs a single channel 8-bit image");
+    }
+
+    response.create(gray.size(), CV_32F);
+    const int bandRows = HarrisKernel::bandRowsFor(gray.cols);
+    for (int y0 = 0; y0 < gray.rows; y0 += bandRows) {
+        responseBand(gray, y0, min(gray.rows, y0 + bandRows), [&](int y, const int64_t* values) {
+            float* row = response.ptr<float>(y);
+            for (int x = 0; x < gray.cols; x++) {
+                row[x] = static_cast<float>(toFloatResponse(values[x]));
+            }
+        });
+    }
+}
+
+/**
+ * @brief Detects thresholded corners, optionally keeping only local maxima of the response.
+ *
+ * Phase one reduces the response range, phase two recomputes each band and stores it as
+ * 16-bit levels, or as 24-bit levels in float when suppressing non-maxima, which are dilated
+ * with a (2r+1) x (2r+1) rectangle as in HarrisKernel. Each band keeps its own corner list so
+ * the output stays in raster order.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param qualityLevel Threshold on the truncated normalized (0-255) response.
+ * @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+ * @param corners Output corners in raster order.
+ * @param scores Optional output normalized response of every corner, to 1/257 or 1/65793.
+ */
+void FixedPointHarris::detect(const Mat& gray, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores) const {
+    corners.clear();
+    if (scores) {
+        scores->clear();
+    }
+
+    int64_t minValue, maxValue;
+    responseRange(gray, minValue, maxValue);
+
+    const bool fine = nmsRadius > 0;
+    const double topLevel = fine ? fineLevels : coarseLevels;
+    const int64_t levelsPerUnit = static_cast<int64_t>(topLevel) / 255;
+    // Differences are taken in double, the response range can exceed 63 bits
+    const double lowest = static_cast<double>(minValue);
+    const double levelScale = maxValue > minValue ? topLevel / (static_cast<double>(maxValue) - lowest) : 0.0;
+    const int64_t threshold = (static_cast<int64_t>(qualityLevel) + 1) * levelsPerUnit;
+    const float scoreScale = 1.0f / levelsPerUnit;
+
+    const int bandRows = HarrisKernel::bandRowsFor(gray.cols);
+    const int bands = (gray.rows + bandRows - 1) / bandRows;
+    vector<vector<Point>> bandCorners(bands);
+    vector<vector<float>> bandScores(bands);
+    Mat peakKernel;
+    if (fine) {
+        peakKernel = getStructuringElement(MORPH_RECT, Size(2 * nmsRadius + 1, 2 * nmsRadius + 1));
+    }
+
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        PooledMat levelsBuffer, peaksBuffer;
+        for (int band = range.start; band < range.end; band++) {
+            int y0 = band * bandRows;
+            int y1 = min(gray.rows, y0 + bandRows);
+            int top = max(0, y0 - max(nmsRadius, 0));
+            int bottom = min(gray.rows, y1 + max(nmsRadius, 0));
+            Mat& levels = levelsBuffer.create(bottom - top, gray.cols, fine ? CV_32F : CV_16U);
+            responseBand(gray, top, bottom, [&](int y, const int64_t* response) {
+                if (fine) {
+                    float* out = levels.ptr<float>(y - top);
+                    for (int x = 0; x < gray.cols; x++) {
+                        out[x] = static_cast<float>(min(topLevel, floor((response[x] - lowest) * levelScale)));
+                    }
+                }
+                else {
+                    ushort* out = levels.ptr<ushort>(y - top);
+                    for (int x = 0; x < gray.cols; x++) {
+                        out[x] = static_cast<ushort>(min(topLevel, floor((response[x] - lowest) * levelScale)));
+                    }
+                }
+            });
+
+            vector<float>* foundScores = scores ? &bandScores[band] : nullptr;
+            if (fine) {
+                Mat& peaks = peaksBuffer.create(bottom - top, gray.cols, CV_32F);
+                dilate(levels, peaks, peakKernel);
+                collectCorners<float>(levels, peaks, top, y0, y1, threshold, scoreScale, bandCorners[band], foundScores);
+            }
+            else {
+                collectCorners<ushort>(levels, Mat(), top, y0, y1, threshold, scoreScale, bandCorners[band], foundScores);
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& found : bandCorners) {
+        total += found.size();
+    }
+    corners.reserve(total);
+    if (scores) {
+        scores->reserve(total);
+    }
+    for (int band = 0; band < bands; band++) {
+        corners.insert(corners.end(), bandCorners[band].begin(), bandCorners[band].end());
+        if (scores) {
+            scores->insert(scores->end(), bandScores[band].begin(), bandScores[band].end());
+        }
+    }
+}
+
+/**
+ * @brief Converts a fixed-point response to the float response cornerHarris gives.
+ *
+ * cornerHarris scales 8-bit derivatives by 1 / (4 blockSize 255), so its tensor is the
+ * integer one divided by (4 blockSize 255)^2 and R by that squared, times 2^16 here.
+ *
+ * @param value The fixed-point response.
+ * @return The response in cornerHarris units.
+ */
+double FixedPointHarris::toFloatResponse(int64_t value) const {
+    const double derivativeScale = 4.0 * blockSize * 255.0;
+    const double tensorScale = derivativeScale * derivativeScale;
+    return static_cast<double>(value) / (tensorScale * tensorScale * (1 << responseShift));
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// FixedPointHarris Class
+/// Integer Harris corners of 8-bit images, an alternative to the float HarrisKernel when only
+/// the 0-255 quality comparison is needed. Bands take 16-bit Sobel derivatives, 32-bit
+/// structure tensor box sums and an exact 64-bit response R = 2^16 (AC - B^2) - round(2^16 k)
+/// (A + C)^2. The first pass only reduces the response range, without writing a response;
+/// the second maps R to compact levels floor((R - min) (2^n - 1) / (max - min)) with n = 16,
+/// or n = 24 when suppressing non-maxima, which need the finer order. 2^n - 1 is a multiple
+/// of 255, so "normalized response truncated above q" becomes the exact integer test
+/// level >= (q + 1) (2^n - 1) / 255. Corners match HarrisKernel except where float rounding
+/// moves a response across the threshold or changes a tie in the suppression window.
+class FixedPointHarris
+{
+public:
+    /// Constructor
+    /// @param blockSize Neighborhood size of the structure tensor box sum, 1 to 3.
+    /// @param k Harris detector free parameter, at most 0.25.
+    FixedPointHarris(int blockSize = 2, double k = 0.04);
+
+    /// Detect thresholded corners, optionally keeping only local maxima of the response
+    /// @param gray Single channel 8-bit image.
+    /// @param qualityLevel Threshold on the truncated normalized (0-255) response.
+    /// @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+    /// @param corners Output corners in raster order.
+    /// @param scores Optional output normalized (0-255) response of every corner.
+    void detect(const Mat& gray, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores = nullptr) const;
+
+    /// Compute the global minimum and maximum fixed-point response with a parallel band reduction
+    /// @param gray Single channel 8-bit image.
+    /// @param minValue Output minimum response.
+    /// @param maxValue Output maximum response.
+    void responseRange(const Mat& gray, int64_t& minValue, int64_t& maxValue) const;
+
+    /// Compute the response of every pixel in cornerHarris units
+    /// For callers that normalize over several images, e.g. the regions of one frame.
+    /// @param gray Single channel 8-bit image.
+    /// @param response Output float response of the size of gray.
+    void computeResponse(const Mat& gray, Mat& response) const;
+
+    /// Convert a fixed-point response to the float response cornerHarris gives
+    /// @param value The fixed-point response.
+    /// @return The response in cornerHarris units.
+    double toFloatResponse(int64_t value) const;
+
+private:
+    /// Compute the fixed-point response of a band, one row at a time
+    /// @param gray The image.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param sink Called with the row index and the response of every row of the band.
+    template<typename RowSink>
+    void responseBand(const Mat& gray, int y0, int y1, const RowSink& sink) const;
+
+    int blockSize;          ///< Structure tensor neighborhood size
+    int64_t kFixed;         ///< Harris free parameter scaled by 2^16
+};
@@ -0,0 +1,447 @@
+#include "HarrisKernel.h"
+#include "BufferPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+
+namespace {
+    /// 3 x 3 Sobel derivatives of one pixel with reflect-101 borders, as cornerHarris takes them
+    void reflectedSobel(const Mat& gray, int x, int y, int& gx, int& gy) {
+        const int left = borderInterpolate(x - 1, gray.cols, BORDER_REFLECT_101);
+        const int right = borderInterpolate(x + 1, gray.cols, BORDER_REFLECT_101);
+        const uchar* top = gray.ptr<uchar>(borderInterpolate(y - 1, gray.rows, BORDER_REFLECT_101));
+        const uchar* middle = gray.ptr<uchar>(y);
+        const uchar* bottom = gray.ptr<uchar>(borderInterpolate(y + 1, gray.rows, BORDER_REFLECT_101));
+        gx = (top[right] - top[left]) + 2 * (middle[right] - middle[left]) + (bottom[right] - bottom[left]);
+        gy = (bottom[left] - top[left]) + 2 * (bottom[x] - top[x]) + (bottom[right] - top[right]);
+    }
+}
+
+/**
+ * @brief Constructor for HarrisKernel class.
+ *
+ * @param blockSize Neighborhood size of the structure tensor box sum.
+ * @param apertureSize Aperture of the Sobel operator.
+ * @param k Harris detector free parameter.
+ */
+HarrisKernel::HarrisKernel(int blockSize, int apertureSize, double k)
+    : blockSize(blockSize), apertureSize(apertureSize), k(k) {
+    if (blockSize < 1) {
+        throw invalid_argument("Harris block size must be at least 1");
+    }
+}
+
+/**
+ * @brief Gets the number of rows per band for a given image width.
+ *
+ * A band row costs about six floats per pixel of scratch (derivatives, tensor sums and
+ * response), so bands are sized to keep that working set inside a typical L2 cache.
+ *
+ * @param cols Image width in pixels.
+ * @return Rows per band.
+ */
+int HarrisKernel::bandRowsFor(int cols) {
+    const int cacheBytes = 512 * 1024;
+    int rows = cacheBytes / (6 * static_cast<int>(sizeof(float)) * max(cols, 1));
+    return min(128, max(8, rows));
+}
+
+/**
+ * @brief Computes the raw Harris response of a band of rows.
+ *
+ * Mirrors cornerHarris: Sobel derivatives scaled by 1 / (2^(ksize-1) * blockSize * 255),
+ * an unnormalized blockSize x blockSize box sum of the structure tensor and
+ * R = det - k * trace^2, all with reflect-101 borders. Derivatives are taken on a row range
+ * of the parent image, so rows just outside the band are real pixels, not extrapolated ones.
+ * Derivative and tensor scratch comes from the thread's buffer pool.
+ *
+ * @param gray Single channel 8-bit or float image.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param response Output float response with y1 - y0 rows.
+ */
+void HarrisKernel::computeResponseRows(const Mat& gray, int y0, int y1, Mat& response) const {
+    if (gray.empty() || gray.channels() != 1 || (gray.depth() != CV_8U && gray.depth() != CV_32F)) {
+        throw runtime_error("Harris response needs a single channel 8-bit or float image");
+    }
+
+    int tensorLo, tensorHi;
+    tensorRows(gray.rows, y0, y1, tensorLo, tensorHi);
+    const double scale = derivativeScale(gray.depth());
+
+    Mat source = gray.rowRange(tensorLo, tensorHi + 1);
+    PooledMat dxBuffer(source.rows, gray.cols, CV_32F), dyBuffer(source.rows, gray.cols, CV_32F);
+    Mat& dx = dxBuffer.get();
+    Mat& dy = dyBuffer.get();
+    Sobel(source, dx, CV_32F, 1, 0, apertureSize, scale, 0, BORDER_DEFAULT);
+    Sobel(source, dy, CV_32F, 0, 1, apertureSize, scale, 0, BORDER_DEFAULT);
+    tensorResponse(dx, dy, gray.rows, tensorLo, y0, y1, response);
+}
+
+/**
+ * @brief Computes the raw Harris response of a band of rows from shared Sobel derivatives.
+ *
+ * The 16-bit derivatives are exact, so scaling them to float gives the cornerHarris
+ * derivatives up to float rounding. Canny takes them with replicated borders, cornerHarris
+ * with reflect-101 borders; the two only differ on the first and last row and column, which
+ * are derived again from gray.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param dx CV_16S 3 x 3 Sobel x derivative of gray with replicated borders.
+ * @param dy CV_16S 3 x 3 Sobel y derivative of gray with replicated borders.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param response Output float response with y1 - y0 rows.
+ */
+void HarrisKernel::computeResponseRows(const Mat& gray, const Mat& dx, const Mat& dy, int y0, int y1, Mat& response) const {
+    if (gray.empty() || gray.type() != CV_8UC1 || apertureSize != 3) {
+        throw runtime_error("Shared derivatives need a single channel 8-bit image and a 3 x 3 aperture");
+    }
+    if (dx.type() != CV_16SC1 || dy.type() != CV_16SC1 || dx.size() != gray.size() || dy.size() != gray.size()) {
+        throw runtime_error("Shared derivatives must be 16-bit and the size of the image");
+    }
+
+    int tensorLo, tensorHi;
+    tensorRows(gray.rows, y0, y1, tensorLo, tensorHi);
+    const double scale = derivativeScale(CV_8U);
+    const float scaleF = static_cast<float>(scale);
+
+    const int rowCount = tensorHi - tensorLo + 1;
+    PooledMat dxBuffer(rowCount, gray.cols, CV_32F), dyBuffer(rowCount, gray.cols, CV_32F);
+    Mat& fx = dxBuffer.get();
+    Mat& fy = dyBuffer.get();
+    dx.rowRange(tensorLo, tensorHi + 1).convertTo(fx, CV_32F, scale);
+    dy.rowRange(tensorLo, tensorHi + 1).convertTo(fy, CV_32F, scale);
+
+    for (int y = tensorLo; y <= tensorHi; y++) {
+        float* px = fx.ptr<float>(y - tensorLo);
+        float* py = fy.ptr<float>(y - tensorLo);
+        const int step = y == 0 || y == gray.rows - 1 ? 1 : max(1, gray.cols - 1);
+        for (int x = 0; x < gray.cols; x += step) {
+            int gx, gy;
+            reflectedSobel(gray, x, y, gx, gy);
+            px[x] = gx * scaleF;
+            py[x] = gy * scaleF;
+        }
+    }
+    tensorResponse(fx, fy, gray.rows, tensorLo, y0, y1, response);
+}
+
+/**
+ * @brief Finds the structure tensor rows the vertical box sum of a band reads.
+ *
+ * @param rows Image height.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param tensorLo Output first tensor row.
+ * @param tensorHi Output last tensor row.
+ */
+void HarrisKernel::tensorRows(int rows, int y0, int y1, int& tensorLo, int& tensorHi) const {
+    const int anchor = blockSize / 2;
+    tensorLo = rows;
+    tensorHi = -1;
+    for (int y = y0 - anchor; y < y1 - anchor + blockSize; y++) {
+        int r = borderInterpolate(y, rows, BORDER_REFLECT_101);
+        tensorLo = min(tensorLo, r);
+        tensorHi = max(tensorHi, r);
+    }
+}
+
+/**
+ * @brief Gets the factor cornerHarris scales the derivatives with.
+ *
+ * @param depth Image depth, CV_8U or CV_32F.
+ * @return 1 / (2^(ksize-1) * blockSize), further divided by 255 for 8-bit images.
+ */
+double HarrisKernel::derivativeScale(int depth) const {
+    double scale = (double)(1 << ((apertureSize > 0 ? apertureSize : 3) - 1)) * blockSize;
+    if (apertureSize < 0) {
+        scale *= 2.0;
+    }
+    if (depth == CV_8U) {
+        scale *= 255.0;
+    }
+    return 1.0 / scale;
+}
+
+/**
+ * @brief Computes the response of a band from the float derivatives of its tensor rows.
+ *
+ * @param dx Scaled x derivative of rows tensorLo..tensorHi.
+ * @param dy Scaled y derivative of the same rows.
+ * @param rows Image height.
+ * @param tensorLo First tensor row, the first row of dx and dy.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param response Output float response with y1 - y0 rows.
+ */
+void HarrisKernel::tensorResponse(const Mat& dx, const Mat& dy, int rows, int tensorLo, int y0, int y1, Mat& response) const {
+    const int cols = dx.cols;
+    const int anchor = blockSize / 2;
+    const int extended = cols + blockSize - 1;
+    const int tensorRows = dx.rows;
+
+    // Horizontal box sums of dx*dx, dx*dy and dy*dy for every tensor row
+    PooledMat sumABuffer(tensorRows, cols, CV_32F), sumBBuffer(tensorRows, cols, CV_32F), sumCBuffer(tensorRows, cols, CV_32F);
+    Mat& sumA = sumABuffer.get();
+    Mat& sumB = sumBBuffer.get();
+    Mat& sumC = sumCBuffer.get();
+    PooledVector<float> extABuffer, extBBuffer, extCBuffer;
+    vector<float>& extA = extABuffer.get();
+    vector<float>& extB = extBBuffer.get();
+    vector<float>& extC = extCBuffer.get();
+    extA.resize(extended);
+    extB.resize(extended);
+    extC.resize(extended);
+    for (int r = 0; r < tensorRows; r++) {
+        const float* pdx = dx.ptr<float>(r);
+        const float* pdy = dy.ptr<float>(r);
+        float* ea = extA.data() + anchor;
+        float* eb = extB.data() + anchor;
+        float* ec = extC.data() + anchor;
+        for (int x = 0; x < cols; x++) {
+            ea[x] = pdx[x] * pdx[x];
+            eb[x] = pdx[x] * pdy[x];
+            ec[x] = pdy[x] * pdy[x];
+        }
+        for (int i = 0; i < extended - cols; i++) {
+            int e = i < anchor ? i : i + cols;
+            int x = borderInterpolate(e - anchor, cols, BORDER_REFLECT_101);
+            extA[e] = ea[x];
+            extB[e] = eb[x];
+            extC[e] = ec[x];
+        }
+
+        float* ha = sumA.ptr<float>(r);
+        float* hb = sumB.ptr<float>(r);
+        float* hc = sumC.ptr<float>(r);
+        for (int x = 0; x < cols; x++) {
+            ha[x] = extA[x];
+            hb[x] = extB[x];
+            hc[x] = extC[x];
+        }
+        for (int j = 1; j < blockSize; j++) {
+            for (int x = 0; x < cols; x++) {
+                ha[x] += extA[x + j];
+                hb[x] += extB[x + j];
+                hc[x] += extC[x + j];
+            }
+        }
+    }
+
+    // Vertical box sum and response, one output row at a time
+    response.create(y1 - y0, cols, CV_32F);
+    PooledVector<float> boxABuffer, boxBBuffer, boxCBuffer;
+    vector<float>& boxA = boxABuffer.get();
+    vector<float>& boxB = boxBBuffer.get();
+    vector<float>& boxC = boxCBuffer.get();
+    boxA.resize(cols);
+    boxB.resize(cols);
+    boxC.resize(cols);
+    const float kf = static_cast<float>(k);
+    for (int y = y0; y < y1; y++) {
+        for (int i = 0; i < blockSize; i++) {
+            int r = borderInterpolate(y - anchor + i, rows, BORDER_REFLECT_101) - tensorLo;
+            const float* ha = sumA.ptr<float>(r);
+            const float* hb = sumB.ptr<float>(r);
+            const float* hc = sumC.ptr<float>(r);
+            if (i == 0) {
+                copy(ha, ha + cols, boxA.begin());
+                copy(hb, hb + cols, boxB.begin());
+                copy(hc, hc + cols, boxC.begin());
+                continue;
+            }
+            for (int x = 0; x < cols; x++) {
+                boxA[x] += ha[x];
+                boxB[x] += hb[x];
+                boxC[x] += hc[x];
+            }
+        }
+
+        float* out = response.ptr<float>(y - y0);
+        for (int x = 0; x < cols; x++) {
+            float a = boxA[x];
+            float b = boxB[x];
+            float c = boxC[x];
+            out[x] = a * c - b * b - kf * (a + c) * (a + c);
+        }
+    }
+}
+
+/**
+ * @brief Computes the global minimum and maximum response with a parallel band reduction.
+ *
+ * @param gray Single channel 8-bit or float image.
+ * @param minValue Output minimum response.
+ * @param maxValue Output maximum response.
+ */
+void HarrisKernel::responseRange(const Mat& gray, double& minValue, double& maxValue) const {
+    responseRange(gray, Mat(), Mat(), minValue, maxValue);
+}
+
+/**
+ * @brief Computes the global minimum and maximum response from shared Sobel derivatives.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param dx CV_16S 3 x 3 Sobel x derivative of gray, empty to compute it here.
+ * @param dy CV_16S 3 x 3 Sobel y derivative of gray, empty to compute it here.
+ * @param minValue Output minimum response.
+ * @param maxValue Output maximum response.
+ */
+void HarrisKernel::responseRange(const Mat& gray, const Mat& dx, const Mat& dy, double& minValue, double& maxValue) const {
+    const int bandRows = bandRowsFor(gray.cols);
+    const int bands = (gray.rows + bandRows - 1) / bandRows;
+    vector<double> bandMin(bands), bandMax(bands);
+
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        PooledMat response;
+        for (int band = range.start; band < range.end; band++) {
+            int y0 = band * bandRows;
+            int y1 = min(gray.rows, y0 + bandRows);
+            computeBand(gray, dx, dy, y0, y1, response.create(y1 - y0, gray.cols, CV_32F));
+            minMaxLoc(response.get(), &bandMin[band], &bandMax[band]);
+        }
+    });
+
+    minValue = *min_element(bandMin.begin(), bandMin.end());
+    maxValue = *max_element(bandMax.begin(), bandMax.end());
+}
+
+/**
+ * @brief Detects the pixels whose normalized (0-255) response is above a quality level.
+ *
+ * @param gray Single channel 8-bit or float image.
+ * @param qualityLevel Threshold on the truncated normalized response.
+ * @param corners Output corners in raster order.
+ */
+void HarrisKernel::detect(const Mat& gray, int qualityLevel, vector<Point>& corners) const {
+    detect(gray, qualityLevel, 0, corners, nullptr);
+}
+
+/**
+ * @brief Detects thresholded corners, optionally keeping only local maxima of the response.
+ *
+ * Phase one reduces the global response range, phase two recomputes each band and applies
+ * the same affine 0-255 mapping and truncating comparison as normalize + at<float> would.
+ * With a suppression radius, each band is computed with radius extra rows on both sides and
+ * dilated with a (2r+1) x (2r+1) rectangle; a pixel survives only if it equals that local
+ * maximum. No full-frame buffer is allocated and the band buffers come from the pool of the
+ * thread running the band; each band keeps its own corner list so the output stays in raster
+ * order.
+ *
+ * @param gray Single channel 8-bit or float image.
+ * @param qualityLevel Threshold on the truncated normalized response.
+ * @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+ * @param corners Output corners in raster order.
+ * @param scores Optional output normalized response of every corner.
+ */
+void HarrisKernel::detect(const Mat& gray, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores) const {
+    detect(gray, Mat(), Mat(), qualityLevel, nmsRadius, corners, scores);
+}
+
+/**
+ * @brief Detects thresholded corners reusing the Sobel derivatives Canny takes.
+ *
+ * Both phases read the shared derivatives instead of running Sobel on every band.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param dx CV_16S 3 x 3 Sobel x derivative of gray with replicated borders, empty to compute it here.
+ * @param dy CV_16S 3 x 3 Sobel y derivative of gray with replicated borders, empty to compute it here.
+ * @param qualityLevel Threshold on the truncated normalized response.
+ * @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+ * @param corners Output corners in raster order.
+ * @param scores Optional output normalized response of every corner.
+ */
+void HarrisKernel::detect(const Mat& gray, const Mat& dx, const Mat& dy, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores) const {
+    corners.clear();
+    if (scores) {
+        scores->clear();
+    }
+    if (gray.empty()) {
+        throw runtime_error("Image is empty, corners cannot be detected");
+    }
+
+    double minValue, maxValue;
+    responseRange(gray, dx, dy, minValue, maxValue);
+
+    // Same mapping as normalize(..., 0, 255, NORM_MINMAX)
+    double range = maxValue - minValue;
+    double scale = range > DBL_EPSILON ? 255.0 / range : 0.0;
+    const float alpha = static_cast<float>(scale);
+    const float beta = static_cast<float>(-minValue * scale);
+
+    const int bandRows = bandRowsFor(gray.cols);
+    const int bands = (gray.rows + bandRows - 1) / bandRows;
+    vector<vector<Point>> bandCorners(bands);
+    vector<vector<float>> bandScores(bands);
+    Mat peakKernel;
+    if (nmsRadius > 0) {
+        peakKernel = getStructuringElement(MORPH_RECT, Size(2 * nmsRadius + 1, 2 * nmsRadius + 1));
+    }
+
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        PooledMat responseBuffer, peaksBuffer;
+        for (int band = range.start; band < range.end; band++) {
+            int y0 = band * bandRows;
+            int y1 = min(gray.rows, y0 + bandRows);
+            int top = max(0, y0 - max(nmsRadius, 0));
+            int bottom = min(gray.rows, y1 + max(nmsRadius, 0));
+            Mat& response = responseBuffer.create(bottom - top, gray.cols, CV_32F);
+            computeBand(gray, dx, dy, top, bottom, response);
+            Mat& peaks = peaksBuffer.get();
+            if (nmsRadius > 0) {
+                dilate(response, peaksBuffer.create(bottom - top, gray.cols, CV_32F), peakKernel);
+            }
+
+            vector<Point>& found = bandCorners[band];
+            vector<float>& foundScores = bandScores[band];
+            for (int y = y0; y < y1; y++) {
+                const float* row = response.ptr<float>(y - top);
+                const float* peak = nmsRadius > 0 ? peaks.ptr<float>(y - top) : row;
+                for (int x = 0; x < gray.cols; x++) {
+                    float normalized = row[x] * alpha + beta;
+                    if ((int)normalized > qualityLevel && row[x] >= peak[x]) {
+                        found.emplace_back(x, y);
+                        if (scores) {
+                            foundScores.push_back(normalized);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& found : bandCorners) {
+        total += found.size();
+    }
+    corners.reserve(total);
+    if (scores) {
+        scores->reserve(total);
+    }
+    for (int band = 0; band < bands; band++) {
+        corners.insert(corners.end(), bandCorners[band].begin(), bandCorners[band].end());
+        if (scores) {
+            scores->insert(scores->end(), bandScores[band].begin(), bandScores[band].end());
+        }
+    }
+}
+
+/**
+ * @brief Computes a band from gray alone or from shared derivatives.
+ *
+ * @param gray The image.
+ * @param dx Shared x derivative, empty to compute it.
+ * @param dy Shared y derivative, empty to compute it.
+ * @param y0 First row of the band.
+ * @param y1 One past the last row of the band.
+ * @param response Output float response with y1 - y0 rows.
+ */
+void HarrisKernel::computeBand(const Mat& gray, const Mat& dx, const Mat& dy, int y0, int y1, Mat& response) const {
+    if (dx.empty() || dy.empty()) {
+        computeResponseRows(gray, y0, y1, response);
+    }
+    else {
+        computeResponseRows(gray, dx, dy, y0, y1, response);
+    }
+}
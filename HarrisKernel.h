@@ -0,0 +1,124 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// HarrisKernel Class
+/// Band-parallel Harris corner response that never materializes a full-frame response image.
+/// The image is split into row bands small enough to stay in cache; each band computes its
+/// Sobel derivatives, structure tensor, box sum and response in one go. Thresholding against
+/// the min-max normalized response runs in two phases: a parallel min/max reduction followed
+/// by a second band pass that emits the corners directly. Results match cornerHarris followed
+/// by normalize(NORM_MINMAX) up to float rounding at the threshold boundary. The derivatives
+/// can also be handed in, so a caller running Canny on the same image computes Sobel once.
+class HarrisKernel
+{
+public:
+    /// Constructor
+    /// @param blockSize Neighborhood size of the structure tensor box sum.
+    /// @param apertureSize Aperture of the Sobel operator.
+    /// @param k Harris detector free parameter.
+    HarrisKernel(int blockSize = 2, int apertureSize = 3, double k = 0.04);
+
+    /// Detect the pixels whose normalized (0-255) response is above a quality level
+    /// @param gray Single channel 8-bit or float image.
+    /// @param qualityLevel Threshold on the truncated normalized response.
+    /// @param corners Output corners in raster order.
+    void detect(const Mat& gray, int qualityLevel, vector<Point>& corners) const;
+
+    /// Detect thresholded corners, optionally keeping only local maxima of the response
+    /// @param gray Single channel 8-bit or float image.
+    /// @param qualityLevel Threshold on the truncated normalized response.
+    /// @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+    /// @param corners Output corners in raster order.
+    /// @param scores Optional output normalized (0-255) response of every corner.
+    void detect(const Mat& gray, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores = nullptr) const;
+
+    /// Detect thresholded corners reusing the Sobel derivatives Canny takes
+    /// @param gray Single channel 8-bit image.
+    /// @param dx CV_16S 3 x 3 Sobel x derivative of gray with replicated borders, as Canny computes it; empty to compute it here.
+    /// @param dy CV_16S 3 x 3 Sobel y derivative of gray with replicated borders; empty to compute it here.
+    /// @param qualityLevel Threshold on the truncated normalized response.
+    /// @param nmsRadius Non-maximum suppression radius in pixels, 0 to disable.
+    /// @param corners Output corners in raster order.
+    /// @param scores Optional output normalized (0-255) response of every corner.
+    void detect(const Mat& gray, const Mat& dx, const Mat& dy, int qualityLevel, int nmsRadius, vector<Point>& corners, vector<float>* scores = nullptr) const;
+
+    /// Compute the raw Harris response of a band of rows
+    /// Pixels outside the band are read from the parent image, so bands stitch seamlessly.
+    /// @param gray Single channel 8-bit or float image.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param response Output float response with y1 - y0 rows.
+    void computeResponseRows(const Mat& gray, int y0, int y1, Mat& response) const;
+
+    /// Compute the raw Harris response of a band of rows from shared Sobel derivatives
+    /// Canny replicates the border where cornerHarris reflects it, so the frame pixels are
+    /// derived again from gray; the response matches the other overload up to float rounding.
+    /// @param gray Single channel 8-bit image.
+    /// @param dx CV_16S 3 x 3 Sobel x derivative of gray with replicated borders.
+    /// @param dy CV_16S 3 x 3 Sobel y derivative of gray with replicated borders.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param response Output float response with y1 - y0 rows.
+    void computeResponseRows(const Mat& gray, const Mat& dx, const Mat& dy, int y0, int y1, Mat& response) const;
+
+    /// Compute the global minimum and maximum response with a parallel band reduction
+    /// @param gray Single channel 8-bit or float image.
+    /// @param minValue Output minimum response.
+    /// @param maxValue Output maximum response.
+    void responseRange(const Mat& gray, double& minValue, double& maxValue) const;
+
+    /// Compute the global minimum and maximum response from shared Sobel derivatives
+    /// @param gray Single channel 8-bit image.
+    /// @param dx CV_16S 3 x 3 Sobel x derivative of gray, empty to compute it here.
+    /// @param dy CV_16S 3 x 3 Sobel y derivative of gray, empty to compute it here.
+    /// @param minValue Output minimum response.
+    /// @param maxValue Output maximum response.
+    void responseRange(const Mat& gray, const Mat& dx, const Mat& dy, double& minValue, double& maxValue) const;
+
+    /// Get the number of rows per band for a given image width
+    /// @param cols Image width in pixels.
+    /// @return Rows per band keeping the band scratch buffers cache resident.
+    static int bandRowsFor(int cols);
+
+private:
+    /// Find the structure tensor rows the vertical box sum of a band reads
+    /// @param rows Image height.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param tensorLo Output first tensor row.
+    /// @param tensorHi Output last tensor row.
+    void tensorRows(int rows, int y0, int y1, int& tensorLo, int& tensorHi) const;
+
+    /// Get the factor cornerHarris scales the derivatives with
+    /// @param depth Image depth, CV_8U or CV_32F.
+    /// @return The scale.
+    double derivativeScale(int depth) const;
+
+    /// Compute the response of a band from the float derivatives of its tensor rows
+    /// @param dx Scaled x derivative of rows tensorLo..tensorHi.
+    /// @param dy Scaled y derivative of the same rows.
+    /// @param rows Image height.
+    /// @param tensorLo First tensor row, the first row of dx and dy.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param response Output float response with y1 - y0 rows.
+    void tensorResponse(const Mat& dx, const Mat& dy, int rows, int tensorLo, int y0, int y1, Mat& response) const;
+
+    /// Compute a band from gray alone or from shared derivatives
+    /// @param gray The image.
+    /// @param dx Shared x derivative, empty to compute it.
+    /// @param dy Shared y derivative, empty to compute it.
+    /// @param y0 First row of the band.
+    /// @param y1 One past the last row of the band.
+    /// @param response Output float response with y1 - y0 rows.
+    void computeBand(const Mat& gray, const Mat& dx, const Mat& dy, int y0, int y1, Mat& response) const;
+
+    int blockSize;          ///< Structure tensor neighborhood size
+    int apertureSize;       ///< Sobel aperture
+    double k;               ///< Harris free parameter
+};
@@ -0,0 +1,220 @@
+#include "IncrementalHough.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+/**
+ * @brief Constructor for an empty accumulator.
+ *
+ * The accumulator layout follows HoughLines: angles in [0, pi), distances centered so that
+ * negative rho values map to the lower half of each row.
+ *
+ * @param imageSize Size of the edge maps that will be voted.
+ * @param rho Distance resolution of the accumulator in pixels.
+ * @param theta Angle resolution of the accumulator in radians.
+ */
+IncrementalHough::IncrementalHough(Size imageSize, double rho, double theta)
+    : imageSize(imageSize), rho(rho), theta(theta) {
+    if (imageSize.width <= 0 || imageSize.height <= 0 || rho <= 0 || theta <= 0) {
+        throw invalid_argument("Hough accumulator needs a non-empty image and positive resolutions");
+    }
+
+    numAngle = max(1, cvRound(CV_PI / theta));
+    numRho = cvRound(((imageSize.width + imageSize.height) * 2 + 1) / rho);
+
+    cosTable.resize(numAngle);
+    sinTable.resize(numAngle);
+    for (int n = 0; n < numAngle; n++) {
+        cosTable[n] = static_cast<float>(cos(n * theta) / rho);
+        sinTable[n] = static_cast<float>(sin(n * theta) / rho);
+    }
+
+    accumulator = Mat::zeros(numAngle, numRho, CV_32S);
+    consumed = Mat::zeros(imageSize, CV_8U);
+}
+
+/**
+ * @brief Adds the votes of edge pixels.
+ *
+ * @param indices Pixel indices (y * cols + x).
+ */
+void IncrementalHough::addPoints(const vector<int>& indices) {
+    vote(indices, 1);
+}
+
+/**
+ * @brief Removes the votes of edge pixels that were added before.
+ *
+ * @param indices Pixel indices (y * cols + x).
+ */
+void IncrementalHough::removePoints(const vector<int>& indices) {
+    vote(indices, -1);
+}
+
+/**
+ * @brief Adds delta to the accumulator cells of every pixel.
+ *
+ * Every angle owns one accumulator row, so splitting the work over angles needs no locking.
+ *
+ * @param indices Pixel indices (y * cols + x).
+ * @param delta Vote increment, +1 or -1.
+ */
+void IncrementalHough::vote(const vector<int>& indices, int delta) {
+    if (indices.empty()) {
+        return;
+    }
+
+    const int cols = imageSize.width;
+    points.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        points[i] = Point(indices[i] % cols, indices[i] / cols);
+    }
+
+    const int rhoOffset = (numRho - 1) / 2;
+    parallel_for_(Range(0, numAngle), [&](const Range& range) {
+        for (int n = range.start; n < range.end; n++) {
+            int* row = accumulator.ptr<int>(n);
+            const float c = cosTable[n];
+            const float s = sinTable[n];
+            for (const Point& p : points) {
+                row[cvRound(p.x * c + p.y * s) + rhoOffset] += delta;
+            }
+        }
+    });
+}
+
+/**
+ * @brief Extracts line segments from the accumulator.
+ *
+ * Cells that reach the threshold and are maxima of their 4-neighborhood are visited from
+ * the strongest down. Each peak line is walked along its major axis; at every step the
+ * nearest pixel, or the second nearest when it also lies within half a bin of the line,
+ * counts if it is an edge not claimed by a stronger segment. A peak whose unclaimed pixels
+ * no longer reach the threshold is skipped, which stands in for the vote removal of the
+ * probabilistic transform. Runs end after more than maxLineGap empty steps and are kept
+ * when they span at least minLineLength along x or y and cover at least half of that span.
+ *
+ * @param edges Edge map whose edge pixels are exactly the voted pixels.
+ * @param threshold Minimum number of votes of a line.
+ * @param minLineLength Minimum segment length.
+ * @param maxLineGap Maximum gap between pixels of one segment.
+ * @param lines Output segments, strongest line first.
+ */
+void IncrementalHough::findSegments(const EdgeMap& edges, int threshold, int minLineLength, int maxLineGap, vector<Vec4i>& lines) {
+    if (edges.size() != imageSize) {
+        throw invalid_argument("Edge map does not match the Hough accumulator");
+    }
+
+    lines.clear();
+
+    // Accumulator peaks as (votes, angle, rho), raster order before sorting
+    vector<Vec3i> peaks;
+    for (int n = 0; n < numAngle; n++) {
+        const int* above = n > 0 ? accumulator.ptr<int>(n - 1) : nullptr;
+        const int* row = accumulator.ptr<int>(n);
+        const int* below = n + 1 < numAngle ? accumulator.ptr<int>(n + 1) : nullptr;
+        for (int r = 0; r < numRho; r++) {
+            const int v = row[r];
+            if (v < max(threshold, 1)) {
+                continue;
+            }
+            if ((r > 0 && v <= row[r - 1]) || (r + 1 < numRho && v < row[r + 1]) ||
+                (above && v <= above[r]) || (below && v < below[r])) {
+                continue;
+            }
+            peaks.push_back(Vec3i(v, n, r));
+        }
+    }
+    stable_sort(peaks.begin(), peaks.end(), [](const Vec3i& a, const Vec3i& b) { return a[0] > b[0]; });
+
+    const int cols = imageSize.width;
+    const int rows = imageSize.height;
+    const int rhoOffset = (numRho - 1) / 2;
+    uchar* claimed = consumed.ptr<uchar>();
+    vector<int> claimedPixels;
+    vector<int> runPixels;
+
+    auto probe = [&](int x, int y) {
+        if (x < 0 || y < 0 || x >= cols || y >= rows) {
+            return -1;
+        }
+        const int index = y * cols + x;
+        return edges.test(x, y) && !claimed[index] ? index : -1;
+    };
+
+    for (const Vec3i& peak : peaks) {
+        const double angle = peak[1] * theta;
+        const double c = cos(angle);
+        const double s = sin(angle);
+        const double distance = (peak[2] - rhoOffset) * rho;
+        const bool alongX = fabs(s) >= fabs(c);
+        const int steps = alongX ? cols : rows;
+
+        // Unclaimed edge pixel of the line at step t, or -1
+        auto sample = [&](int t, Point& pt) {
+            const double exact = alongX ? (distance - t * c) / s : (distance - t * s) / c;
+            const double normalPerStep = fabs(alongX ? s : c);
+            const int nearest = cvRound(exact);
+            const int second = exact > nearest ? nearest + 1 : nearest - 1;
+
+            pt = alongX ? Point(t, nearest) : Point(nearest, t);
+            int index = probe(pt.x, pt.y);
+            if (index < 0 && fabs(second - exact) * normalPerStep <= 0.5 * rho) {
+                pt = alongX ? Point(t, second) : Point(second, t);
+                index = probe(pt.x, pt.y);
+            }
+            return index;
+        };
+
+        Point pt;
+        int support = 0;
+        for (int t = 0; t < steps; t++) {
+            support += sample(t, pt) >= 0;
+        }
+        if (support < threshold) {
+            continue;
+        }
+
+        bool inRun = false;
+        int gap = 0;
+        Point first, last;
+        runPixels.clear();
+
+        auto closeRun = [&]() {
+            const int span = max(abs(last.x - first.x), abs(last.y - first.y));
+            if (span >= minLineLength && 2 * runPixels.size() >= static_cast<size_t>(span + 1)) {
+                lines.push_back(Vec4i(first.x, first.y, last.x, last.y));
+                for (int index : runPixels) {
+                    claimed[index] = 1;
+                }
+                claimedPixels.insert(claimedPixels.end(), runPixels.begin(), runPixels.end());
+            }
+            inRun = false;
+            runPixels.clear();
+        };
+
+        for (int t = 0; t < steps; t++) {
+            const int index = sample(t, pt);
+            if (index >= 0) {
+                if (!inRun) {
+                    inRun = true;
+                    first = pt;
+                }
+                last = pt;
+                runPixels.push_back(index);
+                gap = 0;
+            }
+            else if (inRun && ++gap > maxLineGap) {
+                closeRun();
+            }
+        }
+        if (inRun) {
+            closeRun();
+        }
+    }
+
+    for (int index : claimedPixels) {
+        claimed[index] = 0;
+    }
+}
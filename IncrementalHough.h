@@ -0,0 +1,54 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+#include "EdgeMap.h"
+
+using namespace std;
+using namespace cv;
+
+/// IncrementalHough Class
+/// Line Hough transform whose (rho, theta) accumulator is kept between edge map updates.
+/// Edge pixels are voted in and out individually, so a threshold change only pays for the
+/// pixels whose edge state changed. Segments are extracted from the accumulator peaks by
+/// walking each peak line over the current edge map, with the minimum length and maximum
+/// gap semantics of HoughLinesP; pixels claimed by a stronger segment are not reused.
+class IncrementalHough
+{
+public:
+    /// Constructor for an empty accumulator
+    /// @param imageSize Size of the edge maps that will be voted.
+    /// @param rho Distance resolution of the accumulator in pixels.
+    /// @param theta Angle resolution of the accumulator in radians.
+    IncrementalHough(Size imageSize, double rho = 1, double theta = CV_PI / 180);
+
+    /// Add the votes of edge pixels
+    /// @param indices Pixel indices (y * cols + x).
+    void addPoints(const vector<int>& indices);
+
+    /// Remove the votes of edge pixels that were added before
+    /// @param indices Pixel indices (y * cols + x).
+    void removePoints(const vector<int>& indices);
+
+    /// Extract line segments from the accumulator
+    /// @param edges Edge map whose edge pixels are exactly the voted pixels.
+    /// @param threshold Minimum number of votes of a line.
+    /// @param minLineLength Minimum segment length.
+    /// @param maxLineGap Maximum gap between pixels of one segment.
+    /// @param lines Output segments, strongest line first.
+    void findSegments(const EdgeMap& edges, int threshold, int minLineLength, int maxLineGap, vector<Vec4i>& lines);
+
+private:
+    /// Add delta to the accumulator cells of every pixel, parallel over the angles
+    void vote(const vector<int>& indices, int delta);
+
+    Size imageSize;             ///< Size of the voted edge maps
+    double rho;                 ///< Distance resolution
+    double theta;               ///< Angle resolution
+    int numAngle;               ///< Number of accumulator angles
+    int numRho;                 ///< Number of accumulator distances
+    vector<float> cosTable;     ///< cos(angle) / rho for every accumulator angle
+    vector<float> sinTable;     ///< sin(angle) / rho for every accumulator angle
+    Mat accumulator;            ///< CV_32S votes, one row per angle
+    Mat consumed;               ///< 8-bit mask of pixels claimed by extracted segments
+    vector<Point> points;       ///< Scratch coordinates of the pixels being voted
+};
@@ -1,4 +1,10 @@
 #include "LineDetection.h"
+#include "BufferPool.h"
+#include "ProbabilisticHough.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 /**
  * @brief Constructor for LineDetection class.
@@ -8,7 +14,61 @@
  * @param scale The scaling factor for resizing the image.
  */
 LineDetection::LineDetection(const string& filePath, const string& fileName, double& scale)
-    : Detection(filePath, fileName, scale), lowThresHold(50) {
+    : Detection(filePath, fileName, scale), lowThresHold(50), lineEngine(LineEngine::Hough), mergeSegments(false) {
+    logMessage("Constructor Created for LineDetection");
+}
+
+/**
+ * @brief Constructor for LineDetection class from an image that is already in memory.
+ *
+ * @param image The BGR image to process, shared rather than copied.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+LineDetection::LineDetection(const Mat& image, const string& fileName, double& scale)
+    : Detection(image, fileName, scale), lowThresHold(50), lineEngine(LineEngine::Hough), mergeSegments(false) {
+    logMessage("Constructor Created for LineDetection");
+}
+
+/**
+ * @brief Constructor for LineDetection class from an encoded image held in memory.
+ *
+ * @param encoded The encoded bytes, only read during construction.
+ * @param length Number of encoded bytes.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+LineDetection::LineDetection(const uchar* encoded, size_t length, const string& fileName, double& scale)
+    : Detection(encoded, length, fileName, scale), lowThresHold(50), lineEngine(LineEngine::Hough), mergeSegments(false) {
+    logMessage("Constructor Created for LineDetection");
+}
+
+/**
+ * @brief Constructor for LineDetection class wrapping uncompressed pixels owned by the caller.
+ *
+ * @param pixels The first pixel, shared rather than copied.
+ * @param size Image size.
+ * @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+ * @param step Bytes per row, 0 for tightly packed rows.
+ * @param order Sample order of color pixels.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+LineDetection::LineDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale)
+    : Detection(pixels, size, type, step, order, fileName, scale), lowThresHold(50), lineEngine(LineEngine::Hough), mergeSegments(false) {
+    logMessage("Constructor Created for LineDetection");
+}
+
+/**
+ * @brief Constructor for LineDetection class mapping a raw pixel file.
+ *
+ * @param filePath The raw file.
+ * @param layout Where and how the pixels are stored in the file.
+ * @param fileName The name identifying the image.
+ * @param scale The scaling factor for resizing the image.
+ */
+LineDetection::LineDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale)
+    : Detection(filePath, layout, fileName, scale), lowThresHold(50), lineEngine(LineEngine::Hough), mergeSegments(false) {
     logMessage("Constructor Created for LineDetection");
 }
 
@@ -20,21 +80,297 @@ LineDetection::~LineDetection() {
 }
 
 /**
- * @brief Detects lines in the image using the Canny edge detector and the Hough Transform algorithm.
+ * @brief Detects lines in the image with the selected line engine.
  *
- * - Applies Canny edge detection to detect edges in the image.
- * - Uses the HoughLinesP function to detect lines based on the detected edges.
+ * - Hough: applies Canny edge detection and detects lines on the packed edge list.
+ * - SegmentDetector: groups pixels of similar gradient orientation into segments (LSD).
+ * - Optionally merges collinear fragments and near-duplicates of one edge.
  * - Stores the detected lines in the line features.
+ * - With regions of interest set, searches only the regions and drops segments whose
+ *   midpoint is off the mask; the regions take precedence over the pyramid.
+ * - With pyramid levels set, runs coarse-to-fine instead.
  */
 void LineDetection::detectFeatures() {
-    Canny(getImage(), detectedEdges, lowThresHold, lowThresHold * 3);
+    TRACE_STAGE("detectLines");
     vector<Vec4i> detectedLines;
-    HoughLinesP(detectedEdges, detectedLines, 1, CV_PI / 180, 50, 50, 10);
+    if (!getDetectionRegions().empty()) {
+        detectLinesInRegions(getImage(), getDetectionRegions(), detectedLines);
+        detectedLines.erase(remove_if(detectedLines.begin(), detectedLines.end(), [this](const Vec4i& l) {
+            return !insideMask(Point((l[0] + l[2]) / 2, (l[1] + l[3]) / 2));
+        }), detectedLines.end());
+    }
+    else if (getPyramidLevels() > 0) {
+        detectLinesPyramid(getImage(), detectedLines);
+    }
+    else {
+        findSegments(getImage(), lineEngine, lowThresHold, 50, 50, 10, detectedLines);
+    }
+    if (mergeSegments) {
+        SegmentMerger::merge(detectedLines, mergeTolerances);
+    }
 
-    setLineFeatures(detectedLines); // Store line features
+    traceStage.setCount(detectedLines.size());
+    setLineFeatures(move(detectedLines)); // Store line features
     logMessage("Lines detected and stored in lineFeatures.");
 }
 
+/**
+ * @brief Detects line segments inside regions of an image.
+ *
+ * Edge linking, the probabilistic Hough transform and segment region growing are not local,
+ * so a region is searched together with regionMargin pixels around it and, like the tiles of
+ * TiledProcessor, keeps only the segments whose midpoint it holds. A segment found by
+ * overlapping regions is reported once, by the first of them.
+ *
+ * @param gray Single channel image.
+ * @param regions The regions to search, may overlap.
+ * @param lines Output segments in image coordinates, in region order.
+ */
+void LineDetection::detectLinesInRegions(const Mat& gray, const vector<Rect>& regions, vector<Vec4i>& lines) const {
+    lines.clear();
+    const Rect frame(0, 0, gray.cols, gray.rows);
+    const int margin = regionMargin();
+    const int regionCount = static_cast<int>(regions.size());
+    vector<vector<Vec4i>> found(regionCount);
+
+    parallel_for_(Range(0, regionCount), [&](const Range& range) {
+        for (int index = range.start; index < range.end; index++) {
+            const Rect& region = regions[index];
+            const Rect padded = Rect(region.x - margin, region.y - margin, region.width + 2 * margin, region.height + 2 * margin) & frame;
+
+            PooledVector<Vec4i> segmentBuffer;
+            vector<Vec4i>& segments = segmentBuffer.get();
+            findSegments(gray(padded), lineEngine, lowThresHold, 50, 50, 10, segments);
+            for (const auto& segment : segments) {
+                const Vec4i global(segment[0] + padded.x, segment[1] + padded.y, segment[2] + padded.x, segment[3] + padded.y);
+                const Point middle((global[0] + global[2]) / 2, (global[1] + global[3]) / 2);
+                if (!region.contains(middle)) {
+                    continue;
+                }
+
+                bool earlier = false;
+                for (int other = 0; other < index && !earlier; other++) {
+                    earlier = regions[other].contains(middle);
+                }
+                if (!earlier) {
+                    found[index].push_back(global);
+                }
+            }
+        }
+    });
+
+    for (const auto& segments : found) {
+        lines.insert(lines.end(), segments.begin(), segments.end());
+    }
+}
+
+/**
+ * @brief Gets the margin the line engines read around a region.
+ *
+ * Canny reads one Sobel pixel and one thinning pixel, LSD a little more for its internal
+ * rescaling; the rest lets segments crossing the region border continue past it.
+ *
+ * @return The margin in pixels.
+ */
+int LineDetection::regionMargin(void) const {
+    return 16;
+}
+
+/**
+ * @brief Finds line segments in a grayscale image with the given engine.
+ *
+ * The Canny output only lives in pooled scratch: it is packed to one bit per pixel with a
+ * list of its edge pixels, which the probabilistic Hough transform votes directly, with the
+ * same segments as HoughLinesP. The segment detector runs without refinement, which would
+ * only split curved regions, and its sub-pixel endpoints are rounded. Segments shorter than minLength are dropped, so
+ * both engines report lines of the same minimum length.
+ *
+ * @param gray Single channel 8-bit image.
+ * @param engine The line engine.
+ * @param cannyLowThreshold Canny low threshold, the high one is three times larger; Hough only.
+ * @param votes HoughLinesP accumulator threshold; Hough only.
+ * @param minLength Shortest segment reported.
+ * @param maxGap Largest gap HoughLinesP bridges within a segment; Hough only.
+ * @param lines Output segments.
+ */
+void LineDetection::findSegments(const Mat& gray, LineEngine engine, int cannyLowThreshold, int votes, int minLength, int maxGap, vector<Vec4i>& lines) {
+    lines.clear();
+    if (engine == LineEngine::Hough) {
+        PooledMat edgeBuffer(gray.rows, gray.cols, CV_8U);
+        Canny(gray, edgeBuffer.get(), cannyLowThreshold, cannyLowThreshold * 3);
+        EdgeMap edges;
+        edges.pack(edgeBuffer.get());
+        ProbabilisticHough::findSegments(edges, 1, CV_PI / 180, votes, minLength, maxGap, lines);
+        return;
+    }
+
+    Ptr<LineSegmentDetector> detector = createLineSegmentDetector(LSD_REFINE_NONE);
+    PooledVector<Vec4f> segmentBuffer;
+    vector<Vec4f>& segments = segmentBuffer.get();
+    detector->detect(gray, segments);
+
+    const float shortest = static_cast<float>(minLength) * minLength;
+    for (const auto& s : segments) {
+        const float dx = s[2] - s[0];
+        const float dy = s[3] - s[1];
+        if (dx * dx + dy * dy >= shortest) {
+            lines.push_back(Vec4i(cvRound(s[0]), cvRound(s[1]), cvRound(s[2]), cvRound(s[3])));
+        }
+    }
+}
+
+/**
+ * @brief Gets the line engine.
+ *
+ * @return The engine used by detectFeatures.
+ */
+LineEngine LineDetection::getLineEngine(void) const {
+    return lineEngine;
+}
+
+/**
+ * @brief Selects the line engine.
+ *
+ * @param engine The engine used by detectFeatures.
+ */
+void LineDetection::setLineEngine(LineEngine engine) {
+    lineEngine = engine;
+}
+
+/**
+ * @brief Enables or disables merging of collinear fragments and near-duplicate segments.
+ *
+ * @param enabled True to merge the detected segments.
+ * @param tolerances The match tolerances.
+ */
+void LineDetection::setSegmentMerging(bool enabled, const MergeTolerances& tolerances) {
+    mergeSegments = enabled;
+    mergeTolerances = tolerances;
+}
+
+/**
+ * @brief Checks whether detected segments are merged.
+ *
+ * @return True if merging is enabled.
+ */
+bool LineDetection::isSegmentMerging(void) const {
+    return mergeSegments;
+}
+
+/**
+ * @brief Detects line segments coarse-to-fine.
+ *
+ * The line engine runs on the pyramid level with the length, gap and vote thresholds
+ * scaled down by the reduction factor f. Each coarse segment is mapped to full resolution and
+ * surrounded by a corridor f + 1 pixels wide on each side and extended by f at both ends.
+ * Canny runs on the corridor in pieces of at most 128 pixels, so diagonal segments do not
+ * pull in their whole bounding box, and a robust line fit of the corridor edge pixels gives
+ * the refined segment, spanning the extreme projections of its supporting pixels. Segments
+ * with too little full resolution support keep their scaled coarse position.
+ *
+ * @param gray Single channel full resolution image.
+ * @param lines Output segments in full resolution coordinates.
+ */
+void LineDetection::detectLinesPyramid(const Mat& gray, vector<Vec4i>& lines) const {
+    lines.clear();
+
+    const int levels = getPyramidLevels();
+    const int factor = 1 << levels;
+    Mat coarse;
+    buildPyramidLevel(gray, coarse, levels);
+
+    vector<Vec4i> candidates;
+    findSegments(coarse, lineEngine, lowThresHold, max(10, 50 / factor), max(5, 50 / factor), max(1, 10 / factor), candidates);
+    if (candidates.empty()) {
+        return;
+    }
+
+    const Rect frame(0, 0, gray.cols, gray.rows);
+    const float halfWidth = factor + 1.0f;
+    const float pieceLength = 128.0f;
+    lines.resize(candidates.size());
+
+    parallel_for_(Range(0, static_cast<int>(candidates.size())), [&](const Range& range) {
+        vector<Point2f> support;
+        for (int i = range.start; i < range.end; i++) {
+            const Vec4i& candidate = candidates[i];
+            Point2f start(static_cast<float>(candidate[0] * factor), static_cast<float>(candidate[1] * factor));
+            Point2f end(static_cast<float>(candidate[2] * factor), static_cast<float>(candidate[3] * factor));
+            lines[i] = Vec4i(cvRound(start.x), cvRound(start.y), cvRound(end.x), cvRound(end.y));
+
+            Point2f direction = end - start;
+            float length = static_cast<float>(norm(direction));
+            if (length < 1.0f) {
+                continue;
+            }
+            direction *= 1.0f / length;
+            const Point2f normal(-direction.y, direction.x);
+            start -= direction * static_cast<float>(factor);
+            length += 2.0f * factor;
+
+            // Edge pixels of the corridor, collected piece by piece
+            support.clear();
+            const int pieces = static_cast<int>(ceil(length / pieceLength));
+            for (int piece = 0; piece < pieces; piece++) {
+                const float from = length * piece / pieces;
+                const float to = length * (piece + 1) / pieces;
+                const Point2f a = start + direction * from;
+                const Point2f b = start + direction * to;
+                vector<Point> outline = {
+                    Point(cvFloor((a + normal * halfWidth).x), cvFloor((a + normal * halfWidth).y)),
+                    Point(cvFloor((a - normal * halfWidth).x), cvFloor((a - normal * halfWidth).y)),
+                    Point(cvFloor((b + normal * halfWidth).x), cvFloor((b + normal * halfWidth).y)),
+                    Point(cvFloor((b - normal * halfWidth).x), cvFloor((b - normal * halfWidth).y)) };
+                Rect box = boundingRect(outline);
+                box = Rect(box.x - 2, box.y - 2, box.width + 5, box.height + 5) & frame;
+                if (box.empty()) {
+                    continue;
+                }
+
+                Mat edges;
+                Canny(gray(box), edges, lowThresHold, lowThresHold * 3);
+                for (int y = 0; y < edges.rows; y++) {
+                    const uchar* row = edges.ptr<uchar>(y);
+                    for (int x = 0; x < edges.cols; x++) {
+                        if (!row[x]) {
+                            continue;
+                        }
+                        const Point2f p(static_cast<float>(x + box.x), static_cast<float>(y + box.y));
+                        const Point2f offset = p - start;
+                        const float along = offset.dot(direction);
+                        if (along >= from && along < to && fabs(offset.dot(normal)) <= halfWidth) {
+                            support.push_back(p);
+                        }
+                    }
+                }
+            }
+
+            // Require the corridor to hold at least half of the coarse segment length in edge pixels
+            if (support.size() < max<size_t>(2, static_cast<size_t>((length - 2.0f * factor) / 2.0f))) {
+                continue;
+            }
+
+            Vec4f fitted;
+            fitLine(support, fitted, DIST_HUBER, 0, 0.01, 0.01);
+            Point2f axis(fitted[0], fitted[1]);
+            if (axis.dot(direction) < 0) {
+                axis = -axis;
+            }
+            const Point2f origin(fitted[2], fitted[3]);
+
+            float lowest = FLT_MAX, highest = -FLT_MAX;
+            for (const auto& p : support) {
+                const float t = (p - origin).dot(axis);
+                lowest = min(lowest, t);
+                highest = max(highest, t);
+            }
+            const Point2f first = origin + axis * lowest;
+            const Point2f last = origin + axis * highest;
+            lines[i] = Vec4i(cvRound(first.x), cvRound(first.y), cvRound(last.x), cvRound(last.y));
+        }
+    });
+}
+
 /**
  * @brief Processes line detection with default settings.
  *
@@ -46,15 +382,13 @@ void LineDetection::detectFeatures() {
  * - Creates an adjustable edge map window for visualization.
  */
 void LineDetection::processLineDetection() {
-    showImage("Raw Image",getImage());  // Show raw image
-    convertToGrayScale(getImage());     // Convert to grayscale
-    showImage("GrayScale", getImage()); // Show grayscale image
-
+    PreprocessingPipeline pipeline;
+    pipeline.grayscale();                   // Convert to grayscale
     if (getScaleFactor() != 1.0)
     {
-        rescaleImage(getImage());           // Rescale the image
-        showImage("Resized", getImage());   // Show resized image
+        pipeline.rescale(getScaleFactor()); // Rescale the image
     }
+    preprocess(pipeline, true);         // Show every stage
 
     detectFeatures();                   // Detect lines
     saveFeatures("Lines.txt");          // Save lines to file
@@ -80,28 +414,22 @@ void LineDetection::processLineDetection() {
 void LineDetection::processLineDetection(bool filter) {
 
 
-    showImage("Raw Image", getImage());     // Show raw image
-    convertToGrayScale(getImage());         // Convert to grayscale
-    showImage("GrayScale", getImage());     // Show grayscale image
-
-
+    PreprocessingPipeline pipeline;
+    pipeline.grayscale();                   // Convert to grayscale
     if (getScaleFactor() != 1.0)
     {
-        rescaleImage(getImage());           // Rescale the image
-        showImage("Resized", getImage());   // Show resized image
+        pipeline.rescale(getScaleFactor()); // Rescale the image
     }
-                  
-        
-    
+
     // Apply selected filter
     if (filter)
     {
-        filterNoiseGaus(getImage());
+        pipeline.gaussian();
     }
     else
-        filterNoiseMedian(getImage());
+        pipeline.median();
 
-    showImage("Filtered", getImage());  // Show filtered image
+    preprocess(pipeline, true);         // Show every stage
     detectFeatures();                   // Detect lines
     saveFeatures("LinesFiltered.txt");  // Save filtered lines to file
     displayFeatures("Detected Corners", FeatureType::Lines);  // Display detected lines
@@ -109,3 +437,19 @@ void LineDetection::processLineDetection(bool filter) {
   
 
 }
+
+/**
+ * @brief Records the Canny and Hough settings in a binary feature file header.
+ *
+ * The segment detector uses neither, so both stay 0 for it.
+ *
+ * @param header The header to complete.
+ */
+void LineDetection::describeParameters(FeatureFileHeader& header) const {
+    Detection::describeParameters(header);
+    header.detectors |= FeatureFileLines;
+    if (lineEngine == LineEngine::Hough) {
+        header.cannyLowThreshold = lowThresHold;
+        header.houghThreshold = 50;
+    }
+}
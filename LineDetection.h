@@ -1,11 +1,20 @@
 #pragma once
 #include "Detection.h"
+#include "SegmentMerger.h"
 #include <fstream>
 #include <vector>
 
 using namespace std;
 using namespace cv;
 
+/// Line segment detection implementations
+/// Hough runs Canny and the probabilistic Hough transform, whose cost grows with the number of
+/// edge pixels times the accumulator work per pixel. SegmentDetector runs the LSD gradient
+/// grouping detector: pixels are grouped into line-support regions by gradient orientation and
+/// validated by an a contrario test, in time roughly linear in the image size and without an
+/// accumulator or edge thresholds.
+enum class LineEngine { Hough, SegmentDetector };
+
 /// LineDetection Class
 /// Derived from the Detection class, this class provides specific functionalities for detecting and visualizing lines in an image.
 class LineDetection :  public Detection
@@ -17,13 +26,85 @@ class LineDetection :  public Detection
 		/// @param scale The scale factor for resizing the image.
 		LineDetection(const string& filePath, const string& fileName, double& scale);
 
+		/// Constructor for an image that is already in memory
+		/// @param image The BGR image to process, shared rather than copied.
+		/// @param fileName The name identifying the image.
+		/// @param scale The scale factor for resizing the image.
+		LineDetection(const Mat& image, const string& fileName, double& scale);
+
+		/// Constructor decoding an encoded image held in memory
+		/// @param encoded The encoded bytes, only read during construction.
+		/// @param length Number of encoded bytes.
+		/// @param fileName The name identifying the image.
+		/// @param scale The scale factor for resizing the image.
+		LineDetection(const uchar* encoded, size_t length, const string& fileName, double& scale);
+
+		/// Constructor wrapping uncompressed pixels owned by the caller, which must outlive the object
+		/// @param pixels The first pixel, shared rather than copied.
+		/// @param size Image size.
+		/// @param type Pixel type, 8-bit with 1, 3 or 4 channels.
+		/// @param step Bytes per row, 0 for tightly packed rows.
+		/// @param order Sample order of color pixels.
+		/// @param fileName The name identifying the image.
+		/// @param scale The scale factor for resizing the image.
+		LineDetection(void* pixels, Size size, int type, size_t step, ChannelOrder order, const string& fileName, double& scale);
+
+		/// Constructor mapping a raw pixel file without decoding or copying it
+		/// @param filePath The raw file.
+		/// @param layout Where and how the pixels are stored in the file.
+		/// @param fileName The name identifying the image.
+		/// @param scale The scale factor for resizing the image.
+		LineDetection(const string& filePath, const RawImageLayout& layout, const string& fileName, double& scale);
+
 		/// Destructor for LineDetection
 		~LineDetection();
 
 		/// Detect lines and edges in the image
-		/// Uses the Canny edge detection algorithm and Hough Line Transform.
+		/// Uses the selected line engine, Canny edge detection and the Hough Line Transform by default.
 		void detectFeatures(void) override;
 
+		/// Find line segments in a grayscale image with the given engine
+		/// @param gray Single channel 8-bit image.
+		/// @param engine The line engine.
+		/// @param cannyLowThreshold Canny low threshold, the high one is three times larger; Hough only.
+		/// @param votes HoughLinesP accumulator threshold; Hough only.
+		/// @param minLength Shortest segment reported.
+		/// @param maxGap Largest gap HoughLinesP bridges within a segment; Hough only.
+		/// @param lines Output segments.
+		static void findSegments(const Mat& gray, LineEngine engine, int cannyLowThreshold, int votes, int minLength, int maxGap, vector<Vec4i>& lines);
+
+		/// Get the line engine
+		/// @return The engine used by detectFeatures.
+		LineEngine getLineEngine(void) const;
+
+		/// Select the line engine
+		/// @param engine The engine used by detectFeatures.
+		void setLineEngine(LineEngine engine);
+
+		/// Enable or disable merging of collinear fragments and near-duplicate segments
+		/// When enabled, detectFeatures passes the raw segments through SegmentMerger.
+		/// @param enabled True to merge the detected segments.
+		/// @param tolerances The match tolerances.
+		void setSegmentMerging(bool enabled, const MergeTolerances& tolerances = MergeTolerances());
+
+		/// Check whether detected segments are merged
+		/// @return True if merging is enabled.
+		bool isSegmentMerging(void) const;
+
+		/// Detect line segments coarse-to-fine
+		/// Segments found on the pyramid level are refitted to the full resolution edges of a
+		/// narrow corridor around each of them.
+		/// @param gray Single channel full resolution image.
+		/// @param lines Output segments in full resolution coordinates.
+		void detectLinesPyramid(const Mat& gray, vector<Vec4i>& lines) const;
+
+		/// Detect line segments inside regions of an image
+		/// Every region is searched with its margin and keeps the segments whose midpoint it holds.
+		/// @param gray Single channel image.
+		/// @param regions The regions to search, may overlap.
+		/// @param lines Output segments in image coordinates, each reported by the first region holding its midpoint.
+		void detectLinesInRegions(const Mat& gray, const vector<Rect>& regions, vector<Vec4i>& lines) const;
+
 
 		/// Process line detection with default settings
 		/// Applies grayscale conversion, detects features, saves features, and visualizes detected lines.
@@ -33,6 +114,15 @@ class LineDetection :  public Detection
 		/// @param filter If true, applies a noise reduction filter before detecting lines.
 		void processLineDetection(bool filter);
 
+	protected:
+		/// Record the Canny and Hough settings in a binary feature file header
+		/// @param header The header to complete.
+		void describeParameters(FeatureFileHeader& header) const override;
+
+		/// Get the margin the line engines read around a region
+		/// @return The gradient and edge thinning footprint, with slack for segments leaving the region.
+		int regionMargin(void) const override;
+
 	private:
 
 		/// Low threshold value for edge detection
@@ -41,8 +131,14 @@ class LineDetection :  public Detection
 		/// Maximum threshold value for edge detection
 		const int maxThresHold = 255;
 
-		/// Mat object to store detected edges
-		Mat detectedEdges;
+		/// Line segment implementation
+		LineEngine lineEngine;
+
+		/// True to merge collinear fragments after detection
+		bool mergeSegments;
+
+		/// Tolerances of the segment merge
+		MergeTolerances mergeTolerances;
 
 };
 
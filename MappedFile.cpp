@@ -0,0 +1,177 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Constructor for an unmapped MappedFile.
+ */
+MappedFile::MappedFile()
+    : mappedData(nullptr), mappedSize(0), opened(false), copyOnWrite(false),
+#ifdef _WIN32
+    fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#else
+    fileDescriptor(-1)
+#endif
+{
+}
+
+/**
+ * @brief Constructor mapping a file.
+ *
+ * @param filePath The file to map.
+ * @param writable True to allow writes into private copies of the pages.
+ */
+MappedFile::MappedFile(const string& filePath, bool writable)
+    : MappedFile() {
+    open(filePath, writable);
+}
+
+/**
+ * @brief Destructor, unmaps the file.
+ */
+MappedFile::~MappedFile() {
+    close();
+}
+
+/**
+ * @brief Maps a whole file, releasing any previous mapping.
+ *
+ * The file itself is always opened read-only. A copy-on-write mapping is private and
+ * writable; pages are shared with the page cache until they are written.
+ *
+ * @param filePath The file to map.
+ * @param writable True to allow writes into private copies of the pages.
+ */
+void MappedFile::open(const string& filePath, bool writable) {
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        throw runtime_error("Error: Could not open file: " + filePath);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        close();
+        throw runtime_error("Error: Could not read size of file: " + filePath);
+    }
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+    if (mappedSize > 0) {
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            close();
+            throw runtime_error("Error: Could not map file: " + filePath);
+        }
+        mappedData = static_cast<unsigned char*>(MapViewOfFile(mappingHandle, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+        if (mappedData == nullptr) {
+            close();
+            throw runtime_error("Error: Could not map file: " + filePath);
+        }
+    }
+#else
+    fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        throw runtime_error("Error: Could not open file: " + filePath);
+    }
+
+    struct stat status;
+    if (fstat(fileDescriptor, &status) != 0) {
+        close();
+        throw runtime_error("Error: Could not read size of file: " + filePath);
+    }
+    mappedSize = static_cast<size_t>(status.st_size);
+
+    if (mappedSize > 0) {
+        void* address = writable ? mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0)
+            : mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+        if (address == MAP_FAILED) {
+            close();
+            throw runtime_error("Error: Could not map file: " + filePath);
+        }
+        mappedData = static_cast<unsigned char*>(address);
+    }
+#endif
+
+    opened = true;
+    copyOnWrite = writable;
+}
+
+/**
+ * @brief Releases the mapping and the underlying file handle.
+ */
+void MappedFile::close(void) {
+#ifdef _WIN32
+    if (mappedData != nullptr) {
+        UnmapViewOfFile(mappedData);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mappedData != nullptr) {
+        munmap(mappedData, mappedSize);
+    }
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+
+    mappedData = nullptr;
+    mappedSize = 0;
+    opened = false;
+    copyOnWrite = false;
+}
+
+/**
+ * @brief Checks whether a file is mapped.
+ *
+ * @return True if a file is mapped.
+ */
+bool MappedFile::isOpen(void) const {
+    return opened;
+}
+
+/**
+ * @brief Gets the mapped bytes.
+ *
+ * @return Pointer to the first byte, nullptr for an empty or unmapped file.
+ */
+const unsigned char* MappedFile::data(void) const {
+    return mappedData;
+}
+
+/**
+ * @brief Gets the size of the mapping.
+ *
+ * @return The file size in bytes.
+ */
+size_t MappedFile::size(void) const {
+    return mappedSize;
+}
+
+/**
+ * @brief Checks whether the mapping may be written through.
+ *
+ * @return True for copy-on-write mappings.
+ */
+bool MappedFile::isCopyOnWrite(void) const {
+    return copyOnWrite;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/// MappedFile Class
+/// Read-only memory mapping of a whole file. The mapping lives as long as the object,
+/// so pointers returned by data() must not outlive it. A copy-on-write mapping may also be
+/// written through: written pages become private copies and the file never changes.
+class MappedFile
+{
+public:
+    /// Constructor for an unmapped object
+    MappedFile();
+
+    /// Constructor mapping a file
+    /// @param filePath The file to map.
+    /// @param writable True to allow writes into private copies of the pages.
+    explicit MappedFile(const string& filePath, bool writable = false);
+
+    /// Destructor, unmaps the file
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Map a file, releasing any previous mapping
+    /// @param filePath The file to map.
+    /// @param writable True to allow writes into private copies of the pages.
+    void open(const string& filePath, bool writable = false);
+
+    /// Release the mapping
+    void close(void);
+
+    /// Check whether a file is mapped
+    /// @return True if a file is mapped.
+    bool isOpen(void) const;
+
+    /// Get the mapped bytes
+    /// @return Pointer to the first byte, nullptr for an empty or unmapped file.
+    const unsigned char* data(void) const;
+
+    /// Get the size of the mapping
+    /// @return The file size in bytes.
+    size_t size(void) const;
+
+    /// Check whether the mapping may be written through
+    /// @return True for copy-on-write mappings.
+    bool isCopyOnWrite(void) const;
+
+private:
+    unsigned char* mappedData;      ///< Start of the mapping
+    size_t mappedSize;              ///< Size of the mapping in bytes
+    bool opened;                    ///< True while a file is mapped
+    bool copyOnWrite;               ///< True if pages are copied on their first write
+#ifdef _WIN32
+    void* fileHandle;               ///< Win32 file handle
+    void* mappingHandle;            ///< Win32 file mapping handle
+#else
+    int fileDescriptor;             ///< POSIX file descriptor
+#endif
+};
@@ -0,0 +1,172 @@
+#include "MappedImage.h"
+#include "Profiler.h"
+#include <cctype>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Constructor mapping a binary PNM file.
+ *
+ * @param filePath The P5 or P6 file with 8-bit samples.
+ */
+MappedImage::MappedImage(const string& filePath) {
+    if (!readPnmLayout(filePath, layout)) {
+        throw runtime_error("Error: Not a binary PNM file with 8-bit samples: " + filePath);
+    }
+    map(filePath);
+}
+
+/**
+ * @brief Constructor mapping a raw pixel file.
+ *
+ * @param filePath The file.
+ * @param layout Where and how the pixels are stored.
+ */
+MappedImage::MappedImage(const string& filePath, const RawImageLayout& layout)
+    : layout(layout) {
+    if (layout.size.width <= 0 || layout.size.height <= 0) {
+        throw invalid_argument("Raw image size must be positive");
+    }
+    if (layout.type != CV_8UC1 && layout.type != CV_8UC3 && layout.type != CV_8UC4) {
+        throw invalid_argument("Raw images must hold 8-bit samples with 1, 3 or 4 channels");
+    }
+    map(filePath);
+}
+
+/**
+ * @brief Maps the file and checks that it holds the whole layout.
+ *
+ * @param filePath The file to map.
+ */
+void MappedImage::map(const string& filePath) {
+    TRACE_STAGE("map");
+    const size_t rowBytes = static_cast<size_t>(layout.size.width) * CV_ELEM_SIZE(layout.type);
+    if (layout.step == 0) {
+        layout.step = rowBytes;
+    }
+    if (layout.step < rowBytes) {
+        throw invalid_argument("Raw image rows cannot be shorter than their pixels");
+    }
+
+    file.open(filePath, true);
+    if (file.size() < layout.offset + layout.step * (layout.size.height - 1) + rowBytes) {
+        file.close();
+        throw runtime_error("Error: Image file is truncated: " + filePath);
+    }
+}
+
+/**
+ * @brief Gets the image.
+ *
+ * @return A Mat header over the mapped pixels, in the sample order of getLayout().
+ */
+Mat MappedImage::getImage(void) const {
+    // The mapping is copy-on-write, writes through the header never reach the file
+    unsigned char* first = const_cast<unsigned char*>(file.data()) + layout.offset;
+    return Mat(layout.size, layout.type, first, layout.step);
+}
+
+/**
+ * @brief Gets the layout of the pixels.
+ *
+ * @return The layout, RGB order for P6 files.
+ */
+const RawImageLayout& MappedImage::getLayout(void) const {
+    return layout;
+}
+
+/**
+ * @brief Parses the header of a binary PNM file with 8-bit samples.
+ *
+ * The header is the magic number, width, height and maximum sample value separated by
+ * whitespace, where '#' starts a comment running to the end of the line, followed by a
+ * single whitespace byte before the first pixel.
+ *
+ * @param filePath The file to parse.
+ * @param layout Output pixel layout with tightly packed rows.
+ * @return False if the file is not a binary PNM file with 8-bit samples.
+ */
+bool MappedImage::readPnmLayout(const string& filePath, RawImageLayout& layout) {
+    ifstream file(filePath, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char magic[2] = {};
+    if (!file.read(magic, 2) || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')) {
+        return false;
+    }
+
+    long long fields[3] = {};
+    for (long long& field : fields) {
+        int c = file.get();
+        while (c != EOF && (isspace(c) || c == '#')) {
+            if (c == '#') {
+                while (c != EOF && c != '\n') {
+                    c = file.get();
+                }
+            }
+            c = file.get();
+        }
+        if (c == EOF || !isdigit(c)) {
+            return false;
+        }
+        while (c != EOF && isdigit(c)) {
+            field = field * 10 + (c - '0');
+            if (field > INT_MAX) {
+                return false;
+            }
+            c = file.get();
+        }
+        if (c == EOF || !isspace(c)) {
+            return false;
+        }
+    }
+
+    if (fields[0] <= 0 || fields[1] <= 0 || fields[2] <= 0 || fields[2] > 255) {
+        return false;
+    }
+
+    layout.size = Size(static_cast<int>(fields[0]), static_cast<int>(fields[1]));
+    layout.type = magic[1] == '5' ? CV_8UC1 : CV_8UC3;
+    layout.offset = static_cast<size_t>(file.tellg());
+    layout.step = 0;
+    layout.order = magic[1] == '6' ? ChannelOrder::RGB : ChannelOrder::BGR;
+    return true;
+}
+
+/**
+ * @brief Parses a raw layout written as "width,height,gray|bgr|rgb[,offset]".
+ *
+ * @param description The comma separated layout, e.g. "1920,1080,rgb" or "640,480,gray,512".
+ * @return The layout with tightly packed rows.
+ */
+RawImageLayout MappedImage::parseLayout(const string& description) {
+    stringstream values(description);
+    string width, height, samples, offset;
+    if (!getline(values, width, ',') || !getline(values, height, ',') || !getline(values, samples, ',')) {
+        throw invalid_argument("Raw layouts must be written as width,height,gray|bgr|rgb[,offset]: " + description);
+    }
+
+    RawImageLayout layout;
+    layout.size = Size(stoi(width), stoi(height));
+    if (samples == "gray") {
+        layout.type = CV_8UC1;
+    }
+    else if (samples == "bgr" || samples == "rgb") {
+        layout.type = CV_8UC3;
+        layout.order = samples == "rgb" ? ChannelOrder::RGB : ChannelOrder::BGR;
+    }
+    else {
+        throw invalid_argument("Unknown raw sample layout: " + samples);
+    }
+    if (getline(values, offset, ',')) {
+        layout.offset = static_cast<size_t>(stoull(offset));
+    }
+    if (layout.size.width <= 0 || layout.size.height <= 0) {
+        throw invalid_argument("Raw image size must be positive: " + description);
+    }
+    return layout;
+}
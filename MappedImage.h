@@ -0,0 +1,66 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <string>
+#include "MappedFile.h"
+#include "PreprocessingPipeline.h"
+
+using namespace std;
+using namespace cv;
+
+/// Layout of uncompressed 8-bit pixels inside a file
+struct RawImageLayout {
+    Size size;                              ///< Image size
+    int type = CV_8UC1;                     ///< Pixel type: CV_8UC1, CV_8UC3 or CV_8UC4
+    size_t offset = 0;                      ///< Byte offset of the first pixel
+    size_t step = 0;                        ///< Bytes per row, 0 for tightly packed rows
+    ChannelOrder order = ChannelOrder::BGR; ///< Sample order of color pixels
+};
+
+/// MappedImage Class
+/// Uncompressed image file mapped into memory and wrapped as a Mat without copying or
+/// decoding: binary PNM files (P5 gray, P6 RGB) with 8-bit samples, or raw pixel dumps of a
+/// given layout. The mapping is copy-on-write, so in-place processing of the Mat only copies
+/// the pages it writes and never changes the file. Mats returned by getImage must not
+/// outlive the object.
+class MappedImage
+{
+public:
+    /// Constructor mapping a binary PNM file
+    /// @param filePath The P5 or P6 file with 8-bit samples.
+    explicit MappedImage(const string& filePath);
+
+    /// Constructor mapping a raw pixel file
+    /// @param filePath The file.
+    /// @param layout Where and how the pixels are stored.
+    MappedImage(const string& filePath, const RawImageLayout& layout);
+
+    MappedImage(const MappedImage&) = delete;
+    MappedImage& operator=(const MappedImage&) = delete;
+
+    /// Get the image
+    /// @return A Mat header over the mapped pixels, in the sample order of getLayout().
+    Mat getImage(void) const;
+
+    /// Get the layout of the pixels
+    /// @return The layout, RGB order for P6 files.
+    const RawImageLayout& getLayout(void) const;
+
+    /// Parse the header of a binary PNM file with 8-bit samples
+    /// @param filePath The file to parse.
+    /// @param layout Output pixel layout.
+    /// @return False if the file is not a binary PNM file with 8-bit samples.
+    static bool readPnmLayout(const string& filePath, RawImageLayout& layout);
+
+    /// Parse a raw layout written as "width,height,gray|bgr|rgb[,offset]"
+    /// @param description The comma separated layout, e.g. "1920,1080,rgb".
+    /// @return The layout with tightly packed rows.
+    static RawImageLayout parseLayout(const string& description);
+
+private:
+    /// Map the file and check that it holds the whole layout
+    /// @param filePath The file to map.
+    void map(const string& filePath);
+
+    MappedFile file;                        ///< Copy-on-write mapping of the whole file
+    RawImageLayout layout;                  ///< Layout of the pixels
+};
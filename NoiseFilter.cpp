@@ -0,0 +1,683 @@
+#include "NoiseFilter.h"
+#include "BufferPool.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+    const int histogramStripe = 1024;       // output columns sharing one set of column histograms
+    const int networkChunk = 256;           // columns run through the sorting network at once
+
+    /// One compare-exchange of a selection network; i receives the minimum, j the maximum
+    struct SelectionOp {
+        int i;
+        int j;
+        bool keepMin;                       // the minimum is read later
+        bool keepMax;                       // the maximum is read later
+    };
+
+    /// Build the merge-exchange sorting network of n inputs (Knuth, Algorithm 5.2.2M) and
+    /// keep only the exchanges the middle output depends on
+    vector<SelectionOp> buildSelectionNetwork(int n) {
+        vector<pair<int, int>> exchanges;
+        int t = 0;
+        while ((1 << t) < n) {
+            t++;
+        }
+        for (int p = 1 << (t - 1); p > 0; p >>= 1) {
+            int q = 1 << (t - 1), r = 0, d = p;
+            while (true) {
+                for (int i = 0; i < n - d; i++) {
+                    if ((i & p) == r) {
+                        exchanges.push_back(make_pair(i, i + d));
+                    }
+                }
+                if (q == p) {
+                    break;
+                }
+                d = q - p;
+                q >>= 1;
+                r = p;
+            }
+        }
+
+        vector<char> needed(n, 0);
+        needed[n / 2] = 1;
+        vector<SelectionOp> ops;
+        for (auto it = exchanges.rbegin(); it != exchanges.rend(); ++it) {
+            const bool keepMin = needed[it->first] != 0;
+            const bool keepMax = needed[it->second] != 0;
+            if (keepMin || keepMax) {
+                ops.push_back({ it->first, it->second, keepMin, keepMax });
+                needed[it->first] = needed[it->second] = 1;
+            }
+        }
+        reverse(ops.begin(), ops.end());
+        return ops;
+    }
+
+    /// Get the pruned network of a 3x3 or 5x5 window, built once
+    const vector<SelectionOp>& networkFor(int kernelSize) {
+        static const vector<SelectionOp> network3 = buildSelectionNetwork(9);
+        static const vector<SelectionOp> network5 = buildSelectionNetwork(25);
+        return kernelSize == 3 ? network3 : network5;
+    }
+
+    /// Split rows into bands for parallel_for_, each at least minRows high
+    int bandCount(int rows, int minRows) {
+        return max(1, min(getNumThreads() * 2, rows / max(minRows, 1)));
+    }
+
+    /// Run a band kernel over all rows in parallel
+    template<typename Kernel>
+    void forEachBand(int rows, int minRows, const Kernel& kernel) {
+        const int bands = bandCount(rows, minRows);
+        parallel_for_(Range(0, bands), [&](const Range& range) {
+            for (int band = range.start; band < range.end; band++) {
+                kernel(rows * band / bands, rows * (band + 1) / bands);
+            }
+        });
+    }
+
+    /// Element-wise compare-exchange of two rows of bytes
+    void exchange(uchar* a, uchar* b, int length, bool keepMin, bool keepMax) {
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = VTraits<v_uint8>::vlanes();
+        for (; x <= length - lanes; x += lanes) {
+            v_uint8 va = vx_load(a + x);
+            v_uint8 vb = vx_load(b + x);
+            if (keepMin) {
+                v_store(a + x, v_min(va, vb));
+            }
+            if (keepMax) {
+                v_store(b + x, v_max(va, vb));
+            }
+        }
+#endif
+        for (; x < length; x++) {
+            const uchar lo = min(a[x], b[x]);
+            const uchar hi = max(a[x], b[x]);
+            if (keepMin) {
+                a[x] = lo;
+            }
+            if (keepMax) {
+                b[x] = hi;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Median filter with replicated borders.
+ *
+ * @param source The input image.
+ * @param target Output image of the input size and type, may be the input itself.
+ * @param kernelSize Odd aperture size, at least 3.
+ * @param backend The implementation.
+ */
+void NoiseFilter::median(const Mat& source, Mat& target, int kernelSize, FilterBackend backend) {
+    if (source.empty()) {
+        throw runtime_error("image file is empty filter operation cannot be applied!");
+    }
+    if (kernelSize < 3 || kernelSize % 2 == 0) {
+        throw invalid_argument("Median kernel size must be odd and at least 3");
+    }
+    if (!supportsMedian(backend, kernelSize)) {
+        throw invalid_argument("The " + backendName(backend) + " backend cannot run a median of size " + to_string(kernelSize));
+    }
+
+    if (source.type() != CV_8UC1) {
+        backend = FilterBackend::OpenCV;
+    }
+    else if (backend == FilterBackend::Auto) {
+        backend = selectMedian(kernelSize);
+    }
+
+    // The band kernels read rows other bands write, so they never work in place
+    const Mat input = source.data == target.data ? source.clone() : source;
+    target.create(input.size(), input.type());
+
+    switch (backend) {
+    case FilterBackend::Histogram:
+        medianHistogram(input, target, kernelSize);
+        break;
+    case FilterBackend::Small:
+        medianNetwork(input, target, kernelSize);
+        break;
+    default:
+        medianOpenCV(input, target, kernelSize);
+        break;
+    }
+}
+
+/**
+ * @brief Gaussian filter with reflected borders.
+ *
+ * @param source The input image.
+ * @param target Output image of the input size and type, may be the input itself.
+ * @param kernelSize Odd aperture size.
+ * @param backend The implementation.
+ */
+void NoiseFilter::gaussian(const Mat& source, Mat& target, int kernelSize, FilterBackend backend) {
+    if (source.empty()) {
+        throw runtime_error("image file is empty filter operation cannot be applied!");
+    }
+    if (kernelSize < 1 || kernelSize % 2 == 0) {
+        throw invalid_argument("Gaussian kernel size must be odd and positive");
+    }
+    if (!supportsGaussian(backend, kernelSize)) {
+        throw invalid_argument("The " + backendName(backend) + " backend cannot run a Gaussian of size " + to_string(kernelSize));
+    }
+
+    if (source.type() != CV_8UC1) {
+        backend = FilterBackend::OpenCV;
+    }
+    else if (backend == FilterBackend::Auto) {
+        backend = selectGaussian(kernelSize);
+    }
+
+    if (backend == FilterBackend::OpenCV) {
+        // GaussianBlur is parallel on its own
+        GaussianBlur(source, target, Size(kernelSize, kernelSize), 0);
+        return;
+    }
+
+    const Mat input = source.data == target.data ? source.clone() : source;
+    target.create(input.size(), input.type());
+    if (backend == FilterBackend::Small) {
+        gaussianBinomial(input, target, kernelSize);
+    }
+    else {
+        gaussianRecursive(input, target, kernelSize);
+    }
+}
+
+/**
+ * @brief Checks whether an implementation can run a median of the given size.
+ *
+ * @param backend The implementation.
+ * @param kernelSize The aperture size.
+ * @return True if the combination is supported.
+ */
+bool NoiseFilter::supportsMedian(FilterBackend backend, int kernelSize) {
+    switch (backend) {
+    case FilterBackend::Auto:
+    case FilterBackend::OpenCV:
+        return true;
+    case FilterBackend::Histogram:
+        return kernelSize <= 255;           // window counts must fit the 16-bit bins
+    case FilterBackend::Small:
+        return kernelSize == 3 || kernelSize == 5;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Checks whether an implementation can run a Gaussian of the given size.
+ *
+ * @param backend The implementation.
+ * @param kernelSize The aperture size.
+ * @return True if the combination is supported.
+ */
+bool NoiseFilter::supportsGaussian(FilterBackend backend, int kernelSize) {
+    switch (backend) {
+    case FilterBackend::Auto:
+    case FilterBackend::OpenCV:
+        return true;
+    case FilterBackend::Recursive:
+        return kernelSize >= 3;
+    case FilterBackend::Small:
+        return kernelSize == 3 || kernelSize == 5;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Gets the implementation Auto runs for a median.
+ *
+ * @param kernelSize The aperture size.
+ * @return The fastest bit-exact implementation.
+ */
+FilterBackend NoiseFilter::selectMedian(int kernelSize) {
+    return calibrate(true, kernelSize);
+}
+
+/**
+ * @brief Gets the implementation Auto runs for a Gaussian.
+ *
+ * @param kernelSize The aperture size.
+ * @return The fastest bit-exact implementation.
+ */
+FilterBackend NoiseFilter::selectGaussian(int kernelSize) {
+    return calibrate(false, kernelSize);
+}
+
+/**
+ * @brief Gets the sigma OpenCV derives from a Gaussian kernel size.
+ *
+ * @param kernelSize The aperture size.
+ * @return The standard deviation used by GaussianBlur with sigma 0.
+ */
+double NoiseFilter::sigmaFor(int kernelSize) {
+    return 0.3 * ((kernelSize - 1) * 0.5 - 1) + 0.8;
+}
+
+/**
+ * @brief Gets the name of an implementation.
+ *
+ * @param backend The implementation.
+ * @return The name accepted by parseBackend.
+ */
+string NoiseFilter::backendName(FilterBackend backend) {
+    switch (backend) {
+    case FilterBackend::Auto: return "auto";
+    case FilterBackend::OpenCV: return "opencv";
+    case FilterBackend::Histogram: return "histogram";
+    case FilterBackend::Recursive: return "recursive";
+    case FilterBackend::Small: return "small";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Parses the name of an implementation.
+ *
+ * @param name auto, opencv, histogram, recursive or small.
+ * @return The implementation.
+ */
+FilterBackend NoiseFilter::parseBackend(const string& name) {
+    if (name == "auto") return FilterBackend::Auto;
+    if (name == "opencv") return FilterBackend::OpenCV;
+    if (name == "histogram") return FilterBackend::Histogram;
+    if (name == "recursive") return FilterBackend::Recursive;
+    if (name == "small") return FilterBackend::Small;
+    throw invalid_argument("Unknown filter backend: " + name);
+}
+
+/**
+ * @brief Median through medianBlur, one call per row band.
+ *
+ * Every band is filtered together with kernelSize / 2 margin rows on each side, so its rows
+ * see the same window as in a single call. OpenCV's large-kernel median is serial, which
+ * makes this the parallel reference implementation.
+ */
+void NoiseFilter::medianOpenCV(const Mat& source, Mat& target, int kernelSize) {
+    const int radius = kernelSize / 2;
+    forEachBand(source.rows, 4 * kernelSize, [&](int y0, int y1) {
+        const int lo = max(0, y0 - radius);
+        const int hi = min(source.rows, y1 + radius);
+        PooledMat part(hi - lo, source.cols, source.type());
+        medianBlur(source.rowRange(lo, hi), part.get(), kernelSize);
+        Mat rows = target.rowRange(y0, y1);
+        part.get().rowRange(y0 - lo, y1 - lo).copyTo(rows);
+    });
+}
+
+/**
+ * @brief Constant-time histogram median of an 8-bit single channel image.
+ *
+ * Each band walks down its rows in stripes of output columns. Every column of the stripe and
+ * its margin keeps a histogram of the kernelSize pixels above and below the current row,
+ * updated with one removal and one insertion per row. Along the row the window histogram
+ * slides by adding the entering and subtracting the leaving column, on 16 coarse bins only;
+ * the 16 fine bins of a coarse bin are brought up to date when the median falls into it,
+ * incrementally from the column they were last valid at, or from scratch after a long jump.
+ */
+void NoiseFilter::medianHistogram(const Mat& source, Mat& target, int kernelSize) {
+    const int radius = kernelSize / 2;
+    const int rows = source.rows;
+    const int cols = source.cols;
+    const int rank = kernelSize * kernelSize / 2;
+
+    forEachBand(rows, 4 * kernelSize, [&](int y0, int y1) {
+        PooledVector<uint16_t> coarseBuffer, fineBuffer;
+        vector<uint16_t>& coarse = coarseBuffer.get();
+        vector<uint16_t>& fine = fineBuffer.get();
+
+        for (int x0 = 0; x0 < cols; x0 += histogramStripe) {
+            const int x1 = min(cols, x0 + histogramStripe);
+            const int columns = x1 - x0 + 2 * radius;     // histogram j holds image column x0 - radius + j
+            coarse.assign(static_cast<size_t>(columns) * 16, 0);
+            fine.assign(static_cast<size_t>(columns) * 256, 0);
+
+            auto updateRow = [&](int y, int delta) {
+                const uchar* row = source.ptr<uchar>(min(max(y, 0), rows - 1));
+                for (int j = 0; j < columns; j++) {
+                    const uchar value = row[min(max(x0 - radius + j, 0), cols - 1)];
+                    coarse[j * 16 + (value >> 4)] += static_cast<uint16_t>(delta);
+                    fine[j * 256 + value] += static_cast<uint16_t>(delta);
+                }
+            };
+
+            for (int y = y0 - radius; y <= y0 + radius; y++) {
+                updateRow(y, 1);
+            }
+
+            for (int y = y0; y < y1; y++) {
+                if (y > y0) {
+                    updateRow(y - radius - 1, -1);
+                    updateRow(y + radius, 1);
+                }
+
+                // Window histogram of the first output column
+                int windowCoarse[16] = {};
+                uint16_t windowFine[256];
+                int fineColumn[16];
+                for (int j = 0; j <= 2 * radius; j++) {
+                    for (int b = 0; b < 16; b++) {
+                        windowCoarse[b] += coarse[j * 16 + b];
+                    }
+                }
+                fill(fineColumn, fineColumn + 16, -kernelSize - 1);
+
+                uchar* out = target.ptr<uchar>(y);
+                for (int x = 0; x < x1 - x0; x++) {
+                    if (x > 0) {
+                        const uint16_t* entering = &coarse[(x + 2 * radius) * 16];
+                        const uint16_t* leaving = &coarse[(x - 1) * 16];
+                        for (int b = 0; b < 16; b++) {
+                            windowCoarse[b] += entering[b] - leaving[b];
+                        }
+                    }
+
+                    int below = 0;
+                    int bin = 0;
+                    while (below + windowCoarse[bin] <= rank) {
+                        below += windowCoarse[bin];
+                        bin++;
+                    }
+
+                    uint16_t* segment = windowFine + bin * 16;
+                    if (x - fineColumn[bin] > 2 * radius) {
+                        fill(segment, segment + 16, static_cast<uint16_t>(0));
+                        for (int j = x; j <= x + 2 * radius; j++) {
+                            const uint16_t* column = &fine[j * 256 + bin * 16];
+                            for (int i = 0; i < 16; i++) {
+                                segment[i] += column[i];
+                            }
+                        }
+                    }
+                    else {
+                        for (int step = fineColumn[bin] + 1; step <= x; step++) {
+                            const uint16_t* entering = &fine[(step + 2 * radius) * 256 + bin * 16];
+                            const uint16_t* leaving = &fine[(step - 1) * 256 + bin * 16];
+                            for (int i = 0; i < 16; i++) {
+                                segment[i] += entering[i] - leaving[i];
+                            }
+                        }
+                    }
+                    fineColumn[bin] = x;
+
+                    int value = 0;
+                    while (below + segment[value] <= rank) {
+                        below += segment[value];
+                        value++;
+                    }
+                    out[x0 + x] = static_cast<uchar>(bin * 16 + value);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Sorting network median of a 3x3 or 5x5 window of an 8-bit single channel image.
+ *
+ * For every output row the window rows are padded by replication and the kernelSize^2
+ * shifted copies of a chunk of columns are pushed through the pruned selection network
+ * together, so every compare-exchange is a vector min/max over the whole chunk.
+ */
+void NoiseFilter::medianNetwork(const Mat& source, Mat& target, int kernelSize) {
+    const int radius = kernelSize / 2;
+    const int rows = source.rows;
+    const int cols = source.cols;
+    const int inputs = kernelSize * kernelSize;
+    const vector<SelectionOp>& network = networkFor(kernelSize);
+
+    forEachBand(rows, 16, [&](int y0, int y1) {
+        PooledVector<uchar> paddedBuffer, workBuffer;
+        vector<uchar>& padded = paddedBuffer.get();
+        vector<uchar>& work = workBuffer.get();
+        padded.resize(static_cast<size_t>(kernelSize) * (cols + 2 * radius));
+        work.resize(static_cast<size_t>(inputs) * networkChunk);
+
+        for (int y = y0; y < y1; y++) {
+            for (int dy = 0; dy < kernelSize; dy++) {
+                const uchar* row = source.ptr<uchar>(min(max(y + dy - radius, 0), rows - 1));
+                uchar* line = &padded[dy * (cols + 2 * radius)];
+                memcpy(line + radius, row, cols);
+                for (int i = 0; i < radius; i++) {
+                    line[i] = row[0];
+                    line[radius + cols + i] = row[cols - 1];
+                }
+            }
+
+            uchar* out = target.ptr<uchar>(y);
+            for (int x0 = 0; x0 < cols; x0 += networkChunk) {
+                const int length = min(networkChunk, cols - x0);
+                for (int dy = 0; dy < kernelSize; dy++) {
+                    for (int dx = 0; dx < kernelSize; dx++) {
+                        memcpy(&work[(dy * kernelSize + dx) * networkChunk], &padded[dy * (cols + 2 * radius) + x0 + dx], length);
+                    }
+                }
+                for (const auto& op : network) {
+                    exchange(&work[op.i * networkChunk], &work[op.j * networkChunk], length, op.keepMin, op.keepMax);
+                }
+                memcpy(out + x0, &work[(inputs / 2) * networkChunk], length);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Integer binomial Gaussian of a 3x3 or 5x5 window of an 8-bit single channel image.
+ *
+ * With sigma 0, OpenCV's 3 and 5 tap kernels are [1 2 1] / 4 and [1 4 6 4 1] / 16, so the
+ * filtered pixel is the integer weighted sum divided by 16 or 256 with rounding; the sums
+ * fit in 16 bits. Borders are reflected without repeating the edge pixel, as GaussianBlur.
+ */
+void NoiseFilter::gaussianBinomial(const Mat& source, Mat& target, int kernelSize) {
+    static const uint16_t weights3[] = { 1, 2, 1 };
+    static const uint16_t weights5[] = { 1, 4, 6, 4, 1 };
+    const uint16_t* weights = kernelSize == 3 ? weights3 : weights5;
+    const int radius = kernelSize / 2;
+    const int shift = kernelSize == 3 ? 4 : 8;
+    const uint32_t half = 1u << (shift - 1);
+    const int rows = source.rows;
+    const int cols = source.cols;
+
+    forEachBand(rows, 16, [&](int y0, int y1) {
+        PooledVector<uint16_t> sumBuffer;
+        vector<uint16_t>& sums = sumBuffer.get();
+        sums.resize(cols + 2 * radius);
+        uint16_t* column = sums.data() + radius;
+
+        for (int y = y0; y < y1; y++) {
+            // Vertical pass into the padded row of column sums
+            fill(column, column + cols, static_cast<uint16_t>(0));
+            for (int dy = 0; dy < kernelSize; dy++) {
+                const uchar* row = source.ptr<uchar>(borderInterpolate(y + dy - radius, rows, BORDER_REFLECT_101));
+                const uint16_t weight = weights[dy];
+                for (int x = 0; x < cols; x++) {
+                    column[x] = static_cast<uint16_t>(column[x] + weight * row[x]);
+                }
+            }
+            for (int i = 1; i <= radius; i++) {
+                column[-i] = column[borderInterpolate(-i, cols, BORDER_REFLECT_101)];
+                column[cols - 1 + i] = column[borderInterpolate(cols - 1 + i, cols, BORDER_REFLECT_101)];
+            }
+
+            // Horizontal pass and rounding
+            uchar* out = target.ptr<uchar>(y);
+            if (kernelSize == 3) {
+                for (int x = 0; x < cols; x++) {
+                    out[x] = static_cast<uchar>((column[x - 1] + 2u * column[x] + column[x + 1] + half) >> shift);
+                }
+            }
+            else {
+                for (int x = 0; x < cols; x++) {
+                    out[x] = static_cast<uchar>((column[x - 2] + 4u * column[x - 1] + 6u * column[x] + 4u * column[x + 1] + column[x + 2] + half) >> shift);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Recursive Gaussian of an 8-bit single channel image.
+ *
+ * Young and van Vliet's third order filter runs causally and anti-causally along every row,
+ * then along every column; the recursion starts from the edge value, i.e. replicated
+ * borders. Rows are split into bands, the column pass into strips of columns that walk
+ * down the image together, so both passes are parallel and read memory sequentially.
+ */
+void NoiseFilter::gaussianRecursive(const Mat& source, Mat& target, int kernelSize) {
+    const double sigma = sigmaFor(kernelSize);
+    const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+    const float a1 = static_cast<float>((2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0);
+    const float a2 = static_cast<float>(-(1.4281 * q * q + 1.26661 * q * q * q) / b0);
+    const float a3 = static_cast<float>(0.422205 * q * q * q / b0);
+    const float gain = 1.0f - (a1 + a2 + a3);
+    const int rows = source.rows;
+    const int cols = source.cols;
+
+    PooledMat bufferHolder(rows, cols, CV_32F);
+    Mat& buffer = bufferHolder.get();
+
+    // Row pass
+    forEachBand(rows, 16, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const uchar* in = source.ptr<uchar>(y);
+            float* line = buffer.ptr<float>(y);
+            float p1 = in[0], p2 = in[0], p3 = in[0];
+            for (int x = 0; x < cols; x++) {
+                const float value = gain * in[x] + a1 * p1 + a2 * p2 + a3 * p3;
+                line[x] = value;
+                p3 = p2;
+                p2 = p1;
+                p1 = value;
+            }
+            p1 = p2 = p3 = line[cols - 1];
+            for (int x = cols - 1; x >= 0; x--) {
+                const float value = gain * line[x] + a1 * p1 + a2 * p2 + a3 * p3;
+                line[x] = value;
+                p3 = p2;
+                p2 = p1;
+                p1 = value;
+            }
+        }
+    });
+
+    // Column pass, strips of columns carrying their recursion state down the image
+    const int strip = 64;
+    const int strips = (cols + strip - 1) / strip;
+    parallel_for_(Range(0, strips), [&](const Range& range) {
+        float p1[strip], p2[strip], p3[strip];
+        for (int s = range.start; s < range.end; s++) {
+            const int x0 = s * strip;
+            const int width = min(strip, cols - x0);
+
+            const float* first = buffer.ptr<float>(0) + x0;
+            for (int i = 0; i < width; i++) {
+                p1[i] = p2[i] = p3[i] = first[i];
+            }
+            for (int y = 0; y < rows; y++) {
+                float* line = buffer.ptr<float>(y) + x0;
+                for (int i = 0; i < width; i++) {
+                    const float value = gain * line[i] + a1 * p1[i] + a2 * p2[i] + a3 * p3[i];
+                    line[i] = value;
+                    p3[i] = p2[i];
+                    p2[i] = p1[i];
+                    p1[i] = value;
+                }
+            }
+
+            const float* last = buffer.ptr<float>(rows - 1) + x0;
+            for (int i = 0; i < width; i++) {
+                p1[i] = p2[i] = p3[i] = last[i];
+            }
+            for (int y = rows - 1; y >= 0; y--) {
+                const float* line = buffer.ptr<float>(y) + x0;
+                uchar* out = target.ptr<uchar>(y) + x0;
+                for (int i = 0; i < width; i++) {
+                    const float value = gain * line[i] + a1 * p1[i] + a2 * p2[i] + a3 * p3[i];
+                    out[i] = saturate_cast<uchar>(value);
+                    p3[i] = p2[i];
+                    p2[i] = p1[i];
+                    p1[i] = value;
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Times the bit-exact candidates of a filter once and caches the fastest.
+ *
+ * Candidates run on a 512 x 512 noise image, the best of three calls counts. The cache is
+ * shared by all threads; the first caller of a kernel size measures while the others wait.
+ *
+ * @param median True for the median, false for the Gaussian.
+ * @param kernelSize The aperture size.
+ * @return The fastest implementation.
+ */
+FilterBackend NoiseFilter::calibrate(bool median, int kernelSize) {
+    static mutex cacheMutex;
+    static map<pair<bool, int>, FilterBackend> chosen;
+    lock_guard<mutex> lock(cacheMutex);
+
+    const pair<bool, int> key(median, kernelSize);
+    auto known = chosen.find(key);
+    if (known != chosen.end()) {
+        return known->second;
+    }
+
+    vector<FilterBackend> candidates = { FilterBackend::OpenCV };
+    if (median && supportsMedian(FilterBackend::Histogram, kernelSize)) {
+        candidates.push_back(FilterBackend::Histogram);
+    }
+    if (median ? supportsMedian(FilterBackend::Small, kernelSize) : supportsGaussian(FilterBackend::Small, kernelSize)) {
+        candidates.push_back(FilterBackend::Small);
+    }
+
+    FilterBackend best = FilterBackend::OpenCV;
+    if (candidates.size() > 1) {
+        Mat sample(512, 512, CV_8UC1);
+        RNG(42).fill(sample, RNG::UNIFORM, 0, 256);
+        Mat filtered;
+
+        int64 fastest = 0;
+        for (FilterBackend candidate : candidates) {
+            int64 shortest = 0;
+            for (int run = 0; run < 4; run++) {
+                int64 start = getTickCount();
+                if (median) {
+                    NoiseFilter::median(sample, filtered, kernelSize, candidate);
+                }
+                else {
+                    gaussian(sample, filtered, kernelSize, candidate);
+                }
+                int64 elapsed = getTickCount() - start;
+                if (run > 0 && (shortest == 0 || elapsed < shortest)) {
+                    shortest = elapsed;     // the first call only warms up
+                }
+            }
+            if (fastest == 0 || shortest < fastest) {
+                fastest = shortest;
+                best = candidate;
+            }
+        }
+    }
+
+    chosen[key] = best;
+    return best;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <string>
+
+using namespace std;
+using namespace cv;
+
+/// Noise filter implementations
+/// Auto picks the fastest bit-exact implementation for the kernel size, OpenCV calls
+/// medianBlur / GaussianBlur, Histogram is the constant-time median, Recursive is the IIR
+/// Gaussian whose cost does not grow with the kernel, and Small is the 3x3 / 5x5 sorting
+/// network median and integer binomial Gaussian.
+enum class FilterBackend { Auto, OpenCV, Histogram, Recursive, Small };
+
+/// NoiseFilter Class
+/// Median and Gaussian filters with selectable implementations, all running in parallel over
+/// row bands. The hand-written backends handle 8-bit single channel images, the ones the
+/// detectors filter; other images always go through OpenCV.
+/// - Histogram: the Perreault-Hebert median with per-column coarse (16 bin) and fine (256
+///   bin) histograms; fine bins are only brought up to date for the coarse bin holding the
+///   median, so the cost per pixel is independent of the kernel size. Matches medianBlur.
+/// - Small: medians of 3x3 and 5x5 windows through a pruned merge-exchange sorting network
+///   applied to whole row chunks with SIMD min/max, and binomial [1 2 1] / [1 4 6 4 1]
+///   Gaussians in integer arithmetic. Both match the OpenCV results bit for bit.
+/// - Recursive: the Young - van Vliet third order recursive Gaussian for the sigma OpenCV
+///   derives from the kernel size. It approximates the kernel, so it is never chosen by Auto.
+/// Auto times the bit-exact candidates for a kernel size once per process on a reference
+/// image and keeps the winner, so the choice follows the machine but never the results.
+class NoiseFilter
+{
+public:
+    /// Median filter with replicated borders, as medianBlur
+    /// @param source The input image.
+    /// @param target Output image of the input size and type, may be the input itself.
+    /// @param kernelSize Odd aperture size, at least 3.
+    /// @param backend The implementation.
+    static void median(const Mat& source, Mat& target, int kernelSize, FilterBackend backend = FilterBackend::Auto);
+
+    /// Gaussian filter with reflected borders, as GaussianBlur with the sigma derived from the kernel size
+    /// @param source The input image.
+    /// @param target Output image of the input size and type, may be the input itself.
+    /// @param kernelSize Odd aperture size.
+    /// @param backend The implementation.
+    static void gaussian(const Mat& source, Mat& target, int kernelSize, FilterBackend backend = FilterBackend::Auto);
+
+    /// Check whether an implementation can run a median of the given size
+    /// @param backend The implementation.
+    /// @param kernelSize The aperture size.
+    /// @return True if the combination is supported.
+    static bool supportsMedian(FilterBackend backend, int kernelSize);
+
+    /// Check whether an implementation can run a Gaussian of the given size
+    /// @param backend The implementation.
+    /// @param kernelSize The aperture size.
+    /// @return True if the combination is supported.
+    static bool supportsGaussian(FilterBackend backend, int kernelSize);
+
+    /// Get the implementation Auto runs for a median
+    /// Measured on first use for every kernel size and cached.
+    /// @param kernelSize The aperture size.
+    /// @return The fastest bit-exact implementation.
+    static FilterBackend selectMedian(int kernelSize);
+
+    /// Get the implementation Auto runs for a Gaussian
+    /// Measured on first use for every kernel size and cached.
+    /// @param kernelSize The aperture size.
+    /// @return The fastest bit-exact implementation.
+    static FilterBackend selectGaussian(int kernelSize);
+
+    /// Get the sigma OpenCV derives from a Gaussian kernel size
+    /// @param kernelSize The aperture size.
+    /// @return 0.3 * ((kernelSize - 1) * 0.5 - 1) + 0.8.
+    static double sigmaFor(int kernelSize);
+
+    /// Get the name of an implementation
+    /// @param backend The implementation.
+    /// @return The name accepted by parseBackend.
+    static string backendName(FilterBackend backend);
+
+    /// Parse the name of an implementation
+    /// @param name auto, opencv, histogram, recursive or small.
+    /// @return The implementation.
+    static FilterBackend parseBackend(const string& name);
+
+private:
+    /// Median through medianBlur, one call per row band with its margin rows
+    static void medianOpenCV(const Mat& source, Mat& target, int kernelSize);
+
+    /// Constant-time histogram median
+    static void medianHistogram(const Mat& source, Mat& target, int kernelSize);
+
+    /// Sorting network median of a 3x3 or 5x5 window
+    static void medianNetwork(const Mat& source, Mat& target, int kernelSize);
+
+    /// Integer binomial Gaussian of a 3x3 or 5x5 window
+    static void gaussianBinomial(const Mat& source, Mat& target, int kernelSize);
+
+    /// Recursive Gaussian
+    static void gaussianRecursive(const Mat& source, Mat& target, int kernelSize);
+
+    /// Time the bit-exact candidates of a filter once and cache the fastest
+    /// @param median True for the median, false for the Gaussian.
+    /// @param kernelSize The aperture size.
+    /// @return The fastest implementation.
+    static FilterBackend calibrate(bool median, int kernelSize);
+};
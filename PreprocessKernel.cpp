@@ -0,0 +1,270 @@
+#include "PreprocessKernel.h"
+#include "BufferPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+    const int grayShift = 15;               // cvtColor's 8-bit gray weights: 0.299, 0.587 and 0.114 scaled by 2^15
+    const int grayRed = 9798;
+    const int grayGreen = 19235;
+    const int grayBlue = 3735;
+    const int resizeBits = 11;              // INTER_RESIZE_COEF_BITS of resize's 8-bit linear path
+    const int minBandRows = 16;
+
+    /// Convert one row of color pixels to gray
+    void grayRow(const uchar* in, int cols, int channels, int blue, int red, uchar* out) {
+        const int half = 1 << (grayShift - 1);
+        for (int x = 0; x < cols; x++, in += channels) {
+            out[x] = static_cast<uchar>((in[blue] * grayBlue + in[1] * grayGreen + in[red] * grayRed + half) >> grayShift);
+        }
+    }
+}
+
+/**
+ * @brief Converts a color image to gray, rescales and blurs it in one pass.
+ *
+ * The output rows are split into bands run in parallel. A band recomputes the few rescaled
+ * rows its blur window shares with the neighboring bands instead of synchronizing with them.
+ *
+ * @param source 8-bit image with 3 or 4 channels.
+ * @param order Sample order of the source.
+ * @param scale Rescale factor, 1 to keep the size.
+ * @param kernelSize Gaussian aperture, 3 or 5, or 0 to skip the blur.
+ * @param target Output single channel 8-bit image, must not share memory with the source.
+ */
+void PreprocessKernel::run(const Mat& source, ChannelOrder order, double scale, int kernelSize, Mat& target) {
+    if (source.empty() || source.depth() != CV_8U || (source.channels() != 3 && source.channels() != 4)) {
+        throw invalid_argument("Fused preprocessing needs an 8-bit color image");
+    }
+    if (scale <= 0) {
+        throw invalid_argument("Scale factor must be greater than 0");
+    }
+    if (kernelSize != 0 && !supportsGaussian(kernelSize)) {
+        throw invalid_argument("Fused preprocessing only blurs with 3 x 3 and 5 x 5 Gaussians");
+    }
+
+    const Size size = scaledSize(source.size(), scale);
+    if (size.width <= 0 || size.height <= 0) {
+        throw invalid_argument("Scale factor leaves an empty image");
+    }
+
+    // resize copies an image whose size does not change, so it is only resampled otherwise
+    LinearTaps columns, rows;
+    if (size != source.size()) {
+        linearTaps(size.width, source.cols, scale, true, columns);
+        linearTaps(size.height, source.rows, scale, false, rows);
+    }
+
+    target.create(size, CV_8UC1);
+    const int bands = max(1, min(getNumThreads() * 2, size.height / minBandRows));
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        for (int band = range.start; band < range.end; band++) {
+            runBand(source, order, columns, rows, kernelSize, size.height * band / bands, size.height * (band + 1) / bands, target);
+        }
+    });
+}
+
+/**
+ * @brief Checks whether the fused pass can run a Gaussian of the given size.
+ *
+ * @param kernelSize The aperture size.
+ * @return True for 3 and 5, whose OpenCV kernels are the integer binomials.
+ */
+bool PreprocessKernel::supportsGaussian(int kernelSize) {
+    return kernelSize == 3 || kernelSize == 5;
+}
+
+/**
+ * @brief Gets the size resize gives an image for a scale factor.
+ *
+ * @param size The input size.
+ * @param scale The scale factor.
+ * @return The rounded scaled size.
+ */
+Size PreprocessKernel::scaledSize(Size size, double scale) {
+    return Size(saturate_cast<int>(size.width * scale), saturate_cast<int>(size.height * scale));
+}
+
+/**
+ * @brief Computes the taps resize uses along one axis.
+ *
+ * Output position i samples the source at (i + 0.5) / scale - 0.5 in float, and both
+ * weights are rounded to 11 fractional bits on their own. Along x, positions left of the
+ * first sample or right of the last one take that sample at full weight; along y, resize
+ * keeps the weights and clamps the two row indices instead, so the first index is left
+ * unclamped here.
+ *
+ * @param outSize Number of output positions.
+ * @param inSize Number of source positions.
+ * @param scale The scale factor.
+ * @param clampWeights True to move taps at the border onto the last sample.
+ * @param taps Output taps.
+ */
+void PreprocessKernel::linearTaps(int outSize, int inSize, double scale, bool clampWeights, LinearTaps& taps) {
+    const double inverse = 1.0 / scale;
+    taps.first.resize(outSize);
+    taps.weight0.resize(outSize);
+    taps.weight1.resize(outSize);
+
+    for (int i = 0; i < outSize; i++) {
+        float position = static_cast<float>((i + 0.5) * inverse - 0.5);
+        int first = cvFloor(position);
+        position -= first;
+        if (clampWeights && first < 0) {
+            first = 0;
+            position = 0.0f;
+        }
+        if (clampWeights && first >= inSize - 1) {
+            first = inSize - 1;
+            position = 0.0f;
+        }
+        taps.first[i] = first;
+        taps.weight0[i] = saturate_cast<short>((1.0f - position) * (1 << resizeBits));
+        taps.weight1[i] = saturate_cast<short>(position * (1 << resizeBits));
+    }
+}
+
+/**
+ * @brief Runs the fused pass over a band of output rows.
+ *
+ * Source rows are converted to gray and resampled along x into two cached integer rows;
+ * rescaled rows mix the two cached rows with the rounding of resize's SIMD path,
+ * ((a >> 4) * w0 >> 16) + ((b >> 4) * w1 >> 16) rounded by 4. The blur keeps its window of
+ * rescaled rows in a ring and runs the integer binomial of NoiseFilter's Small backend on
+ * it, with reflect-101 borders as GaussianBlur. All scratch comes from the thread's pool.
+ *
+ * @param source The color image.
+ * @param order Sample order of the source.
+ * @param columns Taps along x, empty without rescaling.
+ * @param rows Taps along y, empty without rescaling.
+ * @param kernelSize Gaussian aperture, 0 to skip the blur.
+ * @param y0 First output row of the band.
+ * @param y1 One past the last output row of the band.
+ * @param target The output image.
+ */
+void PreprocessKernel::runBand(const Mat& source, ChannelOrder order, const LinearTaps& columns, const LinearTaps& rows,
+    int kernelSize, int y0, int y1, Mat& target) {
+    const bool rescaled = !columns.first.empty();
+    const int cols = target.cols;
+    const int channels = source.channels();
+    const int blue = order == ChannelOrder::RGB ? 2 : 0;
+    const int red = 2 - blue;
+
+    PooledVector<uchar> grayBuffer;
+    vector<uchar>& gray = grayBuffer.get();
+    PooledVector<int> resampledBuffer;
+    vector<int>& resampled = resampledBuffer.get();
+    int resampledRow[2] = { -1, -1 };
+    if (rescaled) {
+        gray.resize(source.cols);
+        resampled.resize(2 * static_cast<size_t>(cols));
+    }
+
+    // Source row y resampled along x; the slot holding row keep is not overwritten
+    auto resampledSourceRow = [&](int y, int keep) -> const int* {
+        for (int slot = 0; slot < 2; slot++) {
+            if (resampledRow[slot] == y) {
+                return resampled.data() + slot * cols;
+            }
+        }
+        const int slot = resampledRow[0] == keep ? 1 : 0;
+        int* out = resampled.data() + slot * cols;
+        grayRow(source.ptr<uchar>(y), source.cols, channels, blue, red, gray.data());
+        const int last = source.cols - 1;
+        for (int x = 0; x < cols; x++) {
+            const int first = columns.first[x];
+            out[x] = gray[first] * columns.weight0[x] + gray[min(first + 1, last)] * columns.weight1[x];
+        }
+        resampledRow[slot] = y;
+        return out;
+    };
+
+    auto scaledRow = [&](int y, uchar* out) {
+        if (!rescaled) {
+            grayRow(source.ptr<uchar>(y), source.cols, channels, blue, red, out);
+            return;
+        }
+        const int top = min(max(rows.first[y], 0), source.rows - 1);
+        const int bottom = min(max(rows.first[y] + 1, 0), source.rows - 1);
+        const int* upper = resampledSourceRow(top, bottom);
+        const int* lower = resampledSourceRow(bottom, top);
+        const int weight0 = rows.weight0[y];
+        const int weight1 = rows.weight1[y];
+        for (int x = 0; x < cols; x++) {
+            out[x] = saturate_cast<uchar>(((((upper[x] >> 4) * weight0) >> 16) + (((lower[x] >> 4) * weight1) >> 16) + 2) >> 2);
+        }
+    };
+
+    if (kernelSize == 0) {
+        for (int y = y0; y < y1; y++) {
+            scaledRow(y, target.ptr<uchar>(y));
+        }
+        return;
+    }
+
+    static const uint16_t weights3[] = { 1, 2, 1 };
+    static const uint16_t weights5[] = { 1, 4, 6, 4, 1 };
+    const uint16_t* weights = kernelSize == 3 ? weights3 : weights5;
+    const int radius = kernelSize / 2;
+    const int shift = kernelSize == 3 ? 4 : 8;
+    const uint32_t half = 1u << (shift - 1);
+
+    PooledVector<uchar> ringBuffer;
+    vector<uchar>& ring = ringBuffer.get();
+    ring.resize(static_cast<size_t>(kernelSize) * cols);
+    int ringRow[5] = { -1, -1, -1, -1, -1 };
+    PooledVector<uint16_t> sumBuffer;
+    vector<uint16_t>& sums = sumBuffer.get();
+    sums.resize(cols + 2 * radius);
+    uint16_t* column = sums.data() + radius;
+
+    for (int y = y0; y < y1; y++) {
+        // Bring the rescaled rows of the window into the ring, reusing the ones already there
+        int needed[5];
+        const uchar* window[5];
+        for (int dy = 0; dy < kernelSize; dy++) {
+            needed[dy] = borderInterpolate(y + dy - radius, target.rows, BORDER_REFLECT_101);
+        }
+        for (int dy = 0; dy < kernelSize; dy++) {
+            int slot = static_cast<int>(find(ringRow, ringRow + kernelSize, needed[dy]) - ringRow);
+            if (slot == kernelSize) {
+                slot = 0;
+                while (find(needed, needed + kernelSize, ringRow[slot]) != needed + kernelSize) {
+                    slot++;
+                }
+                scaledRow(needed[dy], ring.data() + slot * cols);
+                ringRow[slot] = needed[dy];
+            }
+            window[dy] = ring.data() + slot * cols;
+        }
+
+        // Vertical pass into the padded row of column sums
+        fill(column, column + cols, static_cast<uint16_t>(0));
+        for (int dy = 0; dy < kernelSize; dy++) {
+            const uchar* row = window[dy];
+            const uint16_t weight = weights[dy];
+            for (int x = 0; x < cols; x++) {
+                column[x] = static_cast<uint16_t>(column[x] + weight * row[x]);
+            }
+        }
+        for (int i = 1; i <= radius; i++) {
+            column[-i] = column[borderInterpolate(-i, cols, BORDER_REFLECT_101)];
+            column[cols - 1 + i] = column[borderInterpolate(cols - 1 + i, cols, BORDER_REFLECT_101)];
+        }
+
+        // Horizontal pass and rounding
+        uchar* out = target.ptr<uchar>(y);
+        if (kernelSize == 3) {
+            for (int x = 0; x < cols; x++) {
+                out[x] = static_cast<uchar>((column[x - 1] + 2u * column[x] + column[x + 1] + half) >> shift);
+            }
+        }
+        else {
+            for (int x = 0; x < cols; x++) {
+                out[x] = static_cast<uchar>((column[x - 2] + 4u * column[x - 1] + 6u * column[x] + 4u * column[x + 1] + column[x + 2] + half) >> shift);
+            }
+        }
+    }
+}
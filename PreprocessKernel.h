@@ -0,0 +1,68 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+#include "PreprocessingPipeline.h"
+
+using namespace std;
+using namespace cv;
+
+/// PreprocessKernel Class
+/// Fused front of the preprocessing pipeline: grayscale conversion, linear rescaling and a
+/// 3 x 3 or 5 x 5 Gaussian in one band-parallel pass that reads the color image once. Every
+/// band converts the source rows it needs into a gray line buffer, resamples them into a
+/// small ring of rescaled rows and blurs the ring straight into the output, so neither the
+/// full-frame gray image nor the rescaled one is ever written. The arithmetic is the
+/// fixed-point arithmetic of cvtColor, resize (INTER_LINEAR, with the rounding of its SIMD
+/// path) and the binomial Gaussian, so the result matches the stage-by-stage pipeline bit
+/// for bit on SIMD builds of OpenCV. Where resize falls back to scalar code (scalar builds,
+/// rescaled rows narrower than one vector) it rounds differently, by at most one gray level.
+class PreprocessKernel
+{
+public:
+    /// Convert a color image to gray, rescale and blur it in one pass
+    /// @param source 8-bit image with 3 or 4 channels.
+    /// @param order Sample order of the source.
+    /// @param scale Rescale factor, 1 to keep the size.
+    /// @param kernelSize Gaussian aperture, 3 or 5, or 0 to skip the blur.
+    /// @param target Output single channel 8-bit image, must not share memory with the source.
+    static void run(const Mat& source, ChannelOrder order, double scale, int kernelSize, Mat& target);
+
+    /// Check whether the fused pass can run a Gaussian of the given size
+    /// @param kernelSize The aperture size.
+    /// @return True for 3 and 5.
+    static bool supportsGaussian(int kernelSize);
+
+    /// Get the size resize gives an image for a scale factor
+    /// @param size The input size.
+    /// @param scale The scale factor.
+    /// @return The rounded scaled size.
+    static Size scaledSize(Size size, double scale);
+
+private:
+    /// Source positions and fixed-point weights of a linear resampling axis
+    struct LinearTaps {
+        vector<int> first;                  ///< Lower source index of every output position, may lie outside the source
+        vector<int> weight0;                ///< Weight of the lower source sample, scaled by 2^11
+        vector<int> weight1;                ///< Weight of the upper source sample, scaled by 2^11
+    };
+
+    /// Compute the taps resize uses along one axis
+    /// @param outSize Number of output positions.
+    /// @param inSize Number of source positions.
+    /// @param scale The scale factor.
+    /// @param clampWeights True to move taps at the border onto the last sample, as resize does along x.
+    /// @param taps Output taps.
+    static void linearTaps(int outSize, int inSize, double scale, bool clampWeights, LinearTaps& taps);
+
+    /// Run the fused pass over a band of output rows
+    /// @param source The color image.
+    /// @param order Sample order of the source.
+    /// @param columns Taps along x, empty without rescaling.
+    /// @param rows Taps along y, empty without rescaling.
+    /// @param kernelSize Gaussian aperture, 0 to skip the blur.
+    /// @param y0 First output row of the band.
+    /// @param y1 One past the last output row of the band.
+    /// @param target The output image.
+    static void runBand(const Mat& source, ChannelOrder order, const LinearTaps& columns, const LinearTaps& rows,
+        int kernelSize, int y0, int y1, Mat& target);
+};
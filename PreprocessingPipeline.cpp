@@ -0,0 +1,461 @@
+#include "PreprocessingPipeline.h"
+#include "PreprocessKernel.h"
+#include "Profiler.h"
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Constructor for an empty pipeline, which returns its input unchanged.
+ */
+PreprocessingPipeline::PreprocessingPipeline() {
+}
+
+/**
+ * @brief Constructor from a list of stages.
+ *
+ * @param steps The stages in execution order.
+ */
+PreprocessingPipeline::PreprocessingPipeline(const vector<PreprocessStep>& steps) {
+    validate(steps);
+    this->steps = steps;
+    planBuffers();
+}
+
+/**
+ * @brief Copy constructor.
+ *
+ * Only the stages are copied; the copy allocates its own buffers on its first run, so
+ * copies can be run on different threads.
+ *
+ * @param other The pipeline to copy.
+ */
+PreprocessingPipeline::PreprocessingPipeline(const PreprocessingPipeline& other)
+    : steps(other.steps), bufferOf(other.bufferOf), buffers(other.buffers.size()), observer(other.observer), fusion(other.fusion) {
+}
+
+/**
+ * @brief Copy assignment, the copy gets its own buffers.
+ *
+ * @param other The pipeline to copy.
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::operator=(const PreprocessingPipeline& other) {
+    if (this != &other) {
+        steps = other.steps;
+        bufferOf = other.bufferOf;
+        buffers.assign(other.buffers.size(), Mat());
+        observer = other.observer;
+        fusion = other.fusion;
+    }
+    return *this;
+}
+
+/**
+ * @brief Parses a pipeline description such as "grayscale,rescale:0.5,median:5".
+ *
+ * @param description Comma separated stages, each a name optionally followed by ":value";
+ *        filters take the implementation as a second value, e.g. "median:11:histogram".
+ * @return The pipeline.
+ */
+PreprocessingPipeline PreprocessingPipeline::parse(const string& description) {
+    PreprocessingPipeline pipeline;
+    stringstream tokens(description);
+    string token;
+
+    while (getline(tokens, token, ',')) {
+        if (token.empty()) {
+            continue;
+        }
+        size_t colon = token.find(':');
+        string name = token.substr(0, colon);
+        string value = colon == string::npos ? "" : token.substr(colon + 1);
+        size_t backendColon = value.find(':');
+        FilterBackend backend = FilterBackend::Auto;
+        if (backendColon != string::npos) {
+            backend = NoiseFilter::parseBackend(value.substr(backendColon + 1));
+            value = value.substr(0, backendColon);
+        }
+
+        if (name == "grayscale" || name == "gray") {
+            pipeline.grayscale();
+        }
+        else if (name == "rescale" || name == "scale") {
+            if (value.empty()) {
+                throw invalid_argument("Rescale stage needs a factor, e.g. rescale:0.5");
+            }
+            pipeline.rescale(stod(value));
+        }
+        else if (name == "gaussian") {
+            pipeline.gaussian(value.empty() ? 3 : stoi(value), backend);
+        }
+        else if (name == "median") {
+            pipeline.median(value.empty() ? 11 : stoi(value), backend);
+        }
+        else {
+            throw invalid_argument("Unknown preprocessing stage: " + name);
+        }
+    }
+
+    return pipeline;
+}
+
+/**
+ * @brief Appends a grayscale conversion.
+ *
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::grayscale(void) {
+    return addStep({ PreprocessStage::Grayscale, 1.0, 0 });
+}
+
+/**
+ * @brief Appends a rescale stage.
+ *
+ * @param scale The scale factor.
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::rescale(double scale) {
+    return addStep({ PreprocessStage::Rescale, scale, 0 });
+}
+
+/**
+ * @brief Appends a Gaussian blur.
+ *
+ * @param kernelSize Odd aperture size.
+ * @param backend The filter implementation.
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::gaussian(int kernelSize, FilterBackend backend) {
+    return addStep({ PreprocessStage::Gaussian, 1.0, kernelSize, backend });
+}
+
+/**
+ * @brief Appends a median blur.
+ *
+ * @param kernelSize Odd aperture size, at least 3.
+ * @param backend The filter implementation.
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::median(int kernelSize, FilterBackend backend) {
+    return addStep({ PreprocessStage::Median, 1.0, kernelSize, backend });
+}
+
+/**
+ * @brief Appends a stage after validating the resulting order.
+ *
+ * @param step The stage to append.
+ * @return Reference to this pipeline.
+ */
+PreprocessingPipeline& PreprocessingPipeline::addStep(const PreprocessStep& step) {
+    vector<PreprocessStep> candidate = steps;
+    candidate.push_back(step);
+    validate(candidate);
+
+    steps.swap(candidate);
+    planBuffers();
+    return *this;
+}
+
+/**
+ * @brief Checks the stage order and parameters.
+ *
+ * Grayscale conversion comes first so no stage processes three channels, and rescaling
+ * precedes the filters so they run on the smaller image. Throws invalid_argument on any
+ * violation.
+ *
+ * @param candidate The stages to check.
+ */
+void PreprocessingPipeline::validate(const vector<PreprocessStep>& candidate) {
+    bool rescaled = false;
+    bool filtered = false;
+
+    for (size_t i = 0; i < candidate.size(); i++) {
+        const PreprocessStep& step = candidate[i];
+        switch (step.stage) {
+        case PreprocessStage::Grayscale:
+            if (i != 0) {
+                throw invalid_argument("Grayscale conversion must be the first preprocessing stage");
+            }
+            break;
+        case PreprocessStage::Rescale:
+            if (rescaled) {
+                throw invalid_argument("Only one rescale stage is allowed");
+            }
+            if (filtered) {
+                throw invalid_argument("Rescale must come before the filter stages");
+            }
+            if (step.scale <= 0) {
+                throw invalid_argument("Scale factor must be greater than 0");
+            }
+            rescaled = true;
+            break;
+        case PreprocessStage::Gaussian:
+            if (step.kernelSize < 1 || step.kernelSize % 2 == 0) {
+                throw invalid_argument("Gaussian kernel size must be odd and positive");
+            }
+            if (!NoiseFilter::supportsGaussian(step.backend, step.kernelSize)) {
+                throw invalid_argument("The " + NoiseFilter::backendName(step.backend) + " backend cannot run a Gaussian of size " + to_string(step.kernelSize));
+            }
+            filtered = true;
+            break;
+        case PreprocessStage::Median:
+            if (step.kernelSize < 3 || step.kernelSize % 2 == 0) {
+                throw invalid_argument("Median kernel size must be odd and at least 3");
+            }
+            if (!NoiseFilter::supportsMedian(step.backend, step.kernelSize)) {
+                throw invalid_argument("The " + NoiseFilter::backendName(step.backend) + " backend cannot run a median of size " + to_string(step.kernelSize));
+            }
+            filtered = true;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Assigns every stage its output buffer.
+ *
+ * A stage never writes the buffer it reads, so consecutive stages alternate between two
+ * buffers. The rescale stage opens a new pair: every buffer then holds a single image size
+ * and type, and a repeated run on an image of the same size finds all of them allocated.
+ */
+void PreprocessingPipeline::planBuffers(void) {
+    bufferOf.resize(steps.size());
+    int pair = 0;
+    int slot = 0;
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].stage == PreprocessStage::Rescale) {
+            pair++;
+            slot = 0;
+        }
+        bufferOf[i] = pair * 2 + slot;
+        slot ^= 1;
+    }
+
+    buffers.resize(steps.empty() ? 0 : (pair + 1) * 2);
+}
+
+/**
+ * @brief Gets a result buffer no caller holds.
+ *
+ * A caller keeps a result by sharing its Mat, which raises the reference count of the
+ * buffer above the pipeline's own reference; such a buffer is skipped. Once the caller
+ * releases it, the buffer is reused. This also keeps a run on a previous result from
+ * writing into its own input.
+ *
+ * @return The buffer.
+ */
+Mat& PreprocessingPipeline::resultBuffer(void) {
+    for (Mat& result : results) {
+        if (result.u == nullptr || result.u->refcount == 1) {
+            return result;
+        }
+    }
+    results.push_back(Mat());
+    return results.back();
+}
+
+/**
+ * @brief Finds the leading stages the fused pass can run on an input.
+ *
+ * The fused pass starts at a grayscale stage on an 8-bit color input and takes the rescale
+ * stage and a following 3 x 3 or 5 x 5 Gaussian with it. The recursive backend approximates
+ * the Gaussian, so a stage asking for it is left to NoiseFilter. Grayscale conversion alone
+ * is not worth a separate path.
+ *
+ * @param input The image to preprocess.
+ * @param scale Output rescale factor of the fused stages, 1 without a rescale stage.
+ * @param kernelSize Output Gaussian aperture of the fused stages, 0 without a Gaussian.
+ * @return Number of fused stages, 0 when the stages run one by one.
+ */
+size_t PreprocessingPipeline::fusedStages(const Mat& input, double& scale, int& kernelSize) const {
+    scale = 1.0;
+    kernelSize = 0;
+    if (!fusion || observer || steps.empty() || steps[0].stage != PreprocessStage::Grayscale ||
+        input.depth() != CV_8U || (input.channels() != 3 && input.channels() != 4)) {
+        return 0;
+    }
+
+    size_t fused = 1;
+    if (fused < steps.size() && steps[fused].stage == PreprocessStage::Rescale) {
+        scale = steps[fused].scale;
+        fused++;
+    }
+    if (fused < steps.size() && steps[fused].stage == PreprocessStage::Gaussian &&
+        PreprocessKernel::supportsGaussian(steps[fused].kernelSize) && steps[fused].backend != FilterBackend::Recursive) {
+        kernelSize = steps[fused].kernelSize;
+        fused++;
+    }
+    return fused > 1 ? fused : 0;
+}
+
+/**
+ * @brief Runs every stage on an image.
+ *
+ * Leading stages the fused pass covers are run as one PreprocessKernel pass into the
+ * buffer of the last of them, the remaining stages one by one. The last stage writes into a
+ * result buffer no caller holds.
+ *
+ * @param input The image to preprocess, left untouched.
+ * @param order Sample order of a color input, used by the grayscale stage.
+ * @return The result, owned by the pipeline. A Mat sharing it stays valid, the reference only
+ *         until the next run. An empty pipeline returns the input itself.
+ */
+const Mat& PreprocessingPipeline::run(const Mat& input, ChannelOrder order) {
+    if (input.empty()) {
+        throw runtime_error("Preprocessing input image is empty");
+    }
+
+    const Mat* source = &input;
+    double scale;
+    int kernelSize;
+    const size_t fused = fusedStages(input, scale, kernelSize);
+    if (fused > 0) {
+        TRACE_STAGE("preprocess");
+        Mat& target = fused == steps.size() ? resultBuffer() : buffers[bufferOf[fused - 1]];
+        PreprocessKernel::run(input, order, scale, kernelSize, target);
+        source = &target;
+    }
+
+    for (size_t i = fused; i < steps.size(); i++) {
+        Mat& target = i + 1 == steps.size() ? resultBuffer() : buffers[bufferOf[i]];
+        apply(steps[i], *source, target, order);
+        if (observer) {
+            observer(steps[i], target);
+        }
+        source = &target;
+    }
+
+    return *source;
+}
+
+/**
+ * @brief Runs one stage.
+ *
+ * The OpenCV calls and NoiseFilter create their output through Mat::create, which keeps
+ * the existing buffer when size and type already match.
+ *
+ * @param step The stage.
+ * @param source The stage input.
+ * @param target The stage output buffer.
+ * @param order Sample order of a color source.
+ */
+void PreprocessingPipeline::apply(const PreprocessStep& step, const Mat& source, Mat& target, ChannelOrder order) {
+    static const char* const traceNames[] = { "convert", "rescale", "filter", "filter" };
+    TRACE_STAGE(traceNames[static_cast<int>(step.stage)]);
+
+    switch (step.stage) {
+    case PreprocessStage::Grayscale:
+        if (source.channels() == 3) {
+            cvtColor(source, target, order == ChannelOrder::RGB ? COLOR_RGB2GRAY : COLOR_BGR2GRAY);
+        }
+        else if (source.channels() == 4) {
+            cvtColor(source, target, order == ChannelOrder::RGB ? COLOR_RGBA2GRAY : COLOR_BGRA2GRAY);
+        }
+        else {
+            source.copyTo(target);
+        }
+        break;
+    case PreprocessStage::Rescale:
+        resize(source, target, Size(), step.scale, step.scale);
+        break;
+    case PreprocessStage::Gaussian:
+        NoiseFilter::gaussian(source, target, step.kernelSize, step.backend);
+        break;
+    case PreprocessStage::Median:
+        NoiseFilter::median(source, target, step.kernelSize, step.backend);
+        break;
+    }
+}
+
+/**
+ * @brief Sets a callback receiving every stage result.
+ *
+ * @param callback The observer, an empty function to disable it.
+ */
+void PreprocessingPipeline::setStageObserver(StageObserver callback) {
+    observer = callback;
+}
+
+/**
+ * @brief Enables or disables the fused grayscale, rescale and Gaussian pass.
+ *
+ * @param enabled True to fuse the leading stages where possible (the default).
+ */
+void PreprocessingPipeline::setFusion(bool enabled) {
+    fusion = enabled;
+}
+
+/**
+ * @brief Checks whether the fused pass is enabled.
+ *
+ * @return True if the leading stages are fused where possible.
+ */
+bool PreprocessingPipeline::isFusionEnabled(void) const {
+    return fusion;
+}
+
+/**
+ * @brief Gets the stages.
+ *
+ * @return The stages in execution order.
+ */
+const vector<PreprocessStep>& PreprocessingPipeline::getSteps(void) const {
+    return steps;
+}
+
+/**
+ * @brief Gets the product of the rescale factors.
+ *
+ * @return The overall scale factor, 1 without a rescale stage.
+ */
+double PreprocessingPipeline::getScaleFactor(void) const {
+    double scale = 1.0;
+    for (const auto& step : steps) {
+        if (step.stage == PreprocessStage::Rescale) {
+            scale *= step.scale;
+        }
+    }
+    return scale;
+}
+
+/**
+ * @brief Describes the stages in the format accepted by parse.
+ *
+ * @return The description, empty for an empty pipeline.
+ */
+string PreprocessingPipeline::describe(void) const {
+    stringstream description;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (i > 0) {
+            description << ",";
+        }
+        description << stageName(steps[i].stage);
+        if (steps[i].stage == PreprocessStage::Rescale) {
+            description << ":" << steps[i].scale;
+        }
+        else if (steps[i].stage != PreprocessStage::Grayscale) {
+            description << ":" << steps[i].kernelSize;
+            if (steps[i].backend != FilterBackend::Auto) {
+                description << ":" << NoiseFilter::backendName(steps[i].backend);
+            }
+        }
+    }
+    return description.str();
+}
+
+/**
+ * @brief Gets a short display name for a stage kind.
+ *
+ * @param stage The stage kind.
+ * @return The name used in descriptions.
+ */
+string PreprocessingPipeline::stageName(PreprocessStage stage) {
+    switch (stage) {
+    case PreprocessStage::Grayscale: return "grayscale";
+    case PreprocessStage::Rescale: return "rescale";
+    case PreprocessStage::Gaussian: return "gaussian";
+    case PreprocessStage::Median: return "median";
+    }
+    return "unknown";
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include "NoiseFilter.h"
+
+using namespace std;
+using namespace cv;
+
+/// Preprocessing stage kinds
+enum class PreprocessStage { Grayscale, Rescale, Gaussian, Median };
+
+/// Sample order of color images
+/// Decoded images are BGR; mapped PPM files and many capture buffers hold RGB samples,
+/// which the grayscale stage weights correctly without swapping them first.
+enum class ChannelOrder { BGR, RGB };
+
+/// One preprocessing stage and its parameters
+struct PreprocessStep {
+    PreprocessStage stage;                  ///< Stage kind
+    double scale;                           ///< Rescale factor, only used by Rescale
+    int kernelSize;                         ///< Filter aperture, only used by Gaussian and Median
+    FilterBackend backend = FilterBackend::Auto; ///< Filter implementation, only used by Gaussian and Median
+};
+
+/// PreprocessingPipeline Class
+/// Describes the preprocessing chain as data: a validated list of stages that is run on an
+/// image through preallocated buffers. Stages alternate between two buffers per resolution,
+/// so running the pipeline again on an image of the same size allocates no new Mat. The last
+/// stage writes into a result buffer the caller may keep by sharing its Mat; a result still
+/// held is never overwritten, and one released is reused by a later run.
+/// Valid order: Grayscale (first, at most once), then Rescale (at most once), then filters.
+/// On color 8-bit input, a leading grayscale + rescale / 3 x 3 or 5 x 5 Gaussian chain runs as
+/// one PreprocessKernel pass unless fusion is disabled or a stage observer needs the
+/// intermediate images. Its output matches the staged one bit for bit on SIMD builds of
+/// OpenCV and within one gray level where resize takes its scalar path.
+class PreprocessingPipeline
+{
+public:
+    /// Callback receiving every stage result, e.g. to display intermediate images
+    typedef function<void(const PreprocessStep&, const Mat&)> StageObserver;
+
+    /// Constructor for an empty pipeline, which returns its input unchanged
+    PreprocessingPipeline();
+
+    /// Constructor from a list of stages
+    /// @param steps The stages in execution order.
+    explicit PreprocessingPipeline(const vector<PreprocessStep>& steps);
+
+    /// Copy constructor, the copy gets its own buffers
+    /// @param other The pipeline to copy.
+    PreprocessingPipeline(const PreprocessingPipeline& other);
+
+    /// Copy assignment, the copy gets its own buffers
+    /// @param other The pipeline to copy.
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& operator=(const PreprocessingPipeline& other);
+
+    /// Parse a pipeline description such as "grayscale,rescale:0.5,median:5"
+    /// Stage names are grayscale, rescale:<factor>, gaussian[:<ksize>[:<backend>]] and
+    /// median[:<ksize>[:<backend>]], the backend being a NoiseFilter::parseBackend name.
+    /// @param description Comma separated stages.
+    /// @return The pipeline.
+    static PreprocessingPipeline parse(const string& description);
+
+    /// Append a grayscale conversion
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& grayscale(void);
+
+    /// Append a rescale stage
+    /// @param scale The scale factor.
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& rescale(double scale);
+
+    /// Append a Gaussian blur
+    /// @param kernelSize Odd aperture size.
+    /// @param backend The filter implementation.
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& gaussian(int kernelSize = 3, FilterBackend backend = FilterBackend::Auto);
+
+    /// Append a median blur
+    /// @param kernelSize Odd aperture size, at least 3.
+    /// @param backend The filter implementation.
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& median(int kernelSize = 11, FilterBackend backend = FilterBackend::Auto);
+
+    /// Append a stage after validating the resulting order
+    /// @param step The stage to append.
+    /// @return Reference to this pipeline.
+    PreprocessingPipeline& addStep(const PreprocessStep& step);
+
+    /// Run every stage on an image
+    /// @param input The image to preprocess, left untouched.
+    /// @param order Sample order of a color input.
+    /// @return The result, owned by the pipeline. A Mat sharing it stays valid, the reference
+    ///         only until the next run.
+    const Mat& run(const Mat& input, ChannelOrder order = ChannelOrder::BGR);
+
+    /// Set a callback receiving every stage result
+    /// @param callback The observer, an empty function to disable it.
+    void setStageObserver(StageObserver callback);
+
+    /// Enable or disable the fused grayscale, rescale and Gaussian pass
+    /// @param enabled True to fuse the leading stages where possible (the default).
+    void setFusion(bool enabled);
+
+    /// Check whether the fused pass is enabled
+    /// @return True if the leading stages are fused where possible.
+    bool isFusionEnabled(void) const;
+
+    /// Get the stages
+    /// @return The stages in execution order.
+    const vector<PreprocessStep>& getSteps(void) const;
+
+    /// Get the product of the rescale factors
+    /// @return The overall scale factor, 1 without a rescale stage.
+    double getScaleFactor(void) const;
+
+    /// Describe the stages in the format accepted by parse
+    /// @return The description, empty for an empty pipeline.
+    string describe(void) const;
+
+    /// Get a short display name for a stage kind
+    /// @param stage The stage kind.
+    /// @return The name used in descriptions.
+    static string stageName(PreprocessStage stage);
+
+private:
+    /// Check the stage order and parameters, throws invalid_argument on violations
+    /// @param candidate The stages to check.
+    static void validate(const vector<PreprocessStep>& candidate);
+
+    /// Assign every stage its output buffer: two per resolution, alternating
+    void planBuffers(void);
+
+    /// Get a result buffer no caller holds, adding one when all of them are held
+    /// @return The buffer.
+    Mat& resultBuffer(void);
+
+    /// Find the leading stages the fused pass can run on an input
+    /// @param input The image to preprocess.
+    /// @param scale Output rescale factor of the fused stages, 1 without a rescale stage.
+    /// @param kernelSize Output Gaussian aperture of the fused stages, 0 without a Gaussian.
+    /// @return Number of fused stages, 0 when the stages run one by one.
+    size_t fusedStages(const Mat& input, double& scale, int& kernelSize) const;
+
+    /// Run one stage
+    /// @param step The stage.
+    /// @param source The stage input.
+    /// @param target The stage output buffer.
+    /// @param order Sample order of a color source.
+    static void apply(const PreprocessStep& step, const Mat& source, Mat& target, ChannelOrder order);
+
+    vector<PreprocessStep> steps;           ///< Stages in execution order
+    vector<int> bufferOf;                   ///< Output buffer index of every stage
+    vector<Mat> buffers;                    ///< Stage output buffers, kept between runs
+    vector<Mat> results;                    ///< Last stage output buffers, some shared with callers
+    StageObserver observer;                 ///< Optional stage result callback
+    bool fusion = true;                     ///< True to fuse the leading stages where possible
+};
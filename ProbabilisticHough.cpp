@@ -0,0 +1,174 @@
+#include "ProbabilisticHough.h"
+#include "BufferPool.h"
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+/**
+ * @brief Finds line segments among the edge pixels of a map.
+ *
+ * Follows the progressive probabilistic transform of HoughLinesP step by step: the edge
+ * pixels are drawn in random order from a generator seeded like OpenCV's, each one votes for
+ * all angles, and a pixel whose strongest line reaches the threshold starts a walk along that
+ * line in 16-bit fixed point in both directions. The walk ends at the image border or after
+ * more than maxLineGap missing pixels; the pixels it passes are cleared from the mask and, for
+ * a segment of at least minLineLength along x or y, voted out again. Resolutions are taken in
+ * float as HoughLinesP takes them.
+ *
+ * @param edges The edge map with its edge list.
+ * @param rho Distance resolution of the accumulator in pixels.
+ * @param theta Angle resolution of the accumulator in radians.
+ * @param threshold Minimum number of votes of a line.
+ * @param minLineLength Minimum segment length.
+ * @param maxLineGap Maximum gap between pixels of one segment.
+ * @param lines Output segments in detection order.
+ */
+void ProbabilisticHough::findSegments(const EdgeMap& edges, double rho, double theta, int threshold, int minLineLength, int maxLineGap, vector<Vec4i>& lines) {
+    if (rho <= 0 || theta <= 0) {
+        throw invalid_argument("Hough resolutions must be positive");
+    }
+
+    lines.clear();
+    if (edges.count() == 0) {
+        return;
+    }
+
+    const float rhoStep = static_cast<float>(rho);
+    const float thetaStep = static_cast<float>(theta);
+    const int width = edges.size().width;
+    const int height = edges.size().height;
+
+    // Angles in [0, pi), the last one dropped when it lies within half a step of pi
+    int numAngle = cvFloor(CV_PI / thetaStep) + 1;
+    if (numAngle > 1 && fabs(CV_PI - (numAngle - 1) * thetaStep) < thetaStep / 2) {
+        numAngle--;
+    }
+    const int numRho = cvRound(((width + height) * 2 + 1) / rhoStep);
+    const int rhoOffset = (numRho - 1) / 2;
+    const float inverseRho = 1 / rhoStep;
+
+    PooledVector<float> trigBuffer;
+    vector<float>& trig = trigBuffer.get();
+    trig.resize(2 * static_cast<size_t>(numAngle));
+    for (int n = 0; n < numAngle; n++) {
+        trig[2 * n] = static_cast<float>(cos(static_cast<double>(n) * thetaStep) * inverseRho);
+        trig[2 * n + 1] = static_cast<float>(sin(static_cast<double>(n) * thetaStep) * inverseRho);
+    }
+
+    PooledMat accumulatorBuffer(numAngle, numRho, CV_32S);
+    Mat& accumulator = accumulatorBuffer.get();
+    accumulator.setTo(Scalar(0));
+
+    // Pixels still free to join a segment, and the pixels not drawn yet
+    PooledVector<uint64_t> maskBuffer;
+    vector<uint64_t>& mask = maskBuffer.get();
+    mask.assign(edges.packedWords().begin(), edges.packedWords().end());
+    PooledVector<int> pointBuffer;
+    vector<int>& points = pointBuffer.get();
+    points.assign(edges.indices().begin(), edges.indices().end());
+
+    const int rowWords = edges.wordsPerRow();
+    auto maskWord = [&](int x, int y) -> uint64_t& { return mask[static_cast<size_t>(y) * rowWords + (x >> 6)]; };
+    auto vote = [&](int x, int y, int delta) {
+        for (int n = 0; n < numAngle; n++) {
+            accumulator.ptr<int>(n)[cvRound(x * trig[2 * n] + y * trig[2 * n + 1]) + rhoOffset] += delta;
+        }
+    };
+
+    const int shift = 16;
+    RNG rng(static_cast<uint64>(-1));
+    for (int count = static_cast<int>(points.size()); count > 0; count--) {
+        // Draw a pixel and remove it by moving the last undrawn one into its place
+        const int drawn = rng.uniform(0, count);
+        const int index = points[drawn];
+        points[drawn] = points[count - 1];
+        const int i = index / width;
+        const int j = index - i * width;
+
+        // Skip pixels claimed by a segment found earlier
+        if (!((maskWord(j, i) >> (j & 63)) & 1)) {
+            continue;
+        }
+
+        int maxVotes = threshold - 1;
+        int maxAngle = 0;
+        for (int n = 0; n < numAngle; n++) {
+            const int votes = ++accumulator.ptr<int>(n)[cvRound(j * trig[2 * n] + i * trig[2 * n + 1]) + rhoOffset];
+            if (maxVotes < votes) {
+                maxVotes = votes;
+                maxAngle = n;
+            }
+        }
+        if (maxVotes < threshold) {
+            continue;
+        }
+
+        // Step one pixel along the major axis and a fixed-point fraction along the other
+        const float a = -trig[2 * maxAngle + 1];
+        const float b = trig[2 * maxAngle];
+        int x0 = j;
+        int y0 = i;
+        int dx0, dy0;
+        const bool alongX = fabs(a) > fabs(b);
+        if (alongX) {
+            dx0 = a > 0 ? 1 : -1;
+            dy0 = cvRound(b * (1 << shift) / fabs(a));
+            y0 = (y0 << shift) + (1 << (shift - 1));
+        }
+        else {
+            dy0 = b > 0 ? 1 : -1;
+            dx0 = cvRound(a * (1 << shift) / fabs(b));
+            x0 = (x0 << shift) + (1 << (shift - 1));
+        }
+
+        // Walk both directions to the last pixel before the border or a too long gap
+        Point lineEnd[2];
+        for (int k = 0; k < 2; k++) {
+            int gap = 0;
+            const int dx = k > 0 ? -dx0 : dx0;
+            const int dy = k > 0 ? -dy0 : dy0;
+            for (int x = x0, y = y0;; x += dx, y += dy) {
+                const int j1 = alongX ? x : x >> shift;
+                const int i1 = alongX ? y >> shift : y;
+                if (j1 < 0 || j1 >= width || i1 < 0 || i1 >= height) {
+                    break;
+                }
+                if ((maskWord(j1, i1) >> (j1 & 63)) & 1) {
+                    gap = 0;
+                    lineEnd[k] = Point(j1, i1);
+                }
+                else if (++gap > maxLineGap) {
+                    break;
+                }
+            }
+        }
+
+        const bool goodLine = abs(lineEnd[1].x - lineEnd[0].x) >= minLineLength ||
+            abs(lineEnd[1].y - lineEnd[0].y) >= minLineLength;
+
+        // Walk again to the ends, claiming the pixels and returning the votes of a kept segment
+        for (int k = 0; k < 2; k++) {
+            const int dx = k > 0 ? -dx0 : dx0;
+            const int dy = k > 0 ? -dy0 : dy0;
+            for (int x = x0, y = y0;; x += dx, y += dy) {
+                const int j1 = alongX ? x : x >> shift;
+                const int i1 = alongX ? y >> shift : y;
+                uint64_t& word = maskWord(j1, i1);
+                const uint64_t bit = uint64_t(1) << (j1 & 63);
+                if (word & bit) {
+                    if (goodLine) {
+                        vote(j1, i1, -1);
+                    }
+                    word &= ~bit;
+                }
+                if (i1 == lineEnd[k].y && j1 == lineEnd[k].x) {
+                    break;
+                }
+            }
+        }
+
+        if (goodLine) {
+            lines.push_back(Vec4i(lineEnd[0].x, lineEnd[0].y, lineEnd[1].x, lineEnd[1].y));
+        }
+    }
+}
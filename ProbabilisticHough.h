@@ -0,0 +1,28 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+#include "EdgeMap.h"
+
+using namespace std;
+using namespace cv;
+
+/// ProbabilisticHough Class
+/// Progressive probabilistic Hough transform fed by a packed edge map. HoughLinesP scans its
+/// 8-bit input for the edge pixels and copies it into a byte mask before voting; here the
+/// points come from the edge list of the map and the mask is a copy of its packed rows, so the
+/// transform only touches edge pixels and the pixels walked along candidate lines. Points are
+/// drawn with the same generator in the same order, and the segments are identical to
+/// HoughLinesP on the unpacked map.
+class ProbabilisticHough
+{
+public:
+    /// Find line segments among the edge pixels of a map
+    /// @param edges The edge map with its edge list.
+    /// @param rho Distance resolution of the accumulator in pixels.
+    /// @param theta Angle resolution of the accumulator in radians.
+    /// @param threshold Minimum number of votes of a line.
+    /// @param minLineLength Minimum segment length.
+    /// @param maxLineGap Maximum gap between pixels of one segment.
+    /// @param lines Output segments in detection order.
+    static void findSegments(const EdgeMap& edges, double rho, double theta, int threshold, int minLineLength, int maxLineGap, vector<Vec4i>& lines);
+};
@@ -0,0 +1,290 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+atomic<bool> Profiler::enabled(false);
+
+namespace {
+    const int histogramBuckets = 32;        // bucket b holds durations below 2^b microseconds
+    const size_t maxEventsPerThread = 1 << 18;
+
+    /// Latency statistics of one stage
+    struct StageStats {
+        const char* name;
+        uint64_t calls;
+        int64_t total;
+        int64_t longest;
+        uint64_t items;
+        uint64_t histogram[histogramBuckets];
+    };
+
+    /// One completed stage execution
+    struct TraceEvent {
+        const char* name;
+        int64_t start;
+        int64_t duration;
+        size_t count;
+    };
+
+    /// Recording buffers of one thread; the lock is only contended while a report is built
+    struct ThreadRecord {
+        int id;
+        mutex lock;
+        vector<StageStats> stages;
+        vector<TraceEvent> events;
+        size_t droppedEvents = 0;
+    };
+
+    mutex registryLock;
+    vector<shared_ptr<ThreadRecord>> registry;
+    atomic<int64_t> traceEpoch(0);
+    atomic<int64_t> summaryInterval(0);
+    atomic<int64_t> lastSummary(0);
+
+    /// Get the record of the calling thread, registering it on first use
+    ThreadRecord& threadRecord(void) {
+        thread_local shared_ptr<ThreadRecord> record;
+        if (!record) {
+            record = make_shared<ThreadRecord>();
+            lock_guard<mutex> guard(registryLock);
+            record->id = static_cast<int>(registry.size()) + 1;
+            registry.push_back(record);
+        }
+        return *record;
+    }
+
+    /// Get the histogram bucket of a duration
+    int bucketOf(int64_t duration) {
+        int64_t micros = duration / 1000;
+        int bucket = 0;
+        while (micros > 0 && bucket < histogramBuckets - 1) {
+            micros >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    /// Find the statistics of a stage by name, appending them if missing
+    StageStats& findStage(vector<StageStats>& stages, const char* name) {
+        for (auto& stats : stages) {
+            if (stats.name == name || strcmp(stats.name, name) == 0) {
+                return stats;
+            }
+        }
+        StageStats stats = {};
+        stats.name = name;
+        stages.push_back(stats);
+        return stages.back();
+    }
+
+    /// Format a duration with a readable unit
+    string formatDuration(double nanoseconds) {
+        stringstream text;
+        text.precision(3);
+        if (nanoseconds < 1e6) text << nanoseconds / 1e3 << "us";
+        else if (nanoseconds < 1e9) text << nanoseconds / 1e6 << "ms";
+        else text << nanoseconds / 1e9 << "s";
+        return text.str();
+    }
+
+    /// Estimate a percentile as the upper bound of the histogram bucket that reaches it
+    double percentile(const StageStats& stats, double fraction) {
+        const uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(fraction * stats.calls + 0.5));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < histogramBuckets; bucket++) {
+            seen += stats.histogram[bucket];
+            if (seen >= target) {
+                return min(static_cast<double>(stats.longest), 1000.0 * (static_cast<int64_t>(1) << bucket));
+            }
+        }
+        return static_cast<double>(stats.longest);
+    }
+}
+
+/**
+ * @brief Enables or disables recording.
+ *
+ * The trace clock starts with the first enable, so trace timestamps begin near zero.
+ *
+ * @param enabled True to record stages.
+ */
+void Profiler::setEnabled(bool enabled) {
+    if (enabled) {
+        int64_t start = now();
+        int64_t unset = 0;
+        traceEpoch.compare_exchange_strong(unset, start);
+        lastSummary = start;
+    }
+    Profiler::enabled.store(enabled, memory_order_relaxed);
+}
+
+/**
+ * @brief Records one completed stage of the calling thread.
+ *
+ * @param stage Stage name, a string literal that outlives the profiler.
+ * @param start Start time from now().
+ * @param duration Duration in nanoseconds.
+ * @param count Number of items the stage produced, 0 if not applicable.
+ */
+void Profiler::record(const char* stage, int64_t start, int64_t duration, size_t count) {
+    ThreadRecord& record = threadRecord();
+    lock_guard<mutex> guard(record.lock);
+
+    StageStats& stats = findStage(record.stages, stage);
+    stats.calls++;
+    stats.total += duration;
+    stats.longest = max(stats.longest, duration);
+    stats.items += count;
+    stats.histogram[bucketOf(duration)]++;
+
+    if (record.events.size() < maxEventsPerThread) {
+        record.events.push_back({ stage, start, duration, count });
+    }
+    else {
+        record.droppedEvents++;
+    }
+}
+
+/**
+ * @brief Drops all statistics and events.
+ */
+void Profiler::reset(void) {
+    lock_guard<mutex> guard(registryLock);
+    for (auto& record : registry) {
+        lock_guard<mutex> recordGuard(record->lock);
+        record->stages.clear();
+        record->events.clear();
+        record->droppedEvents = 0;
+    }
+}
+
+/**
+ * @brief Summarizes every stage on one line.
+ *
+ * Statistics of all threads are merged by stage name. Percentiles are histogram bucket
+ * upper bounds, i.e. accurate to a factor of two.
+ *
+ * @return One entry per stage in first-seen order.
+ */
+string Profiler::summary(void) {
+    vector<StageStats> merged;
+    {
+        lock_guard<mutex> guard(registryLock);
+        for (auto& record : registry) {
+            lock_guard<mutex> recordGuard(record->lock);
+            for (const auto& stats : record->stages) {
+                StageStats& target = findStage(merged, stats.name);
+                target.calls += stats.calls;
+                target.total += stats.total;
+                target.longest = max(target.longest, stats.longest);
+                target.items += stats.items;
+                for (int bucket = 0; bucket < histogramBuckets; bucket++) {
+                    target.histogram[bucket] += stats.histogram[bucket];
+                }
+            }
+        }
+    }
+
+    stringstream line;
+    line << "Profile:";
+    for (size_t i = 0; i < merged.size(); i++) {
+        const StageStats& stats = merged[i];
+        line << (i == 0 ? " " : " | ") << stats.name << " " << stats.calls << "x mean "
+            << formatDuration(static_cast<double>(stats.total) / stats.calls)
+            << " p50<=" << formatDuration(percentile(stats, 0.5))
+            << " p95<=" << formatDuration(percentile(stats, 0.95))
+            << " max " << formatDuration(static_cast<double>(stats.longest));
+        if (stats.items > 0) {
+            line << " items " << stats.items;
+        }
+    }
+    if (merged.empty()) {
+        line << " no stages recorded";
+    }
+    return line.str();
+}
+
+/**
+ * @brief Prints the summary line if the summary interval has passed since the last one.
+ *
+ * Only the thread that wins the timestamp exchange prints, so concurrent workers produce one
+ * line per interval.
+ */
+void Profiler::tick(void) {
+    const int64_t interval = summaryInterval.load(memory_order_relaxed);
+    if (!isEnabled() || interval <= 0) {
+        return;
+    }
+
+    const int64_t current = now();
+    int64_t last = lastSummary.load(memory_order_relaxed);
+    if (current - last >= interval && lastSummary.compare_exchange_strong(last, current)) {
+        cout << summary() << "\n";
+    }
+}
+
+/**
+ * @brief Sets the interval of the periodic summary line.
+ *
+ * @param seconds Interval in seconds, 0 disables the periodic line.
+ */
+void Profiler::setSummaryInterval(double seconds) {
+    if (seconds < 0) {
+        throw invalid_argument("Summary interval cannot be negative");
+    }
+    summaryInterval = static_cast<int64_t>(seconds * 1e9);
+}
+
+/**
+ * @brief Writes the recorded events as a Chrome trace JSON file.
+ *
+ * Every event is a complete ("X") event in microseconds on the thread that ran it; stages
+ * with an item count carry it as an argument. Events beyond the per-thread cap are counted
+ * but not stored.
+ *
+ * @param fileName The output file.
+ */
+void Profiler::writeChromeTrace(const string& fileName) {
+    ofstream file(fileName);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + fileName);
+    }
+
+    const int64_t epoch = traceEpoch.load();
+    size_t dropped = 0;
+    bool first = true;
+
+    file << fixed << setprecision(3) << "{\"traceEvents\":[\n";
+    {
+        lock_guard<mutex> guard(registryLock);
+        for (auto& record : registry) {
+            lock_guard<mutex> recordGuard(record->lock);
+            dropped += record->droppedEvents;
+            for (const auto& event : record->events) {
+                file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record->id
+                    << ",\"ts\":" << (event.start - epoch) / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+                if (event.count > 0) {
+                    file << ",\"args\":{\"count\":" << event.count << "}";
+                }
+                file << "}";
+                first = false;
+            }
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + fileName);
+    }
+    if (dropped > 0) {
+        cerr << "Trace event limit reached, " << dropped << " events were not stored\n";
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/// Time a stage for the rest of the enclosing scope, e.g. TRACE_STAGE("detect");
+/// Declares a ScopedStage named traceStage, so traceStage.setCount(n) attaches a feature count.
+#define TRACE_STAGE(name) ScopedStage traceStage(name)
+
+/// Profiler Class
+/// Collects per-stage latency statistics and trace events while enabled. Every thread records
+/// into its own buffers, so concurrent batch workers do not contend. Latencies go into log2
+/// microsecond histograms from which the summary estimates percentiles; events can be exported
+/// as a Chrome trace (chrome://tracing, ui.perfetto.dev). When disabled, a timed scope costs one
+/// relaxed atomic load.
+class Profiler
+{
+public:
+    /// Enable or disable recording
+    /// Enabling starts the trace clock; recorded data is kept until reset().
+    /// @param enabled True to record stages.
+    static void setEnabled(bool enabled);
+
+    /// Check whether stages are recorded
+    /// @return True if recording is enabled.
+    static bool isEnabled(void) {
+        return enabled.load(memory_order_relaxed);
+    }
+
+    /// Get the current time of the trace clock
+    /// @return Nanoseconds since an arbitrary epoch.
+    static int64_t now(void) {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Record one completed stage of the calling thread
+    /// @param stage Stage name, a string literal that outlives the profiler.
+    /// @param start Start time from now().
+    /// @param duration Duration in nanoseconds.
+    /// @param count Number of items the stage produced, e.g. corners, 0 if not applicable.
+    static void record(const char* stage, int64_t start, int64_t duration, size_t count);
+
+    /// Drop all statistics and events
+    static void reset(void);
+
+    /// Summarize every stage on one line
+    /// @return "stage: calls, mean, p50, p95, max[, items]" entries separated by " | ".
+    static string summary(void);
+
+    /// Print the summary line if the summary interval has passed since the last one
+    /// Called once per image or frame by the processing loops; does nothing while disabled.
+    static void tick(void);
+
+    /// Set the interval of the periodic summary line
+    /// @param seconds Interval in seconds, 0 disables the periodic line.
+    static void setSummaryInterval(double seconds);
+
+    /// Write the recorded events as a Chrome trace JSON file
+    /// @param fileName The output file.
+    static void writeChromeTrace(const string& fileName);
+
+private:
+    static atomic<bool> enabled;            ///< Recording switch read by every scope
+};
+
+/// ScopedStage Class
+/// Times its own lifetime as one stage execution when the profiler is enabled.
+class ScopedStage
+{
+public:
+    /// Constructor starting the stage
+    /// @param stage Stage name, a string literal.
+    explicit ScopedStage(const char* stage) : stage(stage), start(Profiler::isEnabled() ? Profiler::now() : 0), count(0) {
+    }
+
+    /// Destructor recording the stage
+    ~ScopedStage() {
+        if (start != 0) {
+            Profiler::record(stage, start, Profiler::now() - start, count);
+        }
+    }
+
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+    /// Attach the number of items the stage produced
+    /// @param items Item count, e.g. detected corners.
+    void setCount(size_t items) {
+        count = items;
+    }
+
+private:
+    const char* stage;                      ///< Stage name
+    int64_t start;                          ///< Start time, 0 when the profiler was disabled
+    size_t count;                           ///< Items produced by the stage
+};
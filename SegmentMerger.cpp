@@ -0,0 +1,230 @@
+#include "SegmentMerger.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    /// Segment of the direction index, described relative to the direction of its group
+    struct IndexEntry {
+        int candidate;                      // position in the candidate list
+        float offset;                       // midpoint projection onto the group normal
+        float halfLength;                   // half the segment length
+    };
+
+    /// Find the representative of a union-find set, halving the path on the way
+    int findRoot(vector<int>& parent, int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+}
+
+/**
+ * @brief Merges matching segments in place.
+ *
+ * @param lines Segments to merge; a merged segment takes the place of its first piece and
+ *        the order of all other segments is kept.
+ * @param tolerances The match tolerances.
+ */
+void SegmentMerger::merge(vector<Vec4i>& lines, const MergeTolerances& tolerances) {
+    vector<int> candidates(lines.size());
+    iota(candidates.begin(), candidates.end(), 0);
+    merge(lines, candidates, tolerances);
+}
+
+/**
+ * @brief Merges matching segments among a subset in place.
+ *
+ * Directions are folded into [0, pi) and binned with a bin width of at least the angle
+ * tolerance, so matching segments fall into the same or adjacent bins. Each pair of adjacent
+ * bins forms a group measured against the direction of their common border; the last bin is
+ * paired with the first, whose directions continue it once turned by pi. Within a group a segment deviates from the border direction by at most
+ * one bin width e, so two matching segments with lengths la and lb have midpoint offsets
+ * along the border normal that differ by at most distance + ((la + lb) / 2 + maxGap) * sin(e).
+ * Sorting a group by offset turns the search into a sweep that stops at that bound.
+ *
+ * @param lines Segments to merge; segments outside the subset are left untouched.
+ * @param candidates Indices of the segments that may be merged.
+ * @param tolerances The match tolerances.
+ */
+void SegmentMerger::merge(vector<Vec4i>& lines, const vector<int>& candidates, const MergeTolerances& tolerances) {
+    const int count = static_cast<int>(candidates.size());
+    if (count < 2) {
+        return;
+    }
+
+    const double tolerance = max(tolerances.angle, 0.01) * CV_PI / 180.0;
+    const int bins = max(1, static_cast<int>(floor(CV_PI / tolerance)));
+    const double binWidth = CV_PI / bins;
+    const float spread = static_cast<float>(sin(min(binWidth, CV_PI / 2)));
+
+    // Bin every candidate by its folded direction
+    vector<vector<int>> binned(bins);
+    for (int c = 0; c < count; c++) {
+        const Vec4i& l = lines[candidates[c]];
+        double angle = atan2(static_cast<double>(l[3] - l[1]), static_cast<double>(l[2] - l[0]));
+        if (angle < 0) {
+            angle += CV_PI;
+        }
+        if (angle >= CV_PI) {
+            angle -= CV_PI;
+        }
+        binned[min(bins - 1, static_cast<int>(angle / binWidth))].push_back(c);
+    }
+
+    vector<int> parent(count);
+    iota(parent.begin(), parent.end(), 0);
+    vector<IndexEntry> group;
+
+    for (int bin = 0; bin < bins; bin++) {
+        const double border = (bin + 1) * binWidth;
+        const Point2f normal(static_cast<float>(-sin(border)), static_cast<float>(cos(border)));
+
+        group.clear();
+        float longestHalf = 0.0f;
+        for (int side = 0; side < 2; side++) {
+            const vector<int>& members = binned[(bin + side) % bins];
+            for (int c : members) {
+                const Vec4i& l = lines[candidates[c]];
+                const Point2f middle((l[0] + l[2]) * 0.5f, (l[1] + l[3]) * 0.5f);
+                const float halfLength = static_cast<float>(norm(Point(l[2] - l[0], l[3] - l[1]))) * 0.5f;
+                group.push_back({ c, middle.dot(normal), halfLength });
+                longestHalf = max(longestHalf, halfLength);
+            }
+            if (bins == 1) {
+                break;                      // the only bin is its own neighbor
+            }
+        }
+
+        sort(group.begin(), group.end(), [](const IndexEntry& a, const IndexEntry& b) {
+            return a.offset < b.offset;
+        });
+
+        for (size_t i = 0; i < group.size(); i++) {
+            const IndexEntry& a = group[i];
+            const float reach = tolerances.distance + (a.halfLength + longestHalf + tolerances.maxGap) * spread;
+            for (size_t j = i + 1; j < group.size() && group[j].offset - a.offset <= reach; j++) {
+                const int first = findRoot(parent, a.candidate);
+                const int second = findRoot(parent, group[j].candidate);
+                if (first != second && matches(lines[candidates[a.candidate]], lines[candidates[group[j].candidate]], tolerances)) {
+                    parent[max(first, second)] = min(first, second);
+                }
+            }
+        }
+    }
+
+    // Group the pieces of every set under its root
+    vector<vector<int>> sets(count);
+    for (int c = 0; c < count; c++) {
+        sets[findRoot(parent, c)].push_back(candidates[c]);
+    }
+
+    vector<char> drop(lines.size(), 0);
+    for (const auto& pieces : sets) {
+        if (pieces.size() < 2) {
+            continue;
+        }
+
+        int longest = pieces[0];
+        double longestLength = -1.0;
+        for (int i : pieces) {
+            const double length = norm(Point(lines[i][2] - lines[i][0], lines[i][3] - lines[i][1]));
+            if (length > longestLength) {
+                longestLength = length;
+                longest = i;
+            }
+        }
+
+        const Point2f origin(static_cast<float>(lines[longest][0]), static_cast<float>(lines[longest][1]));
+        Point2f axis(static_cast<float>(lines[longest][2]) - origin.x, static_cast<float>(lines[longest][3]) - origin.y);
+        axis *= 1.0f / static_cast<float>(longestLength);
+
+        float lowest = FLT_MAX, highest = -FLT_MAX;
+        for (int i : pieces) {
+            for (int end = 0; end < 4; end += 2) {
+                const float t = (Point2f(static_cast<float>(lines[i][end]), static_cast<float>(lines[i][end + 1])) - origin).dot(axis);
+                lowest = min(lowest, t);
+                highest = max(highest, t);
+            }
+        }
+
+        const Point2f first = origin + axis * lowest;
+        const Point2f last = origin + axis * highest;
+        const int keep = *min_element(pieces.begin(), pieces.end());
+        lines[keep] = Vec4i(cvRound(first.x), cvRound(first.y), cvRound(last.x), cvRound(last.y));
+        for (int i : pieces) {
+            if (i != keep) {
+                drop[i] = 1;
+            }
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!drop[i]) {
+            lines[kept++] = lines[i];
+        }
+    }
+    lines.resize(kept);
+}
+
+/**
+ * @brief Checks whether two segments are pieces of one line.
+ *
+ * Segment directions are ignored, so a segment matches its reversed copy.
+ *
+ * @param a The first segment.
+ * @param b The second segment.
+ * @param tolerances The match tolerances.
+ * @return True if the directions, the endpoint distances and the gap are within tolerance.
+ */
+bool SegmentMerger::matches(const Vec4i& a, const Vec4i& b, const MergeTolerances& tolerances) {
+    const Point2f a0(static_cast<float>(a[0]), static_cast<float>(a[1])), a1(static_cast<float>(a[2]), static_cast<float>(a[3]));
+    const Point2f b0(static_cast<float>(b[0]), static_cast<float>(b[1])), b1(static_cast<float>(b[2]), static_cast<float>(b[3]));
+    Point2f da = a1 - a0, db = b1 - b0;
+    const float la = static_cast<float>(norm(da)), lb = static_cast<float>(norm(db));
+    if (la < 1.0f || lb < 1.0f) {
+        return false;
+    }
+    da *= 1.0f / la;
+    db *= 1.0f / lb;
+    if (fabs(da.x * db.y - da.y * db.x) > sin(tolerances.angle * CV_PI / 180.0)) {
+        return false;
+    }
+
+    const Point2f na(-da.y, da.x), nb(-db.y, db.x);
+    if (fabs((b0 - a0).dot(na)) > tolerances.distance || fabs((b1 - a0).dot(na)) > tolerances.distance ||
+        fabs((a0 - b0).dot(nb)) > tolerances.distance || fabs((a1 - b0).dot(nb)) > tolerances.distance) {
+        return false;
+    }
+
+    const float t0 = (b0 - a0).dot(da), t1 = (b1 - a0).dot(da);
+    return min(t0, t1) <= la + tolerances.maxGap && max(t0, t1) >= -tolerances.maxGap;
+}
+
+/**
+ * @brief Parses tolerances written as "angle,distance,gap".
+ *
+ * @param description The comma separated tolerances, e.g. "3,8,10".
+ * @return The tolerances.
+ */
+MergeTolerances SegmentMerger::parseTolerances(const string& description) {
+    MergeTolerances tolerances;
+    stringstream values(description);
+    string angle, distance, gap;
+    if (!getline(values, angle, ',') || !getline(values, distance, ',') || !getline(values, gap, ',')) {
+        throw invalid_argument("Merge tolerances must be written as angle,distance,gap: " + description);
+    }
+    tolerances.angle = stod(angle);
+    tolerances.distance = stof(distance);
+    tolerances.maxGap = stoi(gap);
+    if (tolerances.angle <= 0 || tolerances.angle >= 90 || tolerances.distance < 0 || tolerances.maxGap < 0) {
+        throw invalid_argument("Merge angle must be between 0 and 90 degrees, distance and gap cannot be negative");
+    }
+    return tolerances;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+/// Tolerances deciding whether two line segments are pieces of one line
+struct MergeTolerances {
+    double angle = 3.0;                     ///< Largest direction difference in degrees
+    float distance = 8.0f;                  ///< Largest distance of an endpoint from the other segment's line in pixels
+    int maxGap = 10;                        ///< Largest gap bridged between the extents of two pieces in pixels
+};
+
+/// SegmentMerger Class
+/// Merges collinear, overlapping or nearly touching line segments, e.g. the fragments and
+/// parallel duplicates HoughLinesP reports for one physical edge. Two segments match when
+/// their directions differ by at most the angle tolerance, every endpoint lies within the
+/// distance tolerance of the other segment's line and their extents along the line overlap
+/// or leave a gap of at most maxGap. Matches are joined transitively with union-find, and
+/// every group is replaced by one segment along its longest piece, spanning the extreme
+/// projections of all piece endpoints.
+/// Candidates are found through an index binned by direction and sorted by offset from the
+/// origin, so only segments of neighboring direction bins whose offsets can still match are
+/// compared and the merge stays near-linear in the number of segments.
+class SegmentMerger
+{
+public:
+    /// Merge matching segments in place
+    /// @param lines Segments to merge; a merged segment takes the place of its first piece
+    ///        and the order of all other segments is kept.
+    /// @param tolerances The match tolerances.
+    static void merge(vector<Vec4i>& lines, const MergeTolerances& tolerances = MergeTolerances());
+
+    /// Merge matching segments among a subset in place
+    /// @param lines Segments to merge; segments outside the subset are left untouched.
+    /// @param candidates Indices of the segments that may be merged.
+    /// @param tolerances The match tolerances.
+    static void merge(vector<Vec4i>& lines, const vector<int>& candidates, const MergeTolerances& tolerances);
+
+    /// Check whether two segments are pieces of one line
+    /// @param a The first segment.
+    /// @param b The second segment.
+    /// @param tolerances The match tolerances.
+    /// @return True if the segments match.
+    static bool matches(const Vec4i& a, const Vec4i& b, const MergeTolerances& tolerances);
+
+    /// Parse tolerances written as "angle,distance,gap", e.g. "3,8,10"
+    /// @param description The comma separated tolerances.
+    /// @return The tolerances.
+    static MergeTolerances parseTolerances(const string& description);
+};
@@ -0,0 +1,389 @@
+#include "StreamProcessor.h"
+#include "BatchProcessor.h"
+#include "BufferPool.h"
+#include "Profiler.h"
+#include <opencv2/video.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+    /// Silences the console and runs the profiler for a stream run, restoring both when it ends or throws
+    class RunStateGuard {
+    public:
+        RunStateGuard(bool profiling, int profileInterval)
+            : wasVerbose(CommonProcesses::isVerbose()), profiling(profiling), active(true) {
+            CommonProcesses::setVerbose(false);
+            if (profiling) {
+                Profiler::reset();
+                Profiler::setSummaryInterval(profileInterval);
+                Profiler::setEnabled(true);
+            }
+        }
+
+        ~RunStateGuard() {
+            restore();
+        }
+
+        /// Restore the console output and stop the profiler, once
+        void restore(void) {
+            if (active) {
+                active = false;
+                CommonProcesses::setVerbose(wasVerbose);
+                if (profiling) {
+                    Profiler::setEnabled(false);
+                }
+            }
+        }
+
+    private:
+        bool wasVerbose;
+        bool profiling;
+        bool active;
+    };
+}
+
+/**
+ * @brief Constructor for StreamProcessor class.
+ *
+ * @param options The stream configuration.
+ */
+StreamProcessor::StreamProcessor(const StreamOptions& options)
+    : options(options), nextFile(0), frameCount(0), keyframeCount(0), framesPerSecond(0.0) {
+    if (this->options.source.empty()) {
+        throw invalid_argument("No stream source given");
+    }
+    if (this->options.scale <= 0) {
+        throw invalid_argument("Scale factor must be greater than 0");
+    }
+    if (this->options.minTrackedFraction < 0 || this->options.minTrackedFraction > 1) {
+        throw invalid_argument("Minimum tracked fraction must be between 0 and 1");
+    }
+    if (this->options.keyframeInterval < 0) {
+        throw invalid_argument("Keyframe interval cannot be negative");
+    }
+    if (this->options.flowWindow < 3 || this->options.flowLevels < 0) {
+        throw invalid_argument("Optical flow window must be at least 3 and pyramid levels cannot be negative");
+    }
+
+    preprocessing.grayscale();
+    if (this->options.scale != 1.0) {
+        preprocessing.rescale(this->options.scale);
+    }
+}
+
+/**
+ * @brief Destructor for StreamProcessor class.
+ */
+StreamProcessor::~StreamProcessor() {
+}
+
+/**
+ * @brief Prints command line usage to the console.
+ */
+void StreamProcessor::printUsage(void) {
+    cout << "Usage: openCV --stream <video|frame_%04d.png|directory|@list.txt> [options]\n"
+        << "  --output FILE                   Per-frame corner file (default: stream_corners.txt)\n"
+        << "  --scale S                       Scale factor applied to every frame (default: 1.0)\n"
+        << "  --quality Q                     Harris quality level (default: 50)\n"
+        << "  --harris fused|opencv|fixed     Harris implementation (default: fused)\n"
+        << "  --nms R                         Keyframe non-maximum suppression radius (default: 5)\n"
+        << "  --grid CELL                     Keyframe bucketing cell size in pixels (default: 0, off)\n"
+        << "  --grid-max N                    Corners kept per bucketing cell (default: 4)\n"
+        << "  --min-tracked F                 Redetect below this fraction of tracked corners (default: 0.7)\n"
+        << "  --keyframe-interval N           Force a keyframe every N frames (default: 0, on loss only)\n"
+        << "  --flow-window W                 Optical flow window size (default: 21)\n"
+        << "  --flow-levels L                 Optical flow pyramid levels (default: 3)\n"
+        << "  --trace FILE                    Write a Chrome trace (chrome://tracing, Perfetto) of every stage\n"
+        << "  --profile S                     Print a stage timing summary every S seconds\n";
+}
+
+/**
+ * @brief Builds stream options from command line arguments.
+ *
+ * @param argc Argument count as received by main.
+ * @param argv Argument values as received by main.
+ * @return The parsed options.
+ */
+StreamOptions StreamProcessor::parseArguments(int argc, char** argv) {
+    StreamOptions parsed;
+
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (i + 1 >= argc) {
+            throw invalid_argument("Missing value for argument: " + argument);
+        }
+        string value = argv[++i];
+
+        if (argument == "--stream") {
+            parsed.source = value;
+        }
+        else if (argument == "--output") {
+            parsed.outputFile = value;
+        }
+        else if (argument == "--scale") {
+            parsed.scale = stod(value);
+        }
+        else if (argument == "--quality") {
+            parsed.qualityLevel = stoi(value);
+        }
+        else if (argument == "--harris") {
+            if (value == "fused") parsed.harrisEngine = HarrisEngine::Fused;
+            else if (value == "opencv") parsed.harrisEngine = HarrisEngine::OpenCV;
+            else if (value == "fixed") parsed.harrisEngine = HarrisEngine::FixedPoint;
+            else throw invalid_argument("Unknown Harris engine: " + value);
+        }
+        else if (argument == "--nms") {
+            parsed.suppressionRadius = stoi(value);
+        }
+        else if (argument == "--grid") {
+            parsed.gridCellSize = stoi(value);
+        }
+        else if (argument == "--grid-max") {
+            parsed.maxCornersPerCell = stoi(value);
+        }
+        else if (argument == "--min-tracked") {
+            parsed.minTrackedFraction = stod(value);
+        }
+        else if (argument == "--keyframe-interval") {
+            parsed.keyframeInterval = stoi(value);
+        }
+        else if (argument == "--flow-window") {
+            parsed.flowWindow = stoi(value);
+        }
+        else if (argument == "--flow-levels") {
+            parsed.flowLevels = stoi(value);
+        }
+        else if (argument == "--trace") {
+            parsed.traceFile = value;
+        }
+        else if (argument == "--profile") {
+            parsed.profileInterval = stod(value);
+        }
+        else {
+            throw invalid_argument("Unknown argument: " + argument);
+        }
+    }
+
+    if (parsed.source.empty()) {
+        throw invalid_argument("No input given, use --stream <video|frame_%04d.png|directory|@list.txt>");
+    }
+
+    return parsed;
+}
+
+/**
+ * @brief Processes every frame of the source and reports the sustained frame rate.
+ *
+ * Each frame is converted to grayscale by the preprocessing pipeline, whose output never
+ * shares memory with the frame the capture may overwrite on the next read. Its optical flow
+ * pyramid is built once and kept as the previous frame of the next step, so no frame is
+ * pyramided twice.
+ * Tracks that fail or leave the frame are dropped. A keyframe, i.e. a fresh Harris
+ * detection replacing all tracks, is taken on the first frame, whenever the surviving
+ * tracks fall below minTrackedFraction of the last keyframe's corners, and optionally every
+ * keyframeInterval frames. A frame of another size than the previous one (image sequences may
+ * mix sizes) cannot be tracked into, so it is always a keyframe. Console output and the
+ * profiler are restored even when a frame throws.
+ *
+ * @return The number of frames processed.
+ */
+int StreamProcessor::run(void) {
+    openSource();
+
+    ofstream file(options.outputFile);
+    if (!file.is_open()) {
+        throw runtime_error("Error: Could not open file: " + options.outputFile);
+    }
+
+    const bool profiling = !options.traceFile.empty() || options.profileInterval > 0;
+    RunStateGuard runState(profiling, options.profileInterval);
+
+    frameCount = 0;
+    keyframeCount = 0;
+
+    unique_ptr<CornerDetection> detector;
+    const Size window(options.flowWindow, options.flowWindow);
+    Mat frame;
+    vector<Mat> pyramid, previousPyramid;
+    vector<Point2f> points, tracked;
+    vector<uchar> status;
+    vector<float> error;
+    vector<Point> detected;
+    size_t keyframePoints = 0;
+    int sinceKeyframe = 0;
+
+    BufferPoolStats poolBefore = BufferPool::getGlobalStats();
+    int64 start = getTickCount();
+
+    while (readFrame(frame)) {
+        TRACE_STAGE("frame");
+        if (!detector) {
+            double scale = options.scale;
+            detector.reset(new CornerDetection(frame, options.source, scale));
+            detector->setQualityLevel(options.qualityLevel);
+            detector->setHarrisEngine(options.harrisEngine);
+            detector->setSuppressionRadius(options.suppressionRadius);
+            detector->setGridBucketing(options.gridCellSize, options.maxCornersPerCell);
+        }
+
+        const Mat& gray = preprocessing.run(frame);
+        if (!previousPyramid.empty() && previousPyramid[0].size() != gray.size()) {
+            previousPyramid.clear();
+            points.clear();
+            keyframePoints = 0;
+        }
+        buildOpticalFlowPyramid(gray, pyramid, window, options.flowLevels);
+
+        // Follow the current tracks and drop the lost ones
+        if (!points.empty() && !previousPyramid.empty()) {
+            TRACE_STAGE("track");
+            calcOpticalFlowPyrLK(previousPyramid, pyramid, points, tracked, status, error, window, options.flowLevels);
+
+            size_t kept = 0;
+            const Rect2f frameArea(0.0f, 0.0f, static_cast<float>(gray.cols), static_cast<float>(gray.rows));
+            for (size_t i = 0; i < tracked.size(); i++) {
+                if (status[i] && frameArea.contains(tracked[i])) {
+                    points[kept++] = tracked[i];
+                }
+            }
+            points.resize(kept);
+        }
+
+        bool keyframe = keyframePoints == 0 ||
+            points.size() < options.minTrackedFraction * keyframePoints ||
+            (options.keyframeInterval > 0 && sinceKeyframe >= options.keyframeInterval);
+        if (keyframe) {
+            TRACE_STAGE("keyframe");
+            detector->detectCorners(gray, detected);
+            traceStage.setCount(detected.size());
+            points.clear();
+            for (const auto& corner : detected) {
+                points.push_back(Point2f(static_cast<float>(corner.x), static_cast<float>(corner.y)));
+            }
+            keyframePoints = points.size();
+            sinceKeyframe = 0;
+            keyframeCount++;
+        }
+        sinceKeyframe++;
+
+        writeFrame(file, frameCount, keyframe, points);
+        swap(pyramid, previousPyramid);
+        frameCount++;
+        Profiler::tick();
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    framesPerSecond = seconds > 0 ? frameCount / seconds : 0.0;
+
+    runState.restore();
+
+    cout << "Processed " << frameCount << " frames (" << keyframeCount << " keyframes) in "
+        << seconds << " s: " << framesPerSecond << " frames/sec\n"
+        << BufferPool::summarize(poolBefore) << "\n";
+
+    if (profiling) {
+        cout << Profiler::summary() << "\n";
+        if (!options.traceFile.empty()) {
+            Profiler::writeChromeTrace(options.traceFile);
+            cout << "Trace written to " << options.traceFile << "\n";
+        }
+    }
+
+    return frameCount;
+}
+
+/**
+ * @brief Opens the source as a video or, failing that, as a list of image files.
+ *
+ * VideoCapture handles video files and printf style image sequence patterns; directories,
+ * glob patterns and "@list.txt" files are expanded like the batch inputs.
+ */
+void StreamProcessor::openSource(void) {
+    capture.release();
+    frameFiles.clear();
+    nextFile = 0;
+
+    if (options.source[0] != '@' && capture.open(options.source) && capture.isOpened()) {
+        return;
+    }
+
+    frameFiles = BatchProcessor::collectInputs(options.source);
+    if (frameFiles.empty()) {
+        throw runtime_error("Could not open video or image sequence: " + options.source);
+    }
+}
+
+/**
+ * @brief Reads the next frame of the source.
+ *
+ * @param frame Output frame.
+ * @return False once the source is exhausted.
+ */
+bool StreamProcessor::readFrame(Mat& frame) {
+    TRACE_STAGE("decode");
+    if (capture.isOpened()) {
+        return capture.read(frame) && !frame.empty();
+    }
+
+    if (nextFile >= frameFiles.size()) {
+        return false;
+    }
+
+    const string& path = frameFiles[nextFile++];
+    frame = imread(path, IMREAD_COLOR);
+    if (frame.empty()) {
+        throw runtime_error("Image could not be loaded: " + path);
+    }
+    return true;
+}
+
+/**
+ * @brief Appends the corner set of one frame to the output file.
+ *
+ * The set is formatted into a reused buffer and handed to the stream in one write.
+ *
+ * @param file The output file.
+ * @param index The frame index.
+ * @param keyframe True if the corners were detected on this frame.
+ * @param points The corner positions.
+ */
+void StreamProcessor::writeFrame(ofstream& file, int index, bool keyframe, const vector<Point2f>& points) {
+    frameText.clear();
+    frameText += "Frame: " + to_string(index) + (keyframe ? " keyframe " : " tracked ") + to_string(points.size()) + "\n";
+    for (const auto& point : points) {
+        frameText += "Point: (" + to_string(cvRound(point.x)) + ", " + to_string(cvRound(point.y)) + ")\n";
+    }
+
+    file.write(frameText.data(), frameText.size());
+    if (!file) {
+        throw runtime_error("Error: Could not write file: " + options.outputFile);
+    }
+}
+
+/**
+ * @brief Gets the number of frames processed by the last run.
+ *
+ * @return The frame count.
+ */
+int StreamProcessor::getFrameCount(void) const {
+    return frameCount;
+}
+
+/**
+ * @brief Gets the number of keyframes of the last run.
+ *
+ * @return The keyframe count.
+ */
+int StreamProcessor::getKeyframeCount(void) const {
+    return keyframeCount;
+}
+
+/**
+ * @brief Gets the sustained throughput of the last run.
+ *
+ * @return Frames per second, including decoding and writing.
+ */
+double StreamProcessor::getFramesPerSecond(void) const {
+    return framesPerSecond;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "CornerDetection.h"
+#include "PreprocessingPipeline.h"
+
+using namespace std;
+using namespace cv;
+
+/// Options for a streaming corner run
+struct StreamOptions {
+    string source;                          ///< Video file, image sequence pattern ("frame_%04d.png"), directory or @list.txt
+    string outputFile = "stream_corners.txt"; ///< File receiving the per-frame corner sets
+    double scale = 1.0;                     ///< Scale factor applied to every frame before detection
+    int qualityLevel = 50;                  ///< Harris quality level for keyframe detection
+    HarrisEngine harrisEngine = HarrisEngine::Fused; ///< Harris response implementation
+    int suppressionRadius = 5;              ///< Keyframe non-maximum suppression radius, so every corner is tracked once
+    int gridCellSize = 0;                   ///< Keyframe bucketing cell size, 0 disables it
+    int maxCornersPerCell = 4;              ///< Corners kept per bucketing cell
+    double minTrackedFraction = 0.7;        ///< Redetect once fewer than this fraction of the keyframe corners are tracked
+    int keyframeInterval = 0;               ///< Force a keyframe every N frames, 0 redetects on track loss only
+    int flowWindow = 21;                    ///< Optical flow search window size in pixels
+    int flowLevels = 3;                     ///< Highest optical flow pyramid level, 0 tracks at full resolution only
+    string traceFile;                       ///< Chrome trace of all stages, empty disables it
+    double profileInterval = 0.0;           ///< Seconds between stage summary lines, 0 disables them
+};
+
+/// StreamProcessor Class
+/// Runs corner detection over a video file or an image sequence without opening any window.
+/// Corners are detected on keyframes only and followed between keyframes with pyramidal
+/// Lucas-Kanade optical flow; a new keyframe is taken when too many tracks are lost.
+/// Every frame's corner set is written to one text file, each set preceded by a
+/// "Frame: <index> <keyframe|tracked> <count>" line.
+class StreamProcessor {
+public:
+    /// Constructor
+    /// @param options The stream configuration.
+    explicit StreamProcessor(const StreamOptions& options);
+
+    /// Destructor
+    ~StreamProcessor();
+
+    /// Build stream options from command line arguments
+    /// @param argc Argument count as received by main.
+    /// @param argv Argument values as received by main.
+    /// @return The parsed options.
+    static StreamOptions parseArguments(int argc, char** argv);
+
+    /// Print command line usage to the console
+    static void printUsage(void);
+
+    /// Process every frame of the source and report the sustained frame rate
+    /// @return The number of frames processed.
+    int run(void);
+
+    /// Get the number of frames processed by the last run
+    /// @return The frame count.
+    int getFrameCount(void) const;
+
+    /// Get the number of keyframes of the last run
+    /// @return The keyframe count.
+    int getKeyframeCount(void) const;
+
+    /// Get the sustained throughput of the last run
+    /// @return Frames per second, including decoding and writing.
+    double getFramesPerSecond(void) const;
+
+private:
+    /// Open the source as a video or, failing that, as a list of image files
+    void openSource(void);
+
+    /// Read the next frame of the source
+    /// @param frame Output frame.
+    /// @return False once the source is exhausted.
+    bool readFrame(Mat& frame);
+
+    /// Append the corner set of one frame to the output file
+    /// @param file The output file.
+    /// @param index The frame index.
+    /// @param keyframe True if the corners were detected on this frame.
+    /// @param points The corner positions.
+    void writeFrame(ofstream& file, int index, bool keyframe, const vector<Point2f>& points);
+
+    StreamOptions options;                  ///< Stream configuration
+    VideoCapture capture;                   ///< Video or image sequence reader
+    vector<string> frameFiles;              ///< Image files when the source is a directory or list
+    size_t nextFile;                        ///< Index of the next image file to read
+    PreprocessingPipeline preprocessing;    ///< Grayscale conversion and rescaling, buffers reused between frames
+    string frameText;                       ///< Scratch buffer for the formatted corner set
+    int frameCount;                         ///< Frames processed by the last run
+    int keyframeCount;                      ///< Keyframes of the last run
+    double framesPerSecond;                 ///< Throughput of the last run
+};
@@ -0,0 +1,187 @@
+#include "TileSource.h"
+#include "Profiler.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Constructor for TileSource class.
+ *
+ * @param size The image size.
+ * @param channels Channels of the returned regions.
+ * @param mapped True if regions are decoded on demand.
+ */
+TileSource::TileSource(Size size, int channels, bool mapped)
+    : size(size), channels(channels), mapped(mapped) {
+}
+
+/**
+ * @brief Destructor for TileSource class.
+ */
+TileSource::~TileSource() {
+}
+
+/**
+ * @brief Opens an image file with the cheapest available reader.
+ *
+ * Binary PNM files with 8-bit samples are mapped; every other format is decoded once as
+ * 8-bit grayscale, because the tiled detectors only need the gray image.
+ *
+ * @param filePath The image file.
+ * @return The source.
+ */
+unique_ptr<TileSource> TileSource::open(const string& filePath) {
+    unique_ptr<TileSource> source;
+    if (PnmTileSource::canOpen(filePath)) {
+        source.reset(new PnmTileSource(filePath));
+        return source;
+    }
+
+    TRACE_STAGE("read");
+    Mat gray = imread(filePath, IMREAD_GRAYSCALE);
+    if (gray.empty()) {
+        cerr << "Image could not be loaded : " << filePath << endl;
+        throw runtime_error("Image could not be loaded");
+    }
+    source.reset(new MatTileSource(gray));
+    return source;
+}
+
+/**
+ * @brief Wraps an image that is already in memory.
+ *
+ * @param image The BGR or grayscale image, shared rather than copied.
+ * @return The source.
+ */
+unique_ptr<TileSource> TileSource::fromImage(const Mat& image) {
+    unique_ptr<TileSource> source(new MatTileSource(image));
+    return source;
+}
+
+/**
+ * @brief Gets the image size.
+ *
+ * @return Width and height of the whole image.
+ */
+Size TileSource::getSize(void) const {
+    return size;
+}
+
+/**
+ * @brief Gets the number of channels of the regions returned by read.
+ *
+ * @return 1 for grayscale sources, 3 for BGR sources.
+ */
+int TileSource::getChannels(void) const {
+    return channels;
+}
+
+/**
+ * @brief Checks whether the source decodes regions on demand.
+ *
+ * @return True for mapped sources.
+ */
+bool TileSource::isMapped(void) const {
+    return mapped;
+}
+
+/**
+ * @brief Constructor for MatTileSource class.
+ *
+ * @param image The BGR or grayscale 8-bit image, shared rather than copied.
+ */
+MatTileSource::MatTileSource(const Mat& image)
+    : TileSource(image.size(), image.channels(), false), image(image) {
+    if (image.empty() || (image.type() != CV_8UC1 && image.type() != CV_8UC3)) {
+        throw runtime_error("Tile source needs an 8-bit grayscale or BGR image");
+    }
+}
+
+/**
+ * @brief Copies a region of the image.
+ *
+ * @param region The region, inside the image.
+ * @param tile Output copy of the region.
+ */
+void MatTileSource::read(const Rect& region, Mat& tile) const {
+    image(region).copyTo(tile);
+}
+
+/**
+ * @brief Constructor for PnmTileSource class.
+ *
+ * @param filePath The P5 or P6 file.
+ */
+PnmTileSource::PnmTileSource(const string& filePath)
+    : PnmTileSource(filePath, requireHeader(filePath)) {
+}
+
+/**
+ * @brief Constructor mapping a file whose header has been parsed.
+ *
+ * @param filePath The file to map.
+ * @param layout The pixel layout read from the header of the file.
+ */
+PnmTileSource::PnmTileSource(const string& filePath, const RawImageLayout& layout)
+    : TileSource(layout.size, CV_MAT_CN(layout.type), true), file(filePath), pixelOffset(layout.offset) {
+    const size_t pixelBytes = static_cast<size_t>(layout.size.width) * layout.size.height * CV_ELEM_SIZE(layout.type);
+    if (file.size() < pixelOffset + pixelBytes) {
+        throw runtime_error("Error: PNM file is truncated: " + filePath);
+    }
+}
+
+/**
+ * @brief Checks whether a file is a binary PNM file with 8-bit samples.
+ *
+ * @param filePath The file to check.
+ * @return True if PnmTileSource can map it.
+ */
+bool PnmTileSource::canOpen(const string& filePath) {
+    RawImageLayout layout;
+    return MappedImage::readPnmLayout(filePath, layout);
+}
+
+/**
+ * @brief Parses the header of a PNM file, throwing if it cannot be mapped.
+ *
+ * @param filePath The file to parse.
+ * @return The layout.
+ */
+RawImageLayout PnmTileSource::requireHeader(const string& filePath) {
+    RawImageLayout layout;
+    if (!MappedImage::readPnmLayout(filePath, layout)) {
+        throw runtime_error("Error: Not a binary PNM file with 8-bit samples: " + filePath);
+    }
+    return layout;
+}
+
+/**
+ * @brief Copies a region of the image, converting RGB samples to BGR.
+ *
+ * The region is addressed in place inside the mapping, so only its pages are touched.
+ *
+ * @param region The region, inside the image.
+ * @param tile Output copy of the region.
+ */
+void PnmTileSource::read(const Rect& region, Mat& tile) const {
+    TRACE_STAGE("read");
+    const Size size = getSize();
+    const int channels = getChannels();
+    if (region.x < 0 || region.y < 0 || region.width <= 0 || region.height <= 0 ||
+        region.x + region.width > size.width || region.y + region.height > size.height) {
+        throw out_of_range("Tile region lies outside the image");
+    }
+
+    const size_t rowBytes = static_cast<size_t>(size.width) * channels;
+    unsigned char* first = const_cast<unsigned char*>(file.data()) + pixelOffset
+        + static_cast<size_t>(region.y) * rowBytes + static_cast<size_t>(region.x) * channels;
+    Mat view(region.height, region.width, CV_8UC(channels), first, rowBytes);
+
+    if (channels == 3) {
+        cvtColor(view, tile, COLOR_RGB2BGR);
+    }
+    else {
+        view.copyTo(tile);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+#include "MappedFile.h"
+#include "MappedImage.h"
+
+using namespace std;
+using namespace cv;
+
+/// TileSource Class
+/// Reads rectangular regions of an image that is too large to decode into one frame.
+/// Binary 8-bit PNM files (P5 gray, P6 color) are memory mapped and every region is copied
+/// straight out of the mapping, so only the pages of the regions in flight are resident.
+/// Other formats are decoded once as 8-bit grayscale, since the image codecs cannot decode
+/// a region on its own; that still needs a third of the memory of the BGR frame and none of
+/// the full-frame intermediates. read() may be called from several threads at once.
+class TileSource
+{
+public:
+    /// Destructor
+    virtual ~TileSource();
+
+    /// Open an image file with the cheapest available reader
+    /// @param filePath The image file.
+    /// @return The source, mapped for binary PNM files and decoded otherwise.
+    static unique_ptr<TileSource> open(const string& filePath);
+
+    /// Wrap an image that is already in memory
+    /// @param image The BGR or grayscale image, shared rather than copied.
+    /// @return The source.
+    static unique_ptr<TileSource> fromImage(const Mat& image);
+
+    /// Get the image size
+    /// @return Width and height of the whole image.
+    Size getSize(void) const;
+
+    /// Get the number of channels of the regions returned by read
+    /// @return 1 for grayscale sources, 3 for BGR sources.
+    int getChannels(void) const;
+
+    /// Check whether the source decodes regions on demand instead of holding the whole image
+    /// @return True for mapped sources.
+    bool isMapped(void) const;
+
+    /// Copy a region of the image
+    /// @param region The region, inside the image.
+    /// @param tile Output 8-bit image of the region size with getChannels() channels.
+    virtual void read(const Rect& region, Mat& tile) const = 0;
+
+protected:
+    /// Constructor
+    /// @param size The image size.
+    /// @param channels Channels of the returned regions.
+    /// @param mapped True if regions are decoded on demand.
+    TileSource(Size size, int channels, bool mapped);
+
+private:
+    Size size;                      ///< Image size
+    int channels;                   ///< Channels of the returned regions
+    bool mapped;                    ///< True if regions are decoded on demand
+};
+
+/// MatTileSource Class
+/// Tile source over an image held in memory.
+class MatTileSource : public TileSource
+{
+public:
+    /// Constructor
+    /// @param image The BGR or grayscale 8-bit image, shared rather than copied.
+    explicit MatTileSource(const Mat& image);
+
+    /// Copy a region of the image
+    /// @param region The region, inside the image.
+    /// @param tile Output copy of the region.
+    void read(const Rect& region, Mat& tile) const override;
+
+private:
+    Mat image;                      ///< The whole image
+};
+
+/// PnmTileSource Class
+/// Tile source over a memory mapped binary PNM file with 8-bit samples.
+class PnmTileSource : public TileSource
+{
+public:
+    /// Constructor mapping the file and parsing its header
+    /// @param filePath The P5 or P6 file.
+    explicit PnmTileSource(const string& filePath);
+
+    /// Check whether a file is a binary PNM file with 8-bit samples
+    /// @param filePath The file to check.
+    /// @return True if PnmTileSource can map it.
+    static bool canOpen(const string& filePath);
+
+    /// Copy a region of the image, converting RGB samples to BGR
+    /// @param region The region, inside the image.
+    /// @param tile Output copy of the region.
+    void read(const Rect& region, Mat& tile) const override;
+
+private:
+    /// Constructor from a parsed header
+    /// @param filePath The file to map.
+    /// @param layout The pixel layout read from the header of the file.
+    PnmTileSource(const string& filePath, const RawImageLayout& layout);
+
+    /// Parse the header of a PNM file, throws if it cannot be mapped
+    /// @param filePath The file to parse.
+    /// @return The layout.
+    static RawImageLayout requireHeader(const string& filePath);
+
+    MappedFile file;                ///< Mapping of the whole file
+    size_t pixelOffset;             ///< Byte offset of the first pixel
+};
@@ -0,0 +1,645 @@
+#include "TiledProcessor.h"
+#include "CornerDetection.h"
+#include "LineDetection.h"
+#include "HarrisKernel.h"
+#include "BufferPool.h"
+#include "FeatureFile.h"
+#include "Profiler.h"
+#include "SegmentMerger.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace {
+    const int cornerFootprint = 4;          // Sobel aperture and structure tensor window, with slack
+    const int cannyLowThreshold = 50;       // Canny and HoughLinesP settings of LineDetection
+    const int houghThreshold = 50;
+    const int minLineLength = 50;
+    const int maxLineGap = 10;
+    const double stitchAngle = 2.0;         // degrees
+    const float stitchDistance = 2.0f;
+
+    /// Cut an image into tile cores in raster order
+    vector<Rect> tileGrid(Size size, int tileSize) {
+        vector<Rect> tiles;
+        for (int y = 0; y < size.height; y += tileSize) {
+            for (int x = 0; x < size.width; x += tileSize) {
+                tiles.push_back(Rect(x, y, min(tileSize, size.width - x), min(tileSize, size.height - y)));
+            }
+        }
+        return tiles;
+    }
+
+    /// Grow a tile core by a margin, clipped to the image
+    Rect padded(const Rect& core, int margin, Size size) {
+        return Rect(core.x - margin, core.y - margin, core.width + 2 * margin, core.height + 2 * margin) & Rect(0, 0, size.width, size.height);
+    }
+
+    /// Runs the profiler for a tiled run, restoring its previous state when the run ends or throws
+    class ProfilerGuard {
+    public:
+        ProfilerGuard(bool profiling, double profileInterval)
+            : wasEnabled(Profiler::isEnabled()), profiling(profiling), active(true) {
+            if (profiling) {
+                Profiler::reset();
+                Profiler::setSummaryInterval(profileInterval);
+                Profiler::setEnabled(true);
+            }
+        }
+
+        ~ProfilerGuard() {
+            restore();
+        }
+
+        /// Restore the previous profiler state, once
+        void restore(void) {
+            if (active) {
+                active = false;
+                if (profiling) {
+                    Profiler::setEnabled(wasEnabled);
+                }
+            }
+        }
+
+    private:
+        bool wasEnabled;
+        bool profiling;
+        bool active;
+    };
+}
+
+/**
+ * @brief Constructor for TiledProcessor class.
+ *
+ * @param options The tiled run configuration.
+ */
+TiledProcessor::TiledProcessor(const TiledOptions& options)
+    : options(options), filterRadius(0), tileCount(0), halo(0) {
+    if (this->options.tileSize < 64) {
+        throw invalid_argument("Tile size must be at least 64 pixels");
+    }
+    if (this->options.lineHalo < 0) {
+        throw invalid_argument("Line halo cannot be negative");
+    }
+    if (this->options.workers < 1) {
+        throw invalid_argument("Worker count must be at least 1");
+    }
+    if (this->options.qualityLevel < 0 || this->options.qualityLevel > 100) {
+        throw invalid_argument("Quality level must be between 0 and 100");
+    }
+    if (this->options.suppressionRadius < 0) {
+        throw invalid_argument("Suppression radius cannot be negative");
+    }
+    if (this->options.gridCellSize < 0 || (this->options.gridCellSize > 0 && this->options.maxCornersPerCell < 1)) {
+        throw invalid_argument("Grid cell size cannot be negative and each cell must keep at least one corner");
+    }
+
+    preprocessing = buildPipeline();
+    for (const auto& step : preprocessing.getSteps()) {
+        if (step.stage == PreprocessStage::Gaussian || step.stage == PreprocessStage::Median) {
+            filterRadius += step.kernelSize / 2;
+        }
+    }
+}
+
+/**
+ * @brief Destructor for TiledProcessor class.
+ */
+TiledProcessor::~TiledProcessor() {
+}
+
+/**
+ * @brief Prints command line usage to the console.
+ */
+void TiledProcessor::printUsage(void) {
+    cout << "Usage: openCV --tiled <image> [options]\n"
+        << "  --detector corners|lines|both   Detectors to run (default: corners)\n"
+        << "  --tile N                        Tile width and height in pixels (default: 2048)\n"
+        << "  --halo H                        Extra tile margin for line detection (default: 32)\n"
+        << "  --workers N                     Worker threads, one tile each (default: hardware concurrency)\n"
+        << "  --output DIR                    Existing directory for feature files (default: .)\n"
+        << "  --filter none|gaussian|median   Noise filter applied before detection (default: none)\n"
+        << "  --filter-size K                 Filter aperture (default: 3 gaussian, 11 median)\n"
+        << "  --filter-backend NAME           auto|opencv|histogram|recursive|small (default: auto)\n"
+        << "  --pipeline STAGES               Preprocessing stages replacing --filter, without rescale\n"
+        << "  --lines hough|lsd               Line engine: Canny + HoughLinesP or the LSD segment detector (default: hough)\n"
+        << "  --merge-lines off|on|A,D,G      Merge collinear segments within A degrees, D pixels and gaps of G pixels\n"
+        << "                                  (default: off; on uses 3,8,10)\n"
+        << "  --quality Q                     Harris quality level (default: 50)\n"
+        << "  --nms R                         Corner non-maximum suppression radius (default: 0, off)\n"
+        << "  --grid CELL                     Corner bucketing cell size in pixels (default: 0, off)\n"
+        << "  --grid-max N                    Corners kept per bucketing cell (default: 4)\n"
+        << "  --format text|binary            Feature file format (default: text)\n"
+        << "  --trace FILE                    Write a Chrome trace (chrome://tracing, Perfetto) of every stage\n"
+        << "  --profile S                     Print a stage timing summary every S seconds\n"
+        << "  Binary PNM images (.pgm, .ppm) are memory mapped, other formats are decoded once as grayscale\n";
+}
+
+/**
+ * @brief Builds tiled options from command line arguments.
+ *
+ * @param argc Argument count as received by main.
+ * @param argv Argument values as received by main.
+ * @return The parsed options.
+ */
+TiledOptions TiledProcessor::parseArguments(int argc, char** argv) {
+    TiledOptions parsed;
+    parsed.workers = max(1, static_cast<int>(thread::hardware_concurrency()));
+
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (i + 1 >= argc) {
+            throw invalid_argument("Missing value for argument: " + argument);
+        }
+        string value = argv[++i];
+
+        if (argument == "--tiled") {
+            parsed.input = value;
+        }
+        else if (argument == "--detector") {
+            if (value == "corners") parsed.detector = BatchDetector::Corners;
+            else if (value == "lines") parsed.detector = BatchDetector::Lines;
+            else if (value == "both") parsed.detector = BatchDetector::Both;
+            else throw invalid_argument("Unknown detector: " + value);
+        }
+        else if (argument == "--tile") {
+            parsed.tileSize = stoi(value);
+        }
+        else if (argument == "--halo") {
+            parsed.lineHalo = stoi(value);
+        }
+        else if (argument == "--workers") {
+            parsed.workers = stoi(value);
+        }
+        else if (argument == "--output") {
+            parsed.outputDirectory = value;
+        }
+        else if (argument == "--filter") {
+            if (value == "none") parsed.filter = BatchFilter::None;
+            else if (value == "gaussian") parsed.filter = BatchFilter::Gaussian;
+            else if (value == "median") parsed.filter = BatchFilter::Median;
+            else throw invalid_argument("Unknown filter: " + value);
+        }
+        else if (argument == "--filter-size") {
+            parsed.filterSize = stoi(value);
+        }
+        else if (argument == "--filter-backend") {
+            parsed.filterBackend = NoiseFilter::parseBackend(value);
+        }
+        else if (argument == "--pipeline") {
+            parsed.pipeline = value;
+        }
+        else if (argument == "--lines") {
+            if (value == "hough") parsed.lineEngine = LineEngine::Hough;
+            else if (value == "lsd") parsed.lineEngine = LineEngine::SegmentDetector;
+            else throw invalid_argument("Unknown line engine: " + value);
+        }
+        else if (argument == "--merge-lines") {
+            parsed.mergeLines = value != "off";
+            if (value != "on" && value != "off") {
+                parsed.mergeTolerances = SegmentMerger::parseTolerances(value);
+            }
+        }
+        else if (argument == "--quality") {
+            parsed.qualityLevel = stoi(value);
+        }
+        else if (argument == "--nms") {
+            parsed.suppressionRadius = stoi(value);
+        }
+        else if (argument == "--grid") {
+            parsed.gridCellSize = stoi(value);
+        }
+        else if (argument == "--grid-max") {
+            parsed.maxCornersPerCell = stoi(value);
+        }
+        else if (argument == "--format") {
+            if (value == "text") parsed.binaryOutput = false;
+            else if (value == "binary") parsed.binaryOutput = true;
+            else throw invalid_argument("Unknown format: " + value);
+        }
+        else if (argument == "--trace") {
+            parsed.traceFile = value;
+        }
+        else if (argument == "--profile") {
+            parsed.profileInterval = stod(value);
+        }
+        else {
+            throw invalid_argument("Unknown argument: " + argument);
+        }
+    }
+
+    if (parsed.input.empty()) {
+        throw invalid_argument("No input given, use --tiled <image>");
+    }
+
+    return parsed;
+}
+
+/**
+ * @brief Detects the features of the input image and saves them.
+ *
+ * Corners and lines go to separate files named after the input image, as in batch mode.
+ * The profiler returns to its previous state even when detection or saving throws.
+ *
+ * @return The number of tiles processed.
+ */
+int TiledProcessor::run(void) {
+    const bool profiling = !options.traceFile.empty() || options.profileInterval > 0;
+    ProfilerGuard profilerState(profiling, options.profileInterval);
+
+    BufferPoolStats poolBefore = BufferPool::getGlobalStats();
+    int64 start = getTickCount();
+
+    unique_ptr<TileSource> source = TileSource::open(options.input);
+    vector<Point> corners;
+    vector<Vec4i> lines;
+    detect(*source, corners, lines);
+
+    {
+        TRACE_STAGE("save");
+        traceStage.setCount(corners.size() + lines.size());
+        const Size size = source->getSize();
+        if (options.detector != BatchDetector::Lines) {
+            if (options.binaryOutput) {
+                FeatureFileHeader header = FeatureFile::makeHeader(options.input, size.width, size.height);
+                header.scaleFactor = 1.0f;
+                header.detectors = FeatureFileCorners;
+                header.qualityLevel = options.qualityLevel;
+                header.suppressionRadius = options.suppressionRadius;
+                FeatureFile::writeBinary(outputPathFor("_corners.feat"), header, corners, vector<Vec4i>());
+            }
+            else {
+                FeatureFile::writeText(outputPathFor("_corners.txt"), corners, vector<Vec4i>());
+            }
+        }
+        if (options.detector != BatchDetector::Corners) {
+            if (options.binaryOutput) {
+                FeatureFileHeader header = FeatureFile::makeHeader(options.input, size.width, size.height);
+                header.scaleFactor = 1.0f;
+                header.detectors = FeatureFileLines;
+                if (options.lineEngine == LineEngine::Hough) {
+                    header.cannyLowThreshold = cannyLowThreshold;
+                    header.houghThreshold = houghThreshold;
+                }
+                FeatureFile::writeBinary(outputPathFor("_lines.feat"), header, vector<Point>(), lines);
+            }
+            else {
+                FeatureFile::writeText(outputPathFor("_lines.txt"), vector<Point>(), lines);
+            }
+        }
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    const Size size = source->getSize();
+    cout << "Processed " << size.width << "x" << size.height << " image as " << tileCount << " tiles of "
+        << options.tileSize << " px (halo " << halo << ", " << (source->isMapped() ? "mapped" : "decoded") << ") in "
+        << seconds << " s with " << options.workers << " workers: " << corners.size() << " corners, "
+        << lines.size() << " lines\n"
+        << BufferPool::summarize(poolBefore) << "\n";
+
+    profilerState.restore();
+    if (profiling) {
+        cout << Profiler::summary() << "\n";
+        if (!options.traceFile.empty()) {
+            Profiler::writeChromeTrace(options.traceFile);
+            cout << "Trace written to " << options.traceFile << "\n";
+        }
+    }
+
+    return tileCount;
+}
+
+/**
+ * @brief Detects the features of an image tile by tile.
+ *
+ * Corners need the global Harris response range for the min-max normalization the quality
+ * level refers to, so they take two passes: the first computes the response of every tile
+ * and reduces it to its minimum and maximum over the tile core, the second recomputes it,
+ * normalizes it with the global range and thresholds and suppresses the core exactly as
+ * CornerDetection::detectCorners does on the full frame. The corner halo covers the filter
+ * radius, the derivative and tensor footprint and the suppression radius, so results match
+ * the full-frame detection. Lines run the line engine on the tile with the line halo;
+ * hysteresis, the probabilistic Hough transform and segment region growing are not local,
+ * so segments are kept by the tile holding their midpoint and then stitched across seams. Responses, edge maps and
+ * tile buffers are leased from the workers' buffer pools and reused tile after tile.
+ *
+ * @param source The image.
+ * @param corners Output corners in image coordinates, raster order.
+ * @param lines Output line segments in image coordinates.
+ */
+void TiledProcessor::detect(const TileSource& source, vector<Point>& corners, vector<Vec4i>& lines) {
+    corners.clear();
+    lines.clear();
+
+    const Size size = source.getSize();
+    const vector<Rect> tiles = tileGrid(size, options.tileSize);
+    const bool findCorners = options.detector != BatchDetector::Lines;
+    const bool findLines = options.detector != BatchDetector::Corners;
+    const int cornerHalo = filterRadius + cornerFootprint + options.suppressionRadius;
+    const int lineHalo = filterRadius + options.lineHalo;
+    const int channels = source.getChannels();
+    const HarrisKernel harris(2, 3, 0.04);
+    tileCount = static_cast<int>(tiles.size());
+    halo = max(findCorners ? cornerHalo : 0, findLines ? lineHalo : 0);
+
+    // OpenCV's own threads would only compete with the tile workers
+    const int cvThreads = getNumThreads();
+    if (options.workers > 1 && tiles.size() > 1) {
+        setNumThreads(1);
+    }
+
+    vector<vector<Point>> tileCorners(tiles.size());
+    vector<vector<float>> tileScores(tiles.size());
+    vector<vector<Vec4i>> tileLines(tiles.size());
+
+    try {
+        // First pass: global response range over the tile cores
+        double minValue = 0.0, maxValue = 0.0;
+        if (findCorners) {
+            vector<double> tileMin(tiles.size(), DBL_MAX), tileMax(tiles.size(), -DBL_MAX);
+            forEachTile(tiles, [&](int index, PreprocessingPipeline& pipeline) {
+                TRACE_STAGE("harrisRange");
+                const Rect region = padded(tiles[index], cornerHalo, size);
+                PooledMat tile(region.height, region.width, CV_8UC(channels));
+                source.read(region, tile.get());
+                const Mat& gray = pipeline.run(tile.get());
+
+                PooledMat response(gray.rows, gray.cols, CV_32F);
+                harris.computeResponseRows(gray, 0, gray.rows, response.get());
+                minMaxLoc(response.get()(tiles[index] - region.tl()), &tileMin[index], &tileMax[index]);
+            });
+            minValue = *min_element(tileMin.begin(), tileMin.end());
+            maxValue = *max_element(tileMax.begin(), tileMax.end());
+        }
+
+        const float alpha = maxValue > minValue ? static_cast<float>(255.0 / (maxValue - minValue)) : 0.0f;
+        const float beta = static_cast<float>(-minValue * alpha);
+
+        // Second pass: thresholded corners and line segments of every tile core
+        forEachTile(tiles, [&](int index, PreprocessingPipeline& pipeline) {
+            TRACE_STAGE("tile");
+            const Rect& core = tiles[index];
+            const Rect region = padded(core, halo, size);
+            PooledMat tile(region.height, region.width, CV_8UC(channels));
+            source.read(region, tile.get());
+            const Mat& gray = pipeline.run(tile.get());
+
+            if (findCorners) {
+                // Response over the core and the corner halo only, normalized with the global range
+                const Rect area = padded(core, cornerHalo, size);
+                const Mat areaGray = gray(area - region.tl());
+                PooledMat responseBuffer(areaGray.rows, areaGray.cols, CV_32F);
+                Mat& normalized = responseBuffer.get();
+                harris.computeResponseRows(areaGray, 0, areaGray.rows, normalized);
+                normalized.convertTo(normalized, CV_32F, alpha, beta);
+
+                PooledMat localMaxBuffer;
+                Mat& localMax = localMaxBuffer.get();
+                if (options.suppressionRadius > 0) {
+                    int window = 2 * options.suppressionRadius + 1;
+                    dilate(normalized, localMaxBuffer.create(normalized.rows, normalized.cols, CV_32F), getStructuringElement(MORPH_RECT, Size(window, window)));
+                }
+
+                const Rect inner = core - area.tl();
+                for (int y = inner.y; y < inner.y + inner.height; y++) {
+                    const float* row = normalized.ptr<float>(y);
+                    const float* peak = options.suppressionRadius > 0 ? localMax.ptr<float>(y) : row;
+                    for (int x = inner.x; x < inner.x + inner.width; x++) {
+                        if ((int)row[x] > options.qualityLevel && row[x] >= peak[x]) {
+                            tileCorners[index].push_back(Point(x + area.x, y + area.y));
+                            tileScores[index].push_back(row[x]);
+                        }
+                    }
+                }
+            }
+
+            if (findLines) {
+                PooledVector<Vec4i> foundBuffer;
+                vector<Vec4i>& found = foundBuffer.get();
+                LineDetection::findSegments(gray, options.lineEngine, cannyLowThreshold, houghThreshold, minLineLength, maxLineGap, found);
+                for (const auto& segment : found) {
+                    const Vec4i global(segment[0] + region.x, segment[1] + region.y, segment[2] + region.x, segment[3] + region.y);
+                    if (core.contains(Point((global[0] + global[2]) / 2, (global[1] + global[3]) / 2))) {
+                        tileLines[index].push_back(global);
+                    }
+                }
+            }
+
+            traceStage.setCount(tileCorners[index].size() + tileLines[index].size());
+        });
+    }
+    catch (...) {
+        setNumThreads(cvThreads);
+        throw;
+    }
+    setNumThreads(cvThreads);
+
+    // Tile cores do not overlap, so merging only has to restore the raster order
+    vector<pair<Point, float>> merged;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        for (size_t i = 0; i < tileCorners[t].size(); i++) {
+            merged.push_back(make_pair(tileCorners[t][i], tileScores[t][i]));
+        }
+    }
+    sort(merged.begin(), merged.end(), [](const pair<Point, float>& a, const pair<Point, float>& b) {
+        return tie(a.first.y, a.first.x) < tie(b.first.y, b.first.x);
+    });
+
+    vector<float> scores;
+    corners.reserve(merged.size());
+    scores.reserve(merged.size());
+    for (const auto& corner : merged) {
+        corners.push_back(corner.first);
+        scores.push_back(corner.second);
+    }
+    if (options.gridCellSize > 0) {
+        CornerDetection::bucketCorners(corners, scores, options.gridCellSize, options.maxCornersPerCell);
+    }
+
+    for (const auto& found : tileLines) {
+        lines.insert(lines.end(), found.begin(), found.end());
+    }
+    if (findLines) {
+        TRACE_STAGE("stitch");
+        stitchSeams(lines, options.tileSize, size, halo + maxLineGap, maxLineGap);
+        if (options.mergeLines) {
+            SegmentMerger::merge(lines, options.mergeTolerances);
+        }
+        traceStage.setCount(lines.size());
+    }
+}
+
+/**
+ * @brief Merges collinear segment pieces that meet at a tile seam.
+ *
+ * Only segments near a seam are handed to SegmentMerger, whose union-find joins chains
+ * crossing several seams into one segment. A merged segment runs along the longest piece
+ * and spans the extreme projections of all piece endpoints.
+ *
+ * @param lines Segments to stitch in place; untouched segments keep their order.
+ * @param tileSize Tile width and height, seams lie on its multiples.
+ * @param imageSize Size of the tiled image.
+ * @param reach Distance from a seam within which segments are candidates.
+ * @param maxGap Largest gap bridged between two pieces.
+ */
+void TiledProcessor::stitchSeams(vector<Vec4i>& lines, int tileSize, Size imageSize, int reach, int maxGap) {
+    const int tilesX = (imageSize.width + tileSize - 1) / tileSize;
+    const int tilesY = (imageSize.height + tileSize - 1) / tileSize;
+
+    // A seam k * tileSize with 0 < k < tiles lies within reach of the extent [low, high]
+    auto nearSeam = [&](int low, int high, int tiles) {
+        const int first = low - reach;
+        const int k = first <= tileSize ? 1 : (first + tileSize - 1) / tileSize;
+        return k < tiles && k * tileSize <= high + reach;
+    };
+
+    vector<int> candidates;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const Vec4i& l = lines[i];
+        if (nearSeam(min(l[0], l[2]), max(l[0], l[2]), tilesX) || nearSeam(min(l[1], l[3]), max(l[1], l[3]), tilesY)) {
+            candidates.push_back(static_cast<int>(i));
+        }
+    }
+    if (candidates.size() < 2) {
+        return;
+    }
+
+    MergeTolerances tolerances;
+    tolerances.angle = stitchAngle;
+    tolerances.distance = stitchDistance;
+    tolerances.maxGap = maxGap;
+    SegmentMerger::merge(lines, candidates, tolerances);
+}
+
+/**
+ * @brief Runs a task for every tile on the worker threads.
+ *
+ * Workers pull tile indices from a shared counter, so uneven tiles balance out. After a
+ * failure no further tiles are handed out and the first exception is rethrown once all
+ * workers have stopped.
+ *
+ * @param tiles The tile cores.
+ * @param task Called with the tile index and the worker's pipeline.
+ */
+void TiledProcessor::forEachTile(const vector<Rect>& tiles, const function<void(int, PreprocessingPipeline&)>& task) {
+    const int count = static_cast<int>(tiles.size());
+    atomic<int> nextTile(0);
+    exception_ptr failure;
+    mutex failureMutex;
+
+    auto workerLoop = [&]() {
+        PreprocessingPipeline pipeline = preprocessing;
+        int index;
+        while ((index = nextTile++) < count) {
+            try {
+                task(index, pipeline);
+                Profiler::tick();
+            }
+            catch (...) {
+                lock_guard<mutex> lock(failureMutex);
+                if (!failure) {
+                    failure = current_exception();
+                }
+                nextTile = count;
+            }
+        }
+    };
+
+    const int workerCount = min(options.workers, count);
+    vector<thread> workers;
+    workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(workerLoop);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (failure) {
+        rethrow_exception(failure);
+    }
+}
+
+/**
+ * @brief Builds the preprocessing pipeline from the options.
+ *
+ * Tiles are detected at full resolution, so rescale stages are rejected; coordinates would
+ * otherwise not stitch. The recursive Gaussian is rejected as well, its footprint exceeds
+ * any halo.
+ *
+ * @return The validated pipeline, starting with grayscale conversion.
+ */
+PreprocessingPipeline TiledProcessor::buildPipeline(void) const {
+    PreprocessingPipeline pipeline;
+    if (!options.pipeline.empty()) {
+        if (options.filter != BatchFilter::None || options.filterSize > 0 || options.filterBackend != FilterBackend::Auto) {
+            throw invalid_argument("--pipeline replaces the --filter options, use only one of them");
+        }
+        pipeline = PreprocessingPipeline::parse(options.pipeline);
+        if (pipeline.getSteps().empty() || pipeline.getSteps().front().stage != PreprocessStage::Grayscale) {
+            throw invalid_argument("Tiled preprocessing pipeline must start with grayscale");
+        }
+    }
+    else {
+        pipeline.grayscale();
+        if (options.filter == BatchFilter::Gaussian) {
+            pipeline.gaussian(options.filterSize > 0 ? options.filterSize : 3, options.filterBackend);
+        }
+        else if (options.filter == BatchFilter::Median) {
+            pipeline.median(options.filterSize > 0 ? options.filterSize : 11, options.filterBackend);
+        }
+    }
+
+    for (const auto& step : pipeline.getSteps()) {
+        if (step.stage == PreprocessStage::Rescale) {
+            throw invalid_argument("Tiled processing runs at full resolution, the pipeline cannot rescale");
+        }
+        if (step.backend == FilterBackend::Recursive) {
+            // Its response never reaches zero, so no halo makes tiles match the full frame
+            throw invalid_argument("Tiled processing needs filters of finite extent, the recursive Gaussian is not supported");
+        }
+    }
+    return pipeline;
+}
+
+/**
+ * @brief Builds the output file name for the input image.
+ *
+ * @param suffix The suffix appended to the image stem.
+ * @return The output file path inside the output directory.
+ */
+string TiledProcessor::outputPathFor(const string& suffix) const {
+    size_t slash = options.input.find_last_of("/\\");
+    string stem = slash == string::npos ? options.input : options.input.substr(slash + 1);
+    size_t dot = stem.find_last_of('.');
+    if (dot != string::npos) {
+        stem = stem.substr(0, dot);
+    }
+
+    return options.outputDirectory + "/" + stem + suffix;
+}
+
+/**
+ * @brief Gets the number of tiles of the last run.
+ *
+ * @return The tile count.
+ */
+int TiledProcessor::getTileCount(void) const {
+    return tileCount;
+}
+
+/**
+ * @brief Gets the halo used by the last run.
+ *
+ * @return Margin read around every tile core in pixels.
+ */
+int TiledProcessor::getHalo(void) const {
+    return halo;
+}
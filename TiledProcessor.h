@@ -0,0 +1,115 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include "BatchProcessor.h"
+#include "PreprocessingPipeline.h"
+#include "TileSource.h"
+
+using namespace std;
+using namespace cv;
+
+/// Options for a tiled run over one very large image
+struct TiledOptions {
+    string input;                           ///< Image to process, binary PNM files are memory mapped
+    string outputDirectory = ".";           ///< Directory receiving the feature files
+    BatchDetector detector = BatchDetector::Corners; ///< Detectors to run
+    BatchFilter filter = BatchFilter::None; ///< Noise filter applied after grayscale conversion
+    int filterSize = 0;                     ///< Filter aperture, 0 keeps the filter default (Gaussian 3, median 11)
+    FilterBackend filterBackend = FilterBackend::Auto; ///< Filter implementation
+    string pipeline;                        ///< Preprocessing stages for PreprocessingPipeline::parse, empty builds them from filter
+    int tileSize = 2048;                    ///< Width and height of a tile without its halo
+    int lineHalo = 32;                      ///< Extra margin around every tile for line detection
+    LineEngine lineEngine = LineEngine::Hough; ///< Line segment implementation
+    bool mergeLines = false;                ///< Merge collinear fragments and near-duplicate segments
+    MergeTolerances mergeTolerances;        ///< Tolerances of the segment merge
+    int workers = 1;                        ///< Number of worker threads, each holding one tile at a time
+    int qualityLevel = 50;                  ///< Harris quality level for corner detection
+    int suppressionRadius = 0;              ///< Corner non-maximum suppression radius, 0 disables it
+    int gridCellSize = 0;                   ///< Corner bucketing cell size, 0 disables it
+    int maxCornersPerCell = 4;              ///< Corners kept per bucketing cell
+    bool binaryOutput = false;              ///< Write binary feature files (.feat) instead of text
+    string traceFile;                       ///< Chrome trace of all stages, empty disables it
+    double profileInterval = 0.0;           ///< Seconds between stage summary lines, 0 disables them
+};
+
+/// TiledProcessor Class
+/// Runs corner and/or line detection on an image too large for full-frame processing.
+/// The image is cut into square tiles, each read together with a halo wide enough for the
+/// filter, Sobel, structure tensor and suppression footprints, so every pixel of a tile core
+/// sees the same neighborhood as in a full-frame run. Tiles are processed in parallel and
+/// each worker holds a single tile, so peak memory follows the tile size and worker count,
+/// not the image size. Corners are only reported from tile cores and therefore never twice;
+/// the Harris threshold uses the global response range found by a first pass over the
+/// tiles. Line segments are kept by the tile holding their midpoint and pieces of one line
+/// that meet at a tile seam are stitched back together.
+class TiledProcessor {
+public:
+    /// Constructor
+    /// @param options The tiled run configuration.
+    explicit TiledProcessor(const TiledOptions& options);
+
+    /// Destructor
+    ~TiledProcessor();
+
+    /// Build tiled options from command line arguments
+    /// @param argc Argument count as received by main.
+    /// @param argv Argument values as received by main.
+    /// @return The parsed options.
+    static TiledOptions parseArguments(int argc, char** argv);
+
+    /// Print command line usage to the console
+    static void printUsage(void);
+
+    /// Detect the features of the input image and save them
+    /// @return The number of tiles processed.
+    int run(void);
+
+    /// Detect the features of an image tile by tile
+    /// @param source The image.
+    /// @param corners Output corners in image coordinates, raster order.
+    /// @param lines Output line segments in image coordinates.
+    void detect(const TileSource& source, vector<Point>& corners, vector<Vec4i>& lines);
+
+    /// Merge collinear segment pieces that meet at a tile seam
+    /// Only segments reaching within reach pixels of a seam are considered; two of them are
+    /// merged when their directions differ by less than two degrees, both lie within two
+    /// pixels of each other's line and their extents overlap or leave a gap of at most maxGap.
+    /// @param lines Segments to stitch in place.
+    /// @param tileSize Tile width and height, seams lie on its multiples.
+    /// @param imageSize Size of the tiled image.
+    /// @param reach Distance from a seam within which segments are candidates.
+    /// @param maxGap Largest gap bridged between two pieces.
+    static void stitchSeams(vector<Vec4i>& lines, int tileSize, Size imageSize, int reach, int maxGap);
+
+    /// Get the number of tiles of the last run
+    /// @return The tile count.
+    int getTileCount(void) const;
+
+    /// Get the halo used by the last run
+    /// @return Margin read around every tile core in pixels.
+    int getHalo(void) const;
+
+private:
+    /// Run a task for every tile on the worker threads
+    /// Every worker owns a copy of the preprocessing pipeline; the first exception is rethrown.
+    /// @param tiles The tile cores.
+    /// @param task Called with the tile index and the worker's pipeline.
+    void forEachTile(const vector<Rect>& tiles, const function<void(int, PreprocessingPipeline&)>& task);
+
+    /// Build the preprocessing pipeline from the options
+    /// @return The validated pipeline, starting with grayscale conversion and without rescaling.
+    PreprocessingPipeline buildPipeline(void) const;
+
+    /// Build the output file name for the input image
+    /// @param suffix The suffix appended to the image stem.
+    /// @return The output file path.
+    string outputPathFor(const string& suffix) const;
+
+    TiledOptions options;                   ///< Tiled run configuration
+    PreprocessingPipeline preprocessing;    ///< Validated preprocessing stages, copied by every worker
+    int filterRadius;                       ///< Combined radius of the preprocessing filters
+    int tileCount;                          ///< Tiles of the last run
+    int halo;                               ///< Margin read around every tile core by the last run
+};
@@ -11,6 +11,10 @@
  * - **Corner Detection**: Implements Harris corner detection using OpenCV functions like `cornerHarris` and `normalize`.
  * - **Inheritance and Polymorphism**: Demonstrates OOP concepts with a base class `Detection` and derived classes `LineDetection` and `CornerDetection`.
  * - **Dynamic Feature Adjustment**: Allows real-time tuning of detection thresholds for both line and corner detection.
+ * - **Headless Batch Mode**: Runs detection over whole directories on a pool of worker threads (`--batch`).
+ * - **Stream Mode**: Tracks corners through video files and image sequences with optical flow (`--stream`).
+ * - **Benchmarks**: Times every detection stage on synthetic and bundled images (`--bench`).
+ * - **Tiled Mode**: Detects features in gigapixel images tile by tile with bounded memory (`--tiled`).
  *
  * Technologies used:
  * - **OpenCV**: For advanced image processing and feature detection.
@@ -31,6 +35,10 @@
 #include "CommonProcesses.h"
 #include "LineDetection.h"
 #include "CornerDetection.h"
+#include "BatchProcessor.h"
+#include "StreamProcessor.h"
+#include "BenchmarkSuite.h"
+#include "TiledProcessor.h"
 
 /* *******************************************************
  * Filename		:	main.cpp
@@ -42,9 +50,57 @@
 using namespace cv;
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {   
     try {
+        /// Headless batch mode when command line arguments are given
+        if (argc > 1)
+        {
+            if (string(argv[1]) == "--help")
+            {
+                BatchProcessor::printUsage();
+                StreamProcessor::printUsage();
+                BenchmarkSuite::printUsage();
+                TiledProcessor::printUsage();
+                return 0;
+            }
+
+            if (string(argv[1]) == "--bench")
+            {
+                BenchmarkSuite benchmarkSuite(BenchmarkSuite::parseArguments(argc, argv));
+                benchmarkSuite.run();
+                return 0;
+            }
+
+            if (string(argv[1]) == "--tiled")
+            {
+                TiledProcessor tiledProcessor(TiledProcessor::parseArguments(argc, argv));
+                tiledProcessor.run();
+                return 0;
+            }
+
+            if (string(argv[1]) == "--stream")
+            {
+                StreamProcessor streamProcessor(StreamProcessor::parseArguments(argc, argv));
+                streamProcessor.run();
+                return 0;
+            }
+
+            if (string(argv[1]) == "--convert" && argc == 4)
+            {
+                string input = argv[2];
+                bool textInput = input.size() >= 4 && input.compare(input.size() - 4, 4, ".txt") == 0;
+                if (textInput)
+                    FeatureFile::textToBinary(input, argv[3]);
+                else
+                    FeatureFile::binaryToText(input, argv[3]);
+                return 0;
+            }
+
+            BatchProcessor batchProcessor(BatchProcessor::parseArguments(argc, argv));
+            return batchProcessor.run() == 0 ? 0 : 1;
+        }
+
         /// Promt Values (From User)
        string filePath = "C:/Users/doguk/OneDrive/Pictures/Ekran Grntleri/test2.jpg";
         //string filePath = "C:/Users/doguk/source/repos/openCV/openCV/resim.png";
@@ -64,6 +120,7 @@ int main()
     /// Exception Handler
     catch (const std::exception& e) {
         cerr << "Error : " << e.what() << std::endl;
+        return 1;
     }
 
     return 0;